@@ -561,37 +561,39 @@ static void ParseBuffer(Session *session)
 }
 
 /**
-**  Parse all session buffers
+**  Parse the complete messages of a session buffer
+**
+**  @param session  Session which received data
 */
-int UpdateParser(void)
+void ParseSession(Session *session)
 {
-	Session *session;
-	int len;
 	char *next;
+	int len;
 
-	if (!Pool || !Pool->First) {
-		// No connections
-		return 0;
-	}
-
-	for (session = Pool->First; session; session = session->Next) {
-		// Confirm full message.
-		while ((next = strpbrk(session->Buffer, "\r\n"))) {
-			*next++ = '\0';
-			if (*next == '\r' || *next == '\n') {
-				++next;
-			}
-
-			ParseBuffer(session);
-
-			// Remove parsed message
-			len = next - session->Buffer;
-			memmove(session->Buffer, next, sizeof(session->Buffer) - len);
-			session->Buffer[sizeof(session->Buffer) - len] = '\0';
+	// Confirm full message.
+	while ((next = strpbrk(session->Buffer, "\r\n"))) {
+		*next++ = '\0';
+		if (*next == '\r' || *next == '\n') {
+			++next;
 		}
 
+		ParseBuffer(session);
+
+		// Remove parsed message
+		len = next - session->Buffer;
+		memmove(session->Buffer, next, sizeof(session->Buffer) - len);
+		session->Buffer[sizeof(session->Buffer) - len] = '\0';
 	}
+}
 
+/**
+**  Parse the received UDP data
+**
+**  The session buffers are parsed by the network driver as soon as
+**  their data is received.
+*/
+int UpdateParser(void)
+{
 	if (strlen(UDPBuffer)) {
 		// If this is a server, we'll note its external data. When clients join,
 		// they'll receive this as part of the TCP response that they
@@ -36,6 +36,9 @@
 --  Declarations
 ----------------------------------------------------------------------------*/
 
+class Session;
+
+extern void ParseSession(Session *session);
 extern int UpdateParser(void);
 
 //@}
@@ -37,17 +37,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL.h"
 
 #include "stratagus.h"
 #include "sqlite3.h"
 #include "games.h"
+#include "netdriver.h"
 
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
 
+#define DB_WRITE_PERIOD 1000 // MS between two transactions of the writer
+#define DB_CACHED_USERS 10000 // Max number of passwords kept in memory
+
 static const char *dbfile = "metaserver.db";
-static sqlite3 *DB;
+static sqlite3 *DB;                     /// Connection of the main thread
+static sqlite3_stmt *FindUserStmt;      /// Password of a user
+static sqlite3_stmt *StatsStmt;         /// Count the games since a date
 
 #define SQLCreatePlayersTable \
 	"CREATE TABLE players (" \
@@ -103,10 +116,404 @@ static sqlite3 *DB;
 	SQLCreatePlayersTable SQLCreateGamesTable SQLCreateGameDataTable \
 	SQLCreateRankingsTable SQLCreateMapsTable
 
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Passwords of the users already found, so the logins do not query the
+**  database. Past DB_CACHED_USERS, the least recently used user is dropped.
+*/
+class PasswordCache
+{
+public:
+	const std::string *Find(const std::string &username);
+	void Insert(const std::string &username, const std::string &password);
+	void Clear();
+
+private:
+	typedef std::list<std::pair<std::string, std::string> > UserList;
+
+	UserList Users;                                            /// Most recently used first
+	std::unordered_map<std::string, UserList::iterator> Index; /// Users by name
+};
+
+static PasswordCache Passwords;
+
+/**
+**  Background writer of the new users, the login dates and the game records.
+**
+**  The main thread only queues the writes. The writer thread has its own
+**  connection and writes all the queued records of a period in one
+**  transaction, so a registration, a login or a game creation does not
+**  wait for the disk.
+*/
+class DBWriter
+{
+public:
+	DBWriter() : Thread(NULL), Lock(NULL), Cond(NULL), Quit(false), DB(NULL),
+		AddUserStmt(NULL), UpdateLoginStmt(NULL), AddGameStmt(NULL) {}
+
+	int Start(const char *file);
+	void Stop();
+
+	void AddUser(const char *username, const char *password, int date);
+	bool FindNewUser(const char *username, std::string &password);
+	void UpdateLoginDate(const char *username, int date);
+	void AddGame(int id, int date, const char *description, const char *mapname, int slots);
+
+private:
+	/// User waiting to be written
+	struct UserRecord {
+		std::string Password;
+		int Date;
+	};
+
+	/// Game record waiting to be written
+	struct GameRecord {
+		int ID;
+		int Date;
+		std::string Description;
+		std::string MapName;
+		int Slots;
+	};
+
+	static int ThreadFunc(void *writer);
+	void Run();
+	void Write(const std::map<std::string, UserRecord> &users,
+		const std::map<std::string, int> &logins, const std::vector<GameRecord> &games);
+
+	SDL_Thread *Thread;
+	SDL_mutex *Lock;                        /// Protects the queues and Quit
+	SDL_cond *Cond;                         /// Signaled to stop the thread
+	bool Quit;                              /// Stop after the last write
+	std::map<std::string, UserRecord> NewUsers; /// Users until they are written
+	std::map<std::string, int> LoginDates;  /// Last login date of the users
+	std::vector<GameRecord> Games;          /// New games
+	sqlite3 *DB;                            /// Connection of the writer thread
+	sqlite3_stmt *AddUserStmt;
+	sqlite3_stmt *UpdateLoginStmt;
+	sqlite3_stmt *AddGameStmt;
+};
+
+static DBWriter Writer;
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Execute SQL statements without parameters
+**
+**  @return  0 for success, non-zero for failure
+*/
+static int DBExec(sqlite3 *db, const char *sql,
+	int (*callback)(void *, int, char **, char **) = NULL, void *data = NULL)
+{
+	char *errmsg = NULL;
+
+	if (sqlite3_exec(db, sql, callback, data, &errmsg) != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", errmsg);
+		sqlite3_free(errmsg);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+**  Compile a statement, kept for the life of the connection
+**
+**  @return  The statement, NULL for failure
+*/
+static sqlite3_stmt *DBPrepare(sqlite3 *db, const char *sql)
+{
+	sqlite3_stmt *stmt = NULL;
+
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s: %s\n", sqlite3_errmsg(db), sql);
+		return NULL;
+	}
+	return stmt;
+}
+
+/**
+**  Run a statement which returns no row, and reset it for the next use
+**
+**  @return  0 for success, non-zero for failure
+*/
+static int DBStep(sqlite3 *db, sqlite3_stmt *stmt)
+{
+	const int result = sqlite3_step(stmt);
+
+	if (result != SQLITE_DONE) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+	}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return result == SQLITE_DONE ? 0 : -1;
+}
+
+/**
+**  Open a connection to the database
+**
+**  The journal is a write-ahead log: the readers do not wait for the
+**  writer, and a commit does not sync the disk.
+**
+**  @return  0 for success, non-zero for failure
+*/
+static int DBOpen(const char *file, sqlite3 **db)
+{
+	if (sqlite3_open(file, db) != SQLITE_OK) {
+		fprintf(stderr, "ERROR: sqlite3_open failed: %s\n", sqlite3_errmsg(*db));
+		return -1;
+	}
+	sqlite3_busy_timeout(*db, 2000);
+	return DBExec(*db, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;");
+}
+
+/**
+**  Find the password of a user, and mark it as the most recently used
+**
+**  @return  The password, NULL if the user is not cached
+*/
+const std::string *PasswordCache::Find(const std::string &username)
+{
+	std::unordered_map<std::string, UserList::iterator>::const_iterator it = Index.find(username);
+	if (it == Index.end()) {
+		return NULL;
+	}
+	Users.splice(Users.begin(), Users, it->second);
+	return &it->second->second;
+}
+
+/**
+**  Cache the password of a user, drop the least recently used user if full
+*/
+void PasswordCache::Insert(const std::string &username, const std::string &password)
+{
+	std::unordered_map<std::string, UserList::iterator>::iterator it = Index.find(username);
+	if (it != Index.end()) {
+		it->second->second = password;
+		Users.splice(Users.begin(), Users, it->second);
+		return;
+	}
+	Users.push_front(std::make_pair(username, password));
+	Index[username] = Users.begin();
+	if (Users.size() > DB_CACHED_USERS) {
+		Index.erase(Users.back().first);
+		Users.pop_back();
+	}
+}
+
+void PasswordCache::Clear()
+{
+	Users.clear();
+	Index.clear();
+}
+
+/**
+**  Open the connection of the writer and start its thread
+**
+**  @param file  Database file
+**
+**  @return      0 for success, non-zero for failure
+*/
+int DBWriter::Start(const char *file)
+{
+	if (DBOpen(file, &DB)) {
+		return -1;
+	}
+	AddUserStmt = DBPrepare(DB, "INSERT INTO players VALUES(?, ?, ?, ?);");
+	UpdateLoginStmt = DBPrepare(DB, "UPDATE players SET last_login_date = ? WHERE username = ?;");
+	AddGameStmt = DBPrepare(DB, "INSERT INTO games VALUES(?, ?, ?, ?, ?);");
+	if (!AddUserStmt || !UpdateLoginStmt || !AddGameStmt) {
+		return -1;
+	}
+
+	Quit = false;
+	Lock = SDL_CreateMutex();
+	Cond = SDL_CreateCond();
+	Thread = SDL_CreateThread(ThreadFunc, this);
+	if (!Thread) {
+		fprintf(stderr, "ERROR: cannot start the database writer: %s\n", SDL_GetError());
+		return -1;
+	}
+	return 0;
+}
+
+/**
+**  Write the last queued records and stop the writer
+*/
+void DBWriter::Stop()
+{
+	if (Thread) {
+		SDL_LockMutex(Lock);
+		Quit = true;
+		SDL_CondSignal(Cond);
+		SDL_UnlockMutex(Lock);
+		SDL_WaitThread(Thread, NULL);
+		Thread = NULL;
+	}
+	if (Cond) {
+		SDL_DestroyCond(Cond);
+		Cond = NULL;
+	}
+	if (Lock) {
+		SDL_DestroyMutex(Lock);
+		Lock = NULL;
+	}
+	sqlite3_finalize(AddUserStmt);
+	sqlite3_finalize(UpdateLoginStmt);
+	sqlite3_finalize(AddGameStmt);
+	AddUserStmt = UpdateLoginStmt = AddGameStmt = NULL;
+	NewUsers.clear();
+	if (DB) {
+		sqlite3_close(DB);
+		DB = NULL;
+	}
+}
+
+/**
+**  Queue a new user
+**
+**  The user stays in the queue until it is written, so it can be found.
+*/
+void DBWriter::AddUser(const char *username, const char *password, int date)
+{
+	UserRecord user;
+
+	user.Password = password;
+	user.Date = date;
+
+	SDL_LockMutex(Lock);
+	NewUsers[username] = user;
+	SDL_UnlockMutex(Lock);
+}
+
+/**
+**  Find a user which is not written yet
+**
+**  @return  true if the user is queued, with its password
+*/
+bool DBWriter::FindNewUser(const char *username, std::string &password)
+{
+	SDL_LockMutex(Lock);
+	std::map<std::string, UserRecord>::const_iterator it = NewUsers.find(username);
+	const bool found = it != NewUsers.end();
+	if (found) {
+		password = it->second.Password;
+	}
+	SDL_UnlockMutex(Lock);
+	return found;
+}
+
+/**
+**  Queue the login date of a user
+*/
+void DBWriter::UpdateLoginDate(const char *username, int date)
+{
+	SDL_LockMutex(Lock);
+	// Only the last login of a period is written
+	LoginDates[username] = date;
+	SDL_UnlockMutex(Lock);
+}
+
+/**
+**  Queue a new game
+*/
+void DBWriter::AddGame(int id, int date, const char *description, const char *mapname, int slots)
+{
+	GameRecord game;
+
+	game.ID = id;
+	game.Date = date;
+	game.Description = description;
+	game.MapName = mapname;
+	game.Slots = slots;
+
+	SDL_LockMutex(Lock);
+	Games.push_back(game);
+	SDL_UnlockMutex(Lock);
+}
+
+int DBWriter::ThreadFunc(void *writer)
+{
+	static_cast<DBWriter *>(writer)->Run();
+	return 0;
+}
+
+/**
+**  Writer thread: write the queued records every period, until stopped
+*/
+void DBWriter::Run()
+{
+	std::map<std::string, UserRecord> users;
+	std::map<std::string, int> logins;
+	std::vector<GameRecord> games;
+
+	SDL_LockMutex(Lock);
+	for (;;) {
+		if (!Quit) {
+			SDL_CondWaitTimeout(Cond, Lock, DB_WRITE_PERIOD);
+		}
+		const bool quit = Quit;
+		users = NewUsers;
+		logins.swap(LoginDates);
+		games.swap(Games);
+		SDL_UnlockMutex(Lock);
+
+		Write(users, logins, games);
+		logins.clear();
+		games.clear();
+
+		// The written users are found in the database from now on
+		SDL_LockMutex(Lock);
+		for (std::map<std::string, UserRecord>::const_iterator it = users.begin(); it != users.end(); ++it) {
+			NewUsers.erase(it->first);
+		}
+		users.clear();
+		if (quit) {
+			SDL_UnlockMutex(Lock);
+			return;
+		}
+	}
+}
+
+/**
+**  Write records in one transaction, the users first for their logins
+*/
+void DBWriter::Write(const std::map<std::string, UserRecord> &users,
+	const std::map<std::string, int> &logins, const std::vector<GameRecord> &games)
+{
+	if (users.empty() && logins.empty() && games.empty()) {
+		return;
+	}
+	if (DBExec(DB, "BEGIN;")) {
+		return;
+	}
+	for (std::map<std::string, UserRecord>::const_iterator it = users.begin(); it != users.end(); ++it) {
+		sqlite3_bind_text(AddUserStmt, 1, it->first.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_text(AddUserStmt, 2, it->second.Password.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_int(AddUserStmt, 3, it->second.Date);
+		sqlite3_bind_int(AddUserStmt, 4, it->second.Date);
+		DBStep(DB, AddUserStmt);
+	}
+	for (std::map<std::string, int>::const_iterator it = logins.begin(); it != logins.end(); ++it) {
+		sqlite3_bind_int(UpdateLoginStmt, 1, it->second);
+		sqlite3_bind_text(UpdateLoginStmt, 2, it->first.c_str(), -1, SQLITE_STATIC);
+		DBStep(DB, UpdateLoginStmt);
+	}
+	for (size_t i = 0; i < games.size(); ++i) {
+		sqlite3_bind_int(AddGameStmt, 1, games[i].ID);
+		sqlite3_bind_int(AddGameStmt, 2, games[i].Date);
+		sqlite3_bind_text(AddGameStmt, 3, games[i].Description.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_text(AddGameStmt, 4, games[i].MapName.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_int(AddGameStmt, 5, games[i].Slots);
+		DBStep(DB, AddGameStmt);
+	}
+	DBExec(DB, "COMMIT;");
+}
+
 /**
 **  Max id callback
 */
@@ -129,7 +536,6 @@ int DBInit(void)
 {
 	FILE *fd;
 	int doinit;
-	char *errmsg;
 
 	// Check if this is the first time running
 	doinit = 0;
@@ -139,28 +545,25 @@ int DBInit(void)
 		doinit = 1;
 	}
 
-	if (sqlite3_open(dbfile, &DB) != SQLITE_OK) {
-		fprintf(stderr, "ERROR: sqlite3_open failed: %s\n", sqlite3_errmsg(DB));
+	if (DBOpen(dbfile, &DB)) {
 		return -1;
 	}
 
-	if (doinit) {
-		errmsg = NULL;
-		if (sqlite3_exec(DB, SQLCreateTables, NULL, NULL, &errmsg) != SQLITE_OK) {
-			fprintf(stderr, "SQL error: %s\n", errmsg);
-			sqlite3_free(errmsg);
-			return -1;
-		}
+	if (doinit && DBExec(DB, SQLCreateTables)) {
+		return -1;
 	}
 
-	errmsg = NULL;
-	if (sqlite3_exec(DB, "SELECT MAX(id) FROM games;", DBMaxIDCallback, NULL, &errmsg) != SQLITE_OK) {
-		fprintf(stderr, "SQL error: %s\n", errmsg);
-		sqlite3_free(errmsg);
+	if (DBExec(DB, "SELECT MAX(id) FROM games;", DBMaxIDCallback)) {
 		return -1;
 	}
 
-	return 0;
+	FindUserStmt = DBPrepare(DB, "SELECT password FROM players WHERE username = ?;");
+	StatsStmt = DBPrepare(DB, "SELECT COUNT(id) FROM games WHERE date > ?;");
+	if (!FindUserStmt || !StatsStmt) {
+		return -1;
+	}
+
+	return Writer.Start(dbfile);
 }
 
 /**
@@ -168,17 +571,13 @@ int DBInit(void)
 */
 void DBQuit(void)
 {
+	Writer.Stop();
+	sqlite3_finalize(FindUserStmt);
+	sqlite3_finalize(StatsStmt);
+	FindUserStmt = StatsStmt = NULL;
 	sqlite3_close(DB);
-}
-
-/**
-**  Find user callback
-*/
-static int DBFindUserCallback(void *password, int argc, char **argv, char **colname)
-{
-	Assert(argc == 1);
-	strcpy((char *)password, argv[0]);
-	return 0;
+	DB = NULL;
+	Passwords.Clear();
 }
 
 /**
@@ -191,22 +590,33 @@ static int DBFindUserCallback(void *password, int argc, char **argv, char **coln
 */
 int DBFindUser(char *username, char *password)
 {
-	char buf[1024];
-	char *errmsg;
-
 	password[0] = '\0';
-	if (strchr(username, '\'')) {
-		return 0;
+
+	const std::string *cached = Passwords.Find(username);
+	if (cached) {
+		strcpy(password, cached->c_str());
+		return 1;
+	}
+	std::string newPassword;
+	if (Writer.FindNewUser(username, newPassword)) {
+		strcpy(password, newPassword.c_str());
+		Passwords.Insert(username, password);
+		return 1;
 	}
 
-	sprintf(buf, "SELECT password FROM players WHERE username = '%s';", username);
-	if (sqlite3_exec(DB, buf, DBFindUserCallback, password, &errmsg) != SQLITE_OK) {
-		fprintf(stderr, "SQL error: %s\n", errmsg);
-		sqlite3_free(errmsg);
-		return 0;
+	sqlite3_bind_text(FindUserStmt, 1, username, -1, SQLITE_STATIC);
+	if (sqlite3_step(FindUserStmt) == SQLITE_ROW) {
+		const char *text = (const char *)sqlite3_column_text(FindUserStmt, 0);
+		if (text) {
+			strncpy(password, text, MAX_PASSWORD_LENGTH);
+			password[MAX_PASSWORD_LENGTH] = '\0';
+		}
 	}
+	sqlite3_reset(FindUserStmt);
+	sqlite3_clear_bindings(FindUserStmt);
 
 	if (password[0]) {
+		Passwords.Insert(username, password);
 		return 1;
 	}
 	return 0;
@@ -215,6 +625,9 @@ int DBFindUser(char *username, char *password)
 /**
 **  Add a user
 **
+**  The user is queued for the writer. A failure of the write is only
+**  printed, the registration is already accepted.
+**
 **  @param username  User name
 **  @param password  Password
 **
@@ -222,18 +635,8 @@ int DBFindUser(char *username, char *password)
 */
 int DBAddUser(char *username, char *password)
 {
-	char buf[1024];
-	int t;
-	char *errmsg;
-
-	t = (int)time(0);
-	sprintf(buf, "INSERT INTO players VALUES('%s', '%s', %d, %d);",
-		username, password, t, t);
-	if (sqlite3_exec(DB, buf, NULL, NULL, &errmsg) != SQLITE_OK) {
-		fprintf(stderr, "SQL error: %s\n", errmsg);
-		sqlite3_free(errmsg);
-		return -1;
-	}
+	Writer.AddUser(username, password, (int)time(0));
+	Passwords.Insert(username, password);
 	return 0;
 }
 
@@ -246,58 +649,111 @@ int DBAddUser(char *username, char *password)
 */
 int DBUpdateLoginDate(char *username)
 {
-	char buf[1024];
-	int t;
-	char *errmsg;
-
-	t = (int)time(0);
-	sprintf(buf, "UPDATE players SET last_login_date = %d WHERE username = '%s'",
-		t, username);
-	if (sqlite3_exec(DB, buf, NULL, NULL, &errmsg) != SQLITE_OK) {
-		fprintf(stderr, "SQL error: %s\n", errmsg);
-		sqlite3_free(errmsg);
-		return -1;
-	}
+	Writer.UpdateLoginDate(username, (int)time(0));
 	return 0;
 }
 
 int DBAddGame(int id, char *description, char *mapname, int numplayers)
 {
-	char buf[1024];
-	int t;
-	char *errmsg;
+	Writer.AddGame(id, (int)time(0), description, mapname, numplayers);
+	return 0;
+}
 
-	t = (int)time(0);
-	sprintf(buf, "INSERT INTO games VALUES(%d, %d, '%s', '%s', %d);",
-			id, t, description, mapname, numplayers);
-	if (sqlite3_exec(DB, buf, NULL, NULL, &errmsg) != SQLITE_OK) {
-		fprintf(stderr, "SQL error: %s\n", errmsg);
-		sqlite3_free(errmsg);
-		return -1;
+/**
+**  Count the games created since a date
+**
+**  The games of the current period of the writer are not counted yet.
+*/
+int DBStats(char* resultbuf, int start_time)
+{
+	int result = -1;
+
+	sqlite3_bind_int(StatsStmt, 1, start_time);
+	if (sqlite3_step(StatsStmt) == SQLITE_ROW) {
+		sprintf(resultbuf, "%d", sqlite3_column_int(StatsStmt, 0));
+		result = 0;
+	} else {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(DB));
 	}
-	return 0;
+	sqlite3_reset(StatsStmt);
+	sqlite3_clear_bindings(StatsStmt);
+	return result;
 }
 
-static int DBStatsCallback(void *resultbuf, int argc, char **argv, char **colname)
+/**
+**  Find user callback
+*/
+static int DBFindUserCallback(void *password, int argc, char **argv, char **colname)
 {
 	Assert(argc == 1);
-	strcpy((char *)resultbuf, argv[0]);
+	strcpy((char *)password, argv[0]);
 	return 0;
 }
 
-
-int DBStats(char* resultbuf, int start_time)
+/**
+**  Measure the logins per second, with the queries formatted and run one
+**  by one, then with the prepared statements, the cache and the writer.
+**
+**  @param logins  Number of logins, of 1000 different users
+**
+**  @return        0 for success, non-zero for failure
+*/
+int DBBenchmark(int logins)
 {
+	const char *benchfile = "metaserver-bench.db";
+	const int users = logins < 1000 ? logins : 1000;
 	char buf[1024];
-	int t;
-	char *errmsg;
+	char password[MAX_PASSWORD_LENGTH + 1];
+	sqlite3 *db;
 
-	t = (int)time(0);
-	sprintf(buf, "SELECT COUNT(id) FROM games WHERE date > %d;", start_time);
-	if (sqlite3_exec(DB, buf, DBStatsCallback, resultbuf, &errmsg) != SQLITE_OK) {
-		fprintf(stderr, "SQL error: %s\n", errmsg);
-		sqlite3_free(errmsg);
+	remove(benchfile);
+	if (sqlite3_open(benchfile, &db) != SQLITE_OK || DBExec(db, SQLCreateTables)
+		|| DBExec(db, "BEGIN;")) {
 		return -1;
 	}
+	for (int i = 0; i < users; ++i) {
+		sprintf(buf, "INSERT INTO players VALUES('user%d', 'password', 0, 0);", i);
+		DBExec(db, buf);
+	}
+	DBExec(db, "COMMIT;");
+
+	// Each login is parsed and the login date is synced at once
+	Uint32 ticks = SDL_GetTicks();
+	for (int i = 0; i < logins; ++i) {
+		sprintf(buf, "SELECT password FROM players WHERE username = 'user%d';", i % users);
+		DBExec(db, buf, DBFindUserCallback, password);
+		sprintf(buf, "UPDATE players SET last_login_date = %d WHERE username = 'user%d'",
+			(int)time(0), i % users);
+		DBExec(db, buf);
+	}
+	const Uint32 before = SDL_GetTicks() - ticks;
+	sqlite3_close(db);
+
+	const char *file = dbfile;
+	dbfile = benchfile;
+	if (DBInit()) {
+		dbfile = file;
+		return -1;
+	}
+	ticks = SDL_GetTicks();
+	for (int i = 0; i < logins; ++i) {
+		sprintf(buf, "user%d", i % users);
+		DBFindUser(buf, password);
+		DBUpdateLoginDate(buf);
+	}
+	// The last batch is written when quitting
+	DBQuit();
+	const Uint32 after = SDL_GetTicks() - ticks;
+	dbfile = file;
+
+	printf("%d logins of %d users\n", logins, users);
+	printf("Formatted queries:   %u ms, %.0f logins/s\n", before, before ? logins * 1000.0 / before : 0.0);
+	printf("Prepared and cached: %u ms, %.0f logins/s\n", after, after ? logins * 1000.0 / after : 0.0);
+
+	remove(benchfile);
+	sprintf(buf, "%s-wal", benchfile);
+	remove(buf);
+	sprintf(buf, "%s-shm", benchfile);
+	remove(buf);
 	return 0;
 }
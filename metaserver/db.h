@@ -43,6 +43,7 @@ extern int DBAddUser(char *username, char *password);
 extern int DBUpdateLoginDate(char *username);
 extern int DBAddGame(int id, char *description, char *mapname, int numplayers);
 extern int DBStats(char *results, int resultlen);
+extern int DBBenchmark(int logins);
 
 //@}
 
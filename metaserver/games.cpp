@@ -36,6 +36,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "stratagus.h"
 #include "games.h"
@@ -45,13 +50,48 @@
 --  Variables
 ----------------------------------------------------------------------------*/
 
-static GameData *Games;
+/// Open games of a game type, by ID
+typedef std::map<int, GameData *> GameList;
+
+static std::unordered_map<int, GameData *> Games;        /// All games, by ID
+static std::unordered_map<std::string, GameList> OpenGames; /// Not started games, by game type
 int GameID;
 
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Key of a game type in the open games table
+**
+**  @param name     Game name, empty matches all names
+**  @param version  Game version, empty matches all versions
+*/
+static std::string GameTypeKey(const char *name, const char *version)
+{
+	std::string key(name);
+	key += '\n';
+	key += version;
+	return key;
+}
+
+/**
+**  Remove a game from the open games table
+*/
+static void CloseGame(GameData *game)
+{
+	std::unordered_map<std::string, GameList>::iterator it =
+		OpenGames.find(GameTypeKey(game->GameName, game->Version));
+
+	if (it == OpenGames.end()) {
+		return;
+	}
+	it->second.erase(game->ID);
+	if (it->second.empty()) {
+		OpenGames.erase(it);
+	}
+}
+
 /**
 **  Create a game
 */
@@ -64,8 +104,8 @@ void CreateGame(Session *session, char *description, char *map,
 
 	strcpy(game->IP, ip);
 	strcpy(game->Port, port);
-	game->UDPHost = 0;
-	game->UDPPort = 0;
+	game->UDPHost = 0;
+	game->UDPPort = 0;
 	strcpy(game->Description, description);
 	strcpy(game->Map, map);
 	game->MaxSlots = atoi(players);
@@ -84,12 +124,8 @@ void CreateGame(Session *session, char *description, char *map,
 	game->GameName = session->UserData.GameName;
 	game->Version = session->UserData.Version;
 
-	if (Games) {
-		Games->Prev = game;
-	}
-	game->Next = Games;
-	game->Prev = NULL;
-	Games = game;
+	Games[game->ID] = game;
+	OpenGames[GameTypeKey(game->GameName, game->Version)][game->ID] = game;
 
 	if (session->Game) {
 		PartGame(session);
@@ -111,15 +147,10 @@ int CancelGame(Session *session)
 		return -1; // Not the host
 	}
 
-	if (game->Next) {
-		game->Next->Prev = game->Prev;
-	}
-	if (game->Prev) {
-		game->Prev->Next = game->Next;
-	}
-	if (Games == game) {
-		Games = game->Next;
+	if (!game->Started) {
+		CloseGame(game);
 	}
+	Games.erase(game->ID);
 
 	for (i = 0; i < game->NumSessions; ++i) {
 		game->Sessions[i]->Game = NULL;
@@ -139,6 +170,9 @@ int StartGame(Session *session)
 		return -1; // Not the host
 	}
 
+	if (!session->Game->Started) {
+		CloseGame(session->Game);
+	}
 	session->Game->Started = 1;
 	return 0;
 }
@@ -154,16 +188,11 @@ int JoinGame(Session *session, int id, char *password, unsigned long *host, int
 		PartGame(session);
 	}
 
-	game = Games;
-	while (game) {
-		if (game->ID == id) {
-			break;
-		}
-		game = game->Next;
-	}
-	if (!game) {
+	std::unordered_map<int, GameData *>::iterator it = Games.find(id);
+	if (it == Games.end()) {
 		return -2; // ID not found
 	}
+	game = it->second;
 
 	if (game->Password[0]) {
 		if (!password || strcmp(game->Password, password)) {
@@ -223,43 +252,80 @@ int PartGame(Session *session)
 	return 0;
 }
 
-static int MatchGameType(Session *session, GameData *game)
+/**
+**  Add the open games of a game type to a list
+*/
+static void AddOpenGames(const std::string &key, std::vector<GameData *> &games)
+{
+	std::unordered_map<std::string, GameList>::const_iterator it = OpenGames.find(key);
+
+	if (it == OpenGames.end()) {
+		return;
+	}
+	for (GameList::const_iterator game = it->second.begin(); game != it->second.end(); ++game) {
+		games.push_back(game->second);
+	}
+}
+
+static bool NewerGame(const GameData *a, const GameData *b)
 {
-	return (!session->UserData.LoggedIn) ||
-		((!*game->GameName ||!strcmp(session->UserData.GameName, game->GameName)) &&
-		 (!*game->Version || !strcmp(session->UserData.Version, game->Version)));
+	return a->ID > b->ID;
 }
 
 /**
 **  List games
+**
+**  Only the open games of the session game type are visited: the games
+**  without a name or version match all the names or versions, so there
+**  are at most four game types to look at.
 */
 void ListGames(Session *session)
 {
-	GameData *game;
+	std::vector<GameData *> games;
 	char buf[1024];
 
-	game = Games;
-	while (game) {
-		if (!game->Started && MatchGameType(session, game)) {
-			sprintf(buf, "LISTGAMES %d \"%s\" \"%s\" %d %d %s %s\n",
-				game->ID, game->Description, game->Map,
-				game->OpenSlots, game->MaxSlots, game->IP, game->Port);
-			Send(session, buf);
+	if (!session->UserData.LoggedIn) {
+		for (std::unordered_map<std::string, GameList>::const_iterator it = OpenGames.begin();
+			it != OpenGames.end(); ++it) {
+			AddOpenGames(it->first, games);
 		}
-		game = game->Next;
+	} else {
+		const char *name = session->UserData.GameName;
+		const char *version = session->UserData.Version;
+
+		AddOpenGames(GameTypeKey(name, version), games);
+		if (*version) {
+			AddOpenGames(GameTypeKey(name, ""), games);
+		}
+		if (*name) {
+			AddOpenGames(GameTypeKey("", version), games);
+			if (*version) {
+				AddOpenGames(GameTypeKey("", ""), games);
+			}
+		}
+	}
+	// Newest games first
+	std::sort(games.begin(), games.end(), NewerGame);
+
+	for (size_t i = 0; i < games.size(); ++i) {
+		GameData *game = games[i];
+		sprintf(buf, "LISTGAMES %d \"%s\" \"%s\" %d %d %s %s\n",
+			game->ID, game->Description, game->Map,
+			game->OpenSlots, game->MaxSlots, game->IP, game->Port);
+		Send(session, buf);
 	}
 }
 
 int FillinUDPInfo(unsigned long udphost, int udpport, char* ip, char* port) {
-	GameData *game;
-	for (game = Games; game; game = Games->Next) {
+	for (std::unordered_map<int, GameData *>::iterator it = Games.begin(); it != Games.end(); ++it) {
+		GameData *game = it->second;
 		if (!strcmp(game->IP, ip) && !strcmp(game->Port, port)) {
-			if (!game->UDPHost && !game->UDPPort) {
+			if (!game->UDPHost && !game->UDPPort) {
 				game->UDPHost = udphost;
 				game->UDPPort = udpport;
 				return 0;
 			}
+		}
 	}
-	}
 	return -1;
 }
@@ -67,9 +67,6 @@ public:
 
 	unsigned long UDPHost;
 	int UDPPort;
-
-	GameData *Next;
-	GameData *Prev;
 };
 
 extern int GameID;
@@ -0,0 +1,339 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name loadgen.cpp - Metaserver load generator. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+**  One client connection of the load generator.
+**
+**  A session sends one command, waits for its whole answer, then sends
+**  the next one, like the game clients do.
+*/
+class LoadSession
+{
+public:
+	LoadSession() : Sock(-1), Sent(0) {}
+
+	int Sock;
+	std::string Input;        /// Received data not parsed yet
+	int Sent;                 /// Commands sent
+	Clock::time_point Start;  /// Time when the current command was sent
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+static const char *Host = "127.0.0.1";  /// Metaserver address
+static int Port = 7775;                 /// Metaserver port
+static int SessionCount = 1000;         /// Sessions to open
+static int CommandCount = 100;          /// Commands of each session
+static int GameCount = 10;              /// Sessions which create a game first
+
+static std::vector<double> Latencies;   /// Latency of each command, in ms
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Open a connection to the metaserver
+**
+**  @return  Non blocking socket, -1 for failure
+*/
+static int OpenSession()
+{
+	sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(Port);
+	if (inet_pton(AF_INET, Host, &addr.sin_addr) != 1) {
+		fprintf(stderr, "Bad address: %s\n", Host);
+		return -1;
+	}
+
+	const int sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock == -1) {
+		return -1;
+	}
+	// Do not wait forever when the server does not accept the connections
+	timeval timeout;
+	timeout.tv_sec = 5;
+	timeout.tv_usec = 0;
+	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	if (connect(sock, (sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(sock);
+		return -1;
+	}
+	const int flag = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+	return sock;
+}
+
+/**
+**  Send the next command of a session
+**
+**  The first sessions create a game, so that the game lists are not
+**  empty, then all the sessions alternate PING and LISTGAMES.
+*/
+static bool SendCommand(LoadSession &session, int index)
+{
+	char buf[256];
+
+	if (session.Sent == 0 && index < GameCount) {
+		snprintf(buf, sizeof(buf), "CREATEGAME \"load %d\" \"map%d.smp\" 8 127.0.0.1 %d\n",
+			index, index, 6660 + index);
+	} else if (session.Sent % 2) {
+		strcpy(buf, "LISTGAMES\n");
+	} else {
+		strcpy(buf, "PING\n");
+	}
+	const size_t len = strlen(buf);
+	session.Start = Clock::now();
+	++session.Sent;
+	return send(session.Sock, buf, len, MSG_NOSIGNAL) == (ssize_t)len;
+}
+
+/**
+**  Receive the answers of a session
+**
+**  @return  1 if the answer of the command is complete, 0 if not yet,
+**           -1 if the connection is lost
+*/
+static int ReceiveAnswer(LoadSession &session)
+{
+	char buf[4096];
+
+	for (;;) {
+		const ssize_t len = recv(session.Sock, buf, sizeof(buf), 0);
+		if (len > 0) {
+			session.Input.append(buf, len);
+			continue;
+		}
+		if (len == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
+		return -1;
+	}
+
+	// An answer ends with a line like XXX_OK or ERR_XXX
+	size_t pos;
+	while ((pos = session.Input.find('\n')) != std::string::npos) {
+		const std::string line = session.Input.substr(0, pos);
+		session.Input.erase(0, pos + 1);
+		if (!line.compare(0, 4, "ERR_")
+			|| (line.size() >= 3 && !line.compare(line.size() - 3, 3, "_OK"))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+**  Print the latency percentiles
+*/
+static void PrintReport(int sessions, int failed, double seconds)
+{
+	std::sort(Latencies.begin(), Latencies.end());
+
+	printf("Sessions:  %d open, %d failed\n", sessions, failed);
+	printf("Commands:  %d in %.2f s, %.0f commands/s\n", (int)Latencies.size(),
+		seconds, seconds > 0 ? Latencies.size() / seconds : 0.0);
+	if (Latencies.empty()) {
+		return;
+	}
+	const size_t n = Latencies.size();
+	printf("Latency:   p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n",
+		Latencies[n / 2], Latencies[n * 90 / 100], Latencies[n * 99 / 100],
+		Latencies[n * 999 / 1000], Latencies[n - 1]);
+}
+
+/**
+**  Run the load: all the sessions are open at the same time and each
+**  one sends its commands one after the other.
+*/
+static int RunLoad()
+{
+	std::vector<LoadSession> sessions;
+	std::vector<pollfd> fds;
+	int failed = 0;
+
+	sessions.reserve(SessionCount);
+	for (int i = 0; i < SessionCount; ++i) {
+		LoadSession session;
+		session.Sock = OpenSession();
+		if (session.Sock == -1) {
+			++failed;
+			continue;
+		}
+		sessions.push_back(session);
+	}
+	if (failed) {
+		fprintf(stderr, "%d sessions could not connect: %s\n", failed, strerror(errno));
+	}
+
+	const Clock::time_point start = Clock::now();
+	fds.resize(sessions.size());
+	for (size_t i = 0; i < sessions.size(); ++i) {
+		fds[i].fd = sessions[i].Sock;
+		fds[i].events = POLLIN;
+		if (!SendCommand(sessions[i], i)) {
+			fds[i].fd = -1;
+			++failed;
+		}
+	}
+	Latencies.reserve(sessions.size() * CommandCount);
+
+	size_t active = sessions.size();
+	for (size_t i = 0; i < fds.size(); ++i) {
+		if (fds[i].fd == -1) {
+			--active;
+		}
+	}
+	while (active) {
+		const int ready = poll(&fds[0], fds.size(), 10000);
+		if (ready == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll");
+			return 1;
+		}
+		if (ready == 0) {
+			fprintf(stderr, "Timeout: %d sessions do not answer\n", (int)active);
+			failed += active;
+			break;
+		}
+		for (size_t i = 0; i < fds.size(); ++i) {
+			if (fds[i].fd == -1 || !fds[i].revents) {
+				continue;
+			}
+			LoadSession &session = sessions[i];
+			const int result = ReceiveAnswer(session);
+			if (result == 0) {
+				continue;
+			}
+			if (result == 1) {
+				const std::chrono::duration<double, std::milli> latency = Clock::now() - session.Start;
+				Latencies.push_back(latency.count());
+				if (session.Sent < CommandCount && SendCommand(session, i)) {
+					continue;
+				}
+				if (session.Sent < CommandCount) {
+					++failed;
+				}
+			} else {
+				++failed;
+			}
+			fds[i].fd = -1;
+			--active;
+		}
+	}
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	for (size_t i = 0; i < sessions.size(); ++i) {
+		close(sessions[i].Sock);
+	}
+	PrintReport((int)sessions.size(), failed, elapsed.count());
+	return failed ? 1 : 0;
+}
+
+/**
+**  The main program: parse the options and run the load.
+*/
+int main(int argc, char **argv)
+{
+	int i;
+
+	while ((i = getopt(argc, argv, "H:P:n:c:g:h")) != -1) {
+		switch (i) {
+			case 'H':
+				Host = optarg;
+				break;
+			case 'P':
+				Port = atoi(optarg);
+				break;
+			case 'n':
+				SessionCount = atoi(optarg);
+				break;
+			case 'c':
+				CommandCount = atoi(optarg);
+				break;
+			case 'g':
+				GameCount = atoi(optarg);
+				break;
+			case 'h':
+			default:
+				printf("Arguments:\n"
+					   "-H\tMetaserver address (default 127.0.0.1)\n"
+					   "-P\tMetaserver port (default 7775)\n"
+					   "-n\tSessions to open (default 1000)\n"
+					   "-c\tCommands of each session (default 100)\n"
+					   "-g\tSessions which create a game (default 10)\n"
+					   "The metaserver must accept enough connections (-m), and the\n"
+					   "open files limit (ulimit -n) must be above the sessions count.\n");
+				exit(i == 'h' ? 0 : 1);
+		}
+	}
+	if (SessionCount < 1 || CommandCount < 1) {
+		fprintf(stderr, "Need at least one session and one command\n");
+		return 1;
+	}
+	return RunLoad();
+}
+
+//@}
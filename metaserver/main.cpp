@@ -160,6 +160,25 @@ int getopt(int argc, char *const *argv, const char *opts)
 /**
 **  Main loop
 */
+#ifdef USE_EPOLL
+static void MainLoop(void)
+{
+	int done;
+
+	//
+	// Start the transactions.
+	//
+	done = 0;
+	while (!done) {
+		//
+		// Wait for the sockets, the messages are parsed as soon as they
+		// are received, so there is no polling delay.
+		//
+		UpdateSessions();
+		UpdateParser();
+	}
+}
+#else
 static void MainLoop(void)
 {
 	Uint32 ticks[2];
@@ -198,6 +217,8 @@ static void MainLoop(void)
 	}
 
 }
+#endif
+
 /**
 **  The main program: initialize, parse options and arguments.
 */
@@ -205,6 +226,7 @@ int main(int argc, char **argv)
 {
 	int status;
 	int i;
+	int benchmark = 0;
 
 	Server.Port = DEFAULT_PORT;
 	Server.MaxConnections = DEFAULT_MAX_CONN;
@@ -223,7 +245,7 @@ int main(int argc, char **argv)
 	//
 	// Parse the command line.
 	//
-	while ((i = getopt(argc, argv, "aP:pm:i:d:h")) != -1) {
+	while ((i = getopt(argc, argv, "aP:pm:i:d:b:h")) != -1) {
 		switch (i) {
 			case 'a':
 				EnableAssert = true;
@@ -246,6 +268,9 @@ int main(int argc, char **argv)
 			case 'd':
 				Server.PollingDelay = atoi(optarg);
 				break;
+			case 'b':
+				benchmark = atoi(optarg);
+				break;
 			case ':':
 				printf("Missing argument for %c\n", optopt);
 				exit(0);
@@ -257,7 +282,8 @@ int main(int argc, char **argv)
 					   "-p\tEnable debug print\n"
 					   "-m\tMax connections\n"
 					   "-i\tIdle timeout\n"
-					   "-d\tPolling delay\n");
+					   "-d\tPolling delay, not used with epoll\n"
+					   "-b\tMeasure the logins per second of the database and quit\n");
 				exit(0);
 				break;
 			case '?':
@@ -266,6 +292,10 @@ int main(int argc, char **argv)
 		}
     }
 
+	if (benchmark > 0) {
+		exit(DBBenchmark(benchmark) ? 1 : 0);
+	}
+
 	// Initialize the database
 	if (DBInit()) {
 		fprintf(stderr, "DBInit failed\n");
@@ -40,12 +40,20 @@
 #ifndef _MSC_VER
 #include <errno.h>
 #endif
+#include <algorithm>
+#include <vector>
 
 #include "stratagus.h"
+#include "cmd.h"
 #include "games.h"
 #include "netdriver.h"
 #include "net_lowlevel.h"
 
+#ifdef USE_EPOLL
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#endif
+
 /*----------------------------------------------------------------------------
 --  Defines
 ----------------------------------------------------------------------------*/
@@ -88,12 +96,64 @@
 	--count;                          \
 }
 
+#define IDLE_WHEEL_SLOTS 64 // Seconds in one turn of the idle timer wheel
+
+#ifdef USE_EPOLL
+#define SESSION_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLET) // Events of the session sockets
+#endif
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Timer wheel of the idle timeouts.
+**
+**  A session is in the slot of the second at which it may expire. The
+**  activity of a session only updates its Idle time: when its slot is
+**  reached, the session is kicked if it was really idle, else it is moved
+**  to the slot of its new expiry time. Each second only looks at the
+**  sessions of its slot, instead of all the sessions.
+*/
+class IdleTimerWheel
+{
+public:
+	IdleTimerWheel() : Now(0)
+	{
+		for (int i = 0; i < IDLE_WHEEL_SLOTS; ++i) {
+			Slots[i].First = Slots[i].Last = NULL;
+			Slots[i].Count = 0;
+		}
+	}
+
+	void Init(time_t now) { Now = now; }
+	void Add(Session *session);
+	void Remove(Session *session);
+	void Expire(time_t now, std::vector<Session *> &expired);
+
+private:
+	/// Sessions which may expire at the same second (modulo the wheel size)
+	struct Slot {
+		Session *First;
+		Session *Last;
+		int Count;
+	};
+
+	Slot Slots[IDLE_WHEEL_SLOTS];
+	time_t Now;                   /// Last expired second
+};
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
 
 static Socket MasterSocket;
 static Socket HolePunchSocket;
+static IdleTimerWheel IdleTimers;
+#ifdef USE_EPOLL
+static int EpollFD = -1;
+static std::vector<Session *> DroppedSessions; /// Sessions to kill after the current events
+#endif
 
 SessionPool *Pool;
 ServerStruct Server;
@@ -105,6 +165,191 @@ int UDPPort = 0;
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Schedule the idle timeout of a session
+**
+**  @param session  Session which is not in a slot
+*/
+void IdleTimerWheel::Add(Session *session)
+{
+	time_t expiry = session->Idle + Server.IdleTimeout + 1;
+
+	if (expiry <= Now) {
+		expiry = Now + 1;
+	}
+	session->TimerSlot = (int)(expiry % IDLE_WHEEL_SLOTS);
+	Slot &slot = Slots[session->TimerSlot];
+	LINK(slot.First, session, slot.Last, slot.Count);
+}
+
+/**
+**  Cancel the idle timeout of a session
+**
+**  @param session  Session to remove from its slot
+*/
+void IdleTimerWheel::Remove(Session *session)
+{
+	if (session->TimerSlot == -1) {
+		return;
+	}
+	Slot &slot = Slots[session->TimerSlot];
+	UNLINK(slot.First, session, slot.Last, slot.Count);
+	session->Next = session->Prev = NULL;
+	session->TimerSlot = -1;
+}
+
+/**
+**  Find the idle sessions of the seconds elapsed since the last call
+**
+**  @param now      Current time
+**  @param expired  Filled with the idle sessions, which are removed from the wheel
+*/
+void IdleTimerWheel::Expire(time_t now, std::vector<Session *> &expired)
+{
+	if (now - Now > IDLE_WHEEL_SLOTS) {
+		// One turn visits all the slots
+		Now = now - IDLE_WHEEL_SLOTS;
+	}
+	while (Now < now) {
+		++Now;
+		const int current = (int)(Now % IDLE_WHEEL_SLOTS);
+		for (Session *session = Slots[current].First; session; ) {
+			Session *next = session->Next;
+			if (now - session->Idle > Server.IdleTimeout) {
+				Remove(session);
+				expired.push_back(session);
+			} else if ((session->Idle + Server.IdleTimeout + 1) % IDLE_WHEEL_SLOTS != current) {
+				Remove(session);
+				Add(session);
+			} // else it stays here for the next turn
+			session = next;
+		}
+	}
+}
+
+#ifdef USE_EPOLL
+/**
+**  Add a socket to the epoll set
+**
+**  @param sock    Socket to watch
+**  @param events  Events to wait for
+**
+**  @return        0 for success, -1 for failure
+*/
+static int EpollAdd(Socket sock, unsigned int events)
+{
+	epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.fd = sock;
+	return epoll_ctl(EpollFD, EPOLL_CTL_ADD, sock, &event);
+}
+
+/**
+**  Change the events watched for a socket of the epoll set
+**
+**  @param sock    Socket in the set
+**  @param events  Events to wait for
+**
+**  @return        0 for success, -1 for failure
+*/
+static int EpollModify(Socket sock, unsigned int events)
+{
+	epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.fd = sock;
+	return epoll_ctl(EpollFD, EPOLL_CTL_MOD, sock, &event);
+}
+
+/**
+**  Send the output of a session until the socket would block
+**
+**  The socket is watched for EPOLLOUT while some output is left.
+**
+**  @param session  Session with output to send
+**
+**  @return         0 if the output was sent or is queued, -1 on error
+*/
+static int FlushSession(Session *session)
+{
+	const bool waiting = !session->Output.empty();
+	size_t sent = 0;
+
+	while (sent < session->Output.size()) {
+		const int result = NetSendTCP(session->Sock, session->Output.data() + sent,
+			session->Output.size() - sent);
+		if (result > 0) {
+			sent += result;
+		} else if (result == -1 && errno == EINTR) {
+			continue;
+		} else if (result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		} else {
+			return -1;
+		}
+	}
+	session->Output.erase(0, sent);
+	if (waiting && session->Output.empty()) {
+		EpollModify(session->Sock, SESSION_EVENTS);
+	}
+	return 0;
+}
+
+/**
+**  Kill a session after the current events
+**
+**  The session may be used by the caller, as Send is called while a
+**  message of the session is parsed.
+**
+**  @param session  Session to kill
+*/
+static void DropSession(Session *session)
+{
+	if (!session->Dropped) {
+		session->Dropped = true;
+		session->Output.clear();
+		DroppedSessions.push_back(session);
+	}
+}
+
+/**
+**  Send a message to a session
+**
+**  The sockets are not blocking: what the client does not read yet is
+**  queued and sent when the socket is writable again. The session is
+**  dropped if it does not read its queued output.
+**
+**  @param session  Session to send the message to
+**  @param msg      Message to send
+*/
+void Send(Session *session, const char *msg)
+{
+	if (session->Dropped) {
+		return;
+	}
+	const bool waiting = !session->Output.empty();
+
+	session->Output += msg;
+	// With queued output, wait for EPOLLOUT to keep the order of the messages
+	if (!waiting) {
+		if (FlushSession(session) == -1) {
+			DebugPrint("Cannot send to '%s'\n" _C_ session->AddrData.IPStr);
+			DropSession(session);
+			return;
+		}
+		if (!session->Output.empty()) {
+			EpollModify(session->Sock, SESSION_EVENTS | EPOLLOUT);
+		}
+	}
+	if (session->Output.size() > MAX_OUTPUT_BUFFER) {
+		DebugPrint("Output overflow for '%s'\n" _C_ session->AddrData.IPStr);
+		DropSession(session);
+	}
+}
+#else
 /**
 **  Send a message to a session
 **
@@ -115,6 +360,7 @@ void Send(Session *session, const char *msg)
 {
 	NetSendTCP(session->Sock, msg, strlen(msg));
 }
+#endif
 
 /**
 **  Initialize the server
@@ -160,6 +406,18 @@ int ServerInit(int port)
 		goto error;
 	}
 
+#ifdef USE_EPOLL
+	// The listening socket is edge triggered and accepted until empty. The
+	// UDP socket stays level triggered, as one datagram is read per update.
+	if ((EpollFD = epoll_create(Server.MaxConnections + 2)) == -1
+		|| EpollAdd(MasterSocket, EPOLLIN | EPOLLET) == -1
+		|| EpollAdd(HolePunchSocket, EPOLLIN) == -1) {
+		fprintf(stderr, "epoll failed: %s\n", strerror(errno));
+		code = -7;
+		goto error;
+	}
+#endif
+
 	if (!(Pool = new SessionPool)) {
 		fprintf(stderr, "Out of memory\n");
 		code = -5;
@@ -171,13 +429,18 @@ int ServerInit(int port)
 		goto error;
 	}
 
-	Pool->First = NULL;
-	Pool->Last = NULL;
 	Pool->Count = 0;
+	IdleTimers.Init(time(0));
 
 	return 0;
 
  error:
+#ifdef USE_EPOLL
+	if (EpollFD != -1) {
+		close(EpollFD);
+		EpollFD = -1;
+	}
+#endif
 	NetCloseTCP(MasterSocket);
 	NetCloseUDP(HolePunchSocket);
 	NetExit();
@@ -192,32 +455,26 @@ void ServerQuit(void)
 	NetCloseTCP(MasterSocket);
 	// begin clean up of any remaining sockets
 	if (Pool) {
-		Session *ptr;
-
-		while (Pool->First) {
-			ptr = Pool->First;
-			UNLINK(Pool->First, Pool->First, Pool->Last, Pool->Count);
-			NetCloseTCP(ptr->Sock);
-			delete ptr;
+		for (std::unordered_map<Socket, Session *>::iterator it = Pool->Sessions.begin();
+			it != Pool->Sessions.end(); ++it) {
+			NetCloseTCP(it->second->Sock);
+			delete it->second;
 		}
+		Pool->Sessions.clear();
 
 		delete Pool->Sockets;
 		delete Pool;
 	}
+#ifdef USE_EPOLL
+	if (EpollFD != -1) {
+		close(EpollFD);
+		EpollFD = -1;
+	}
+#endif
 
 	NetExit();
 }
 
-/**
-**  Returns time (in seconds) that a session has been idle.
-**
-**  @param session  This is the session we are checking.
-*/
-static int IdleSeconds(Session *session)
-{
-	return (int)(time(0) - session->Idle);
-}
-
 /**
 **  Destroys and cleans up session data.
 **
@@ -226,9 +483,19 @@ static int IdleSeconds(Session *session)
 static int KillSession(Session *session)
 {
 	DebugPrint("Closing connection from '%s'\n" _C_ session->AddrData.IPStr);
+	// Closing the socket also removes it from the epoll set
 	NetCloseTCP(session->Sock);
+#ifndef USE_EPOLL
 	Pool->Sockets->DelSocket(session->Sock);
-	UNLINK(Pool->First, session, Pool->Last, Pool->Count);
+#endif
+	IdleTimers.Remove(session);
+#ifdef USE_EPOLL
+	if (session->Dropped) {
+		DroppedSessions.erase(std::find(DroppedSessions.begin(), DroppedSessions.end(), session));
+	}
+#endif
+	Pool->Sessions.erase(session->Sock);
+	--Pool->Count;
 	PartGame(session);
 	delete session;
 	return 0;
@@ -248,7 +515,12 @@ static void AcceptConnections()
 		if (Pool->Count == Server.MaxConnections) {
 			NetSendTCP(new_socket, "Server Full\n", 12);
 			NetCloseTCP(new_socket);
+#ifdef USE_EPOLL
+			// Edge triggered: refuse all the pending connections
+			continue;
+#else
 			break;
+#endif
 		}
 
 		new_session = new Session;
@@ -265,33 +537,159 @@ static void AcceptConnections()
 		new_session->AddrData.Port = port;
 		DebugPrint("New connection from '%s'\n" _C_ new_session->AddrData.IPStr);
 
-		LINK(Pool->First, new_session, Pool->Last, Pool->Count);
+#ifdef USE_EPOLL
+		if (NetSetNonBlocking(new_socket) == -1
+			|| EpollAdd(new_socket, SESSION_EVENTS) == -1) {
+			fprintf(stderr, "ERROR: %s\n", strerror(errno));
+			NetCloseTCP(new_socket);
+			delete new_session;
+			continue;
+		}
+		// The answers are sent line by line, do not wait to merge them
+		const int nodelay = 1;
+		setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+#else
 		Pool->Sockets->AddSocket(new_socket);
+#endif
+		Pool->Sessions[new_socket] = new_session;
+		++Pool->Count;
+		IdleTimers.Add(new_session);
 	}
+#ifndef USE_EPOLL
 	if (NetSocketReady(HolePunchSocket, 0)) {
 		NetRecvUDP(HolePunchSocket, UDPBuffer, sizeof(UDPBuffer), &UDPHost, &UDPPort);
-		DebugPrint("New UDP %s (%d %d)\n" _C_ UDPBuffer _C_ UDPHost _C_ UDPPort);
+		DebugPrint("New UDP %s (%d %d)\n" _C_ UDPBuffer _C_ UDPHost _C_ UDPPort);
 	}
+#endif
+}
+
+#ifdef USE_EPOLL
+/**
+**  Receive a UDP hole punching message
+*/
+static void ReadUDP()
+{
+	const int len = NetRecvUDP(HolePunchSocket, UDPBuffer, sizeof(UDPBuffer) - 1, &UDPHost, &UDPPort);
+	UDPBuffer[len > 0 ? len : 0] = '\0';
+	DebugPrint("New UDP %s (%d %d)\n" _C_ UDPBuffer _C_ UDPHost _C_ UDPPort);
 }
+#endif
 
 /**
 **  Kick idlers
 */
 static void KickIdlers(void)
 {
-	Session *session;
-	Session *next;
+	std::vector<Session *> expired;
+
+	IdleTimers.Expire(time(0), expired);
+	for (size_t i = 0; i < expired.size(); ++i) {
+		DebugPrint("Kicking idler '%s'\n" _C_ expired[i]->AddrData.IPStr);
+		KillSession(expired[i]);
+	}
+}
 
-	for (session = Pool->First; session; ) {
-		next = session->Next;
-		if (IdleSeconds(session) > Server.IdleTimeout) {
-			DebugPrint("Kicking idler '%s'\n" _C_ session->AddrData.IPStr);
+/**
+**  Receive the data of a session and parse its complete messages
+**
+**  With epoll the socket is edge triggered, so it is read until it
+**  would block.
+**
+**  @param session  Session with data to read
+**
+**  @return         0 if the session is alive, -1 if it was killed
+*/
+static int ReadSession(Session *session)
+{
+	session->Idle = time(0);
+	for (;;) {
+		int clen = strlen(session->Buffer);
+		if (clen == sizeof(session->Buffer) - 1) {
+			// Message too long
 			KillSession(session);
+			return -1;
+		}
+		const int result = NetRecvTCP(session->Sock, session->Buffer + clen,
+			sizeof(session->Buffer) - 1 - clen);
+		if (result < 0) {
+			KillSession(session);
+			return -1;
+		}
+		session->Buffer[clen + result] = '\0';
+		ParseSession(session);
+#ifdef USE_EPOLL
+		if (result == 0) {
+			// Would block
+			return 0;
+		}
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef USE_EPOLL
+/**
+**  Wait for the sockets and handle their events
+**
+**  The wait ends at the latest for the next second of the idle timers.
+*/
+static int ReadData()
+{
+	epoll_event events[64];
+	const int result = epoll_wait(EpollFD, events, 64, 1000);
+
+	if (result == -1) {
+		if (errno != EINTR) {
+			fprintf(stderr, "epoll_wait failed: %s\n", strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+
+	for (int i = 0; i < result; ++i) {
+		const Socket sock = events[i].data.fd;
+		if (sock == MasterSocket) {
+			AcceptConnections();
+			continue;
+		}
+		if (sock == HolePunchSocket) {
+			ReadUDP();
+			continue;
 		}
-		session = next;
+		std::unordered_map<Socket, Session *>::iterator it = Pool->Sessions.find(sock);
+		if (it == Pool->Sessions.end()) {
+			continue;
+		}
+		Session *session = it->second;
+		if ((events[i].events & EPOLLOUT) && !session->Dropped && FlushSession(session) == -1) {
+			DropSession(session);
+		}
+		if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+			// On hang up the last data is still read, then the read fails.
+			ReadSession(session);
+		}
+	}
+
+	// Kill the sessions which could not be sent their output
+	while (!DroppedSessions.empty()) {
+		KillSession(DroppedSessions.back());
 	}
+	return 0;
 }
 
+/**
+**  Waits for new connections and data, receives and parses the data,
+**  kicks the idle sessions.
+*/
+int UpdateSessions(void)
+{
+	const int result = ReadData();
+
+	KickIdlers();
+	return result;
+}
+#else
 /**
 **  Read data
 */
@@ -309,21 +707,15 @@ static int ReadData()
 	}
 
 	// ready sockets
-	for (Session *session = Pool->First; session; ) {
-		Session *next = session->Next;
-		if (Pool->Sockets->HasDataToRead(session->Sock)) {
-			// socket ready
-			session->Idle = time(0);
-			int clen = strlen(session->Buffer);
-			result = NetRecvTCP(session->Sock, session->Buffer + clen,
-				sizeof(session->Buffer) - clen);
-			if (result < 0) {
-				KillSession(session);
-			} else {
-				session->Buffer[clen + result] = '\0';
-			}
+	std::vector<Session *> ready;
+	for (std::unordered_map<Socket, Session *>::iterator it = Pool->Sessions.begin();
+		it != Pool->Sessions.end(); ++it) {
+		if (Pool->Sockets->HasDataToRead(it->first)) {
+			ready.push_back(it->second);
 		}
-		session = next;
+	}
+	for (size_t i = 0; i < ready.size(); ++i) {
+		ReadSession(ready[i]);
 	}
 
 	return 0;
@@ -336,7 +728,7 @@ int UpdateSessions(void)
 {
 	AcceptConnections();
 
-	if (!Pool->First) {
+	if (Pool->Sessions.empty()) {
 		// No connections
 		return 0;
 	}
@@ -345,5 +737,6 @@ int UpdateSessions(void)
 
 	return ReadData();
 }
+#endif
 
 //@}
@@ -36,7 +36,9 @@
 --  Includes
 ----------------------------------------------------------------------------*/
 
+#include <string>
 #include <time.h>
+#include <unordered_map>
 #include "net_lowlevel.h"
 
 /*----------------------------------------------------------------------------
@@ -47,6 +49,11 @@
 #define DEFAULT_MAX_CONN		500			// Max Connections
 #define DEFAULT_SESSION_TIMEOUT		900			// 15 miniutes
 #define DEFAULT_POLLING_DELAY		250			// MS (1000 = 1s)
+#define MAX_OUTPUT_BUFFER		(64 * 1024)		// Bytes queued for a slow client
+
+#ifdef __linux__
+#define USE_EPOLL // Wait for the sockets with epoll instead of polling
+#endif
 
 #define MAX_USERNAME_LENGTH 32
 #define MAX_PASSWORD_LENGTH 32
@@ -83,7 +90,7 @@ extern ServerStruct Server;
 */
 class Session {
 public:
-	Session() : Next(NULL), Prev(NULL), Idle(0), Sock(0), Game(NULL)
+	Session() : Next(NULL), Prev(NULL), TimerSlot(-1), Idle(0), Sock(0), Dropped(false), Game(NULL)
 	{
 		Buffer[0] = '\0';
 		AddrData.Host = 0;
@@ -95,13 +102,16 @@ public:
 		UserData.LoggedIn = 0;
 	}
 
-	Session *Next;
-	Session *Prev;
+	Session *Next;            /// Next session in the idle timer slot
+	Session *Prev;            /// Previous session in the idle timer slot
+	int TimerSlot;            /// Idle timer slot, -1 if none
 
 	char Buffer[1024];
 	time_t Idle;
 
 	Socket Sock;
+	std::string Output;       /// Data not sent yet, the socket would block
+	bool Dropped;             /// Killed after the current events, its output overflowed
 
 	struct {
 		unsigned long Host;
@@ -124,13 +134,12 @@ public:
 */
 class SessionPool {
 public:
-	SessionPool() : First(NULL), Last(NULL), Count(0), Sockets(NULL) {}
+	SessionPool() : Count(0), Sockets(NULL) {}
 
-	Session *First;
-	Session *Last;
+	std::unordered_map<Socket, Session *> Sessions; /// Sessions by socket
 	int Count;
 
-	SocketSet *Sockets;
+	SocketSet *Sockets;       /// Sockets to select, when epoll is not used
 };
 
 /// external reference to session tracking.
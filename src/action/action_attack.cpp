@@ -113,7 +113,7 @@ void AnimateActionAttack(CUnit &unit, COrder &order)
 
 	COrder_Attack *order = new COrder_Attack(false);
 
-	if (Map.WallOnMap(dest) && Map.Field(dest)->playerInfo.IsExplored(*attacker.Player)) {
+	if (Map.WallOnMap(dest) && Map.IsFieldExplored(*attacker.Player, dest)) {
 		// FIXME: look into action_attack.cpp about this ugly problem
 		order->goalPos = dest;
 		order->Range = attacker.Stats->Variables[ATTACKRANGE_INDEX].Max;
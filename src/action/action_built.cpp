@@ -42,6 +42,7 @@
 #include "script.h"
 #include "sound.h"
 #include "translate.h"
+#include "trigger.h"
 #include "unit.h"
 #include "unittype.h"
 
@@ -159,6 +160,7 @@ static void Finish(COrder_Built &order, CUnit &unit)
 		player.UnitTypesAiActiveCount[type.Slot]++;
 	}
 	unit.Constructed = 0;
+	TriggerUnitChanged(player, type);
 	if (unit.Frame < 0) {
 		unit.Frame = -1;
 	} else {
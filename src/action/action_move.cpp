@@ -183,7 +183,7 @@ int DoActionMove(CUnit &unit)
 		unit.MoveToXY(pos);
 
 		// Remove unit from the current selection
-		if (unit.Selected && !Map.Field(pos)->playerInfo.IsTeamVisible(*ThisPlayer)) {
+		if (unit.Selected && !Map.IsFieldTeamVisible(*ThisPlayer, pos)) {
 			if (IsOnlySelected(unit)) { //  Remove building cursor
 				CancelBuildingMode();
 			}
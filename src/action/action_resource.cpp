@@ -90,7 +90,7 @@ private:
 
 VisitResult NearReachableTerrainFinder::Visit(TerrainTraversal &terrainTraversal, const Vec2i &pos, const Vec2i &from)
 {
-	if (!player.AiEnabled && !Map.Field(pos)->playerInfo.IsExplored(player)) {
+	if (!player.AiEnabled && !Map.IsFieldExplored(player, pos)) {
 		return VisitResult_DeadEnd;
 	}
 	// Look if found what was required.
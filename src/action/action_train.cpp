@@ -45,6 +45,7 @@
 #include "translate.h"
 #include "ui.h"
 #include "unit.h"
+#include "unit_manager.h"
 #include "unitsound.h"
 #include "unittype.h"
 
@@ -215,6 +216,7 @@ static void AnimateActionTrain(CUnit &unit)
 	// Set life span
 	if (unit.Type->DecayRate) {
 		newUnit->TTL = GameCycle + unit.Type->DecayRate * 6 * CYCLES_PER_SECOND;
+		UnitManager.UpdateHotState(*newUnit, false);
 	}
 
 
@@ -249,6 +251,7 @@ static void AnimateActionTrain(CUnit &unit)
 	if (CanHandleOrder(*newUnit, unit.NewOrder) == true) {
 		delete newUnit->Orders[0];
 		newUnit->Orders[0] = unit.NewOrder->Clone();
+		UnitManager.UpdateHotState(*newUnit, false);
 	} else {
 #if 0
 		// Tell the unit to rigth-click ?
@@ -46,6 +46,7 @@
 #include "spells.h"
 #include "translate.h"
 #include "unit.h"
+#include "unit_manager.h"
 #include "unittype.h"
 
 /// How many resources the player gets back if canceling upgrade
@@ -150,6 +151,7 @@ static int TransformUnitIntoType(CUnit &unit, const CUnitType &newtype)
 		memset(unit.AutoCastSpell, 0, SpellTypeTable.size() * sizeof(char));
 		memset(unit.SpellCoolDownTimers, 0, SpellTypeTable.size() * sizeof(int));
 	}
+	UnitManager.UpdateHotState(unit);
 
 	UpdateForNewUnit(unit, 1);
 	//  Update Possible sight range change
@@ -66,8 +66,11 @@
 #include "missile.h"
 #include "pathfinder.h"
 #include "player.h"
+#include "pool.h"
+#include "profiler.h"
 #include "script.h"
 #include "spells.h"
+#include "trigger.h"
 #include "unit.h"
 #include "unit_find.h"
 #include "unit_manager.h"
@@ -79,6 +82,9 @@
 
 unsigned SyncHash; /// Hash calculated to find sync failures
 
+/// Memory of the orders
+static CClassPool OrderPool("orders", 256);
+
 
 /*----------------------------------------------------------------------------
 --  Functions
@@ -89,6 +95,16 @@ COrder::~COrder()
 	Goal.Reset();
 }
 
+void *COrder::operator new(size_t size)
+{
+	return OrderPool.Alloc(size);
+}
+
+void COrder::operator delete(void *p, size_t size)
+{
+	OrderPool.Free(p, size);
+}
+
 void COrder::SetGoal(CUnit *const new_goal)
 {
 	Goal = new_goal;
@@ -372,6 +388,9 @@ static void HandleUnitAction(CUnit &unit)
 		if (unit.Orders[0]->Finished && unit.Orders[0]->Action != UnitActionStill
 			&& unit.Orders.size() == 1) {
 
+			if (unit.Orders[0]->Action == UnitActionBuilt) { // unit becomes usable
+				TriggerUnitChanged(*unit.Player, *unit.Type);
+			}
 			delete unit.Orders[0];
 			unit.Orders[0] = COrder::NewActionStill();
 			if (IsOnlySelected(unit)) { // update display for new action
@@ -389,6 +408,9 @@ static void HandleUnitAction(CUnit &unit)
 				return;
 			}
 
+			if (unit.Orders[0]->Action == UnitActionBuilt) { // unit becomes usable
+				TriggerUnitChanged(*unit.Player, *unit.Type);
+			}
 			delete unit.Orders[0];
 			unit.Orders.erase(unit.Orders.begin());
 
@@ -424,6 +446,7 @@ static void UnitActionsEachSecond(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 		}
 		// 2) Buffs...
 		HandleBuffsEachSecond(unit);
+		UnitManager.UpdateHotState(unit);
 	}
 }
 
@@ -459,15 +482,26 @@ static void DumpUnitInfo(CUnit &unit)
 	fflush(NULL);
 }
 
-template <typename UNITP_ITERATOR>
-static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
+/**
+**  Handle the units each cycle.
+**
+**  The hot state of the units is in the order of the table until a unit
+**  is added or released. Until then it is used to skip the destroyed
+**  units and the buffs which would change nothing without loading the
+**  units.
+**
+**  @param table         Copy of the unit table.
+**  @param tableVersion  Version of the unit table when it was copied.
+*/
+static void UnitActionsEachCycle(const std::vector<CUnit *> &table, unsigned int tableVersion)
 {
-	for (UNITP_ITERATOR it = begin; it != end; ++it) {
-		CUnit &unit = **it;
+	const CUnitHotState &hot = UnitManager.GetHotState();
 
-		if (unit.Destroyed) {
+	for (size_t i = 0; i != table.size(); ++i) {
+		if (UnitManager.GetTableVersion() == tableVersion ? hot.Destroyed[i] : table[i]->Destroyed) {
 			continue;
 		}
+		CUnit &unit = *table[i];
 
 		if (!ReplayRevealMap && unit.Selected && !unit.IsVisible(*ThisPlayer)) {
 			UnSelectUnit(unit);
@@ -482,10 +516,13 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 		}
 
 		// Handle each cycle buffs
-		HandleBuffsEachCycle(unit);
-		// Unit could be dead after TTL kill
-		if (unit.Destroyed) {
-			continue;
+		const bool buffs = UnitManager.GetTableVersion() != tableVersion || hot.TTL[i] || hot.BuffsRunning[i];
+		if (buffs) {
+			HandleBuffsEachCycle(unit);
+			// Unit could be dead after TTL kill
+			if (unit.Destroyed) {
+				continue;
+			}
 		}
 
 		try {
@@ -494,6 +531,8 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 			AnimationDie_OnCatch(unit);
 		}
 
+		UnitManager.UpdateHotState(unit, buffs);
+
 		if (EnableUnitDebug) {
 			DumpUnitInfo(unit);
 		}
@@ -510,16 +549,23 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 */
 void UnitActions()
 {
+	PROFILE_ZONE("UnitActions");
 	const bool isASecondCycle = !(GameCycle % CYCLES_PER_SECOND);
 	// Unit list may be modified during loop... so make a copy
-	std::vector<CUnit *> table(UnitManager.begin(), UnitManager.end());
+	// (kept between cycles to reuse its memory)
+	static std::vector<CUnit *> table;
+	table.assign(UnitManager.begin(), UnitManager.end());
+	// The units released each second move the hot state of the table
+	const unsigned int tableVersion = UnitManager.GetTableVersion();
 
 	// Check for things that only happen every second
 	if (isASecondCycle) {
 		UnitActionsEachSecond(table.begin(), table.end());
 	}
+	// Compute the paths needed in this cycle at once
+	PathfinderPrefetch(table, tableVersion);
 	// Do all actions
-	UnitActionsEachCycle(table.begin(), table.end());
+	UnitActionsEachCycle(table, tableVersion);
 }
 
 //@}
@@ -149,6 +149,7 @@
 #include "map.h"
 #include "pathfinder.h"
 #include "player.h"
+#include "profiler.h"
 #include "script.h"
 #include "unit.h"
 #include "unit_manager.h"
@@ -1003,6 +1004,7 @@ void AiResearchComplete(CUnit &unit, const CUpgrade *what)
 */
 void AiEachCycle(CPlayer &player)
 {
+	PROFILE_ZONE("AiEachCycle");
 	AiPlayer = player.Ai;
 }
 
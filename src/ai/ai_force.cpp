@@ -47,6 +47,7 @@
 #include "tileset.h"
 #include "unit.h"
 #include "unit_find.h"
+#include "unit_manager.h"
 #include "unittype.h"
 
 /*----------------------------------------------------------------------------
@@ -452,6 +453,7 @@ void AiForce::Attack(const Vec2i &pos)
 			const int delay = i / 5; // To avoid lot of CPU consuption, send them with a small time difference.
 
 			unit->Wait = delay;
+			UnitManager.UpdateHotState(*unit, false);
 			if (unit->IsAgressive()) {
 				CommandAttack(*unit, this->GoalPos,  NULL, FlushCommands);
 			} else {
@@ -917,6 +919,7 @@ void AiForce::Update()
 				const int delay = i / 5; // To avoid lot of CPU consuption, send them with a small time difference.
 
 				trans.Wait = delay;
+				UnitManager.UpdateHotState(trans, false);
 				CommandUnload(trans, this->GoalPos, NULL, FlushCommands);
 			}
 		}
@@ -971,6 +974,7 @@ void AiForce::Update()
 				const int delay = i / 5; // To avoid lot of CPU consuption, send them with a small time difference.
 
 				aiunit.Wait = delay;
+				UnitManager.UpdateHotState(aiunit, false);
 				if (aiunit.IsAgressive()) {
 					CommandAttack(aiunit, this->GoalPos, NULL, FlushCommands);
 				} else {
@@ -1033,6 +1037,7 @@ void AiForce::Update()
 		const int delay = i / 5; // To avoid lot of CPU consuption, send them with a small time difference.
 
 		aiunit.Wait = delay;
+		UnitManager.UpdateHotState(aiunit, false);
 		if (leader) {
 			if (aiunit.IsAgressive()) {
 				if (State == AiForceAttackingState_Attacking) {
@@ -1113,6 +1118,7 @@ void AiForceManager::Update()
 							const int delay = i / 5; // To avoid lot of CPU consuption, send them with a small time difference.
 
 							unit->Wait = delay;
+							UnitManager.UpdateHotState(*unit, false);
 							if (unit->Type->CanAttack) {
 								CommandAttack(*unit, force.GoalPos, NULL, FlushCommands);
 							} else {
@@ -161,6 +161,7 @@
 		goal->Variable[index].Value = goal->Variable[index].Max * value / 100;
 	}
 	clamp(&goal->Variable[index].Value, 0, goal->Variable[index].Max);
+	UnitManager.UpdateHotState(*goal);
 }
 
 /*
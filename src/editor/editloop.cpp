@@ -1836,6 +1836,8 @@ void CEditor::Init()
 		}
 
 		Map.Fields = new CMapField[Map.Info.MapWidth * Map.Info.MapHeight];
+		Map.UnitCells.Create(Map.Info.MapWidth, Map.Info.MapHeight);
+		Map.Visibility.Create(Map.Info.MapWidth * Map.Info.MapHeight);
 
 		const int defaultTile = Map.Tileset->getDefaultTileIndex();
 
@@ -59,6 +59,7 @@
 #include "parameters.h"
 #include "pathfinder.h"
 #include "player.h"
+#include "profiler.h"
 #include "replay.h"
 #include "results.h"
 #include "settings.h"
@@ -76,6 +77,8 @@
 #include "version.h"
 #include "video.h"
 
+#include <chrono>
+
 
 extern void CleanGame();
 
@@ -95,6 +98,17 @@ unsigned long FastForwardCycle;      /// Cycle to fastforward to in a replay
 
 bool UseHPForXp = false;              /// true if gain XP by dealing damage, false if by killing.
 
+/// Time of a phase of a load
+struct LoadPhaseTime {
+	std::string Name;  /// name of the phase
+	double Time;       /// time in ms
+};
+
+static std::vector<LoadPhaseTime> LoadPhases;      /// phases of the current load
+static double LoadPhaseStart;                      /// start of the current phase, in ms
+/// Phases of the last loads, by load name
+static std::map<std::string, std::vector<LoadPhaseTime> > LoadTimes;
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -126,6 +140,8 @@ void SaveGameSettings(CFile &file)
 	file.printf("GameSettings.RevealMap = %d\n", GameSettings.RevealMap);
 	file.printf("GameSettings.MapRichness = %d\n", GameSettings.MapRichness);
 	file.printf("GameSettings.Inside = %s\n", GameSettings.Inside ? "true" : "false");
+	file.printf("GameSettings.PathfinderPrefetch = %s\n", GameSettings.PathfinderPrefetch ? "true" : "false");
+	file.printf("GameSettings.PathCache = %s\n", GameSettings.PathCache ? "true" : "false");
 	file.printf("\n");
 }
 
@@ -267,6 +283,7 @@ static void WriteMapPreview(const char *mapname, CMap &map)
 	if (fp == NULL) {
 		return;
 	}
+	NoteFileWritten(mapname);
 
 	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (png_ptr == NULL) {
@@ -854,6 +871,86 @@ static void GameTypeManTeamVsMachine()
 	}
 }
 
+/*----------------------------------------------------------------------------
+--  Load times
+----------------------------------------------------------------------------*/
+
+/// Get a time in ms for the load phases
+static double GetLoadTime()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+**  Start to time a phase of a load, the current phase ends.
+**
+**  @param name  Name of the phase.
+*/
+void StartLoadPhase(const char *name)
+{
+	const double now = GetLoadTime();
+
+	if (!LoadPhases.empty()) {
+		LoadPhases.back().Time = now - LoadPhaseStart;
+	}
+	LoadPhaseTime phase;
+	phase.Name = name;
+	phase.Time = 0;
+	LoadPhases.push_back(phase);
+	LoadPhaseStart = now;
+}
+
+/**
+**  End the current phase and keep the times of the load.
+**
+**  @param load  Name of the load.
+*/
+void EndLoadPhases(const char *load)
+{
+	if (LoadPhases.empty()) {
+		return;
+	}
+	LoadPhases.back().Time = GetLoadTime() - LoadPhaseStart;
+	LoadTimes[load].swap(LoadPhases);
+	LoadPhases.clear();
+#ifdef DEBUG
+	PrintLoadTimes(stdout);
+#endif
+}
+
+/**
+**  Print the time of the phases of the last loads.
+**
+**  @param file  Output file.
+*/
+void PrintLoadTimes(FILE *file)
+{
+	for (std::map<std::string, std::vector<LoadPhaseTime> >::const_iterator it = LoadTimes.begin();
+		 it != LoadTimes.end(); ++it) {
+		const std::vector<LoadPhaseTime> &phases = it->second;
+		double total = 0;
+
+		fprintf(file, "Load %s:\n", it->first.c_str());
+		for (size_t i = 0; i != phases.size(); ++i) {
+			fprintf(file, "  %-16s %9.2f ms\n", phases[i].Name.c_str(), phases[i].Time);
+			total += phases[i].Time;
+		}
+		fprintf(file, "  %-16s %9.2f ms\n", "total", total);
+	}
+}
+
+/**
+**  Print the time of the phases of the last loads.
+**
+**  @param l  Lua state.
+*/
+static int CclPrintLoadTimes(lua_State *l)
+{
+	LuaCheckArgs(l, 0);
+	PrintLoadTimes(stdout);
+	return 0;
+}
+
 /*----------------------------------------------------------------------------
 --  Game creation
 ----------------------------------------------------------------------------*/
@@ -877,6 +974,7 @@ void CreateGame(const std::string &filename, CMap *map)
 		return;
 	}
 
+	StartLoadPhase("map");
 	InitPlayers();
 
 	if (IsNetworkGame()) {
@@ -990,23 +1088,31 @@ void CreateGame(const std::string &filename, CMap *map)
 	// Graphic part
 	//
 	SetPlayersPalette();
+	StartLoadPhase("icons");
 	LoadIcons();
 
+	StartLoadPhase("cursors");
 	LoadCursors(PlayerRaces.Name[ThisPlayer->Race]);
 	UnitUnderCursor = NoUnitP;
 
+	StartLoadPhase("missiles");
 	InitMissileTypes();
 #ifndef DYNAMIC_LOAD
 	LoadMissileSprites();
 #endif
+	StartLoadPhase("constructions");
 	InitConstructions();
 	LoadConstructions();
+	StartLoadPhase("unit types");
 	LoadUnitTypes();
+	StartLoadPhase("decorations");
 	LoadDecorations();
 
+	StartLoadPhase("user interface");
 	InitUserInterface();
 	UI.Load();
 
+	StartLoadPhase("map setup");
 	Map.Init();
 	UI.Minimap.Create();
 	PreprocessMap();
@@ -1014,6 +1120,7 @@ void CreateGame(const std::string &filename, CMap *map)
 	//
 	// Sound part
 	//
+	StartLoadPhase("sounds");
 	LoadUnitSounds();
 	MapUnitSounds();
 	if (SoundEnabled()) {
@@ -1023,6 +1130,7 @@ void CreateGame(const std::string &filename, CMap *map)
 	//
 	// Spells
 	//
+	StartLoadPhase("game setup");
 	InitSpells();
 
 	//
@@ -1064,6 +1172,7 @@ void CreateGame(const std::string &filename, CMap *map)
 	// Various hacks which must be done after the map is loaded.
 	//
 	// FIXME: must be done after map is loaded
+	StartLoadPhase("pathfinder");
 	InitPathfinder();
 	//
 	// FIXME: The palette is loaded after the units are created.
@@ -1082,6 +1191,7 @@ void CreateGame(const std::string &filename, CMap *map)
 	GameResult = GameNoResult;
 
 	CommandLog(NULL, NoUnitP, FlushCommands, -1, -1, NoUnitP, NULL, -1);
+	EndLoadPhases("game");
 	Video.ClearScreen();
 }
 
@@ -1128,6 +1238,7 @@ static void CleanGame_Lua()
 */
 void CleanGame()
 {
+	WaitAsyncSave();
 	EndReplayLog();
 	CleanMessages();
 
@@ -1573,6 +1684,7 @@ void LuaRegisterModules()
 	lua_register(Lua, "GetStratagusHomepage", CclGetStratagusHomepage);
 
 	lua_register(Lua, "SavedGameInfo", CclSavedGameInfo);
+	lua_register(Lua, "PrintLoadTimes", CclPrintLoadTimes);
 
 	AiCclRegister();
 	AnimationCclRegister();
@@ -1586,6 +1698,7 @@ void LuaRegisterModules()
 	NetworkCclRegister();
 	PathfinderCclRegister();
 	PlayerCclRegister();
+	ProfilerCclRegister();
 	ReplayCclRegister();
 	ScriptRegister();
 	SelectionCclRegister();
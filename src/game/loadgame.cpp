@@ -41,6 +41,7 @@
 #include "construct.h"
 #include "depend.h"
 #include "font.h"
+#include "game.h"
 #include "map.h"
 #include "minimap.h"
 #include "missile.h"
@@ -48,6 +49,7 @@
 #include "pathfinder.h"
 #include "replay.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sound_server.h"
 #include "spells.h"
@@ -152,19 +154,29 @@ void InitModules()
 */
 void LoadModules()
 {
+	StartLoadPhase("fonts");
 	LoadFonts();
+	StartLoadPhase("icons");
 	LoadIcons();
+	StartLoadPhase("cursors");
 	LoadCursors(PlayerRaces.Name[ThisPlayer->Race]);
+	StartLoadPhase("user interface");
 	UI.Load();
 #ifndef DYNAMIC_LOAD
+	StartLoadPhase("missiles");
 	LoadMissileSprites();
 #endif
+	StartLoadPhase("constructions");
 	LoadConstructions();
+	StartLoadPhase("decorations");
 	LoadDecorations();
+	StartLoadPhase("unit types");
 	LoadUnitTypes();
 
+	StartLoadPhase("pathfinder");
 	InitPathfinder();
 
+	StartLoadPhase("sounds");
 	LoadUnitSounds();
 	MapUnitSounds();
 	if (SoundEnabled()) {
@@ -188,6 +200,38 @@ static void PlaceUnits()
 	}
 }
 
+/**
+**  Load the sections of a savegame snapshot, in their order.
+**
+**  @param filename  File name, for the messages.
+**  @param content   Content of the file.
+*/
+static void LoadSnapshot(const std::string &filename, const std::string &content)
+{
+	CSnapshotReader snapshot(reinterpret_cast<const unsigned char *>(content.data()), content.size());
+
+	if (snapshot.GetVersion() > SnapshotVersion) {
+		fprintf(stderr, "Savegame '%s' has a newer version: %u\n", filename.c_str(), snapshot.GetVersion());
+		ExitFatal(-1);
+	}
+	while (snapshot.NextSection()) {
+		if (snapshot.IsSection(SNAPSHOT_SECTION_LUA)) {
+			LuaLoadBuffer(reinterpret_cast<const char *>(snapshot.GetSectionData()), snapshot.GetSectionSize(), filename);
+		} else if (snapshot.IsSection(SNAPSHOT_SECTION_MAP_FIELDS)) {
+			if (!Map.LoadFieldsSnapshot(snapshot.GetSectionData(), snapshot.GetSectionSize())) {
+				fprintf(stderr, "Savegame '%s' has bad map fields\n", filename.c_str());
+				ExitFatal(-1);
+			}
+		} else {
+			DebugPrint("Unknown savegame section in '%s'\n" _C_ filename.c_str());
+		}
+	}
+	if (!snapshot.IsAtEnd()) {
+		fprintf(stderr, "Savegame '%s' is truncated\n", filename.c_str());
+		ExitFatal(-1);
+	}
+}
+
 /**
 **  Load a game to file.
 **
@@ -195,24 +239,39 @@ static void PlaceUnits()
 */
 void LoadGame(const std::string &filename)
 {
+	// the autosave may be written
+	WaitAsyncSave();
 	// log will be enabled if found in the save game
 	CommandLogDisabled = true;
 	SaveGameLoading = true;
 
+	StartLoadPhase("fonts");
 	SetDefaultTextColors(FontYellow, FontWhite);
 	LoadFonts();
 
+	StartLoadPhase("savegame");
 	LuaGarbageCollect();
 	InitUnitTypes(1);
-	LuaLoadFile(filename);
+	DebugPrint("Loading '%s'\n" _C_ filename.c_str());
+	std::string content;
+	if (GetFileContent(filename, content)) {
+		if (CSnapshotReader::IsSnapshot(reinterpret_cast<const unsigned char *>(content.data()), content.size())) {
+			LoadSnapshot(filename, content);
+		} else {
+			// Savegame of an older version, a lua script
+			LuaLoadBuffer(content.data(), content.size(), filename);
+		}
+	}
 	LuaGarbageCollect();
 
+	StartLoadPhase("units");
 	PlaceUnits();
 
 	const unsigned long game_cycle = GameCycle;
 	const unsigned syncrand = SyncRandSeed;
 	const unsigned synchash = SyncHash;
 
+	StartLoadPhase("modules");
 	InitModules();
 	LoadModules();
 
@@ -220,6 +279,7 @@ void LoadGame(const std::string &filename)
 	SyncRandSeed = syncrand;
 	SyncHash = synchash;
 	SelectionChanged();
+	EndLoadPhases("savegame");
 }
 
 //@}
@@ -35,6 +35,7 @@
 #include "stratagus.h"
 
 #include "replay.h"
+#include "replay_format.h"
 
 #include "actions.h"
 #include "commands.h"
@@ -58,102 +59,38 @@
 
 #include <sstream>
 #include <time.h>
+#include <vector>
 
 extern void ExpandPath(std::string &newpath, const std::string &path);
 extern void StartMap(const std::string &filename, bool clean);
 
 //----------------------------------------------------------------------------
-// Structures
+// Constants
 //----------------------------------------------------------------------------
 
-/**
-**  LogEntry structure.
-*/
-class LogEntry
-{
-public:
-	LogEntry() : GameCycle(0), Flush(0), PosX(0), PosY(0), DestUnitNumber(0),
-		Num(0), SyncRandSeed(0), Next(NULL)
-	{
-		UnitNumber = 0;
-	}
-
-	unsigned long GameCycle;
-	int UnitNumber;
-	std::string UnitIdent;
-	std::string Action;
-	int Flush;
-	int PosX;
-	int PosY;
-	int DestUnitNumber;
-	std::string Value;
-	int Num;
-	unsigned SyncRandSeed;
-	LogEntry *Next;
+static const char ReplayMagic[4] = { 'S', 'R', 'P', 'L' };       /// Start of a binary replay
+static const char ReplayIndexMagic[4] = { 'S', 'R', 'P', 'X' };  /// End of a binary replay index
+static const unsigned char ReplayVersion = 3;                   /// Binary replay format version
+static const char ReplayKeyframeFile[] = "replay_keyframe.sav";  /// Savegame used for the keyframes
+
+/// Record tags of the binary replay
+enum ReplayRecord {
+	ReplayRecordHeader = 1,  /// Settings of the replay
+	ReplayRecordString,      /// Definition of the next string index
+	ReplayRecordCommand,     /// Logged command
+	ReplayRecordKeyframe,    /// Savegame at a cycle
+	ReplayRecordIndex        /// Cycles and offsets of the keyframes
 };
 
-/**
-**  Multiplayer Player definition
-*/
-class MPPlayer
-{
-public:
-	MPPlayer() : PlayerColor(0), Race(0), Team(0), Type(0) {}
-
-	std::string Name;
-	std::string AIScript;
-	int PlayerColor;
-	int Race;
-	int Team;
-	int Type;
-};
-
-/**
-** Full replay structure (definition + logs)
-*/
-class FullReplay
-{
-public:
-	FullReplay() :
-		MapId(0), Type(0), Race(0), LocalPlayer(0),
-		Resource(0), NumUnits(0), Difficulty(0), NoFow(false), Inside(false), RevealMap(0),
-		MapRichness(0), GameType(0), Opponents(0), Commands(NULL)
-	{
-		memset(Engine, 0, sizeof(Engine));
-		memset(Network, 0, sizeof(Network));
-	}
-	std::string Comment1;
-	std::string Comment2;
-	std::string Comment3;
-	std::string Date;
-	std::string Map;
-	std::string MapPath;
-	unsigned MapId;
-
-	int Type;
-	int Race;
-	int LocalPlayer;
-	MPPlayer Players[PlayerMax];
-
-	int Resource;
-	int NumUnits;
-	int Difficulty;
-	bool NoFow;
-	bool Inside;
-	int RevealMap;
-	int MapRichness;
-	int GameType;
-	int Opponents;
-	int Engine[3];
-	int Network[3];
-	LogEntry *Commands;
+/// Optional fields of a binary command record
+enum {
+	ReplayHasUnit = 0x01,   /// UnitNumber and UnitIdent
+	ReplayHasPos = 0x02,    /// PosX and PosY
+	ReplayHasDest = 0x04,   /// DestUnitNumber
+	ReplayHasValue = 0x08,  /// Value
+	ReplayHasNum = 0x10     /// Num
 };
 
-//----------------------------------------------------------------------------
-// Constants
-//----------------------------------------------------------------------------
-
-
 //----------------------------------------------------------------------------
 // Variables
 //----------------------------------------------------------------------------
@@ -161,7 +98,14 @@ public:
 bool CommandLogDisabled;           /// True if command log is off
 ReplayType ReplayGameType;         /// Replay game type
 static bool DisabledLog;           /// Disabled log for replay
-static CFile *LogFile;             /// Replay log file
+static CReplayWriter *LogFile;     /// Replay log file
+static int ReplayKeyframeCycles = CYCLES_PER_SECOND * 60 * 5; /// Cycles between two keyframes, 0 for none
+static bool ReplayImporting;       /// Parsing a text replay to convert it
+static bool ReplayFromKeyframe;    /// Replay started from a keyframe savegame
+static bool ReplayKeyframeDue;     /// A keyframe waits for the end of another save
+static bool ReplayKeyframeSaving;  /// A keyframe is written by the asynchronous save
+static unsigned long ReplayKeyframeCycle; /// Game cycle of the keyframe being written
+static unsigned long ReplaySeekCycle; /// Cycle to fast forward the replay to
 static unsigned long NextLogCycle; /// Next log cycle number
 static int InitReplay;             /// Initialize replay
 static FullReplay *CurrentReplay;
@@ -220,6 +164,8 @@ static FullReplay *StartReplay()
 	replay->RevealMap = GameSettings.RevealMap;
 	replay->MapRichness = GameSettings.MapRichness;
 	replay->Opponents = GameSettings.Opponents;
+	replay->PathfinderPrefetch = GameSettings.PathfinderPrefetch;
+	replay->PathCache = GameSettings.PathCache;
 
 	replay->Engine[0] = StratagusMajorVersion;
 	replay->Engine[1] = StratagusMinorVersion;
@@ -270,6 +216,8 @@ static void ApplyReplaySettings()
 	FlagRevealMap = GameSettings.RevealMap = CurrentReplay->RevealMap;
 	GameSettings.MapRichness = CurrentReplay->MapRichness;
 	GameSettings.Opponents = CurrentReplay->Opponents;
+	GameSettings.PathfinderPrefetch = CurrentReplay->PathfinderPrefetch;
+	GameSettings.PathCache = CurrentReplay->PathCache;
 
 	// FIXME : check engine version
 	// FIXME : FIXME: check network version
@@ -281,7 +229,7 @@ static void ApplyReplaySettings()
 **
 **  @param replay  Pointer to the replay to be freed
 */
-static void DeleteReplay(FullReplay *replay)
+void DeleteReplay(FullReplay *replay)
 {
 	LogEntry *log = replay->Commands;
 
@@ -293,6 +241,621 @@ static void DeleteReplay(FullReplay *replay)
 	delete replay;
 }
 
+/**
+**  Append a log entry at the end of the commands of a replay
+**
+**  @param replay  Replay to append to
+**  @param log     Log entry to append
+*/
+static void AddLogEntry(FullReplay &replay, LogEntry *log)
+{
+	log->Next = NULL;
+	if (replay.LastCommand) {
+		replay.LastCommand->Next = log;
+	} else {
+		replay.Commands = log;
+	}
+	replay.LastCommand = log;
+}
+
+//----------------------------------------------------------------------------
+// Binary replay
+//----------------------------------------------------------------------------
+
+/**
+**  Append a varint to a buffer
+*/
+static void PutVarint(std::vector<unsigned char> &buf, unsigned long value)
+{
+	while (value >= 0x80) {
+		buf.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	buf.push_back((unsigned char)value);
+}
+
+/**
+**  Append a zigzag encoded signed varint to a buffer
+*/
+static void PutSigned(std::vector<unsigned char> &buf, long value)
+{
+	PutVarint(buf, value < 0 ? ((~(unsigned long)value) << 1) | 1 : (unsigned long)value << 1);
+}
+
+/**
+**  Append a string, with its length, to a buffer
+*/
+static void PutString(std::vector<unsigned char> &buf, const std::string &s)
+{
+	PutVarint(buf, s.size());
+	buf.insert(buf.end(), s.begin(), s.end());
+}
+
+/**
+**  Decoder of the binary replay records.
+**  Reading past the end sets the error flag and returns 0.
+*/
+class CReplayReader
+{
+public:
+	CReplayReader(const std::vector<unsigned char> &data, size_t pos) :
+		Data(data), Pos(pos), Error(false) {}
+
+	bool AtEnd() const { return Pos >= Data.size(); }
+	bool Failed() const { return Error; }
+	size_t Tell() const { return Pos; }
+
+	unsigned char GetByte()
+	{
+		if (Pos >= Data.size()) {
+			Error = true;
+			return 0;
+		}
+		return Data[Pos++];
+	}
+
+	unsigned long GetVarint()
+	{
+		unsigned long value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			const unsigned char c = GetByte();
+			value |= (unsigned long)(c & 0x7F) << shift;
+			if (!(c & 0x80)) {
+				return value;
+			}
+		}
+		Error = true;
+		return 0;
+	}
+
+	long GetSigned()
+	{
+		const unsigned long value = GetVarint();
+		return (value & 1) ? (long)~(value >> 1) : (long)(value >> 1);
+	}
+
+	std::string GetString()
+	{
+		const unsigned long size = GetVarint();
+		if (!Skip(size)) {
+			return std::string();
+		}
+		return std::string((const char *)&Data[Pos - size], size);
+	}
+
+	bool Skip(unsigned long size)
+	{
+		if (size > Data.size() - Pos) {
+			Error = true;
+			Pos = Data.size();
+			return false;
+		}
+		Pos += size;
+		return true;
+	}
+
+private:
+	const std::vector<unsigned char> &Data;
+	size_t Pos;
+	bool Error;
+};
+
+/**
+**  Read a whole file in memory
+**
+**  @param filename  File to read
+**  @param data      Filled with the content of the file
+**
+**  @return          true if the file was read
+*/
+bool ReadReplayFile(const std::string &filename, std::vector<unsigned char> &data)
+{
+	FILE *fd = fopen(filename.c_str(), "rb");
+	if (!fd) {
+		return false;
+	}
+	data.clear();
+	unsigned char buf[4096];
+	size_t size;
+	while ((size = fread(buf, 1, sizeof(buf), fd)) != 0) {
+		data.insert(data.end(), buf, buf + size);
+	}
+	const bool ok = !ferror(fd);
+	fclose(fd);
+	return ok;
+}
+
+/**
+**  Check if a file content is a binary replay
+*/
+static bool IsBinaryReplay(const std::vector<unsigned char> &data)
+{
+	return data.size() > sizeof(ReplayMagic) && !memcmp(&data[0], ReplayMagic, sizeof(ReplayMagic));
+}
+
+/**
+**  Open a binary replay file for writing
+**
+**  @param filename  File to create
+**
+**  @return          true if the file is opened
+*/
+bool CReplayWriter::Open(const std::string &filename)
+{
+	Close();
+	File = fopen(filename.c_str(), "wb");
+	if (!File) {
+		return false;
+	}
+	Record.assign(ReplayMagic, ReplayMagic + sizeof(ReplayMagic));
+	Record.push_back(ReplayVersion);
+	WriteRecord();
+	return true;
+}
+
+/**
+**  Write the keyframe index and close the file
+*/
+void CReplayWriter::Close()
+{
+	if (!File) {
+		return;
+	}
+	const size_t indexOffset = Offset;
+
+	Record.push_back(ReplayRecordIndex);
+	PutVarint(Record, Keyframes.size());
+	for (size_t i = 0; i != Keyframes.size(); ++i) {
+		PutVarint(Record, Keyframes[i].GameCycle);
+		PutVarint(Record, Keyframes[i].Offset);
+		PutVarint(Record, Keyframes[i].Size);
+	}
+	for (int i = 0; i != 8; ++i) {
+		Record.push_back((unsigned char)((unsigned long long)indexOffset >> (8 * i)));
+	}
+	Record.insert(Record.end(), ReplayIndexMagic, ReplayIndexMagic + sizeof(ReplayIndexMagic));
+	WriteRecord();
+
+	fclose(File);
+	File = NULL;
+	Offset = 0;
+	LastCycle = 0;
+	Strings.clear();
+	Keyframes.clear();
+}
+
+/**
+**  Flush the written records, for the logs of crashed games
+*/
+void CReplayWriter::Flush()
+{
+	if (File) {
+		fflush(File);
+	}
+}
+
+/**
+**  Write the encoded record
+*/
+void CReplayWriter::WriteRecord()
+{
+	if (File && !Record.empty()) {
+		fwrite(&Record[0], Record.size(), 1, File);
+		Offset += Record.size();
+	}
+	Record.clear();
+}
+
+/**
+**  Get the index of a string, writing its definition the first time
+**
+**  @param s  String to intern
+**
+**  @return   Index of the string
+*/
+unsigned long CReplayWriter::Intern(const std::string &s)
+{
+	std::map<std::string, unsigned long>::const_iterator it = Strings.find(s);
+	if (it != Strings.end()) {
+		return it->second;
+	}
+	const unsigned long index = Strings.size();
+	Strings[s] = index;
+
+	std::vector<unsigned char> command;
+	command.swap(Record);
+	Record.push_back(ReplayRecordString);
+	PutString(Record, s);
+	WriteRecord();
+	command.swap(Record);
+	return index;
+}
+
+/**
+**  Write the settings of a replay
+**
+**  @param replay  Replay to write the settings of
+*/
+void CReplayWriter::WriteHeader(const FullReplay &replay)
+{
+	Record.push_back(ReplayRecordHeader);
+	PutString(Record, replay.Comment1);
+	PutString(Record, replay.Comment2);
+	PutString(Record, replay.Comment3);
+	PutString(Record, replay.Date);
+	PutString(Record, replay.Map);
+	PutString(Record, replay.MapPath);
+	PutVarint(Record, replay.MapId);
+	PutSigned(Record, replay.Type);
+	PutSigned(Record, replay.Race);
+	PutSigned(Record, replay.LocalPlayer);
+	PutVarint(Record, PlayerMax);
+	for (int i = 0; i < PlayerMax; ++i) {
+		PutString(Record, replay.Players[i].Name);
+		PutString(Record, replay.Players[i].AIScript);
+		PutSigned(Record, replay.Players[i].PlayerColor);
+		PutSigned(Record, replay.Players[i].Race);
+		PutSigned(Record, replay.Players[i].Team);
+		PutSigned(Record, replay.Players[i].Type);
+	}
+	PutSigned(Record, replay.Resource);
+	PutSigned(Record, replay.NumUnits);
+	PutSigned(Record, replay.Difficulty);
+	PutVarint(Record, replay.NoFow);
+	PutVarint(Record, replay.Inside);
+	PutSigned(Record, replay.RevealMap);
+	PutSigned(Record, replay.GameType);
+	PutSigned(Record, replay.Opponents);
+	PutSigned(Record, replay.MapRichness);
+	for (int i = 0; i < 3; ++i) {
+		PutSigned(Record, replay.Engine[i]);
+	}
+	for (int i = 0; i < 3; ++i) {
+		PutSigned(Record, replay.Network[i]);
+	}
+	// Since version 2: the pathfinder settings, they change the simulation
+	PutVarint(Record, replay.PathfinderPrefetch);
+	// Since version 3
+	PutVarint(Record, replay.PathCache);
+	WriteRecord();
+}
+
+/**
+**  Write a logged command
+**
+**  @param log  Command to write
+*/
+void CReplayWriter::WriteCommand(const LogEntry &log)
+{
+	int fields = 0;
+	if (log.UnitNumber != -1) {
+		fields |= ReplayHasUnit;
+	}
+	if (log.PosX != -1 || log.PosY != -1) {
+		fields |= ReplayHasPos;
+	}
+	if (log.DestUnitNumber != -1) {
+		fields |= ReplayHasDest;
+	}
+	if (!log.Value.empty()) {
+		fields |= ReplayHasValue;
+	}
+	if (log.Num != -1) {
+		fields |= ReplayHasNum;
+	}
+	// Intern the strings first, their definitions go before the command.
+	const unsigned long action = Intern(log.Action);
+	const unsigned long ident = (fields & ReplayHasUnit) ? Intern(log.UnitIdent) : 0;
+	const unsigned long value = (fields & ReplayHasValue) ? Intern(log.Value) : 0;
+
+	Record.push_back(ReplayRecordCommand);
+	PutVarint(Record, fields);
+	PutSigned(Record, (long)log.GameCycle - (long)LastCycle);
+	LastCycle = log.GameCycle;
+	PutVarint(Record, action);
+	PutSigned(Record, log.Flush);
+	if (fields & ReplayHasUnit) {
+		PutVarint(Record, log.UnitNumber);
+		PutVarint(Record, ident);
+	}
+	if (fields & ReplayHasPos) {
+		PutSigned(Record, log.PosX);
+		PutSigned(Record, log.PosY);
+	}
+	if (fields & ReplayHasDest) {
+		PutVarint(Record, log.DestUnitNumber);
+	}
+	if (fields & ReplayHasValue) {
+		PutVarint(Record, value);
+	}
+	if (fields & ReplayHasNum) {
+		PutSigned(Record, log.Num);
+	}
+	for (int i = 0; i != 4; ++i) {
+		Record.push_back((unsigned char)(log.SyncRandSeed >> (8 * i)));
+	}
+	WriteRecord();
+}
+
+/**
+**  Write a savegame of the current game
+**
+**  @param gameCycle  Cycle of the savegame
+**  @param savegame   Content of the savegame file
+*/
+void CReplayWriter::WriteKeyframe(unsigned long gameCycle, const std::vector<unsigned char> &savegame)
+{
+	Record.push_back(ReplayRecordKeyframe);
+	PutVarint(Record, gameCycle);
+	PutVarint(Record, savegame.size());
+
+	ReplayKeyframe keyframe;
+	keyframe.GameCycle = gameCycle;
+	keyframe.Offset = Offset + Record.size();
+	keyframe.Size = savegame.size();
+	Keyframes.push_back(keyframe);
+
+	Record.insert(Record.end(), savegame.begin(), savegame.end());
+	WriteRecord();
+}
+
+/**
+**  Read the keyframe index at the end of a closed binary replay
+**
+**  @param data       Content of the replay file
+**  @param keyframes  Filled with the keyframes of the index
+**
+**  @return           Offset of the index, 0 if the replay has none
+*/
+static size_t ReadReplayIndex(const std::vector<unsigned char> &data, std::vector<ReplayKeyframe> &keyframes)
+{
+	const size_t trailer = 8 + sizeof(ReplayIndexMagic);
+	if (data.size() < sizeof(ReplayMagic) + 1 + trailer
+		|| memcmp(&data[data.size() - sizeof(ReplayIndexMagic)], ReplayIndexMagic, sizeof(ReplayIndexMagic))) {
+		return 0;
+	}
+	unsigned long long offset = 0;
+	for (int i = 0; i != 8; ++i) {
+		offset |= (unsigned long long)data[data.size() - trailer + i] << (8 * i);
+	}
+	if (offset >= data.size() - trailer || data[offset] != ReplayRecordIndex) {
+		return 0;
+	}
+	CReplayReader reader(data, offset + 1);
+	const unsigned long count = reader.GetVarint();
+	keyframes.clear();
+	for (unsigned long i = 0; i != count && !reader.Failed(); ++i) {
+		ReplayKeyframe keyframe;
+		keyframe.GameCycle = reader.GetVarint();
+		keyframe.Offset = reader.GetVarint();
+		keyframe.Size = reader.GetVarint();
+		if (keyframe.Offset > data.size() || keyframe.Size > data.size() - keyframe.Offset) {
+			break;
+		}
+		keyframes.push_back(keyframe);
+	}
+	if (reader.Failed() || keyframes.size() != count) {
+		keyframes.clear();
+		return 0;
+	}
+	return offset;
+}
+
+/**
+**  Parse a binary replay
+**
+**  @param filename  Name of the replay file, kept to read the keyframes
+**  @param data      Content of the replay file
+**
+**  @return          The replay, NULL if the file is not a valid binary replay
+*/
+FullReplay *ParseBinaryReplay(const std::string &filename, const std::vector<unsigned char> &data)
+{
+	if (!IsBinaryReplay(data)) {
+		return NULL;
+	}
+	const unsigned char version = data[sizeof(ReplayMagic)];
+	if (version < 1 || version > ReplayVersion) {
+		return NULL;
+	}
+	FullReplay *replay = new FullReplay;
+	replay->FileName = filename;
+
+	// A log of a crashed game has no index, keyframes are then found while reading.
+	const size_t indexOffset = ReadReplayIndex(data, replay->Keyframes);
+	const size_t end = indexOffset ? indexOffset : data.size();
+	std::vector<std::string> strings;
+	unsigned long lastCycle = 0;
+	bool header = false;
+
+	CReplayReader reader(data, sizeof(ReplayMagic) + 1);
+	while (reader.Tell() < end && !reader.Failed()) {
+		switch (reader.GetByte()) {
+			case ReplayRecordHeader: {
+				replay->Comment1 = reader.GetString();
+				replay->Comment2 = reader.GetString();
+				replay->Comment3 = reader.GetString();
+				replay->Date = reader.GetString();
+				replay->Map = reader.GetString();
+				replay->MapPath = reader.GetString();
+				replay->MapId = reader.GetVarint();
+				replay->Type = reader.GetSigned();
+				replay->Race = reader.GetSigned();
+				replay->LocalPlayer = reader.GetSigned();
+				const unsigned long players = reader.GetVarint();
+				for (unsigned long i = 0; i != players && !reader.Failed(); ++i) {
+					MPPlayer player;
+					player.Name = reader.GetString();
+					player.AIScript = reader.GetString();
+					player.PlayerColor = reader.GetSigned();
+					player.Race = reader.GetSigned();
+					player.Team = reader.GetSigned();
+					player.Type = reader.GetSigned();
+					if (i < PlayerMax) {
+						replay->Players[i] = player;
+					}
+				}
+				replay->Resource = reader.GetSigned();
+				replay->NumUnits = reader.GetSigned();
+				replay->Difficulty = reader.GetSigned();
+				replay->NoFow = reader.GetVarint() != 0;
+				replay->Inside = reader.GetVarint() != 0;
+				replay->RevealMap = reader.GetSigned();
+				replay->GameType = reader.GetSigned();
+				replay->Opponents = reader.GetSigned();
+				replay->MapRichness = reader.GetSigned();
+				for (int i = 0; i < 3; ++i) {
+					replay->Engine[i] = reader.GetSigned();
+				}
+				for (int i = 0; i < 3; ++i) {
+					replay->Network[i] = reader.GetSigned();
+				}
+				if (version >= 2) {
+					replay->PathfinderPrefetch = reader.GetVarint() != 0;
+				}
+				if (version >= 3) {
+					replay->PathCache = reader.GetVarint() != 0;
+				}
+				header = true;
+				break;
+			}
+			case ReplayRecordString:
+				strings.push_back(reader.GetString());
+				break;
+			case ReplayRecordCommand: {
+				LogEntry *log = new LogEntry;
+				const unsigned long fields = reader.GetVarint();
+				lastCycle += reader.GetSigned();
+				log->GameCycle = lastCycle;
+				const unsigned long action = reader.GetVarint();
+				log->Flush = reader.GetSigned();
+				log->UnitNumber = -1;
+				log->PosX = -1;
+				log->PosY = -1;
+				log->DestUnitNumber = -1;
+				log->Num = -1;
+				unsigned long ident = 0;
+				unsigned long value = 0;
+				if (fields & ReplayHasUnit) {
+					log->UnitNumber = reader.GetVarint();
+					ident = reader.GetVarint();
+				}
+				if (fields & ReplayHasPos) {
+					log->PosX = reader.GetSigned();
+					log->PosY = reader.GetSigned();
+				}
+				if (fields & ReplayHasDest) {
+					log->DestUnitNumber = reader.GetVarint();
+				}
+				if (fields & ReplayHasValue) {
+					value = reader.GetVarint();
+				}
+				if (fields & ReplayHasNum) {
+					log->Num = reader.GetSigned();
+				}
+				log->SyncRandSeed = 0;
+				for (int i = 0; i != 4; ++i) {
+					log->SyncRandSeed |= (unsigned)reader.GetByte() << (8 * i);
+				}
+				if (reader.Failed() || action >= strings.size() || ident >= strings.size() || value >= strings.size()) {
+					delete log;
+					reader.Skip(data.size());
+					break;
+				}
+				log->Action = strings[action];
+				if (fields & ReplayHasUnit) {
+					log->UnitIdent = strings[ident];
+				}
+				if (fields & ReplayHasValue) {
+					log->Value = strings[value];
+				}
+				AddLogEntry(*replay, log);
+				break;
+			}
+			case ReplayRecordKeyframe: {
+				ReplayKeyframe keyframe;
+				keyframe.GameCycle = reader.GetVarint();
+				keyframe.Size = reader.GetVarint();
+				keyframe.Offset = reader.Tell();
+				if (reader.Skip(keyframe.Size) && !indexOffset) {
+					replay->Keyframes.push_back(keyframe);
+				}
+				break;
+			}
+			default:
+				reader.Skip(data.size());
+				break;
+		}
+	}
+	if (!header) {
+		DeleteReplay(replay);
+		return NULL;
+	}
+	if (reader.Failed()) {
+		// Keep the commands before the damage, like the text log of a crashed game.
+		fprintf(stderr, "Replay '%s' is truncated\n", filename.c_str());
+	}
+	return replay;
+}
+
+/**
+**  Load a binary replay file
+**
+**  @param filename  Name of the replay file
+**
+**  @return          The replay, NULL if the file is not a valid binary replay
+*/
+static FullReplay *LoadBinaryReplay(const std::string &filename)
+{
+	std::vector<unsigned char> data;
+	if (!ReadReplayFile(filename, data)) {
+		return NULL;
+	}
+	return ParseBinaryReplay(filename, data);
+}
+
+/**
+**  Write a replay in the binary format, without keyframes
+**
+**  @param replay    Replay to write
+**  @param filename  Name of the file to create
+**
+**  @return          true if the file was written
+*/
+static bool SaveBinaryReplay(const FullReplay &replay, const std::string &filename)
+{
+	CReplayWriter writer;
+	if (!writer.Open(filename)) {
+		return false;
+	}
+	writer.WriteHeader(replay);
+	for (const LogEntry *log = replay.Commands; log; log = log->Next) {
+		writer.WriteCommand(*log);
+	}
+	writer.Close();
+	return true;
+}
+
 static void PrintLogCommand(const LogEntry &log, CFile &file)
 {
 	file.printf("Log( { ");
@@ -323,54 +886,57 @@ static void PrintLogCommand(const LogEntry &log, CFile &file)
 /**
 **  Output the FullReplay list to file
 **
-**  @param file  The file to output to
+**  @param replay  The replay to output
+**  @param file    The file to output to
 */
-static void SaveFullLog(CFile &file)
+static void SaveFullLog(const FullReplay &replay, CFile &file)
 {
 	file.printf("\n--- -----------------------------------------\n");
 	file.printf("--- MODULE: replay list\n");
 
 	file.printf("\n");
 	file.printf("ReplayLog( {\n");
-	file.printf("  Comment1 = \"%s\",\n", CurrentReplay->Comment1.c_str());
-	file.printf("  Comment2 = \"%s\",\n", CurrentReplay->Comment2.c_str());
-	file.printf("  Date = \"%s\",\n", CurrentReplay->Date.c_str());
-	file.printf("  Map = \"%s\",\n", CurrentReplay->Map.c_str());
-	file.printf("  MapPath = \"%s\",\n", CurrentReplay->MapPath.c_str());
-	file.printf("  MapId = %u,\n", CurrentReplay->MapId);
-	file.printf("  Type = %d,\n", CurrentReplay->Type);
-	file.printf("  Race = %d,\n", CurrentReplay->Race);
-	file.printf("  LocalPlayer = %d,\n", CurrentReplay->LocalPlayer);
+	file.printf("  Comment1 = \"%s\",\n", replay.Comment1.c_str());
+	file.printf("  Comment2 = \"%s\",\n", replay.Comment2.c_str());
+	file.printf("  Date = \"%s\",\n", replay.Date.c_str());
+	file.printf("  Map = \"%s\",\n", replay.Map.c_str());
+	file.printf("  MapPath = \"%s\",\n", replay.MapPath.c_str());
+	file.printf("  MapId = %u,\n", replay.MapId);
+	file.printf("  Type = %d,\n", replay.Type);
+	file.printf("  Race = %d,\n", replay.Race);
+	file.printf("  LocalPlayer = %d,\n", replay.LocalPlayer);
 	file.printf("  Players = {\n");
 	for (int i = 0; i < PlayerMax; ++i) {
-		if (!CurrentReplay->Players[i].Name.empty()) {
-			file.printf("\t{ Name = \"%s\",", CurrentReplay->Players[i].Name.c_str());
+		if (!replay.Players[i].Name.empty()) {
+			file.printf("\t{ Name = \"%s\",", replay.Players[i].Name.c_str());
 		} else {
 			file.printf("\t{");
 		}
-		file.printf(" AIScript = \"%s\",", CurrentReplay->Players[i].AIScript.c_str());
-		file.printf(" PlayerColor = %d,", CurrentReplay->Players[i].PlayerColor);
-		file.printf(" Race = %d,", CurrentReplay->Players[i].Race);
-		file.printf(" Team = %d,", CurrentReplay->Players[i].Team);
-		file.printf(" Type = %d }%s", CurrentReplay->Players[i].Type,
+		file.printf(" AIScript = \"%s\",", replay.Players[i].AIScript.c_str());
+		file.printf(" PlayerColor = %d,", replay.Players[i].PlayerColor);
+		file.printf(" Race = %d,", replay.Players[i].Race);
+		file.printf(" Team = %d,", replay.Players[i].Team);
+		file.printf(" Type = %d }%s", replay.Players[i].Type,
 					i != PlayerMax - 1 ? ",\n" : "\n");
 	}
 	file.printf("  },\n");
-	file.printf("  Resource = %d,\n", CurrentReplay->Resource);
-	file.printf("  NumUnits = %d,\n", CurrentReplay->NumUnits);
-	file.printf("  Difficulty = %d,\n", CurrentReplay->Difficulty);
-	file.printf("  NoFow = %s,\n", CurrentReplay->NoFow ? "true" : "false");
-	file.printf("  Inside = %s,\n", CurrentReplay->Inside ? "true" : "false");
-	file.printf("  RevealMap = %d,\n", CurrentReplay->RevealMap);
-	file.printf("  GameType = %d,\n", CurrentReplay->GameType);
-	file.printf("  Opponents = %d,\n", CurrentReplay->Opponents);
-	file.printf("  MapRichness = %d,\n", CurrentReplay->MapRichness);
+	file.printf("  Resource = %d,\n", replay.Resource);
+	file.printf("  NumUnits = %d,\n", replay.NumUnits);
+	file.printf("  Difficulty = %d,\n", replay.Difficulty);
+	file.printf("  NoFow = %s,\n", replay.NoFow ? "true" : "false");
+	file.printf("  Inside = %s,\n", replay.Inside ? "true" : "false");
+	file.printf("  RevealMap = %d,\n", replay.RevealMap);
+	file.printf("  GameType = %d,\n", replay.GameType);
+	file.printf("  Opponents = %d,\n", replay.Opponents);
+	file.printf("  MapRichness = %d,\n", replay.MapRichness);
+	file.printf("  PathfinderPrefetch = %s,\n", replay.PathfinderPrefetch ? "true" : "false");
+	file.printf("  PathCache = %s,\n", replay.PathCache ? "true" : "false");
 	file.printf("  Engine = { %d, %d, %d },\n",
-				CurrentReplay->Engine[0], CurrentReplay->Engine[1], CurrentReplay->Engine[2]);
+				replay.Engine[0], replay.Engine[1], replay.Engine[2]);
 	file.printf("  Network = { %d, %d, %d }\n",
-				CurrentReplay->Network[0], CurrentReplay->Network[1], CurrentReplay->Network[2]);
+				replay.Network[0], replay.Network[1], replay.Network[2]);
 	file.printf("} )\n");
-	const LogEntry *log = CurrentReplay->Commands;
+	const LogEntry *log = replay.Commands;
 	while (log) {
 		PrintLogCommand(*log, file);
 		log = log->Next;
@@ -380,24 +946,16 @@ static void SaveFullLog(CFile &file)
 /**
 **  Append the LogEntry structure at the end of currentLog, and to LogFile
 **
+**  The file is flushed once per second by CommandLogEachCycle, not after
+**  each command.
+**
 **  @param log   Pointer the replay log entry to be added
-**  @param dest  The file to output to
+**  @param file  The file to output to
 */
-static void AppendLog(LogEntry *log, CFile &file)
+static void AppendLog(LogEntry *log, CReplayWriter &file)
 {
-	LogEntry **last;
-
-	// Append to linked list
-	last = &CurrentReplay->Commands;
-	while (*last) {
-		last = &(*last)->Next;
-	}
-
-	*last = log;
-	log->Next = 0;
-
-	PrintLogCommand(*log, file);
-	file.flush();
+	AddLogEntry(*CurrentReplay, log);
+	file.WriteCommand(*log);
 }
 
 /**
@@ -444,8 +1002,8 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 		path += buf;
 		path += ".log";
 
-		LogFile = new CFile;
-		if (LogFile->open(path.c_str(), CL_OPEN_WRITE) == -1) {
+		LogFile = new CReplayWriter;
+		if (!LogFile->Open(path)) {
 			// don't retry for each command
 			CommandLogDisabled = false;
 			delete LogFile;
@@ -454,14 +1012,17 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 		}
 
 		if (CurrentReplay) {
-			SaveFullLog(*LogFile);
+			LogFile->WriteHeader(*CurrentReplay);
+			for (const LogEntry *log = CurrentReplay->Commands; log; log = log->Next) {
+				LogFile->WriteCommand(*log);
+			}
 		}
 	}
 
 	if (!CurrentReplay) {
 		CurrentReplay = StartReplay();
 
-		SaveFullLog(*LogFile);
+		LogFile->WriteHeader(*CurrentReplay);
 	}
 
 	if (!action) {
@@ -514,7 +1075,6 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 static int CclLog(lua_State *l)
 {
 	LogEntry *log;
-	LogEntry **last;
 	const char *value;
 
 	LuaCheckArgs(l, 1);
@@ -562,13 +1122,7 @@ static int CclLog(lua_State *l)
 		lua_pop(l, 1);
 	}
 
-	// Append to linked list
-	last = &CurrentReplay->Commands;
-	while (*last) {
-		last = &(*last)->Next;
-	}
-
-	*last = log;
+	AddLogEntry(*CurrentReplay, log);
 
 	return 0;
 }
@@ -666,6 +1220,10 @@ static int CclReplayLog(lua_State *l)
 			replay->Opponents = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "MapRichness")) {
 			replay->MapRichness = LuaToNumber(l, -1);
+		} else if (!strcmp(value, "PathfinderPrefetch")) {
+			replay->PathfinderPrefetch = LuaToBoolean(l, -1);
+		} else if (!strcmp(value, "PathCache")) {
+			replay->PathCache = LuaToBoolean(l, -1);
 		} else if (!strcmp(value, "Engine")) {
 			if (!lua_istable(l, -1) || lua_rawlen(l, -1) != 3) {
 				LuaError(l, "incorrect argument");
@@ -689,7 +1247,9 @@ static int CclReplayLog(lua_State *l)
 	CurrentReplay = replay;
 
 	// Apply CurrentReplay settings.
-	if (!SaveGameLoading) {
+	if (ReplayImporting) {
+		// Only converting the file
+	} else if (!SaveGameLoading) {
 		ApplyReplaySettings();
 	} else {
 		CommandLogDisabled = false;
@@ -713,7 +1273,21 @@ bool IsReplayGame()
 */
 void SaveReplayList(CFile &file)
 {
-	SaveFullLog(file);
+	SaveFullLog(*CurrentReplay, file);
+}
+
+/**
+**  Disable the command log and replay the commands of CurrentReplay
+*/
+static void BeginReplay()
+{
+	NextLogCycle = ~0UL;
+	if (!CommandLogDisabled) {
+		CommandLogDisabled = true;
+		DisabledLog = true;
+	}
+	GameObserve = true;
+	InitReplay = 1;
 }
 
 /**
@@ -726,15 +1300,19 @@ int LoadReplay(const std::string &name)
 	CleanReplayLog();
 	ReplayGameType = ReplaySinglePlayer;
 
-	LuaLoadFile(name);
-
-	NextLogCycle = ~0UL;
-	if (!CommandLogDisabled) {
-		CommandLogDisabled = true;
-		DisabledLog = true;
+	std::vector<unsigned char> data;
+	if (ReadReplayFile(name, data) && IsBinaryReplay(data)) {
+		CurrentReplay = ParseBinaryReplay(name, data);
+		if (!CurrentReplay) {
+			fprintf(stderr, "Invalid binary replay '%s'\n", name.c_str());
+			ReplayGameType = ReplayNone;
+			return -1;
+		}
+		ApplyReplaySettings();
+	} else {
+		LuaLoadFile(name);
 	}
-	GameObserve = true;
-	InitReplay = 1;
+	BeginReplay();
 
 	return 0;
 }
@@ -744,8 +1322,13 @@ int LoadReplay(const std::string &name)
 */
 void EndReplayLog()
 {
+	if (ReplayKeyframeSaving) {
+		// store the keyframe in this log, not in the one of the next game
+		WaitAsyncSave();
+	}
+	ReplayKeyframeDue = false;
 	if (LogFile) {
-		LogFile->close();
+		LogFile->Close();
 		delete LogFile;
 		LogFile = NULL;
 	}
@@ -774,6 +1357,8 @@ void CleanReplayLog()
 	GameObserve = false;
 	NetPlayers = 0;
 	ReplayGameType = ReplayNone;
+	ReplayFromKeyframe = false;
+	ReplaySeekCycle = 0;
 }
 
 /**
@@ -927,6 +1512,19 @@ static void ReplayEachCycle()
 			}
 		}
 		ReplayStep = CurrentReplay->Commands;
+		if (ReplayFromKeyframe) {
+			// Skip the commands done before the savegame. Multiplayer
+			// commands of the current cycle were already executed.
+			const unsigned long firstCycle = GameCycle + (ReplayGameType == ReplayMultiPlayer ? 1 : 0);
+			while (ReplayStep && ReplayStep->GameCycle < firstCycle) {
+				ReplayStep = ReplayStep->Next;
+			}
+			ReplayFromKeyframe = false;
+		}
+		if (ReplaySeekCycle > GameCycle) {
+			FastForwardCycle = ReplaySeekCycle;
+		}
+		ReplaySeekCycle = 0;
 		NextLogCycle = (ReplayStep ? (unsigned)ReplayStep->GameCycle : ~0UL);
 		InitReplay = 0;
 	}
@@ -1028,19 +1626,249 @@ int SaveReplay(const std::string &filename)
 	return 0;
 }
 
-void StartReplay(const std::string &filename, bool reveal)
+/**
+**  Get the file written by SaveGame for the replay keyframes
+*/
+static std::string GetKeyframeSavePath()
+{
+	std::string path = GetSaveDir() + "/" + ReplayKeyframeFile;
+#ifdef USE_ZLIB
+	path += ".gz";
+#endif
+	return path;
+}
+
+/**
+**  Start to save a keyframe of the current game for the replay log
+**
+**  The savegame is written by the asynchronous save, EndReplayKeyframe
+**  stores it in the log.
+*/
+static void SaveReplayKeyframe()
+{
+	ReplayKeyframeDue = false;
+	ReplayKeyframeSaving = true;
+	ReplayKeyframeCycle = GameCycle;
+	if (SaveGameAsync(ReplayKeyframeFile, true) == -1) {
+		ReplayKeyframeSaving = false;
+	}
+}
+
+/**
+**  Store the keyframe written by the asynchronous save in the replay log
+**
+**  @param saved  The savegame of the keyframe was written
+*/
+void EndReplayKeyframe(bool saved)
+{
+	if (!ReplayKeyframeSaving) {
+		return;
+	}
+	ReplayKeyframeSaving = false;
+	const std::string path = GetKeyframeSavePath();
+	std::vector<unsigned char> savegame;
+	if (saved && LogFile && ReadReplayFile(path, savegame)) {
+		LogFile->WriteKeyframe(ReplayKeyframeCycle, savegame);
+	}
+	unlink(path.c_str());
+	NoteFileRemoved(path.c_str());
+}
+
+/**
+**  Flush the command log each second and store its keyframes
+**
+**  Keyframes aren't saved while a replay is played. A keyframe is delayed
+**  while another save, like the autosave, is written.
+*/
+void CommandLogEachCycle()
+{
+	if (!LogFile) {
+		return;
+	}
+	if (ReplayKeyframeCycles && GameCycle % ReplayKeyframeCycles == 0 && !IsReplayGame()) {
+		ReplayKeyframeDue = true;
+	}
+	if (ReplayKeyframeDue && !IsAsyncSaveRunning()) {
+		SaveReplayKeyframe();
+	}
+	if (GameCycle % CYCLES_PER_SECOND == 0) {
+		LogFile->Flush();
+	}
+}
+
+/**
+**  Find the last keyframe of a replay before a cycle
+**
+**  @param replay     Replay with its keyframes
+**  @param seekCycle  Cycle to start the replay at
+**
+**  @return           The keyframe, NULL if the replay has none before the cycle
+*/
+const ReplayKeyframe *FindReplayKeyframe(const FullReplay &replay, unsigned long seekCycle)
+{
+	const ReplayKeyframe *keyframe = NULL;
+	for (size_t i = 0; i != replay.Keyframes.size(); ++i) {
+		const ReplayKeyframe &k = replay.Keyframes[i];
+		if (k.GameCycle <= seekCycle && (!keyframe || k.GameCycle > keyframe->GameCycle)) {
+			keyframe = &k;
+		}
+	}
+	return keyframe;
+}
+
+/**
+**  Load the last keyframe of the current replay before a cycle
+**
+**  @param seekCycle  Cycle to start the replay at
+**
+**  @return           true if the game was loaded from a keyframe
+*/
+static bool LoadReplayKeyframe(unsigned long seekCycle)
+{
+	const ReplayKeyframe *keyframe = FindReplayKeyframe(*CurrentReplay, seekCycle);
+	if (!keyframe) {
+		return false;
+	}
+
+	std::vector<unsigned char> data;
+	if (!ReadReplayFile(CurrentReplay->FileName, data)
+		|| keyframe->Offset > data.size() || keyframe->Size > data.size() - keyframe->Offset) {
+		return false;
+	}
+	const std::string path = GetKeyframeSavePath();
+	FILE *fd = fopen(path.c_str(), "wb");
+	if (!fd) {
+		fprintf(stderr, "Can't save to '%s'\n", path.c_str());
+		return false;
+	}
+	const size_t written = keyframe->Size ? fwrite(&data[keyframe->Offset], keyframe->Size, 1, fd) : 1;
+	fclose(fd);
+	if (written != 1) {
+		unlink(path.c_str());
+		return false;
+	}
+
+	// The savegame brings its own replay list, keep the one of the replay file.
+	FullReplay *replay = CurrentReplay;
+	CurrentReplay = NULL;
+	SaveGameLoading = true;
+	LoadGame(GetSaveDir() + "/" + ReplayKeyframeFile);
+	unlink(path.c_str());
+	NoteFileRemoved(path.c_str());
+
+	CleanReplayLog();
+	CurrentReplay = replay;
+	ApplyReplaySettings();
+	BeginReplay();
+	ReplayFromKeyframe = true;
+	return true;
+}
+
+/**
+**  Start a replay
+**
+**  @param filename   Name of the replay file
+**  @param reveal     Reveal the map
+**  @param seekCycle  Fast forward the replay to this cycle, from the last
+**                    keyframe before it when the replay has some
+*/
+void StartReplay(const std::string &filename, bool reveal, unsigned long seekCycle)
 {
 	std::string replay;
 
 	CleanPlayers();
 	ExpandPath(replay, filename);
-	LoadReplay(replay);
+	if (LoadReplay(replay) == -1) {
+		return;
+	}
 
 	ReplayRevealMap = reveal;
 
+	if (seekCycle) {
+		LoadReplayKeyframe(seekCycle);
+		ReplaySeekCycle = seekCycle;
+	}
+
 	StartMap(CurrentMapPath, false);
 }
 
+/**
+**  Convert a binary replay to the text format
+**
+**  @param l  Lua state.
+*/
+static int CclExportReplay(lua_State *l)
+{
+	LuaCheckArgs(l, 2);
+	std::string from;
+	std::string to;
+	ExpandPath(from, LuaToString(l, 1));
+	ExpandPath(to, LuaToString(l, 2));
+
+	FullReplay *replay = LoadBinaryReplay(from);
+	if (!replay) {
+		LuaError(l, "'%s' is not a binary replay" _C_ from.c_str());
+	}
+	CFile file;
+	if (file.open(to.c_str(), CL_OPEN_WRITE) == -1) {
+		DeleteReplay(replay);
+		LuaError(l, "Can't save to '%s'" _C_ to.c_str());
+	}
+	SaveFullLog(*replay, file);
+	file.close();
+	DeleteReplay(replay);
+	return 0;
+}
+
+/**
+**  Convert a text replay to the binary format
+**
+**  @param l  Lua state.
+*/
+static int CclImportReplay(lua_State *l)
+{
+	LuaCheckArgs(l, 2);
+	std::string from;
+	std::string to;
+	ExpandPath(from, LuaToString(l, 1));
+	ExpandPath(to, LuaToString(l, 2));
+
+	// Parse in a new replay, without touching the one of the current game.
+	FullReplay *current = CurrentReplay;
+	CurrentReplay = NULL;
+	ReplayImporting = true;
+	LuaLoadFile(from);
+	ReplayImporting = false;
+	FullReplay *replay = CurrentReplay;
+	CurrentReplay = current;
+
+	if (!replay) {
+		LuaError(l, "'%s' is not a replay" _C_ from.c_str());
+	}
+	const bool saved = SaveBinaryReplay(*replay, to);
+	DeleteReplay(replay);
+	if (!saved) {
+		LuaError(l, "Can't save to '%s'" _C_ to.c_str());
+	}
+	return 0;
+}
+
+/**
+**  Set the minutes between two keyframes of the replay log
+**
+**  @param l  Lua state.
+*/
+static int CclSetReplayKeyframeInterval(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	const int minutes = LuaToNumber(l, 1);
+	if (minutes < 0) {
+		LuaError(l, "Invalid keyframe interval: %d" _C_ minutes);
+	}
+	ReplayKeyframeCycles = minutes * CYCLES_PER_SECOND * 60;
+	return 0;
+}
+
 /**
 **  Register Ccl functions with lua
 */
@@ -1048,6 +1876,9 @@ void ReplayCclRegister()
 {
 	lua_register(Lua, "Log", CclLog);
 	lua_register(Lua, "ReplayLog", CclReplayLog);
+	lua_register(Lua, "ExportReplay", CclExportReplay);
+	lua_register(Lua, "ImportReplay", CclImportReplay);
+	lua_register(Lua, "SetReplayKeyframeInterval", CclSetReplayKeyframeInterval);
 }
 
 //@}
@@ -46,7 +46,9 @@
 #include "parameters.h"
 #include "player.h"
 #include "replay.h"
+#include "snapshot.h"
 #include "spells.h"
+#include "translate.h"
 #include "trigger.h"
 #include "ui.h"
 #include "unit.h"
@@ -55,6 +57,10 @@
 #include "upgrade.h"
 #include "version.h"
 
+#include "SDL.h"
+
+#include <algorithm>
+#include <atomic>
 #include <time.h>
 
 extern void StartMap(const std::string &filename, bool clean);
@@ -64,6 +70,21 @@ extern void StartMap(const std::string &filename, bool clean);
 --  Variables
 ----------------------------------------------------------------------------*/
 
+static const size_t AsyncSaveMaxSize = 128 * 1024 * 1024; /// Bigger snapshots are written synchronously
+static const size_t AsyncSaveBlockSize = 256 * 1024;      /// Size written between progress updates
+
+/// Save game compressed and written by a thread
+static struct {
+	SDL_Thread *Thread;              /// writing thread, NULL if no save in progress
+	CFile *File;                     /// file opened by the game thread
+	std::string Data;                /// snapshot of the game
+	std::string FileName;            /// file name of the save game
+	std::atomic<size_t> Written;     /// bytes of Data written
+	std::atomic<bool> Done;          /// the thread has finished
+	bool Failed;                     /// the file couldn't be written
+	bool Keyframe;                   /// replay keyframe, see SaveGameAsync
+} AsyncSave;
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -85,7 +106,7 @@ void ExpandPath(std::string &newpath, const std::string &path)
 /**
 ** Get the save directory and create dirs if needed
 */
-static std::string GetSaveDir()
+std::string GetSaveDir()
 {
 	struct stat tmp;
 	std::string dir(Parameters::Instance.GetUserDirectory());
@@ -101,25 +122,29 @@ static std::string GetSaveDir()
 }
 
 /**
-**  Save a game to file.
+**  Write the snapshot of the game.
 **
-**  @param filename  File name to be stored.
-**  @return  -1 if saving failed, 0 if all OK
+**  @param filename    File name of the save game, for the preview.
+**  @param out         File or memory buffer where the snapshot is written.
+**  @param replayList  Save the replay list of the game.
+**  @param maxSize     Stop as soon as the snapshot is bigger, 0 for no limit.
 **
-**  @note  Later we want to store in a more compact binary format.
+**  @return true if written, false if it failed or is bigger than maxSize.
 */
-int SaveGame(const std::string &filename)
+static bool WriteGameSnapshot(const std::string &filename, CFile &out, bool replayList = true, size_t maxSize = 0)
 {
-	CFile file;
-	std::string fullpath(GetSaveDir());
-
-	fullpath += "/";
-	fullpath += filename;
-	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
-		fprintf(stderr, "Can't save to '%s'\n", filename.c_str());
-		return -1;
+	CSnapshotWriter snapshot(out);
+	if (!snapshot.WriteHeader()) {
+		return false;
 	}
 
+	// The modules are saved as lua scripts in the sections,
+	// the map fields are saved in binary.
+	CFile file;
+	std::string script;
+	std::string fields;
+	file.openBuffer(script);
+
 	time_t now;
 	char dateStr[64];
 
@@ -128,6 +153,8 @@ int SaveGame(const std::string &filename)
 	strftime(dateStr, sizeof(dateStr), "%c", timeinfo);
 
 	// Load initial level // Without units
+	// The map script defines the triggers and the types of the map, which
+	// the savegame doesn't contain, so it is loaded again.
 	file.printf("local oldCreateUnit = CreateUnit\n");
 	file.printf("local oldSetResourcesHeld = SetResourcesHeld\n");
 	file.printf("local oldSetTile = SetTile\n");
@@ -164,14 +191,32 @@ int SaveGame(const std::string &filename)
 	SaveUnitTypes(file);
 	SaveUpgrades(file);
 	SavePlayers(file);
-	Map.Save(file);
+	Map.Save(file, false);
+	file.close();
+	Map.SaveFieldsSnapshot(fields);
+	size_t size = script.size() + fields.size();
+	if (maxSize && size > maxSize) {
+		return false;
+	}
+	bool written = snapshot.WriteSection(SNAPSHOT_SECTION_LUA, script)
+				   && snapshot.WriteSection(SNAPSHOT_SECTION_MAP_FIELDS, fields);
+
+	script.clear();
+	file.openBuffer(script);
 	UnitManager.Save(file);
+	// The units are most of the snapshot
+	if (maxSize && size + script.size() > maxSize) {
+		file.close();
+		return false;
+	}
 	SaveUserInterface(file);
 	SaveAi(file);
 	SaveSelections(file);
 	SaveGroups(file);
 	SaveMissiles(file);
-	SaveReplayList(file);
+	if (replayList) {
+		SaveReplayList(file);
+	}
 	SaveGameSettings(file);
 	// FIXME: find all state information which must be saved.
 	const std::string s = SaveGlobal(Lua);
@@ -180,9 +225,199 @@ int SaveGame(const std::string &filename)
 	}
 	SaveTriggers(file); //Triggers are saved in SaveGlobal, so load it after Global
 	file.close();
+	size += script.size();
+	if (maxSize && size > maxSize) {
+		return false;
+	}
+	return written && snapshot.WriteSection(SNAPSHOT_SECTION_LUA, script);
+}
+
+/**
+**  Save a game to file.
+**
+**  @param filename  File name to be stored.
+**  @return  -1 if saving failed, 0 if all OK
+**
+**  @note  The game is saved in a snapshot, see snapshot.h.
+*/
+int SaveGame(const std::string &filename)
+{
+	// Don't write the file while the autosave writes it
+	WaitAsyncSave();
+
+	CFile out;
+	std::string fullpath(GetSaveDir());
+
+	fullpath += "/";
+	fullpath += filename;
+	if (out.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to '%s'\n", filename.c_str());
+		return -1;
+	}
+	const bool written = WriteGameSnapshot(filename, out);
+	out.close();
+	if (!written) {
+		fprintf(stderr, "Can't save to '%s'\n", filename.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+/**
+**  Compress and write the snapshot of the asynchronous save.
+**
+**  The snapshot is written by blocks, so the game thread can show the
+**  progress.
+*/
+static int AsyncSaveThread(void *)
+{
+	const std::string &data = AsyncSave.Data;
+	bool written = true;
+
+	for (size_t offset = 0; offset < data.size() && written; offset += AsyncSaveBlockSize) {
+		const size_t size = std::min<size_t>(AsyncSaveBlockSize, data.size() - offset);
+
+		written = AsyncSave.File->write(&data[offset], size) > 0;
+		AsyncSave.Written = offset + size;
+	}
+	AsyncSave.File->close();
+	AsyncSave.Failed = !written;
+	AsyncSave.Done = true;
 	return 0;
 }
 
+/**
+**  Free the asynchronous save once its thread has finished.
+*/
+static void EndAsyncSave()
+{
+	if (AsyncSave.Thread != NULL) {
+		SDL_WaitThread(AsyncSave.Thread, NULL);
+		AsyncSave.Thread = NULL;
+	}
+	delete AsyncSave.File;
+	AsyncSave.File = NULL;
+	std::string().swap(AsyncSave.Data);
+	if (AsyncSave.Failed) {
+		fprintf(stderr, "Can't save to '%s'\n", AsyncSave.FileName.c_str());
+	}
+	if (AsyncSave.Keyframe) {
+		AsyncSave.Keyframe = false;
+		EndReplayKeyframe(!AsyncSave.Failed);
+	}
+}
+
+/**
+**  Save a game to file without stalling the game.
+**
+**  The game is serialized in memory now, the compression and the writing
+**  of the file are done by a thread. UpdateAsyncSave shows the progress.
+**  The serialization stops once the snapshot is bigger than
+**  AsyncSaveMaxSize, the game is then saved directly in the file.
+**
+**  The status line shows the autosave once it starts, not when it is
+**  skipped because another save is in progress. A replay keyframe is saved
+**  without the replay list, which the replay file already holds, and
+**  without progress in the status line.
+**  EndReplayKeyframe is called once its file is written.
+**
+**  @param filename  File name to be stored.
+**  @param keyframe  Save a keyframe of the replay.
+**  @return  -1 if saving failed or another save is in progress, 0 if started
+*/
+int SaveGameAsync(const std::string &filename, bool keyframe)
+{
+	if (AsyncSave.Thread != NULL) {
+		return -1;
+	}
+	CFile buffer;
+
+	AsyncSave.Data.clear();
+	buffer.openBuffer(AsyncSave.Data);
+	const bool serialized = WriteGameSnapshot(filename, buffer, !keyframe, AsyncSaveMaxSize);
+	buffer.close();
+	if (!serialized) {
+		std::string().swap(AsyncSave.Data);
+		if (keyframe) {
+			// a keyframe is skipped rather than stalling the game
+			fprintf(stderr, "Replay keyframe bigger than %lu bytes not saved\n", (unsigned long)AsyncSaveMaxSize);
+			return -1;
+		}
+		const int ret = SaveGame(filename);
+		UI.StatusLine.Set(ret == -1 ? _("Autosave failed") : _("Autosave done"));
+		return ret;
+	}
+	const std::string fullpath = GetSaveDir() + "/" + filename;
+	AsyncSave.File = new CFile;
+	if (AsyncSave.File->open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to '%s'\n", filename.c_str());
+		delete AsyncSave.File;
+		AsyncSave.File = NULL;
+		std::string().swap(AsyncSave.Data);
+		return -1;
+	}
+	AsyncSave.FileName = filename;
+	AsyncSave.Written = 0;
+	AsyncSave.Done = false;
+	AsyncSave.Failed = false;
+	AsyncSave.Keyframe = keyframe;
+	if (!keyframe) {
+		UI.StatusLine.Set(_("Autosave"));
+	}
+	AsyncSave.Thread = SDL_CreateThread(AsyncSaveThread, NULL);
+	if (AsyncSave.Thread == NULL) {
+		AsyncSaveThread(NULL);
+		EndAsyncSave();
+		return AsyncSave.Failed ? -1 : 0;
+	}
+	return 0;
+}
+
+/**
+**  Show the progress of the asynchronous save in the status line,
+**  called each game cycle.
+*/
+void UpdateAsyncSave()
+{
+	if (AsyncSave.Thread == NULL) {
+		return;
+	}
+	if (AsyncSave.Done) {
+		const bool keyframe = AsyncSave.Keyframe;
+
+		EndAsyncSave();
+		if (!keyframe) {
+			UI.StatusLine.Set(AsyncSave.Failed ? _("Autosave failed") : _("Autosave done"));
+		}
+		return;
+	}
+	if (AsyncSave.Keyframe) {
+		return;
+	}
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s %d%%", _("Autosave"),
+			 int(AsyncSave.Written * 100 / std::max<size_t>(1, AsyncSave.Data.size())));
+	UI.StatusLine.Set(buf);
+}
+
+/**
+**  Check if an asynchronous save is in progress.
+*/
+bool IsAsyncSaveRunning()
+{
+	return AsyncSave.Thread != NULL;
+}
+
+/**
+**  Wait for the end of the asynchronous save.
+*/
+void WaitAsyncSave()
+{
+	if (AsyncSave.Thread != NULL) {
+		EndAsyncSave();
+	}
+}
+
 /**
 **  Delete save game
 **
@@ -198,6 +433,8 @@ void DeleteSaveGame(const std::string &filename)
 	std::string fullpath = GetSaveDir() + "/" + filename;
 	if (unlink(fullpath.c_str()) == -1) {
 		fprintf(stderr, "delete failed for %s", fullpath.c_str());
+	} else {
+		NoteFileRemoved(fullpath.c_str());
 	}
 }
 
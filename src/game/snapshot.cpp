@@ -0,0 +1,139 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name snapshot.cpp - The binary savegame snapshot. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "snapshot.h"
+
+#include "iolib.h"
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+void SnapshotAppend16(std::string &out, unsigned int value)
+{
+	out += char(value & 0xFF);
+	out += char((value >> 8) & 0xFF);
+}
+
+void SnapshotAppend32(std::string &out, unsigned int value)
+{
+	SnapshotAppend16(out, value & 0xFFFF);
+	SnapshotAppend16(out, value >> 16);
+}
+
+/**
+**  Write the magic and the version of the snapshot.
+**
+**  @return true if written.
+*/
+bool CSnapshotWriter::WriteHeader()
+{
+	std::string header(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+
+	SnapshotAppend32(header, SnapshotVersion);
+	return File.write(header.data(), header.size()) > 0;
+}
+
+/**
+**  Write a section of the snapshot.
+**
+**  @param tag   4 chars tag of the section.
+**  @param data  Data of the section.
+**  @param size  Size of the data.
+**
+**  @return true if written.
+*/
+bool CSnapshotWriter::WriteSection(const char *tag, const void *data, size_t size)
+{
+	std::string header(tag, 4);
+
+	SnapshotAppend32(header, size);
+	if (File.write(header.data(), header.size()) <= 0) {
+		return false;
+	}
+	return size == 0 || File.write(data, size) > 0;
+}
+
+/**
+**  Prepare the reading of a snapshot, the data is not copied.
+**
+**  @param data  Content of the snapshot.
+**  @param size  Size of the content.
+*/
+CSnapshotReader::CSnapshotReader(const unsigned char *data, size_t size) :
+	Data(data), Size(size), Offset(SNAPSHOT_HEADER_SIZE), Version(0), Corrupt(false),
+	SectionTag(NULL), SectionData(NULL), SectionSize(0)
+{
+	if (IsSnapshot(data, size)) {
+		Version = SnapshotGet32(data + SNAPSHOT_MAGIC_SIZE);
+	} else {
+		Corrupt = true;
+	}
+}
+
+bool CSnapshotReader::IsSnapshot(const unsigned char *data, size_t size)
+{
+	return size >= SNAPSHOT_HEADER_SIZE && !memcmp(data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+}
+
+bool CSnapshotReader::NextSection()
+{
+	if (Corrupt || Offset == Size) {
+		return false;
+	}
+	if (Size - Offset < SNAPSHOT_SECTION_HEADER_SIZE) {
+		Corrupt = true;
+		return false;
+	}
+	const unsigned char *p = Data + Offset;
+	const size_t sectionSize = SnapshotGet32(p + 4);
+
+	if (Size - Offset - SNAPSHOT_SECTION_HEADER_SIZE < sectionSize) {
+		Corrupt = true;
+		return false;
+	}
+	SectionTag = p;
+	SectionData = p + SNAPSHOT_SECTION_HEADER_SIZE;
+	SectionSize = sectionSize;
+	Offset += SNAPSHOT_SECTION_HEADER_SIZE + sectionSize;
+	return true;
+}
+
+bool CSnapshotReader::IsSection(const char *tag) const
+{
+	return SectionTag != NULL && !memcmp(SectionTag, tag, 4);
+}
+
+//@}
@@ -47,6 +47,8 @@
 #include "unit_find.h"
 #include "unittype.h"
 
+#include <vector>
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
@@ -55,6 +57,20 @@ CTimer GameTimer;               /// The game timer
 static int Trigger;
 static bool *ActiveTriggers;
 
+/**
+**  Change counters of the units on the map.
+**
+**  They are increased each time a unit is inserted in or removed from the
+**  map, changes its owner or its construction state. The native trigger
+**  conditions compare them to know if their result may have changed.
+*/
+static unsigned long UnitChanges;                         /// changes of all the units
+static unsigned long PlayerUnitChanges[PlayerMax];        /// changes of the units by player
+static std::vector<unsigned long> TypeUnitChanges;        /// changes of the units by unit-type slot
+
+class CTriggerCondition;
+static std::vector<CTriggerCondition *> TriggerConditions; /// native conditions by trigger / 2
+
 /// Some data accessible for script during the game.
 TriggerDataType TriggerData;
 
@@ -154,22 +170,29 @@ static CompareFunction GetCompareFunction(const char *op)
 }
 
 /**
-**  Return the number of units of a given unit-type and player at a location.
+**  Check if a unit is of the unit-type of a trigger.
+**
+**  @param unit      Unit to check.
+**  @param unittype  Unit-type, or ANY_UNIT, ALL_FOODUNITS, ALL_BUILDINGS.
 */
-static int CclGetNumUnitsAt(lua_State *l)
+static bool IsTriggerUnitType(const CUnit &unit, const CUnitType *unittype)
 {
-	LuaCheckArgs(l, 4);
-
-	int plynr = LuaToNumber(l, 1);
-	lua_pushvalue(l, 2);
-	const CUnitType *unittype = TriggerGetUnitType(l);
-	lua_pop(l, 1);
-
-	Vec2i minPos;
-	Vec2i maxPos;
-	CclGetPos(l, &minPos.x, &minPos.y, 3);
-	CclGetPos(l, &maxPos.x, &maxPos.y, 4);
+	return unittype == ANY_UNIT
+		   || (unittype == ALL_FOODUNITS && !unit.Type->Building)
+		   || (unittype == ALL_BUILDINGS && unit.Type->Building)
+		   || unittype == unit.Type;
+}
 
+/**
+**  Return the number of units of a given unit-type and player at a location.
+**
+**  @param plynr     Player number, -1 matches any.
+**  @param unittype  Unit-type, or ANY_UNIT, ALL_FOODUNITS, ALL_BUILDINGS.
+**  @param minPos    Top left tile of the location.
+**  @param maxPos    Bottom right tile of the location.
+*/
+static int GetNumUnitsAt(int plynr, const CUnitType *unittype, const Vec2i &minPos, const Vec2i &maxPos)
+{
 	std::vector<CUnit *> units;
 
 	Select(minPos, maxPos, units);
@@ -179,10 +202,8 @@ static int CclGetNumUnitsAt(lua_State *l)
 		const CUnit &unit = *units[i];
 		// Check unit type
 
-		if (unittype == ANY_UNIT
-			|| (unittype == ALL_FOODUNITS && !unit.Type->Building)
-			|| (unittype == ALL_BUILDINGS && unit.Type->Building)
-			|| (unittype == unit.Type && !unit.Constructed)) {
+		if (IsTriggerUnitType(unit, unittype)
+			&& (unittype != unit.Type || !unit.Constructed)) {
 
 			// Check the player
 			if (plynr == -1 || plynr == unit.Player->Index) {
@@ -192,40 +213,29 @@ static int CclGetNumUnitsAt(lua_State *l)
 			}
 		}
 	}
-	lua_pushnumber(l, s);
-	return 1;
+	return s;
 }
 
 /**
-**  Player has the quantity of unit-type near to unit-type.
+**  Check if the quantity of units of a player is near a unit of a unit-type.
+**
+**  @param plynr       Player number, -1 matches any.
+**  @param compare     Comparison of the number of units with q.
+**  @param q           Quantity of units.
+**  @param unittype    Unit-type, or ANY_UNIT, ALL_FOODUNITS, ALL_BUILDINGS.
+**  @param centerType  Unit-type of the units to be near.
+**  @param rescued     Count only the rescued units.
 */
-static int CclIfNearUnit(lua_State *l)
+static bool IsNearUnit(int plynr, CompareFunction compare, int q,
+					   const CUnitType *unittype, const CUnitType &centerType, bool rescued)
 {
-	LuaCheckArgs(l, 5);
-	lua_pushvalue(l, 1);
-	const int plynr = TriggerGetPlayer(l);
-	lua_pop(l, 1);
-	const char *op = LuaToString(l, 2);
-	const int q = LuaToNumber(l, 3);
-	lua_pushvalue(l, 4);
-	const CUnitType *unittype = TriggerGetUnitType(l);
-	lua_pop(l, 1);
-	const CUnitType *ut2 = CclGetUnitType(l);
-	if (!unittype || !ut2) {
-		LuaError(l, "CclIfNearUnit: not a unit-type valid");
-	}
-	CompareFunction compare = GetCompareFunction(op);
-	if (!compare) {
-		LuaError(l, "Illegal comparison operation in if-near-unit: %s" _C_ op);
-	}
-
 	//
 	// Get all unit types 'near'.
 	//
 
 	std::vector<CUnit *> unitsOfType;
 
-	FindUnitsByType(*ut2, unitsOfType);
+	FindUnitsByType(centerType, unitsOfType);
 	for (size_t i = 0; i != unitsOfType.size(); ++i) {
 		const CUnit &centerUnit = *unitsOfType[i];
 
@@ -237,11 +247,11 @@ static int CclIfNearUnit(lua_State *l)
 		for (size_t j = 0; j < around.size(); ++j) {
 			const CUnit &unit = *around[j];
 
+			if (rescued && !unit.RescuedFrom) { // only rescued units
+				continue;
+			}
 			// Check unit type
-			if (unittype == ANY_UNIT
-				|| (unittype == ALL_FOODUNITS && !unit.Type->Building)
-				|| (unittype == ALL_BUILDINGS && unit.Type->Building)
-				|| (unittype == unit.Type)) {
+			if (IsTriggerUnitType(unit, unittype)) {
 
 				// Check the player
 				if (plynr == -1 || plynr == unit.Player->Index) {
@@ -250,11 +260,240 @@ static int CclIfNearUnit(lua_State *l)
 			}
 		}
 		if (compare(s, q)) {
-			lua_pushboolean(l, 1);
-			return 1;
+			return true;
 		}
 	}
-	lua_pushboolean(l, 0);
+	return false;
+}
+
+/**
+**  Trigger condition evaluated without Lua.
+**
+**  It is the table form of GetNumUnitsAt, IfNearUnit and IfRescuedNearUnit
+**  given to AddTrigger. The result is cached and only computed again when
+**  the units it depends on have changed.
+*/
+class CTriggerCondition
+{
+public:
+	enum ConditionType {
+		NumUnitsAt,        /// GetNumUnitsAt(player, type, pos1, pos2) op quantity
+		NearUnit,          /// IfNearUnit(player, op, quantity, type, centerType)
+		RescuedNearUnit    /// IfRescuedNearUnit(player, op, quantity, type, centerType)
+	};
+
+	CTriggerCondition() : Type(NumUnitsAt), Player(-1), UnitType(ANY_UNIT),
+		CenterType(NULL), Compare(NULL), Quantity(0), Version(0), Cached(false),
+		Result(false) {}
+
+	bool Evaluate();
+
+private:
+	unsigned long GetVersion() const;
+	bool Compute() const;
+
+public:
+	ConditionType Type;          /// kind of condition
+	int Player;                  /// player of the counted units, -1 for any
+	const CUnitType *UnitType;   /// unit-type of the counted units
+	const CUnitType *CenterType; /// unit-type to be near
+	Vec2i MinPos;                /// top left corner of the area
+	Vec2i MaxPos;                /// bottom right corner of the area
+	CompareFunction Compare;     /// comparison of the count with the quantity
+	int Quantity;                /// quantity to compare with
+private:
+	unsigned long Version;       /// unit changes when Result was computed
+	bool Cached;                 /// Result is valid for Version
+	bool Result;                 /// last result
+};
+
+/**
+**  Get the changes of a unit-type.
+*/
+static unsigned long GetTypeUnitChanges(const CUnitType &type)
+{
+	return (size_t)type.Slot < TypeUnitChanges.size() ? TypeUnitChanges[type.Slot] : 0;
+}
+
+/**
+**  Get the sum of the change counters the condition depends on.
+*/
+unsigned long CTriggerCondition::GetVersion() const
+{
+	unsigned long version;
+
+	if (UnitType != ANY_UNIT && UnitType != ALL_FOODUNITS && UnitType != ALL_BUILDINGS) {
+		version = GetTypeUnitChanges(*UnitType);
+	} else if (Player < 0 || Player >= PlayerMax) {
+		// any player, TriggerGetPlayer also accepts PlayerMax
+		version = UnitChanges;
+	} else {
+		version = PlayerUnitChanges[Player];
+	}
+	if (CenterType) {
+		version += GetTypeUnitChanges(*CenterType);
+	}
+	return version;
+}
+
+/**
+**  Compute the result of the condition.
+*/
+bool CTriggerCondition::Compute() const
+{
+	switch (Type) {
+		case NumUnitsAt:
+			return Compare(GetNumUnitsAt(Player, UnitType, MinPos, MaxPos), Quantity) != 0;
+		case NearUnit:
+			return IsNearUnit(Player, Compare, Quantity, UnitType, *CenterType, false);
+		case RescuedNearUnit:
+			return IsNearUnit(Player, Compare, Quantity, UnitType, *CenterType, true);
+	}
+	return false;
+}
+
+/**
+**  Evaluate the condition, using the last result if no unit it depends
+**  on has changed.
+*/
+bool CTriggerCondition::Evaluate()
+{
+	const unsigned long version = GetVersion();
+
+	if (!Cached || version != Version) {
+		Result = Compute();
+		Version = version;
+		Cached = true;
+	}
+	return Result;
+}
+
+/**
+**  Note a change of the units of a player and unit-type on the map.
+**
+**  @param player  Owner of the unit.
+**  @param type    Unit-type of the unit.
+*/
+void TriggerUnitChanged(const CPlayer &player, const CUnitType &type)
+{
+	++UnitChanges;
+	++PlayerUnitChanges[player.Index];
+	if ((size_t)type.Slot >= TypeUnitChanges.size()) {
+		TypeUnitChanges.resize(type.Slot + 1);
+	}
+	++TypeUnitChanges[type.Slot];
+}
+
+/**
+**  Parse the table form of a trigger condition.
+**
+**  @param l  Lua state, with the table on top of the stack.
+**
+**  @return   The new condition.
+*/
+static CTriggerCondition *CclParseTriggerCondition(lua_State *l)
+{
+	CTriggerCondition *condition = new CTriggerCondition;
+	const char *value = LuaToString(l, -1, 1);
+	const int args = lua_rawlen(l, -1);
+
+	if (!strcmp(value, "num-units-at")) {
+		if (args != 7) {
+			LuaError(l, "incorrect argument");
+		}
+		condition->Type = CTriggerCondition::NumUnitsAt;
+		lua_rawgeti(l, -1, 2);
+		condition->Player = LuaToNumber(l, -1);
+		if (condition->Player < -1 || condition->Player >= PlayerMax) {
+			LuaError(l, "bad player: %d" _C_ condition->Player);
+		}
+		lua_pop(l, 1);
+		lua_rawgeti(l, -1, 3);
+		condition->UnitType = TriggerGetUnitType(l);
+		lua_pop(l, 1);
+		lua_rawgeti(l, -1, 4);
+		CclGetPos(l, &condition->MinPos.x, &condition->MinPos.y);
+		lua_pop(l, 1);
+		lua_rawgeti(l, -1, 5);
+		CclGetPos(l, &condition->MaxPos.x, &condition->MaxPos.y);
+		lua_pop(l, 1);
+		value = LuaToString(l, -1, 6);
+		condition->Compare = GetCompareFunction(value);
+		condition->Quantity = LuaToNumber(l, -1, 7);
+	} else if (!strcmp(value, "if-near-unit") || !strcmp(value, "if-rescued-near-unit")) {
+		if (args != 6) {
+			LuaError(l, "incorrect argument");
+		}
+		condition->Type = !strcmp(value, "if-near-unit")
+						  ? CTriggerCondition::NearUnit : CTriggerCondition::RescuedNearUnit;
+		lua_rawgeti(l, -1, 2);
+		condition->Player = TriggerGetPlayer(l);
+		lua_pop(l, 1);
+		value = LuaToString(l, -1, 3);
+		condition->Compare = GetCompareFunction(value);
+		condition->Quantity = LuaToNumber(l, -1, 4);
+		lua_rawgeti(l, -1, 5);
+		condition->UnitType = TriggerGetUnitType(l);
+		lua_pop(l, 1);
+		lua_rawgeti(l, -1, 6);
+		condition->CenterType = CclGetUnitType(l);
+		lua_pop(l, 1);
+		if (!condition->UnitType || !condition->CenterType) {
+			LuaError(l, "AddTrigger: not a unit-type valid");
+		}
+	} else {
+		LuaError(l, "Unsupported trigger condition: %s" _C_ value);
+	}
+	if (!condition->Compare) {
+		LuaError(l, "Illegal comparison operation in trigger condition: %s" _C_ value);
+	}
+	return condition;
+}
+
+/**
+**  Return the number of units of a given unit-type and player at a location.
+*/
+static int CclGetNumUnitsAt(lua_State *l)
+{
+	LuaCheckArgs(l, 4);
+
+	int plynr = LuaToNumber(l, 1);
+	lua_pushvalue(l, 2);
+	const CUnitType *unittype = TriggerGetUnitType(l);
+	lua_pop(l, 1);
+
+	Vec2i minPos;
+	Vec2i maxPos;
+	CclGetPos(l, &minPos.x, &minPos.y, 3);
+	CclGetPos(l, &maxPos.x, &maxPos.y, 4);
+
+	lua_pushnumber(l, GetNumUnitsAt(plynr, unittype, minPos, maxPos));
+	return 1;
+}
+
+/**
+**  Player has the quantity of unit-type near to unit-type.
+*/
+static int CclIfNearUnit(lua_State *l)
+{
+	LuaCheckArgs(l, 5);
+	lua_pushvalue(l, 1);
+	const int plynr = TriggerGetPlayer(l);
+	lua_pop(l, 1);
+	const char *op = LuaToString(l, 2);
+	const int q = LuaToNumber(l, 3);
+	lua_pushvalue(l, 4);
+	const CUnitType *unittype = TriggerGetUnitType(l);
+	lua_pop(l, 1);
+	const CUnitType *ut2 = CclGetUnitType(l);
+	if (!unittype || !ut2) {
+		LuaError(l, "CclIfNearUnit: not a unit-type valid");
+	}
+	CompareFunction compare = GetCompareFunction(op);
+	if (!compare) {
+		LuaError(l, "Illegal comparison operation in if-near-unit: %s" _C_ op);
+	}
+	lua_pushboolean(l, IsNearUnit(plynr, compare, q, unittype, *ut2, false));
 	return 1;
 }
 
@@ -282,41 +521,7 @@ static int CclIfRescuedNearUnit(lua_State *l)
 	if (!compare) {
 		LuaError(l, "Illegal comparison operation in if-rescued-near-unit: %s" _C_ op);
 	}
-
-	// Get all unit types 'near'.
-	std::vector<CUnit *> table;
-	FindUnitsByType(*ut2, table);
-	for (size_t i = 0; i != table.size(); ++i) {
-		CUnit &centerUnit = *table[i];
-		std::vector<CUnit *> around;
-
-		SelectAroundUnit(centerUnit, 1, around);
-		// Count the requested units
-		int s = 0;
-		for (size_t j = 0; j != around.size(); ++j) {
-			CUnit &unit = *around[j];
-
-			if (unit.RescuedFrom) { // only rescued units
-				// Check unit type
-
-				if (unittype == ANY_UNIT
-					|| (unittype == ALL_FOODUNITS && !unit.Type->Building)
-					|| (unittype == ALL_BUILDINGS && unit.Type->Building)
-					|| (unittype == unit.Type)) {
-
-					// Check the player
-					if (plynr == -1 || plynr == unit.Player->Index) {
-						++s;
-					}
-				}
-			}
-		}
-		if (compare(s, q)) {
-			lua_pushboolean(l, 1);
-			return 1;
-		}
-	}
-	lua_pushboolean(l, 0);
+	lua_pushboolean(l, IsNearUnit(plynr, compare, q, unittype, *ut2, true));
 	return 1;
 }
 
@@ -424,11 +629,14 @@ void ActionStopTimer()
 
 /**
 **  Add a trigger.
+**
+**  The condition is a function, or a table of a condition evaluated
+**  natively (see CclParseTriggerCondition).
 */
 static int CclAddTrigger(lua_State *l)
 {
 	LuaCheckArgs(l, 2);
-	if (!lua_isfunction(l, 1)
+	if ((!lua_isfunction(l, 1) && !lua_istable(l, 1))
 		|| (!lua_isfunction(l, 2) && !lua_istable(l, 2))) {
 		LuaError(l, "incorrect argument");
 	}
@@ -446,12 +654,18 @@ static int CclAddTrigger(lua_State *l)
 	}
 
 	const int i = lua_rawlen(l, -1);
+	TriggerConditions.resize(i / 2 + 1);
 	if (ActiveTriggers && !ActiveTriggers[i / 2]) {
 		lua_pushnil(l);
 		lua_rawseti(l, -2, i + 1);
 		lua_pushnil(l);
 		lua_rawseti(l, -2, i + 2);
 	} else {
+		if (lua_istable(l, 1)) {
+			lua_pushvalue(l, 1);
+			TriggerConditions[i / 2] = CclParseTriggerCondition(l);
+			lua_pop(l, 1);
+		}
 		lua_pushvalue(l, 1);
 		lua_rawseti(l, -2, i + 1);
 		lua_newtable(l);
@@ -523,14 +737,34 @@ static int TriggerExecuteAction(int script)
 */
 static void TriggerRemoveTrigger(int trig)
 {
+	if ((size_t)trig / 2 < TriggerConditions.size()) {
+		delete TriggerConditions[trig / 2];
+		TriggerConditions[trig / 2] = NULL;
+	}
 	lua_pushnumber(Lua, -1);
 	lua_rawseti(Lua, -2, trig + 1);
 	lua_pushnumber(Lua, -1);
 	lua_rawseti(Lua, -2, trig + 2);
 }
 
+/**
+**  Get the native condition of a trigger.
+**
+**  @param trig  Current trigger
+**
+**  @return      The native condition, or NULL for a Lua condition.
+*/
+static CTriggerCondition *GetTriggerCondition(int trig)
+{
+	return (size_t)trig / 2 < TriggerConditions.size() ? TriggerConditions[trig / 2] : NULL;
+}
+
 /**
 **  Check trigger each game cycle.
+**
+**  The triggers are checked in order, one Lua condition each cycle.
+**  The native conditions before it are checked in the same cycle, as
+**  they are cheap when no unit they depend on has changed.
 */
 void TriggersEachCycle()
 {
@@ -548,27 +782,39 @@ void TriggersEachCycle()
 		return;
 	}
 
-	// Skip to the next trigger
-	while (Trigger < triggers) {
+	while (Trigger < triggers && !GamePaused) {
+		// Skip to the next trigger
 		lua_rawgeti(Lua, -1, Trigger + 1);
-		if (!lua_isnumber(Lua, -1)) {
-			break;
+		if (lua_isnumber(Lua, -1)) {
+			lua_pop(Lua, 1);
+			Trigger += 2;
+			continue;
 		}
-		lua_pop(Lua, 1);
-		Trigger += 2;
-	}
-	if (Trigger < triggers) {
-		int currentTrigger = Trigger;
+		const int currentTrigger = Trigger;
 		Trigger += 2;
-		LuaCall(0, 0);
+
+		CTriggerCondition *condition = GetTriggerCondition(currentTrigger);
+		bool result;
+		if (condition) {
+			lua_pop(Lua, 1);
+			result = condition->Evaluate();
+		} else {
+			LuaCall(0, 0);
+			result = lua_gettop(Lua) > base + 1 && lua_toboolean(Lua, -1);
+		}
 		// If condition is true execute action
-		if (lua_gettop(Lua) > base + 1 && lua_toboolean(Lua, -1)) {
+		if (result) {
 			lua_settop(Lua, base + 1);
 			if (TriggerExecuteAction(currentTrigger + 1)) {
 				TriggerRemoveTrigger(currentTrigger);
 			}
 		}
 		lua_settop(Lua, base + 1);
+		if (!condition) {
+			break;
+		}
+		// The actions may have added triggers
+		triggers = lua_rawlen(Lua, -1);
 	}
 	lua_pop(Lua, 1);
 }
@@ -660,6 +906,14 @@ void CleanTriggers()
 
 	Trigger = 0;
 
+	for (size_t i = 0; i != TriggerConditions.size(); ++i) {
+		delete TriggerConditions[i];
+	}
+	TriggerConditions.clear();
+	UnitChanges = 0;
+	memset(PlayerUnitChanges, 0, sizeof(PlayerUnitChanges));
+	TypeUnitChanges.clear();
+
 	delete[] ActiveTriggers;
 	ActiveTriggers = NULL;
 
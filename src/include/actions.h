@@ -98,6 +98,9 @@ public:
 	}
 	virtual ~COrder();
 
+	void *operator new(size_t size);
+	void operator delete(void *p, size_t size);
+
 	virtual COrder *Clone() const = 0;
 	virtual void Execute(CUnit &unit) = 0;
 	virtual void Cancel(CUnit &unit) {}
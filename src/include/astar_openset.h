@@ -0,0 +1,106 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name astar_openset.h - The open node set of the a* path finder. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __ASTAR_OPENSET_H__
+#define __ASTAR_OPENSET_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <vector>
+#include "vec2i.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Node of the open set.
+**
+**  Nodes are ordered by Costs, then by CostToGoal, then by Dist.
+*/
+struct AStarOpenNode {
+	Vec2i pos;
+	short int Costs;          /// complete costs to goal
+	short int CostToGoal;     /// estimated cost to goal
+	short int Dist;           /// manhattan distance to goal
+	unsigned short int O;     /// Offset into matrix
+};
+
+/**
+**  Open set stored in buckets of equal costs.
+**
+**  The costs are small integers, so a bucket holds all the nodes with
+**  the same costs. The nodes are in the order of the array sorted by
+**  decreasing costs the path finder used before: when a new node has the
+**  same costs, CostToGoal and Dist as other nodes, the binary search of
+**  that array is replayed from the bucket sizes to place it between them,
+**  so the paths found don't change.
+*/
+class AStarOpenSet
+{
+public:
+	enum {MaxCosts = 32768}; /// Costs must be lower than this value
+
+	AStarOpenSet(int mapSize, int maxSize);
+	~AStarOpenSet();
+
+	int Size() const { return size; }
+	int MaxSize() const { return maxSize; }
+
+	bool Push(const AStarOpenNode &node);
+	AStarOpenNode PopMinimum();
+	bool Contains(int o) const { return costsAt[o] != -1; }
+	void Requeue(int o);
+	void Clear();
+
+	void GetNodes(std::vector<AStarOpenNode> &nodes) const;
+
+private:
+	AStarOpenSet(const AStarOpenSet &); // not implemented
+	void operator=(const AStarOpenSet &); // not implemented
+
+	void Insert(const AStarOpenNode &node);
+	void Remove(int costs, int index);
+	int CountHigher(int costs) const;
+
+private:
+	std::vector<std::vector<AStarOpenNode> > buckets; /// nodes by costs
+	short int *costsAt;   /// costs of the open node for each offset, or -1
+	int mapSize;
+	int size;
+	int maxSize;
+	int minCosts;         /// lowest non empty bucket
+	int maxCosts;         /// highest bucket used since the last clear
+};
+
+//@}
+
+#endif // !__ASTAR_OPENSET_H__
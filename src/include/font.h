@@ -89,6 +89,7 @@ public:
 	int Width(const std::string &text) const;
 	int Width(const int number) const;
 	bool IsLoaded() const;
+	const CGraphic *GetGraphic() const { return G; }
 
 	virtual int getHeight() const { return Height(); }
 	virtual int getWidth(const std::string &text) const { return Width(text); }
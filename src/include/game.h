@@ -29,13 +29,19 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <stdio.h>
 #include <string>
 
 class CFile;
 
 extern void LoadGame(const std::string &filename); /// Load saved game
 extern int SaveGame(const std::string &filename); /// Save game
+extern int SaveGameAsync(const std::string &filename, bool keyframe = false); /// Save game, written by a thread
+extern void UpdateAsyncSave();               /// Show the progress of the asynchronous save
+extern bool IsAsyncSaveRunning();            /// Check if an asynchronous save is in progress
+extern void WaitAsyncSave();                 /// Wait for the end of the asynchronous save
 extern void DeleteSaveGame(const std::string &filename); /// Delete save game
+extern std::string GetSaveDir();              /// Directory of the save games
 extern bool SaveGameLoading;                 /// Save game is in progress of loading
 
 extern void InitModules();              /// Initialize all modules
@@ -45,6 +51,10 @@ extern void CleanModules();             /// Cleanup all modules
 
 extern void FreeAllContainers();
 
+extern void StartLoadPhase(const char *name);  /// Start to time a phase of a load
+extern void EndLoadPhases(const char *load);   /// Keep the times of the phases of a load
+extern void PrintLoadTimes(FILE *file);        /// Print the times of the last loads
+
 extern void SaveGameSettings(CFile &file);             /// Save game settings
 
 extern std::string GameName;                /// Name of the game
@@ -36,6 +36,7 @@
 --  Includes
 ----------------------------------------------------------------------------*/
 
+#include <stdio.h>
 #include <vector>
 
 /*----------------------------------------------------------------------------
@@ -105,9 +106,11 @@ public:
 	~CFile();
 
 	int open(const char *name, long flags);
+	int openBuffer(std::string &buffer);
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
+	int write(const void *buf, size_t len);
 	int seek(long offset, int whence);
 	long tell();
 
@@ -124,7 +127,8 @@ enum {
 	CLF_TYPE_INVALID,  /// invalid file handle
 	CLF_TYPE_PLAIN,    /// plain text file handle
 	CLF_TYPE_GZIP,     /// gzip file handle
-	CLF_TYPE_BZIP2     /// bzip2 file handle
+	CLF_TYPE_BZIP2,    /// bzip2 file handle
+	CLF_TYPE_BUFFER    /// memory buffer handle, write only
 };
 
 #define CL_OPEN_READ 0x1
@@ -141,6 +145,15 @@ extern std::string LibraryFileName(const char *file);
 
 extern bool CanAccessFile(const char *filename);
 
+/// Note that the engine has written a file, for the index of the data files
+extern void NoteFileWritten(const char *filename);
+/// Note that the engine has removed a file, for the index of the data files
+extern void NoteFileRemoved(const char *filename);
+/// Enable or disable the index of the data files
+extern void SetFileIndexEnabled(bool enabled);
+/// Print the statistics of the searches of the library files
+extern void PrintFileLookupStatistics(FILE *file);
+
 /// Read the contents of a directory
 extern int ReadDataDirectory(const char *dirname, std::vector<FileList> &flp);
 
@@ -83,6 +83,7 @@
 ----------------------------------------------------------------------------*/
 
 #include <string>
+#include <vector>
 
 #ifndef __MAP_TILE_H__
 #include "tile.h"
@@ -141,6 +142,60 @@ public:
 	unsigned int MapUID;        /// Unique Map ID (hash)
 };
 
+/*----------------------------------------------------------------------------
+--  Map visibility
+----------------------------------------------------------------------------*/
+
+/**
+**  Visibility counters of the map fields.
+**
+**  The counters of a player are stored in their own plane, one counter
+**  by field in the order of the fields, so the sight of a unit only
+**  touches the memory of its player. A counter is 0 when the field is
+**  unexplored, 1 when explored and n+1 when n units see the field.
+**
+**  The rectangles where the fields of the local player changed their
+**  visibility state are kept, so the fog of war is only computed again
+**  where it changed.
+*/
+class CMapVisibility
+{
+public:
+	CMapVisibility() : FieldCount(0), AllDirty(true) {}
+
+	/// Create the planes for this number of fields, all unexplored.
+	void Create(unsigned int fieldCount);
+	/// Free the planes.
+	void Clean();
+
+	/// Counters of a player, by field index.
+	unsigned short *Plane(int player) { return &Counters[player * FieldCount]; }
+	const unsigned short *Plane(int player) const { return &Counters[player * FieldCount]; }
+
+	/// Get the counter of a player for a field.
+	unsigned short Get(int player, unsigned int index) const { return Counters[player * FieldCount + index]; }
+
+	/// Note that the visibility state changed in this rectangle.
+	void MarkDirty(const Vec2i &minPos, const Vec2i &maxPos);
+	/// Note that the visibility state changed everywhere.
+	void MarkAllDirty() { AllDirty = true; DirtyRects.clear(); }
+	/// Forget the changes, they have been handled.
+	void ClearDirty() { AllDirty = false; DirtyRects.clear(); }
+
+	bool IsAllDirty() const { return AllDirty; }
+	size_t GetDirtyRectCount() const { return DirtyRects.size() / 2; }
+	const Vec2i &GetDirtyMinPos(size_t i) const { return DirtyRects[2 * i]; }
+	const Vec2i &GetDirtyMaxPos(size_t i) const { return DirtyRects[2 * i + 1]; }
+
+private:
+	enum {MaxDirtyRects = 512}; /// More changes mark all the map dirty
+
+	std::vector<unsigned short> Counters; /// PlayerMax planes of counters
+	unsigned int FieldCount;              /// number of fields in a plane
+	std::vector<Vec2i> DirtyRects;        /// min and max pos of the rectangles
+	bool AllDirty;                        /// all the map changed
+};
+
 /*----------------------------------------------------------------------------
 --  Map itself
 ----------------------------------------------------------------------------*/
@@ -199,12 +254,48 @@ public:
 	/// Mark a tile as seen by the player.
 	void MarkSeenTile(CMapField &mf);
 
+	/// Check if a field for the user is explored.
+	bool IsFieldExplored(const CPlayer &player, unsigned int index) const;
+	bool IsFieldExplored(const CPlayer &player, const Vec2i &pos) const
+	{
+		return IsFieldExplored(player, getIndex(pos));
+	}
+	/// @note Manage Map.NoFogOfWar
+	bool IsFieldVisible(const CPlayer &player, unsigned int index) const;
+	bool IsFieldVisible(const CPlayer &player, const Vec2i &pos) const
+	{
+		return IsFieldVisible(player, getIndex(pos));
+	}
+	bool IsFieldTeamVisible(const CPlayer &player, unsigned int index) const;
+	bool IsFieldTeamVisible(const CPlayer &player, const Vec2i &pos) const
+	{
+		return IsFieldTeamVisible(player, getIndex(pos));
+	}
+	/**
+	**  Find out how a field is seen (By player, or by shared vision)
+	**
+	**  @param player   Player to check for.
+	**  @param index    Index of the field.
+	**  @note manage fogOfWar (using Map.NoFogOfWar)
+	**
+	**  @return        0 unexplored, 1 explored, 2 visible.
+	*/
+	unsigned char FieldTeamVisibilityState(const CPlayer &player, unsigned int index) const;
+	unsigned char FieldTeamVisibilityState(const CPlayer &player, const Vec2i &pos) const
+	{
+		return FieldTeamVisibilityState(player, getIndex(pos));
+	}
+
 	/// Regenerate the forest.
 	void RegenerateForest();
 	/// Reveal the complete map, make everything known.
 	void Reveal();
-	/// Save the map.
-	void Save(CFile &file) const;
+	/// Save the map, the fields can be saved by SaveFieldsSnapshot.
+	void Save(CFile &file, bool fields = true) const;
+	/// Save the fields in a savegame snapshot section.
+	void SaveFieldsSnapshot(std::string &out) const;
+	/// Load the fields from a savegame snapshot section.
+	bool LoadFieldsSnapshot(const unsigned char *data, size_t size);
 
 	//
 	// Wall
@@ -231,6 +322,9 @@ public:
 	/// Remove unit from cache
 	void Remove(CUnit &unit);
 
+	/// Update the cache for the new owner of a unit
+	void ChangeUnitOwner(const CUnit &unit, const CPlayer &oldPlayer);
+
 	void Clamp(Vec2i &pos) const;
 
 	//Warning: we expect typical usage as xmin = x - range
@@ -265,6 +359,8 @@ public:
 	static CGraphic *FogGraphic;      /// graphic for fog of war
 
 	CMapInfo Info;             /// descriptive information
+	CUnitCellGrid UnitCells;   /// players of the units by cell of tiles
+	CMapVisibility Visibility; /// visibility counters of the players
 };
 
 
@@ -315,6 +411,9 @@ extern MapMarkerFunc MapUnmarkTileDetectCloak;
 /// Mark sight changes
 extern void MapSight(const CPlayer &player, const Vec2i &pos, int w,
 					 int h, int range, MapMarkerFunc *marker);
+/// Mark sight changes, only where it is not seen from an other position
+extern void MapSightDelta(const CPlayer &player, const Vec2i &pos, const Vec2i &otherPos,
+						  int w, int h, int range, MapMarkerFunc *marker);
 /// Update fog of war
 extern void UpdateFogOfWarChange();
 
@@ -335,6 +434,12 @@ extern MapMarkerFunc MapMarkTileRadarJammer;
 extern MapMarkerFunc MapUnmarkTileRadarJammer;
 
 
+//
+// in map_draw.cpp
+//
+/// Free the cached terrain chunks of the map background
+extern void FreeTerrainChunks();
+
 //
 // in map_wall.c
 //
@@ -385,6 +490,10 @@ extern void PreprocessMap();
 void MapMarkUnitSight(CUnit &unit);
 /// Unmark on vision table the Sight of the unit.
 void MapUnmarkUnitSight(CUnit &unit);
+/// Unmark on vision table the Sight of the unit lost by moving to a tile.
+void MapUnmarkUnitSightMoving(CUnit &unit, const Vec2i &newPos);
+/// Mark on vision table the Sight of the unit gained by moving from a tile.
+void MapMarkUnitSightMoved(CUnit &unit, const Vec2i &oldPos);
 
 /*----------------------------------------------------------------------------
 --  Defines
@@ -35,6 +35,7 @@
 #include "color.h"
 #include "vec2i.h"
 
+class CUnit;
 class CViewport;
 
 struct SDL_Surface;
@@ -54,6 +55,11 @@ class CMinimap
 	template <const int BPP>
 	void UpdateSeen(void *const pixels, const int pitch);
 
+	void DrawTerrainArea(int x, int y, int w, int h);
+	void DrawFogArea(int x, int y, int w, int h);
+	void UpdateAll(int red_phase);
+	void UpdateDirty(int red_phase);
+
 public:
 	CMinimap() : X(0), Y(0), W(0), H(0), XOffset(0), YOffset(0),
 		WithTerrain(false), ShowSelected(false),
@@ -62,6 +68,9 @@ public:
 	void UpdateXY(const Vec2i &pos);
 	void UpdateSeenXY(const Vec2i &) {}
 	void Update();
+	void MarkDirty(const Vec2i &minPos, const Vec2i &maxPos);
+	void MarkUnitDirty(const CUnit &unit);
+	void MarkAllDirty();
 	void Create();
 #if defined(USE_OPENGL) || defined(USE_GLES)
 	void FreeOpenGL();
@@ -418,6 +418,9 @@ protected:
 public:
 	virtual ~Missile();
 
+	void *operator new(size_t size);
+	void operator delete(void *p, size_t size);
+
 	static Missile *Init(const MissileType &mtype, const PixelPos &startPos, const PixelPos &destPos);
 
 	virtual void Action() = 0;
@@ -609,6 +612,8 @@ extern void FindAndSortMissiles(const CViewport &vp, std::vector<Missile *> &tab
 
 /// handle all missiles
 extern void MissileActions();
+/// measure the missile actions with many missiles
+extern void PrintMissileBenchmark(FILE *file, const MissileType &mtype, int count, int cycles);
 /// distance from view point to missile
 extern int ViewPointDistanceToMissile(const Missile &missile);
 
@@ -75,7 +75,7 @@ public:
 	CServerSetup() { Clear(); }
 	size_t Serialize(unsigned char *p) const;
 	size_t Deserialize(const unsigned char *p);
-	static size_t Size() { return 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 * PlayerMax + 1 * PlayerMax + 1 * PlayerMax; }
+	static size_t Size() { return 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 * PlayerMax + 1 * PlayerMax + 1 * PlayerMax; }
 	void Clear();
 
 	bool operator == (const CServerSetup &rhs) const;
@@ -91,6 +91,8 @@ public:
 	uint8_t Difficulty;            /// Difficulty option
 	uint8_t MapRichness;           /// Map richness option
 	uint8_t Opponents;             /// Number of AI opponents
+	uint8_t PathfinderPrefetch;    /// Compute the paths at the start of the cycles
+	uint8_t PathCache;             /// Units going to the same goal share their paths
 	uint8_t CompOpt[PlayerMax];    /// Free slot option selection  {"Available", "Computer", "Closed" }
 	uint8_t Ready[PlayerMax];      /// Client ready state
 	uint8_t Race[PlayerMax];       /// Client race selection
@@ -160,7 +162,7 @@ private:
 	CInitMessage_Header header;
 public:
 	char PlyName[NetPlayerNameSize];  /// Name of player
-	int32_t Stratagus;  /// Stratagus engine version
+	int32_t Stratagus;  /// Network protocol version of the engine
 	uint32_t Version;   /// Lua files version
 };
 
@@ -191,7 +193,7 @@ public:
 private:
 	CInitMessage_Header header;
 public:
-	int32_t Stratagus;  /// Stratagus engine version
+	int32_t Stratagus;  /// Network protocol version of the engine
 };
 
 class CInitMessage_LuaFilesMismatch
@@ -379,18 +381,28 @@ public:
 
 /**
 **  Network sync message.
+**
+**  It also carries the time the sender sent it and echoes the time of
+**  the last sync received from one of the hosts, to measure the
+**  round-trip time of the links, and the lag wanted by the sender.
 */
 class CNetworkCommandSync
 {
 public:
-	CNetworkCommandSync() : syncSeed(0), syncHash(0) {}
+	CNetworkCommandSync() : syncSeed(0), syncHash(0), pingTime(0), echoTime(0),
+		echoDelay(0), echoPlayer(255), lag(0) {}
 	size_t Serialize(unsigned char *buf) const;
 	size_t Deserialize(const unsigned char *buf);
-	static size_t Size() { return 4 + 4; };
+	static size_t Size() { return 4 + 4 + 4 + 4 + 2 + 1 + 1; };
 
 public:
 	uint32_t syncSeed;
 	uint32_t syncHash;
+	uint32_t pingTime;   /// Ticks of the sender when sent
+	uint32_t echoTime;   /// Ticks of echoPlayer when it sent its last sync
+	uint16_t echoDelay;  /// Ms between the receive of that sync and this one
+	uint8_t echoPlayer;  /// Player whose sync is echoed, 255 for none
+	uint8_t lag;         /// Lag wanted by the sender (# game cycles), 0 if unknown
 };
 
 /**
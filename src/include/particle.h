@@ -33,6 +33,8 @@
 
 #include <vector>
 
+#include "vec2i.h"
+
 class CGraphic;
 class CViewport;
 
@@ -47,47 +49,42 @@ class GraphicAnimation
 {
 	CGraphic *g;
 	int ticksPerFrame;
-	int currentFrame;
-	int currTicks;
 public:
 	GraphicAnimation(CGraphic *g, int ticksPerFrame);
 	~GraphicAnimation() {}
 
-	/**
-	**  Draw the current frame of the animation.
-	**  @param x x screen coordinate where to draw the animation.
-	**  @param y y screen coordinate where to draw the animation.
-	*/
-	void draw(int x, int y);
-
-	/**
-	**  Update the animation.
-	**  @param ticks the number of ticks elapsed since the last call.
-	*/
-	void update(int ticks);
-
-	bool isFinished();
-	bool isVisible(const CViewport &vp, const CPosition &pos);
+	void *operator new(size_t size);
+	void operator delete(void *p, size_t size);
+
+	CGraphic *getGraphic() const { return g; }
+	int getTicksPerFrame() const { return ticksPerFrame; }
+
 	GraphicAnimation *clone();
 };
 
 
+class CParticleManager;
 
-// Base particle class
+/**
+**  Base particle class.
+**
+**  The particles created by the scripts are only descriptions: when
+**  they are added to the particle manager, their state is copied in
+**  the arrays of the manager and the object is deleted.
+*/
 class CParticle
 {
 public:
 	CParticle(CPosition position, int drawlevel = 0) :
-		pos(position), destroyed(false), drawLevel(drawlevel)
+		pos(position), drawLevel(drawlevel)
 	{}
 	virtual ~CParticle() {}
 
-	virtual bool isVisible(const CViewport &vp) const = 0;
-	virtual void draw() = 0;
-	virtual void update(int) = 0;
+	void *operator new(size_t size);
+	void operator delete(void *p, size_t size);
 
-	inline void destroy() { destroyed = true; }
-	inline bool isDestroyed() { return destroyed; }
+	/// Copy the particle in the arrays of the particle manager
+	virtual void addTo(CParticleManager &manager) const = 0;
 
 	virtual CParticle *clone() = 0;
 
@@ -96,7 +93,6 @@ public:
 
 protected:
 	CPosition pos;
-	bool destroyed;
 	int drawLevel;
 };
 
@@ -105,15 +101,12 @@ class StaticParticle : public CParticle
 {
 public:
 	StaticParticle(CPosition position, GraphicAnimation *flame, int drawlevel = 0);
-	virtual ~StaticParticle();
 
-	virtual bool isVisible(const CViewport &vp) const;
-	virtual void draw();
-	virtual void update(int ticks);
+	virtual void addTo(CParticleManager &manager) const;
 	virtual CParticle *clone();
 
 protected:
-	GraphicAnimation *animation;
+	GraphicAnimation animation;
 };
 
 
@@ -125,11 +118,8 @@ public:
 				   GraphicAnimation *destroyAnimation,
 				   int minVelocity = 0, int maxVelocity = 400,
 				   int minTrajectoryAngle = 77, int maxTTL = 0, int drawlevel = 0);
-	virtual ~CChunkParticle();
 
-	virtual bool isVisible(const CViewport &vp) const;
-	virtual void draw();
-	virtual void update(int ticks);
+	virtual void addTo(CParticleManager &manager) const;
 	virtual CParticle *clone();
 	int getSmokeDrawLevel() const { return smokeDrawLevel; }
 	int getDestroyDrawLevel() const { return destroyDrawLevel; }
@@ -137,22 +127,18 @@ public:
 	void setDestroyDrawLevel(int value) { destroyDrawLevel = value; }
 
 protected:
-	CPosition initialPos;
 	int initialVelocity;
 	float trajectoryAngle;
 	int maxTTL;
-	int nextSmokeTicks;
 	int lifetime;
-	int age;
 	int minVelocity;
 	int maxVelocity;
 	int minTrajectoryAngle;
-	float height;
 	int smokeDrawLevel;
 	int destroyDrawLevel;
-	GraphicAnimation *debrisAnimation;
-	GraphicAnimation *smokeAnimation;
-	GraphicAnimation *destroyAnimation;
+	GraphicAnimation debrisAnimation;
+	GraphicAnimation smokeAnimation;
+	GraphicAnimation destroyAnimation;
 
 	struct {
 		float x;
@@ -166,15 +152,12 @@ class CSmokeParticle : public CParticle
 {
 public:
 	CSmokeParticle(CPosition position, GraphicAnimation *animation, float speedx = 0, float speedy = -22.0f, int drawlevel = 0);
-	virtual ~CSmokeParticle();
 
-	virtual bool isVisible(const CViewport &vp) const;
-	virtual void draw();
-	virtual void update(int ticks);
+	virtual void addTo(CParticleManager &manager) const;
 	virtual CParticle *clone();
 
 protected:
-	GraphicAnimation *puff;
+	GraphicAnimation puff;
 	struct {
 		float x;
 		float y;
@@ -185,21 +168,86 @@ class CRadialParticle : public CParticle
 {
 public:
 	CRadialParticle(CPosition position, GraphicAnimation *animation, int maxSpeed, int drawlevel = 0);
-	virtual ~CRadialParticle();
 
-	virtual bool isVisible(const CViewport &vp) const;
-	virtual void draw();
-	virtual void update(int ticks);
+	virtual void addTo(CParticleManager &manager) const;
 	virtual CParticle *clone();
 
 protected:
-	GraphicAnimation *animation;
+	GraphicAnimation animation;
 	float direction;
 	int speed;
 	int maxSpeed;
 };
 
 
+/**
+**  Animated particles of one kind, stored as a structure of arrays so
+**  that the update loops only touch the fields they need.
+*/
+class CParticleArray
+{
+public:
+	void add(const CPosition &pos, const GraphicAnimation &animation,
+			 float speedx, float speedy, int drawLevel);
+	void animate(int ticks);
+	void move(float scale);
+	void removeFinished();
+	void clear();
+
+	size_t size() const { return X.size(); }
+
+	std::vector<float> X;              /// map pixel position
+	std::vector<float> Y;
+	std::vector<float> SpeedX;         /// speed, in pixels per second or per update
+	std::vector<float> SpeedY;
+	std::vector<CGraphic *> Graphic;   /// animation sheet
+	std::vector<int> TicksPerFrame;    /// ticks to display each frame
+	std::vector<int> NumFrames;        /// frames of the sheet
+	std::vector<int> Frame;            /// current frame
+	std::vector<int> FrameTicks;       /// ticks of the current frame
+	std::vector<int> DrawLevel;        /// draw level
+};
+
+/// Gravity of the chunk particles, in pixels per second squared
+static const int ChunkGravity = 32 * 12;
+
+/**
+**  Chunk particles, stored as a structure of arrays.
+*/
+class CChunkArray
+{
+public:
+	void removeDestroyed();
+	void clear();
+
+	size_t size() const { return X.size(); }
+
+	std::vector<float> X;              /// map pixel position
+	std::vector<float> Y;
+	std::vector<float> Height;         /// height above the ground
+	std::vector<float> InitialX;       /// position of the explosion
+	std::vector<float> InitialY;
+	std::vector<float> SpeedX;         /// horizontal speed, in pixels per second
+	std::vector<float> SpeedY;
+	std::vector<float> SpeedZ;         /// initial vertical speed
+	std::vector<int> Age;              /// ticks since the explosion
+	std::vector<int> Lifetime;         /// ticks until the chunk hits the ground
+	std::vector<int> NextSmokeTicks;   /// age of the next smoke puff
+	std::vector<CGraphic *> Graphic;   /// debris animation sheet
+	std::vector<int> TicksPerFrame;
+	std::vector<int> NumFrames;
+	std::vector<int> Frame;
+	std::vector<int> FrameTicks;
+	std::vector<int> DrawLevel;
+	std::vector<CGraphic *> SmokeGraphic;    /// smoke puff animation
+	std::vector<int> SmokeTicksPerFrame;
+	std::vector<int> SmokeDrawLevel;
+	std::vector<CGraphic *> DestroyGraphic;  /// animation when hitting the ground
+	std::vector<int> DestroyTicksPerFrame;
+	std::vector<int> DestroyDrawLevel;
+};
+
+
 class CParticleManager
 {
 public:
@@ -209,7 +257,8 @@ public:
 	static void init();
 	static void exit();
 
-	void prepareToDraw(const CViewport &vp, std::vector<CParticle *> &table);
+	void prepareToDraw(const CViewport &vp);
+	void drawUpTo(int drawLevel);
 	void endDraw();
 
 	void update();
@@ -217,15 +266,43 @@ public:
 	void add(CParticle *particle);
 	void clear();
 
-	CPosition getScreenPos(const CPosition &pos) const;
+	void addStatic(const CPosition &pos, const GraphicAnimation &animation, int drawLevel);
+	void addSmoke(const CPosition &pos, const GraphicAnimation &animation,
+				  float speedx, float speedy, int drawLevel);
+	void addRadial(const CPosition &pos, const GraphicAnimation &animation,
+				   float speedx, float speedy, int drawLevel);
+	void addChunk(const CPosition &pos, const GraphicAnimation &debris,
+				  const GraphicAnimation &smoke, const GraphicAnimation &destroy,
+				  float speedx, float speedy, float speedz, int lifetime,
+				  int drawLevel, int smokeDrawLevel, int destroyDrawLevel);
+
+	size_t getCount() const;
 
 	inline void setLowDetail(bool detail) { lowDetail = detail; }
 	inline bool getLowDetail() const { return lowDetail; }
 
 private:
-	std::vector<CParticle *> particles;
-	std::vector<CParticle *> new_particles;
-	const CViewport *vp;
+	void updateChunks(int ticks);
+	void addToDraw(CGraphic *g, unsigned frame, int x, int y, int drawLevel);
+
+	/// Visible particles of a sheet
+	struct DrawBatch {
+		CGraphic *Graphic;
+		std::vector<unsigned> Frames;
+		std::vector<PixelPos> Positions;
+	};
+	/// Visible particles of a draw level
+	struct DrawBucket {
+		int DrawLevel;
+		std::vector<DrawBatch> Batches;
+	};
+
+	CParticleArray staticParticles;
+	CParticleArray smokeParticles;
+	CParticleArray radialParticles;
+	CChunkArray chunkParticles;
+	std::vector<DrawBucket> buckets;    /// sorted by draw level
+	size_t nextBucket;                  /// first bucket not drawn
 	unsigned long lastTicks;
 	bool lowDetail;
 };
@@ -43,10 +43,12 @@
 ----------------------------------------------------------------------------*/
 
 #include <queue>
+#include "astar_openset.h"
 #include "vec2i.h"
 
 class CUnit;
 class CFile;
+class PathCache;
 struct lua_State;
 
 /**
@@ -120,6 +122,73 @@ public:
 };
 
 
+/**
+**  State of one A* search.
+**
+**  Each context owns its buffers, so several paths can be searched
+**  at the same time from different threads (one context per thread).
+**  The map and the units must not be modified during the search.
+*/
+class PathSearchContext
+{
+public:
+	PathSearchContext(int mapWidth, int mapHeight);
+	~PathSearchContext();
+
+	int FindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				 int tilesizex, int tilesizey, int minrange, int maxrange,
+				 char *path, int pathlen, const CUnit &unit);
+
+	struct Node {
+		int CostFromStart;     /// Real costs to reach this point
+		short int CostToGoal;  /// Estimated cost to goal
+		char InGoal;           /// is this point in the goal
+		char Direction;        /// Direction for trace back
+	};
+	typedef AStarOpenNode Open;
+
+	const Node *GetMatrix() const { return matrix; }
+	const AStarOpenSet &GetOpenSet() const { return openSet; }
+
+	/// Set the cache of the found paths, NULL to disable it
+	void SetCache(PathCache *pathCache) { cache = pathCache; }
+
+	/// Mark the tile as goal if the unit can move on it
+	void MarkGoalTile(int offset, const CUnit &unit, bool *goal_reachable);
+
+private:
+	PathSearchContext(const PathSearchContext &); // not implemented
+	void operator=(const PathSearchContext &); // not implemented
+
+	void Prepare();
+	void CleanUp();
+	void CostMoveToCacheCleanUp();
+	int AddNode(const Vec2i &pos, int o, int costs);
+	void ReplaceNode(int eo);
+	bool FindNode(int eo) const;
+	void AddToClose(int node);
+	int CostMoveTo(unsigned int index, const CUnit &unit);
+	int MarkGoal(const Vec2i &goal, int gw, int gh, int tilesizex, int tilesizey,
+				 int minrange, int maxrange, const CUnit &unit);
+	int SavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen) const;
+	int FindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw, int gh,
+					   int minrange, int maxrange, char *path, const CUnit &unit);
+
+private:
+	int mapWidth;
+	int mapHeight;
+	int heading2O[9];     /// heading to offset
+	Node *matrix;         /// cost matrix
+	int matrixSize;
+	int *closeSet;        /// close nodes, helps to speed up the matrix cleaning
+	int closeSetSize;
+	int threshold;
+	AStarOpenSet openSet; /// nodes to visit
+	int *costMoveToCache;
+	Vec2i goal;
+	PathCache *cache;     /// found paths, can be NULL
+};
+
 //
 //  Terrain traversal stuff.
 //
@@ -200,6 +269,18 @@ extern bool AStarKnowUnseenTerrain;
 /// Cost of using a square we haven't seen before.
 extern int AStarUnknownTerrainCost;
 
+/// Path finder algorithms
+enum PathfinderModes {
+	PathfinderModeFlat,         /// A* on the whole map
+	PathfinderModeHierarchical  /// HPA*, A* on clusters then refined by the flat A*
+};
+
+/// Path finder algorithm used for units
+extern int PathfinderMode;
+
+/// Number of threads computing the paths of the moving units, see GameSettings.PathfinderPrefetch
+extern int PathfinderThreads;
+
 //
 //  Convert heading into direction.
 //  N NE  E SE  S SW  W NW
@@ -223,6 +304,8 @@ extern int UnitReachable(const CUnit &unit, const CUnit &dst, int range);
 /// Can the unit 'src' reach the place x,y
 extern int PlaceReachable(const CUnit &src, const Vec2i &pos, int w, int h,
 						  int minrange, int maxrange);
+/// Compute the new paths of the moving units
+extern void PathfinderPrefetch(const std::vector<CUnit *> &units, unsigned int tableVersion);
 
 //
 // in astar.cpp
@@ -237,8 +320,18 @@ extern int GetAStarMovingUnitCrossingCost();
 extern void SetAStarUnknownTerrainCost(int cost);
 extern int GetAStarUnknownTerrainCost();
 
+extern void AStarInvalidatePathCache();
+extern void AStarGetCacheStats(unsigned long *hits, unsigned long *misses);
+
 extern void PathfinderCclRegister();
 
+//
+// in hpastar.cpp
+//
+
+/// Passability of the tiles changed (terrain, walls, buildings)
+extern void PathfinderTerrainChanged(const Vec2i &pos, const Vec2i &size);
+
 //@}
 
 #endif // !__PATH_FINDER_H__
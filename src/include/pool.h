@@ -0,0 +1,144 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name pool.h - The object pools headerfile. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <vector>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Pool of objects of the same size.
+**
+**  The objects are allocated in slabs which are only freed with the
+**  pool, so an object keeps its address while it is alive. Freed
+**  objects are kept in a free list and reused first.
+*/
+class CObjectPool
+{
+public:
+	CObjectPool(size_t objectSize, size_t objectsPerSlab);
+	~CObjectPool();
+
+	void *Alloc();
+	void Free(void *object);
+
+	size_t GetObjectSize() const { return objectSize; }
+	size_t GetSlabCount() const { return slabs.size(); }
+	size_t GetCapacity() const { return slabs.size() * objectsPerSlab; }
+	size_t GetUsedCount() const { return usedCount; }
+	size_t GetPeakCount() const { return peakCount; }
+
+private:
+	CObjectPool(const CObjectPool &); // not implemented
+	void operator=(const CObjectPool &); // not implemented
+
+	void AddSlab();
+
+private:
+	struct FreeObject {
+		FreeObject *Next;
+	};
+
+	std::vector<char *> slabs;  /// allocated memory
+	FreeObject *freeList;       /// objects ready to be reused
+	size_t objectSize;          /// size of an object, aligned
+	size_t objectsPerSlab;      /// number of objects in a slab
+	size_t usedCount;           /// objects in use
+	size_t peakCount;           /// max objects in use
+};
+
+/**
+**  Pools of a class hierarchy.
+**
+**  Each size of the derived classes (rounded to Alignment) has its own
+**  pool. Classes use it from their operator new and operator delete:
+**
+**  void *operator new(size_t size) { return Pool.Alloc(size); }
+**  void operator delete(void *p, size_t size) { Pool.Free(p, size); }
+**
+**  The class pools are static objects without destructor: their memory
+**  is made by InitClassPools and freed by CleanClassPools, so an object
+**  deleted by the destructor of another static object still finds its
+**  pool. They aren't thread safe, only the game thread allocates and
+**  frees the objects.
+*/
+class CClassPool
+{
+public:
+	enum {
+		Alignment = 16,   /// Alignment of the objects
+		MaxSize = 4096,   /// Bigger objects use the global operator new
+		PoolCount = MaxSize / Alignment + 1, /// Pools of a class, by size
+		MaxClassPools = 8 /// Class pools of the engine
+	};
+
+	CClassPool(const char *name, size_t objectsPerSlab);
+
+	void Init();
+	void Clean();
+
+	void *Alloc(size_t size);
+	void Free(void *object, size_t size);
+
+	void PrintStatistics(FILE *file) const;
+
+private:
+	CClassPool(const CClassPool &); // not implemented
+	void operator=(const CClassPool &); // not implemented
+
+private:
+	const char *name;                    /// name in the statistics
+	size_t objectsPerSlab;               /// objects per slab of the pools
+	CObjectPool **pools;                 /// pools by size / Alignment, NULL before Init
+	size_t bigCount;                     /// objects allocated with new
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Make the memory of all the class pools
+extern void InitClassPools();
+/// Free the memory of all the class pools
+extern void CleanClassPools();
+/// Print the occupancy of all the class pools
+extern void PrintPoolStatistics(FILE *file);
+
+//@}
+
+#endif // !__POOL_H__
@@ -0,0 +1,130 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name profiler.h - The profiler headerfile. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <atomic>
+#include <string>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Named zone of code measured by the profiler.
+**
+**  Declared once with PROFILE_ZONE, where the zone begins.
+*/
+struct CProfileZoneInfo {
+	explicit CProfileZoneInfo(const char *name) : Name(name), StatIndex(-1) {}
+
+	const char *Name;       /// name shown in the overlay and the trace
+	int StatIndex;          /// statistics of the overlay, only used by the main thread
+};
+
+/**
+**  Time spent in a zone, from the construction to the destruction.
+**
+**  Costs a test of ProfilerEnabled when the profiler is disabled.
+*/
+class CProfileZone
+{
+public:
+	explicit CProfileZone(CProfileZoneInfo &info);
+	~CProfileZone();
+
+private:
+	CProfileZone(const CProfileZone &); // not implemented
+	void operator=(const CProfileZone &); // not implemented
+
+private:
+	CProfileZoneInfo *info;        /// measured zone, NULL if not recording
+	unsigned long long begin;      /// time of the beginning of the zone
+};
+
+/**
+**  Measure the time spent until the end of the scope.
+**
+**  @param name  Name of the zone, a string literal.
+*/
+#define PROFILE_ZONE(name) \
+	static CProfileZoneInfo profileZoneInfo(name); \
+	CProfileZone profileZone(profileZoneInfo)
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+extern std::atomic<bool> ProfilerEnabled; /// Zones are recorded, read by all the threads
+extern bool ShowProfiler;        /// Draw the profiler overlay
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Time of the profiler clock, in nanoseconds
+extern unsigned long long GetProfileTime();
+/// Record the end of a zone
+extern void EndProfileZone(CProfileZoneInfo &info, unsigned long long begin);
+
+/// Start or stop the recording of the zones
+extern void SetProfilerEnabled(bool enabled);
+/// Mark the end of a displayed frame
+extern void ProfileFrame();
+/// Draw the frame times and the time of each zone
+extern void DrawProfilerOverlay();
+/// Save the recorded zones in the Chrome trace format
+extern bool SaveProfilerTrace(const std::string &filename);
+
+/// Register ccl features
+extern void ProfilerCclRegister();
+
+inline CProfileZone::CProfileZone(CProfileZoneInfo &info) : info(NULL), begin(0)
+{
+	if (ProfilerEnabled.load(std::memory_order_relaxed)) {
+		this->info = &info;
+		this->begin = GetProfileTime();
+	}
+}
+
+inline CProfileZone::~CProfileZone()
+{
+	if (this->info) {
+		EndProfileZone(*this->info, this->begin);
+	}
+}
+
+//@}
+
+#endif // !__PROFILER_H__
@@ -68,8 +68,14 @@ extern void CommandLog(const char *action, const CUnit *unit, int flush,
 extern void SinglePlayerReplayEachCycle();
 /// Replay user commands from log each cycle, multiplayer games
 extern void MultiPlayerReplayEachCycle();
+/// Flush the command log and store its keyframes each cycle
+extern void CommandLogEachCycle();
+/// Store the keyframe written by the asynchronous save in the replay log
+extern void EndReplayKeyframe(bool saved);
 /// Load replay
 extern int LoadReplay(const std::string &name);
+/// Start a replay, optionally at a cycle
+extern void StartReplay(const std::string &filename, bool reveal, unsigned long seekCycle);
 /// End logging
 extern void EndReplayLog();
 /// Clean replay
@@ -0,0 +1,204 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name replay_format.h - The binary replay format headerfile. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __REPLAY_FORMAT_H__
+#define __REPLAY_FORMAT_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <map>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  LogEntry structure.
+*/
+class LogEntry
+{
+public:
+	LogEntry() : GameCycle(0), Flush(0), PosX(0), PosY(0), DestUnitNumber(0),
+		Num(0), SyncRandSeed(0), Next(NULL)
+	{
+		UnitNumber = 0;
+	}
+
+	unsigned long GameCycle;
+	int UnitNumber;
+	std::string UnitIdent;
+	std::string Action;
+	int Flush;
+	int PosX;
+	int PosY;
+	int DestUnitNumber;
+	std::string Value;
+	int Num;
+	unsigned SyncRandSeed;
+	LogEntry *Next;
+};
+
+/**
+**  Multiplayer Player definition
+*/
+class MPPlayer
+{
+public:
+	MPPlayer() : PlayerColor(0), Race(0), Team(0), Type(0) {}
+
+	std::string Name;
+	std::string AIScript;
+	int PlayerColor;
+	int Race;
+	int Team;
+	int Type;
+};
+
+/**
+**  Savegame stored in a binary replay, to start the replay at its cycle.
+*/
+class ReplayKeyframe
+{
+public:
+	ReplayKeyframe() : GameCycle(0), Offset(0), Size(0) {}
+
+	unsigned long GameCycle;  /// Cycle when the game was saved
+	size_t Offset;            /// Offset of the savegame in the replay file
+	size_t Size;              /// Size of the savegame
+};
+
+/**
+** Full replay structure (definition + logs)
+*/
+class FullReplay
+{
+public:
+	FullReplay() :
+		MapId(0), Type(0), Race(0), LocalPlayer(0),
+		Resource(0), NumUnits(0), Difficulty(0), NoFow(false), Inside(false), RevealMap(0),
+		MapRichness(0), GameType(0), Opponents(0), PathfinderPrefetch(false), PathCache(false),
+		Commands(NULL), LastCommand(NULL)
+	{
+		memset(Engine, 0, sizeof(Engine));
+		memset(Network, 0, sizeof(Network));
+	}
+	std::string Comment1;
+	std::string Comment2;
+	std::string Comment3;
+	std::string Date;
+	std::string Map;
+	std::string MapPath;
+	unsigned MapId;
+
+	int Type;
+	int Race;
+	int LocalPlayer;
+	MPPlayer Players[PlayerMax];
+
+	int Resource;
+	int NumUnits;
+	int Difficulty;
+	bool NoFow;
+	bool Inside;
+	int RevealMap;
+	int MapRichness;
+	int GameType;
+	int Opponents;
+	bool PathfinderPrefetch;                /// Paths computed at the start of the cycles
+	bool PathCache;                         /// Units going to the same goal share their paths
+	int Engine[3];
+	int Network[3];
+	LogEntry *Commands;
+	LogEntry *LastCommand;                  /// Last entry of Commands, to append in O(1)
+	std::string FileName;                   /// Binary replay file, to read the keyframes
+	std::vector<ReplayKeyframe> Keyframes;  /// Savegames of a binary replay, by cycle
+};
+
+/**
+**  Writer of the binary replay format.
+**
+**  The file starts with ReplayMagic and ReplayVersion, followed by
+**  records beginning with their ReplayRecord tag. Numbers are stored as
+**  varints (7 bits per byte, low bits first), signed numbers zigzag
+**  encoded. A string is written once in a ReplayRecordString record and
+**  then referenced by its index, so the unit-type idents and actions of
+**  the commands take one or two bytes.
+**
+**  Closing the file appends the keyframe index, its offset on 8 bytes
+**  and ReplayIndexMagic. A log of a crashed game has no index, the
+**  keyframes are then found while reading the records.
+*/
+class CReplayWriter
+{
+public:
+	CReplayWriter() : File(NULL), Offset(0), LastCycle(0) {}
+	~CReplayWriter() { Close(); }
+
+	bool Open(const std::string &filename);
+	void Close();
+	void Flush();
+
+	void WriteHeader(const FullReplay &replay);
+	void WriteCommand(const LogEntry &log);
+	void WriteKeyframe(unsigned long gameCycle, const std::vector<unsigned char> &savegame);
+
+private:
+	unsigned long Intern(const std::string &s);
+	void WriteRecord();
+
+private:
+	FILE *File;                                    /// Replay file
+	size_t Offset;                                 /// Bytes written in the file
+	unsigned long LastCycle;                       /// Cycle of the last command
+	std::map<std::string, unsigned long> Strings;  /// Index of the written strings
+	std::vector<unsigned char> Record;             /// Record being encoded
+	std::vector<ReplayKeyframe> Keyframes;         /// Written keyframes
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Free a replay from memory
+extern void DeleteReplay(FullReplay *replay);
+/// Read a whole file in memory
+extern bool ReadReplayFile(const std::string &filename, std::vector<unsigned char> &data);
+/// Parse a binary replay
+extern FullReplay *ParseBinaryReplay(const std::string &filename, const std::vector<unsigned char> &data);
+/// Find the last keyframe of a replay before a cycle
+extern const ReplayKeyframe *FindReplayKeyframe(const FullReplay &replay, unsigned long seekCycle);
+
+//@}
+
+#endif // !__REPLAY_FORMAT_H__
@@ -69,6 +69,8 @@ enum {
 extern lua_State *Lua;
 
 extern int LuaLoadFile(const std::string &file, const std::string &strArg = "");
+extern int LuaLoadBuffer(const char *buffer, size_t size, const std::string &name);
+extern bool GetFileContent(const std::string &file, std::string &content);
 extern int LuaCall(int narg, int clear, bool exitOnError = true);
 
 #define LuaError(l, args) \
@@ -193,6 +195,11 @@ struct UnitDesc;
 */
 struct StringDesc;
 
+/**
+**  Compiled number or string description.
+*/
+class CScriptProgram;
+
 /// for Bin operand  a ?? b
 struct BinOp {
 	NumberDesc *Left;           /// Left operand.
@@ -240,6 +247,7 @@ struct NumberDesc {
 			StringDesc *ResType;  /// Resource type
 		} PlayerData; /// conditional string.
 	} D;
+	mutable CScriptProgram *Program; /// Compiled description, see EvalNumber.
 };
 
 /**
@@ -286,6 +294,7 @@ struct StringDesc {
 		ES_GameInfo GameInfoType;
 		NumberDesc *PlayerName;  /// Player name.
 	} D;
+	mutable CScriptProgram *Program; /// Compiled description, see EvalString.
 };
 
 /*----------------------------------------------------------------------------
@@ -0,0 +1,151 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name script_program.h - The compiled number and string descriptions headerfile. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __SCRIPT_PROGRAM_H__
+#define __SCRIPT_PROGRAM_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "script.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Number or string description compiled in a flat stack program.
+**
+**  The constant parts of the description are folded when compiling,
+**  and the variables of the units and unit-types are stored with their
+**  index in the instructions. The program gives the same results, with
+**  the same side effects, as the evaluation of the description tree.
+*/
+class CScriptProgram
+{
+public:
+	static CScriptProgram *Compile(const NumberDesc &number);
+	static CScriptProgram *Compile(const StringDesc &s);
+	~CScriptProgram();
+
+	int EvalNumber() const;
+	std::string EvalString() const;
+
+	size_t GetInstructionCount() const { return Code.size(); }
+
+	static void PrintBenchmark(FILE *file, int iterations);
+
+private:
+	CScriptProgram();
+	CScriptProgram(const CScriptProgram &); // not implemented
+	void operator=(const CScriptProgram &); // not implemented
+
+	/// Instruction codes
+	enum OpCode {
+		OpPushNumber,      /// push Arg
+		OpLuaNumber,       /// push the result of the lua function Arg
+		OpAdd,             /// a + b
+		OpSub,             /// a - b
+		OpMul,             /// a * b
+		OpDiv,             /// a / b, 0 if b is 0
+		OpMin,             /// Min(a, b)
+		OpMax,             /// Max(a, b)
+		OpGt,              /// a  > b
+		OpGtEq,            /// a >= b
+		OpLt,              /// a  < b
+		OpLtEq,            /// a <= b
+		OpEq,              /// a == b
+		OpNEq,             /// a != b
+		OpRand,            /// random number in [0..a-1]
+		OpUnitVar,         /// component of a unit variable
+		OpTypeVar,         /// component of a unit-type variable
+		OpVideoTextLength, /// width of the string with the font
+		OpStringFind,      /// position of the char Arg in the string
+		OpPlayerData,      /// data of a player
+		OpJump,            /// go to Arg
+		OpJumpIfZero,      /// pop a number, go to Arg if it is 0
+		OpJumpIfEmpty,     /// go to Arg if the string is empty
+		OpPushString,      /// push the string constant Arg
+		OpLuaString,       /// push the result of the lua function Arg
+		OpConcat,          /// concatenation of the Arg last strings
+		OpNumberToString,  /// 42 -> "42"
+		OpInverseVideo,    /// "a" -> "~<a~>"
+		OpUnitName,        /// name of the unit-type of a unit
+		OpSubStringCheck,  /// empty string and go to Arg if begin is out of the string
+		OpSubString,       /// substring(s, begin, end)
+		OpLineCheck,       /// empty string and go to Arg if line <= 0
+		OpLine,            /// line of the string
+		OpPlayerName       /// name of a player
+	};
+
+	/// Instruction of the program
+	struct Instruction {
+		OpCode Op;                 /// what to do
+		int Arg;                   /// value, index, jump or count
+		int Index;                 /// variable index
+		EnumVariable Component;    /// variable component
+		const void *Ptr;           /// unit, unit-type reference or font
+	};
+
+	size_t Emit(OpCode op, int arg = 0, const void *ptr = NULL);
+	void CompileNumber(const NumberDesc &number);
+	void CompileString(const StringDesc &s);
+	void AllocateStacks();
+	void Run() const;
+
+private:
+	std::vector<Instruction> Code;              /// instructions
+	std::vector<std::string> Strings;           /// string constants
+	mutable std::vector<int> Numbers;           /// number stack
+	mutable std::vector<std::string> Texts;     /// string stack, reused between runs
+	const NumberDesc *SourceNumber;             /// description of a number program
+	const StringDesc *SourceString;             /// description of a string program
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Evaluate the number description tree, without compiling it
+extern int EvalNumberTree(const NumberDesc *number);
+/// Evaluate the string description tree, without compiling it
+extern std::string EvalStringTree(const StringDesc *s);
+/// Call the lua function of a number description
+extern int CallLuaNumberFunction(unsigned int handler);
+/// Call the lua function of a string description
+extern std::string CallLuaStringFunction(unsigned int handler);
+
+//@}
+
+#endif // !__SCRIPT_PROGRAM_H__
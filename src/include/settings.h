@@ -81,6 +81,8 @@ struct Settings {
 	bool Inside;     /// If game uses interior tileset
 	int RevealMap;   /// Reveal map
 	int MapRichness; /// Map richness
+	bool PathfinderPrefetch; /// Compute the paths of the moving units at the start of the cycles
+	bool PathCache;  /// Units going to the same goal share their paths
 };
 
 #define SettingsPresetMapDefault  -1  /// Special: Use map supplied
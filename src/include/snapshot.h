@@ -0,0 +1,139 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name snapshot.h - The binary savegame snapshot headerfile. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <string>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+class CFile;
+
+#define SNAPSHOT_MAGIC "STRATSNP"       /// first bytes of a snapshot
+#define SNAPSHOT_MAGIC_SIZE 8           /// size of the magic
+#define SNAPSHOT_HEADER_SIZE 12         /// magic and version
+#define SNAPSHOT_SECTION_HEADER_SIZE 8  /// tag and size of a section
+
+static const unsigned int SnapshotVersion = 1; /// version of the snapshot format
+
+#define SNAPSHOT_SECTION_LUA "LUA "     /// lua script, run when loading
+#define SNAPSHOT_SECTION_MAP_FIELDS "MAPF" /// fields of the map, see CMap::SaveFieldsSnapshot
+
+/**
+**  Write a savegame snapshot.
+**
+**  A snapshot is the magic, the version, then a list of sections.
+**  A section is a 4 chars tag, its size and its data, the numbers are
+**  32 bits little endian. The sections are loaded in the order they
+**  were written.
+*/
+class CSnapshotWriter
+{
+public:
+	explicit CSnapshotWriter(CFile &file) : File(file) {}
+
+	bool WriteHeader();
+	bool WriteSection(const char *tag, const void *data, size_t size);
+	bool WriteSection(const char *tag, const std::string &data) { return WriteSection(tag, data.data(), data.size()); }
+
+private:
+	CFile &File; /// file written
+};
+
+/**
+**  Read the sections of a savegame snapshot in memory.
+*/
+class CSnapshotReader
+{
+public:
+	CSnapshotReader(const unsigned char *data, size_t size);
+
+	/// Check if the data starts like a snapshot.
+	static bool IsSnapshot(const unsigned char *data, size_t size);
+
+	unsigned int GetVersion() const { return Version; }
+	/// Go to the next section, false at the end or if the data is truncated.
+	bool NextSection();
+	/// Check if all the data has been read without error.
+	bool IsAtEnd() const { return !Corrupt && Offset == Size; }
+
+	bool IsSection(const char *tag) const;
+	const unsigned char *GetSectionData() const { return SectionData; }
+	size_t GetSectionSize() const { return SectionSize; }
+
+private:
+	const unsigned char *Data;          /// snapshot data
+	size_t Size;                        /// size of the data
+	size_t Offset;                      /// offset of the next section
+	unsigned int Version;               /// version of the snapshot
+	bool Corrupt;                       /// truncated or bad header
+	const unsigned char *SectionTag;    /// tag of the current section
+	const unsigned char *SectionData;   /// data of the current section
+	size_t SectionSize;                 /// size of the current section
+};
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Append a 16 bits little endian number
+extern void SnapshotAppend16(std::string &out, unsigned int value);
+/// Append a 32 bits little endian number
+extern void SnapshotAppend32(std::string &out, unsigned int value);
+
+/// Store a 16 bits little endian number
+inline void SnapshotPut16(unsigned char *p, unsigned int value)
+{
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+}
+
+/// Get a 16 bits little endian number
+inline unsigned int SnapshotGet16(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/// Get a 32 bits little endian number
+inline unsigned int SnapshotGet32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+//@}
+
+#endif // !__SNAPSHOT_H__
@@ -151,6 +151,9 @@ extern bool IsMusicEnabled();
 /// Check if music is playing
 extern bool IsMusicPlaying();
 
+/// Measure the mixing kernels
+extern void PrintMixerBenchmark(FILE *file, int channels, int iterations);
+
 /// Check if sound is enabled
 extern bool SoundEnabled();
 /// Initialize the sound card.
@@ -170,6 +170,8 @@ extern const char NameLine[];
 
 extern std::string StratagusLibPath;        /// Location of stratagus data
 extern std::string MenuRace;
+extern unsigned long HeadlessCycles;        /// Cycles to simulate in headless mode
+extern std::string HeadlessSaveFile;        /// Savegame written at the end of the headless mode
 
 extern unsigned long GameCycle;             /// Game simulation cycle counter
 extern unsigned long FastForwardCycle;      /// Game Replay Fast Forward Counter
@@ -47,12 +47,6 @@
 **    This is the tile number, that the player sitting on the computer
 **    currently knows. Idea: Can be uses for illusions.
 **
-**  CMapFieldPlayerInfo::Visible[]
-**
-**    Counter how many units of the player can see this field. 0 the
-**    field is not explored, 1 explored, n-1 unit see it. Currently
-**    no more than 253 units can see a field.
-**
 **  CMapFieldPlayerInfo::VisCloak[]
 **
 **    Visiblity for cloaking.
@@ -152,31 +146,13 @@ class CMapFieldPlayerInfo
 public:
 	CMapFieldPlayerInfo() : SeenTile(0)
 	{
-		memset(Visible, 0, sizeof(Visible));
 		memset(VisCloak, 0, sizeof(VisCloak));
 		memset(Radar, 0, sizeof(Radar));
 		memset(RadarJammer, 0, sizeof(RadarJammer));
 	}
 
-	/// Check if a field for the user is explored.
-	bool IsExplored(const CPlayer &player) const;
-
-	/// @note Manage Map.NoFogOfWar
-	bool IsVisible(const CPlayer &player) const;
-	bool IsTeamVisible(const CPlayer &player) const;
-	/**
-	**  Find out how a field is seen (By player, or by shared vision)
-	**
-	**  @param player   Player to check for.
-	**  @note manage fogOfWar (using Map.NoFogOfWar)
-	**
-	**  @return        0 unexplored, 1 explored, 2 visible.
-	*/
-	unsigned char TeamVisibilityState(const CPlayer &player) const;
-
 public:
 	unsigned short SeenTile;              /// last seen tile (FOW)
-	unsigned short Visible[PlayerMax];    /// Seen counter 0 unexplored
 	unsigned char VisCloak[PlayerMax];    /// Visiblity for cloaking.
 	unsigned char Radar[PlayerMax];       /// Visiblity for radar.
 	unsigned char RadarJammer[PlayerMax]; /// Jamming capabilities.
@@ -188,8 +164,13 @@ class CMapField
 public:
 	CMapField();
 
-	void Save(CFile &file) const;
-	void parse(lua_State *l);
+	void Save(CFile &file, unsigned int index) const;
+	void parse(lua_State *l, unsigned int index);
+
+	/// Size of a field in a savegame snapshot
+	enum {SnapshotSize = 8};
+	void SaveSnapshot(unsigned char *p) const;
+	void LoadSnapshot(const unsigned char *p);
 
 	void setTileIndex(const CTileset &tileset, unsigned int tileIndex, int value);
 
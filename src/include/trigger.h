@@ -36,6 +36,7 @@
 --  Declarations
 ----------------------------------------------------------------------------*/
 
+class CPlayer;
 class CUnit;
 class CUnitType;
 struct lua_State;
@@ -97,6 +98,8 @@ extern TriggerDataType TriggerData;
 extern int TriggerGetPlayer(lua_State *l);/// get player number.
 extern const CUnitType *TriggerGetUnitType(lua_State *l); /// get the unit-type
 extern void TriggersEachCycle();    /// test triggers
+/// Note a change of the units of a player and unit-type on the map
+extern void TriggerUnitChanged(const CPlayer &player, const CUnitType &type);
 
 extern void TriggerCclRegister();   /// Register ccl features
 extern void SaveTriggers(CFile &file); /// Save the trigger module
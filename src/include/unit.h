@@ -121,6 +121,9 @@ class CUnit
 public:
 	CUnit() : tilePos(-1, -1), pathFinderData(NULL), SavedOrder(NULL), NewOrder(NULL), CriticalOrder(NULL) { Init(); }
 
+	void *operator new(size_t size);
+	void operator delete(void *p, size_t size);
+
 	void Init();
 
 	COrder *CurrentOrder() const { return Orders[0]; }
@@ -339,7 +342,6 @@ public:
 	// DISPLAY:
 	int         Frame;      /// Image frame: <0 is mirrored
 	CUnitColors *Colors;    /// Player colors
-	bool IndividualUpgrades[UpgradeMax];      /// individual upgrades which the unit has
 
 	signed char IX;         /// X image displacement to map position
 	signed char IY;         /// Y image displacement to map position
@@ -371,21 +373,6 @@ public:
 	unsigned TeamSelected;  /// unit is selected by a team member.
 	CPlayer *RescuedFrom;        /// The original owner of a rescued unit.
 	/// NULL if the unit was not rescued.
-	/* Seen stuff. */
-	int VisCount[PlayerMax];     /// Unit visibility counts
-	struct _seen_stuff_ {
-		_seen_stuff_() : CFrame(NULL), Type(NULL), tilePos(-1, -1) {}
-		const CConstructionFrame  *CFrame;  /// Seen construction frame
-		int         Frame;                  /// last seen frame/stage of buildings
-		const CUnitType  *Type;             /// Pointer to last seen unit-type
-		Vec2i       tilePos;                /// Last unit->tilePos Seen
-		signed char IX;                     /// Seen X image displacement to map position
-		signed char IY;                     /// seen Y image displacement to map position
-		unsigned    Constructed : 1;        /// Unit seen construction
-		unsigned    State : 3;              /// Unit seen build/upgrade state
-unsigned    Destroyed : PlayerMax;  /// Unit seen destroyed or not
-unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
-	} Seen;
 
 	CVariable *Variable; /// array of User Defined variables.
 
@@ -414,6 +401,25 @@ unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
 	int *SpellCoolDownTimers;   /// how much time unit need to wait before spell will be ready
 
 	CUnit *Goal; /// Generic/Teleporter goal pointer
+
+	// The big arrays are at the end, so the fields used at each cycle
+	// (above) stay in a few cache lines.
+	bool IndividualUpgrades[UpgradeMax];      /// individual upgrades which the unit has
+	/* Seen stuff. */
+	int VisCount[PlayerMax];     /// Unit visibility counts
+	struct _seen_stuff_ {
+		_seen_stuff_() : CFrame(NULL), Type(NULL), tilePos(-1, -1) {}
+		const CConstructionFrame  *CFrame;  /// Seen construction frame
+		int         Frame;                  /// last seen frame/stage of buildings
+		const CUnitType  *Type;             /// Pointer to last seen unit-type
+		Vec2i       tilePos;                /// Last unit->tilePos Seen
+		signed char IX;                     /// Seen X image displacement to map position
+		signed char IY;                     /// seen Y image displacement to map position
+		unsigned    Constructed : 1;        /// Unit seen construction
+		unsigned    State : 3;              /// Unit seen build/upgrade state
+unsigned    Destroyed : PlayerMax;  /// Unit seen destroyed or not
+unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
+	} Seen;
 };
 
 #define NoUnitP (CUnit *)0        /// return value: for no unit found
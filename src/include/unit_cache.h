@@ -38,6 +38,8 @@
 #include <vector>
 #include <algorithm>
 
+#include "vec2i.h"
+
 /*----------------------------------------------------------------------------
 --  Declarations
 ----------------------------------------------------------------------------*/
@@ -228,6 +230,64 @@ public:
 };
 
 
+/**
+**  Coarse grid of the unit caches.
+**
+**  The map is cut in cells of CellSize x CellSize tiles. For each cell,
+**  the grid counts the tiles of the cell occupied by the units of each
+**  player, so that the searches can skip the empty cells and the cells
+**  without units of the wanted players without visiting their tiles.
+**
+**  It is kept up to date by CMap::Insert and CMap::Remove.
+*/
+class CUnitCellGrid
+{
+public:
+	enum {
+		CellShift = 3,               /// log2 of CellSize
+		CellSize = 1 << CellShift    /// Width and height of a cell in tiles
+	};
+
+	CUnitCellGrid() : Width(0), Height(0) {}
+
+	/// Create an empty grid for a map of this size.
+	void Create(int mapWidth, int mapHeight);
+	/// Free the grid.
+	void Clear();
+
+	/// Count a tile of the unit of this player.
+	void Add(const Vec2i &pos, int player);
+	/// Uncount a tile of the unit of this player.
+	void Sub(const Vec2i &pos, int player);
+
+	/// Players with units on the cell of this tile, a bit per player.
+	unsigned int PlayersAt(const Vec2i &pos) const
+	{
+		if (Cells.empty()) {
+			return 0;
+		}
+		return Cells[(pos.x >> CellShift) + (pos.y >> CellShift) * Width].Players;
+	}
+	/// Check if there is no unit in the cell of this tile.
+	bool IsEmptyAt(const Vec2i &pos) const { return PlayersAt(pos) == 0; }
+
+	/// Check if there are units of these players in the rectangle.
+	bool HasPlayersIn(const Vec2i &ltPos, const Vec2i &rbPos, unsigned int players) const;
+
+private:
+	struct Cell {
+		Cell() : Players(0) { std::fill(Count, Count + PlayerMax, 0); }
+
+		unsigned int Players;                  /// bit field of Count[i] != 0
+		unsigned short int Count[PlayerMax];   /// occupied tiles by player
+	};
+
+	std::vector<Cell> Cells;   /// cells by row
+	int Width;                 /// number of cells in a row
+	int Height;                /// number of rows
+};
+
+
 //@}
 
 #endif // !__UNIT_CACHE_H__
@@ -228,8 +228,13 @@ void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &u
 	Assert(Map.Info.IsPointOnMap(rbPos));
 	Assert(units.empty());
 
-	for (Vec2i posIt = ltPos; posIt.y != rbPos.y + 1; ++posIt.y) {
-		for (posIt.x = ltPos.x; posIt.x != rbPos.x + 1; ++posIt.x) {
+	for (Vec2i posIt = ltPos; posIt.y <= rbPos.y; ++posIt.y) {
+		for (posIt.x = ltPos.x; posIt.x <= rbPos.x; ++posIt.x) {
+			if (Map.UnitCells.IsEmptyAt(posIt)) {
+				// Go to the last tile of the empty cell
+				posIt.x |= CUnitCellGrid::CellSize - 1;
+				continue;
+			}
 			const CMapField &mf = *Map.Field(posIt);
 			const CUnitCache &cache = mf.UnitCache;
 
@@ -275,8 +280,13 @@ CUnit *FindUnit_IfFixed(const Vec2i &ltPos, const Vec2i &rbPos, Pred pred)
 	Assert(Map.Info.IsPointOnMap(ltPos));
 	Assert(Map.Info.IsPointOnMap(rbPos));
 
-	for (Vec2i posIt = ltPos; posIt.y != rbPos.y + 1; ++posIt.y) {
-		for (posIt.x = ltPos.x; posIt.x != rbPos.x + 1; ++posIt.x) {
+	for (Vec2i posIt = ltPos; posIt.y <= rbPos.y; ++posIt.y) {
+		for (posIt.x = ltPos.x; posIt.x <= rbPos.x; ++posIt.x) {
+			if (Map.UnitCells.IsEmptyAt(posIt)) {
+				// Go to the last tile of the empty cell
+				posIt.x |= CUnitCellGrid::CellSize - 1;
+				continue;
+			}
 			const CMapField &mf = *Map.Field(posIt);
 			const CUnitCache &cache = mf.UnitCache;
 
@@ -47,6 +47,30 @@ class CUnit;
 class CFile;
 struct lua_State;
 
+/**
+**  Struct of arrays mirror of the unit fields read at each cycle, in the
+**  order of the unit table.
+**
+**  The action loop reads it to skip the destroyed units and the work
+**  which has no effect without loading the units. It is written through
+**  by CUnitManager::UpdateHotState where these fields change outside of
+**  the action of the unit.
+*/
+class CUnitHotState
+{
+public:
+	void Resize(size_t size);
+	void Move(size_t from, size_t to);
+
+public:
+	std::vector<unsigned char> Destroyed;    /// Unit is destroyed
+	std::vector<unsigned char> Removed;      /// Unit is removed
+	std::vector<unsigned char> Action;       /// Action of the current order
+	std::vector<unsigned int> Wait;          /// Action counter
+	std::vector<unsigned long> TTL;          /// Time to live
+	std::vector<unsigned char> BuffsRunning; /// Threshold, spell cool downs or spell effects to decrease
+};
+
 class CUnitManager
 {
 public:
@@ -68,6 +92,12 @@ public:
 
 	CUnit *lastCreatedUnit();
 
+	// Following is for the per-cycle state of the units
+	void UpdateHotState(const CUnit &unit, bool buffs = true);
+	const CUnitHotState &GetHotState() const { return hotState; }
+	/// Changed when a unit is added or released, and the table reordered
+	unsigned int GetTableVersion() const { return tableVersion; }
+
 	// Following is mainly for scripting
 	CUnit &GetSlotUnit(int index) const;
 	unsigned int GetUsedSlotCount() const;
@@ -77,6 +107,8 @@ private:
 	std::vector<CUnit *> unitSlots;
 	std::list<CUnit *> releasedUnits;
 	CUnit *lastCreated;
+	CUnitHotState hotState;
+	unsigned int tableVersion;
 };
 
 
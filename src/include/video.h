@@ -52,6 +52,9 @@
 #include "color.h"
 #include "vec2i.h"
 
+#include <string>
+#include <vector>
+
 class CFont;
 
 #if defined(USE_OPENGL) || defined(USE_GLES)
@@ -98,6 +101,7 @@ public:
 	void DoDrawFrameClip(GLuint *textures, unsigned frame, int x, int y) const;
 #endif
 	void DrawFrameClip(unsigned frame, int x, int y) const;
+	void DrawFramesClip(const unsigned *frames, const PixelPos *positions, size_t count) const;
 	void DrawFrameTrans(unsigned frame, int x, int y, int alpha) const;
 	void DrawFrameClipTrans(unsigned frame, int x, int y, int alpha) const;
 
@@ -438,6 +442,15 @@ extern int VideoValidResolution(int w, int h);
 
 /// Load graphic from PNG file
 extern int LoadGraphicPNG(CGraphic *g);
+/// Decode a PNG file, thread safe
+extern SDL_Surface *DecodeGraphicPNG(const std::string &name);
+
+/// Decode graphic files on worker threads before they are loaded
+extern void PreloadGraphics(const std::vector<std::string> &files);
+/// Take the decoded surface of a preloaded file, NULL if not preloaded
+extern SDL_Surface *TakePreloadedGraphic(const std::string &name);
+/// Free the preloaded surfaces which have not been loaded
+extern void FreePreloadedGraphics();
 
 #if defined(USE_OPENGL) || defined(USE_GLES)
 
@@ -106,6 +106,8 @@ private:
 	void Set(const PixelPos &mapPixelPos);
 	/// Draw the map background
 	void DrawMapBackgroundInViewport() const;
+	/// Draw the map background tile by tile
+	void DrawMapBackgroundTiles() const;
 	/// Draw the map fog of war
 	void DrawMapFogOfWar() const;
 
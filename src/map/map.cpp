@@ -39,7 +39,9 @@
 #include "map.h"
 
 #include "iolib.h"
+#include "pathfinder.h"
 #include "player.h"
+#include "snapshot.h"
 #include "tileset.h"
 #include "unit.h"
 #include "unit_manager.h"
@@ -125,6 +127,46 @@ void CMap::MarkSeenTile(CMapField &mf)
 #endif
 }
 
+bool CMap::IsFieldExplored(const CPlayer &player, unsigned int index) const
+{
+	return this->Visibility.Get(player.Index, index) != 0;
+}
+
+bool CMap::IsFieldVisible(const CPlayer &player, unsigned int index) const
+{
+	const bool fogOfWar = !this->NoFogOfWar;
+	const unsigned short visible = this->Visibility.Get(player.Index, index);
+	return visible >= 2 || (!fogOfWar && visible != 0);
+}
+
+bool CMap::IsFieldTeamVisible(const CPlayer &player, unsigned int index) const
+{
+	return FieldTeamVisibilityState(player, index) == 2;
+}
+
+unsigned char CMap::FieldTeamVisibilityState(const CPlayer &player, unsigned int index) const
+{
+	if (IsFieldVisible(player, index)) {
+		return 2;
+	}
+	unsigned char maxVision = 0;
+	if (IsFieldExplored(player, index)) {
+		maxVision = 1;
+	}
+	for (int i = 0; i != PlayerMax ; ++i) {
+		if (player.IsBothSharedVision(Players[i])) {
+			maxVision = std::max<unsigned char>(maxVision, this->Visibility.Get(i, index));
+			if (maxVision >= 2) {
+				return 2;
+			}
+		}
+	}
+	if (maxVision == 1 && this->NoFogOfWar) {
+		return 2;
+	}
+	return maxVision;
+}
+
 /**
 **  Reveal the entire map.
 */
@@ -133,12 +175,14 @@ void CMap::Reveal()
 	//  Mark every explored tile as visible. 1 turns into 2.
 	for (int i = 0; i != this->Info.MapWidth * this->Info.MapHeight; ++i) {
 		CMapField &mf = *this->Field(i);
-		CMapFieldPlayerInfo &playerInfo = mf.playerInfo;
 		for (int p = 0; p < PlayerMax; ++p) {
-			playerInfo.Visible[p] = std::max<unsigned short>(1, playerInfo.Visible[p]);
+			unsigned short &visible = this->Visibility.Plane(p)[i];
+			visible = std::max<unsigned short>(1, visible);
 		}
 		MarkSeenTile(mf);
 	}
+	this->Visibility.MarkAllDirty();
+	UI.Minimap.MarkAllDirty();
 	//  Global seen recount. Simple and effective.
 	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
 		CUnit &unit = **it;
@@ -326,6 +370,8 @@ void CMap::Create()
 	Assert(!this->Fields);
 
 	this->Fields = new CMapField[this->Info.MapWidth * this->Info.MapHeight];
+	this->UnitCells.Create(this->Info.MapWidth, this->Info.MapHeight);
+	this->Visibility.Create(this->Info.MapWidth * this->Info.MapHeight);
 }
 
 /**
@@ -348,9 +394,12 @@ void CMap::Clean()
 
 	this->Info.Clear();
 	this->Fields = NULL;
+	this->UnitCells.Clear();
+	this->Visibility.Clean();
 	this->NoFogOfWar = false;
 	this->Tileset->clear();
 	this->TileModelsFileName.clear();
+	FreeTerrainChunks();
 	CGraphic::Free(this->TileGraphic);
 	this->TileGraphic = NULL;
 
@@ -364,8 +413,9 @@ void CMap::Clean()
 ** Save the complete map.
 **
 ** @param file Output file.
+** @param fields Save the map fields, false when they are in a snapshot section.
 */
-void CMap::Save(CFile &file) const
+void CMap::Save(CFile &file, bool fields) const
 {
 	file.printf("\n--- -----------------------------------------\n");
 	file.printf("--- MODULE: map\n");
@@ -377,13 +427,17 @@ void CMap::Save(CFile &file) const
 	file.printf("  \"size\", {%d, %d},\n", this->Info.MapWidth, this->Info.MapHeight);
 	file.printf("  \"%s\",\n", this->NoFogOfWar ? "no-fog-of-war" : "fog-of-war");
 	file.printf("  \"filename\", \"%s\",\n", this->Info.Filename.c_str());
+	if (!fields) {
+		file.printf("}})\n");
+		return;
+	}
 	file.printf("  \"map-fields\", {\n");
 	for (int h = 0; h < this->Info.MapHeight; ++h) {
 		file.printf("  -- %d\n", h);
 		for (int w = 0; w < this->Info.MapWidth; ++w) {
 			const CMapField &mf = *this->Field(w, h);
 
-			mf.Save(file);
+			mf.Save(file, this->getIndex(w, h));
 			if (w & 1) {
 				file.printf(",\n");
 			} else {
@@ -394,6 +448,91 @@ void CMap::Save(CFile &file) const
 	file.printf("}})\n");
 }
 
+/**
+**  Save the fields of the map in a savegame snapshot section.
+**
+**  The section is the map width, height and number of players on 32
+**  bits, the fields (see CMapField::SaveSnapshot), then a bitset of the
+**  explored fields of each player. The fields seen by units are saved
+**  unexplored, as in CMap::Save, their counters are made again when the
+**  units are placed.
+**
+**  @param out  Section data to fill.
+*/
+void CMap::SaveFieldsSnapshot(std::string &out) const
+{
+	const unsigned int fieldCount = this->Info.MapWidth * this->Info.MapHeight;
+	const size_t bitsetSize = (fieldCount + 7) / 8;
+	const size_t offset = out.size() + 12;
+
+	out.reserve(offset + fieldCount * CMapField::SnapshotSize + PlayerMax * bitsetSize);
+	SnapshotAppend32(out, this->Info.MapWidth);
+	SnapshotAppend32(out, this->Info.MapHeight);
+	SnapshotAppend32(out, PlayerMax);
+	out.resize(offset + fieldCount * CMapField::SnapshotSize + PlayerMax * bitsetSize, '\0');
+
+	unsigned char *p = reinterpret_cast<unsigned char *>(&out[offset]);
+	for (unsigned int i = 0; i != fieldCount; ++i) {
+		this->Fields[i].SaveSnapshot(p);
+		p += CMapField::SnapshotSize;
+	}
+	for (int player = 0; player != PlayerMax; ++player) {
+		const unsigned short *counters = this->Visibility.Plane(player);
+
+		for (unsigned int i = 0; i != fieldCount; ++i) {
+			if (counters[i] == 1) {
+				p[i / 8] |= 1 << (i % 8);
+			}
+		}
+		p += bitsetSize;
+	}
+}
+
+/**
+**  Load the fields of the map from a savegame snapshot section.
+**
+**  The map must have been created with the same size by StratagusMap.
+**
+**  @param data  Section data, see SaveFieldsSnapshot.
+**  @param size  Size of the data.
+**
+**  @return true if loaded, false if the data doesn't fit the map.
+*/
+bool CMap::LoadFieldsSnapshot(const unsigned char *data, size_t size)
+{
+	if (size < 12 || this->Fields == NULL) {
+		return false;
+	}
+	const int width = SnapshotGet32(data);
+	const int height = SnapshotGet32(data + 4);
+	const int playerCount = SnapshotGet32(data + 8);
+	if (width != this->Info.MapWidth || height != this->Info.MapHeight || playerCount != PlayerMax) {
+		return false;
+	}
+	const unsigned int fieldCount = width * height;
+	const size_t bitsetSize = (fieldCount + 7) / 8;
+	if (size != 12 + fieldCount * CMapField::SnapshotSize + PlayerMax * bitsetSize) {
+		return false;
+	}
+
+	const unsigned char *p = data + 12;
+	for (unsigned int i = 0; i != fieldCount; ++i) {
+		this->Fields[i].LoadSnapshot(p);
+		p += CMapField::SnapshotSize;
+	}
+	for (int player = 0; player != PlayerMax; ++player) {
+		unsigned short *counters = this->Visibility.Plane(player);
+
+		for (unsigned int i = 0; i != fieldCount; ++i) {
+			if (p[i / 8] & (1 << (i % 8))) {
+				counters[i] = 1;
+			}
+		}
+		p += bitsetSize;
+	}
+	return true;
+}
+
 /*----------------------------------------------------------------------------
 -- Map Tile Update Functions
 ----------------------------------------------------------------------------*/
@@ -478,6 +617,7 @@ void CMap::FixTile(unsigned short type, int seen, const Vec2i &pos)
 			mf.Flags &= ~flags;
 			mf.Value = 0;
 			UI.Minimap.UpdateXY(pos);
+			PathfinderTerrainChanged(pos, Vec2i(1, 1));
 		}
 	} else if (seen && this->Tileset->isEquivalentTile(tile, mf.playerInfo.SeenTile)) { //Same Type
 		return;
@@ -490,7 +630,7 @@ void CMap::FixTile(unsigned short type, int seen, const Vec2i &pos)
 	}
 
 	//maybe isExplored
-	if (mf.playerInfo.IsExplored(*ThisPlayer)) {
+	if (IsFieldExplored(*ThisPlayer, pos)) {
 		UI.Minimap.UpdateSeenXY(pos);
 		if (!seen) {
 			MarkSeenTile(mf);
@@ -526,10 +666,11 @@ void CMap::ClearWoodTile(const Vec2i &pos)
 	mf.Value = 0;
 
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, Vec2i(1, 1));
 	FixNeighbors(MapFieldForest, 0, pos);
 
 	//maybe isExplored
-	if (mf.playerInfo.IsExplored(*ThisPlayer)) {
+	if (IsFieldExplored(*ThisPlayer, pos)) {
 		UI.Minimap.UpdateSeenXY(pos);
 		MarkSeenTile(mf);
 	}
@@ -544,10 +685,11 @@ void CMap::ClearRockTile(const Vec2i &pos)
 	mf.Value = 0;
 
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, Vec2i(1, 1));
 	FixNeighbors(MapFieldRocks, 0, pos);
 
 	//maybe isExplored
-	if (mf.playerInfo.IsExplored(*ThisPlayer)) {
+	if (IsFieldExplored(*ThisPlayer, pos)) {
 		UI.Minimap.UpdateSeenXY(pos);
 		MarkSeenTile(mf);
 	}
@@ -605,10 +747,11 @@ void CMap::RegenerateForestTile(const Vec2i &pos)
 		mf.Flags |= MapFieldForest | MapFieldUnpassable;
 		UI.Minimap.UpdateSeenXY(pos);
 		UI.Minimap.UpdateXY(pos);
-		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+		PathfinderTerrainChanged(pos + offset, Vec2i(1, 2));
+		if (IsFieldTeamVisible(*ThisPlayer, pos)) {
 			MarkSeenTile(mf);
 		}
-		if (Map.Field(pos + offset)->playerInfo.IsTeamVisible(*ThisPlayer)) {
+		if (IsFieldTeamVisible(*ThisPlayer, pos + offset)) {
 			MarkSeenTile(topMf);
 		}
 		FixNeighbors(MapFieldForest, 0, pos + offset);
@@ -212,7 +212,7 @@ void CViewport::Center(const PixelPos &mapPixelPos)
 }
 
 /**
-**  Draw the map backgrounds.
+**  Draw the map backgrounds tile by tile.
 **
 ** StephanR: variables explained below for screen:<PRE>
 ** *---------------------------------------*
@@ -236,7 +236,7 @@ void CViewport::Center(const PixelPos &mapPixelPos)
 ** (in pixels)
 ** </PRE>
 */
-void CViewport::DrawMapBackgroundInViewport() const
+void CViewport::DrawMapBackgroundTiles() const
 {
 	int ex = this->BottomRightPos.x;
 	int ey = this->BottomRightPos.y;
@@ -275,6 +275,392 @@ void CViewport::DrawMapBackgroundInViewport() const
 	}
 }
 
+/*----------------------------------------------------------------------------
+--  Terrain chunks
+----------------------------------------------------------------------------*/
+
+/// Side of a terrain chunk, in tiles
+static const int TerrainChunkSize = 16;
+/// Memory used at most by the chunk surfaces of the software renderer
+static const size_t MaxTerrainChunkBytes = 64 * 1024 * 1024;
+
+/**
+**  Square of TerrainChunkSize tiles of the map background, composited
+**  once and drawn as a whole until one of its seen tiles changes.
+**
+**  The software renderer keeps the tiles pre-blitted in a surface of the
+**  tileset format, OpenGL keeps their quads in vertex arrays and draws
+**  them in one call with the current, maybe color cycled, tileset texture.
+*/
+struct TerrainChunk {
+	TerrainChunk() : Surface(NULL), LastUsed(0) {}
+
+	std::vector<unsigned short> Tiles; /// tiles composited in the chunk
+	SDL_Surface *Surface;              /// pre-blitted tiles
+#ifdef USE_OPENGL
+	std::vector<GLshort> Vertices;     /// quads of the tiles, relative to the chunk
+	std::vector<GLfloat> TexCoords;    /// texture coordinates of the quads
+#endif
+	unsigned long LastUsed;            /// last draw of the chunk
+};
+
+static std::vector<TerrainChunk> TerrainChunks; /// chunks of the map, row by row
+static const CGraphic *TerrainChunkGraphic;     /// tileset of the chunks
+static const SDL_Surface *TerrainChunkTiles;    /// tileset surface of the chunks
+static Vec2i TerrainChunkCount;                 /// number of chunks in each direction
+static size_t TerrainChunkBytes;                /// memory used by the chunk surfaces
+static unsigned long TerrainChunkDraws;         /// number of background draws
+
+/**
+**  Free the surface of a chunk.
+*/
+static void FreeChunkSurface(TerrainChunk &chunk)
+{
+	if (chunk.Surface) {
+		TerrainChunkBytes -= chunk.Surface->pitch * chunk.Surface->h;
+		SDL_FreeSurface(chunk.Surface);
+		chunk.Surface = NULL;
+	}
+}
+
+/**
+**  Free the cached terrain chunks of the map background.
+*/
+void FreeTerrainChunks()
+{
+	for (size_t i = 0; i != TerrainChunks.size(); ++i) {
+		FreeChunkSurface(TerrainChunks[i]);
+	}
+	TerrainChunks.clear();
+	TerrainChunkGraphic = NULL;
+	TerrainChunkTiles = NULL;
+	TerrainChunkCount.x = TerrainChunkCount.y = 0;
+}
+
+/**
+**  Check if the map background can be drawn with the terrain chunks.
+**
+**  OpenGL needs the tileset in a single texture, the software renderer
+**  can't composite tilesets with an alpha channel.
+*/
+static bool CanDrawTerrainChunks()
+{
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (UseOpenGL) {
+#ifdef USE_OPENGL
+		return Map.TileGraphic->NumTextures == 1;
+#else
+		return false;
+#endif
+	}
+#endif
+	return Map.TileGraphic->Surface->format->Amask == 0;
+}
+
+/**
+**  Forget the chunks made for an other map or an other tileset.
+*/
+static void PrepareTerrainChunks()
+{
+	const Vec2i count((Map.Info.MapWidth + TerrainChunkSize - 1) / TerrainChunkSize,
+					  (Map.Info.MapHeight + TerrainChunkSize - 1) / TerrainChunkSize);
+
+	if (TerrainChunkGraphic != Map.TileGraphic || TerrainChunkTiles != Map.TileGraphic->Surface
+		|| TerrainChunkCount != count) {
+		FreeTerrainChunks();
+		TerrainChunks.resize(count.x * count.y);
+		TerrainChunkGraphic = Map.TileGraphic;
+		TerrainChunkTiles = Map.TileGraphic->Surface;
+		TerrainChunkCount = count;
+	}
+	++TerrainChunkDraws;
+}
+
+/**
+**  Copy the tiles seen in the chunk.
+**
+**  @param chunk  Chunk to update.
+**  @param pos    Top left tile of the chunk.
+**  @param size   Size of the chunk in tiles.
+**
+**  @return       true if a tile changed since the last update.
+*/
+static bool UpdateChunkTiles(TerrainChunk &chunk, const Vec2i &pos, const Vec2i &size)
+{
+	bool changed = chunk.Tiles.empty();
+
+	chunk.Tiles.resize(size.x * size.y);
+	unsigned short *tile = &chunk.Tiles[0];
+	for (int y = 0; y < size.y; ++y) {
+		const CMapField *mf = Map.Field(pos.x, pos.y + y);
+		for (int x = 0; x < size.x; ++x, ++mf, ++tile) {
+			const unsigned short seen = ReplayRevealMap ? mf->getGraphicTile() : mf->playerInfo.SeenTile;
+			if (*tile != seen) {
+				*tile = seen;
+				changed = true;
+			}
+		}
+	}
+	return changed;
+}
+
+/**
+**  Free the least recently drawn chunk surfaces until there is room for
+**  a new surface.
+*/
+static void MakeRoomForChunkSurface(size_t bytes)
+{
+	while (TerrainChunkBytes + bytes > MaxTerrainChunkBytes) {
+		TerrainChunk *oldest = NULL;
+		for (size_t i = 0; i != TerrainChunks.size(); ++i) {
+			TerrainChunk &chunk = TerrainChunks[i];
+			if (chunk.Surface && (oldest == NULL || chunk.LastUsed < oldest->LastUsed)) {
+				oldest = &chunk;
+			}
+		}
+		if (oldest == NULL) {
+			return;
+		}
+		FreeChunkSurface(*oldest);
+	}
+}
+
+/**
+**  Blit the tiles of the chunk in its surface.
+**
+**  The surface has the format of the tileset, so 8 bit tilesets are only
+**  copied, and the palette of the chunk follows the color cycling of the
+**  tileset when drawing.
+**
+**  @param chunk  Chunk to composite.
+**  @param size   Size of the chunk in tiles.
+*/
+static void MakeChunkSurface(TerrainChunk &chunk, const Vec2i &size)
+{
+	const CGraphic &g = *Map.TileGraphic;
+	SDL_Surface *tiles = g.Surface;
+	const SDL_PixelFormat &format = *tiles->format;
+
+	if (chunk.Surface == NULL) {
+		const int w = size.x * PixelTileSize.x;
+		const int h = size.y * PixelTileSize.y;
+
+		MakeRoomForChunkSurface(w * h * format.BytesPerPixel);
+		chunk.Surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, format.BitsPerPixel,
+											 format.Rmask, format.Gmask, format.Bmask, format.Amask);
+		if (chunk.Surface == NULL) {
+			fprintf(stderr, "Can't create a terrain chunk surface: %s\n", SDL_GetError());
+			return;
+		}
+		TerrainChunkBytes += chunk.Surface->pitch * chunk.Surface->h;
+		if (tiles->flags & SDL_SRCCOLORKEY) {
+			SDL_SetColorKey(chunk.Surface, SDL_SRCCOLORKEY, format.colorkey);
+		}
+	}
+	if (format.palette) {
+		SDL_SetColors(chunk.Surface, format.palette->colors, 0, format.palette->ncolors);
+	}
+	if (tiles->flags & SDL_SRCCOLORKEY) {
+		SDL_FillRect(chunk.Surface, NULL, format.colorkey);
+	}
+
+	const unsigned short *tile = &chunk.Tiles[0];
+	for (int y = 0; y < size.y; ++y) {
+		for (int x = 0; x < size.x; ++x, ++tile) {
+			SDL_Rect srect = {g.frame_map[*tile].x, g.frame_map[*tile].y,
+							  Uint16(PixelTileSize.x), Uint16(PixelTileSize.y)
+							 };
+			SDL_Rect drect = {Sint16(x * PixelTileSize.x), Sint16(y * PixelTileSize.y), 0, 0};
+			SDL_BlitSurface(tiles, &srect, chunk.Surface, &drect);
+		}
+	}
+}
+
+/**
+**  Draw the surface of a chunk, clipped to the viewport.
+**
+**  @param vp         Viewport of the chunk.
+**  @param chunk      Chunk to draw.
+**  @param screenPos  Screen position of the chunk.
+*/
+static void DrawChunkSurface(const CViewport &vp, const TerrainChunk &chunk, const PixelPos &screenPos)
+{
+	SDL_Surface *surface = chunk.Surface;
+	const SDL_Palette *palette = Map.TileGraphic->Surface->format->palette;
+
+	if (palette && memcmp(surface->format->palette->colors, palette->colors,
+						  palette->ncolors * sizeof(SDL_Color))) {
+		SDL_SetColors(surface, palette->colors, 0, palette->ncolors);
+	}
+
+	const int left = std::max<int>(screenPos.x, vp.TopLeftPos.x);
+	const int top = std::max<int>(screenPos.y, vp.TopLeftPos.y);
+	const int right = std::min<int>(screenPos.x + surface->w - 1, vp.BottomRightPos.x);
+	const int bottom = std::min<int>(screenPos.y + surface->h - 1, vp.BottomRightPos.y);
+	if (left > right || top > bottom) {
+		return;
+	}
+	SDL_Rect srect = {Sint16(left - screenPos.x), Sint16(top - screenPos.y),
+					  Uint16(right - left + 1), Uint16(bottom - top + 1)
+					 };
+	SDL_Rect drect = {Sint16(left), Sint16(top), 0, 0};
+	SDL_BlitSurface(surface, &srect, TheScreen, &drect);
+}
+
+#ifdef USE_OPENGL
+/**
+**  Make the quads of the tiles of the chunk.
+**
+**  @param chunk  Chunk to composite.
+**  @param size   Size of the chunk in tiles.
+*/
+static void MakeChunkQuads(TerrainChunk &chunk, const Vec2i &size)
+{
+	const CGraphic &g = *Map.TileGraphic;
+	const int count = size.x * size.y;
+
+	chunk.Vertices.resize(8 * count);
+	chunk.TexCoords.resize(8 * count);
+	GLshort *vertex = &chunk.Vertices[0];
+	GLfloat *texCoord = &chunk.TexCoords[0];
+	const unsigned short *tile = &chunk.Tiles[0];
+	for (int y = 0; y < size.y; ++y) {
+		for (int x = 0; x < size.x; ++x, ++tile, vertex += 8, texCoord += 8) {
+			const GLshort x_beg = x * PixelTileSize.x;
+			const GLshort x_end = x_beg + PixelTileSize.x;
+			const GLshort y_beg = y * PixelTileSize.y;
+			const GLshort y_end = y_beg + PixelTileSize.y;
+			const int gx = g.frame_map[*tile].x;
+			const int gy = g.frame_map[*tile].y;
+			const GLfloat tx_beg = gx * g.TextureWidth / g.GraphicWidth;
+			const GLfloat tx_end = (gx + g.Width) * g.TextureWidth / g.GraphicWidth;
+			const GLfloat ty_beg = gy * g.TextureHeight / g.GraphicHeight;
+			const GLfloat ty_end = (gy + g.Height) * g.TextureHeight / g.GraphicHeight;
+
+			vertex[0] = x_beg;
+			vertex[1] = y_beg;
+			vertex[2] = x_beg;
+			vertex[3] = y_end;
+			vertex[4] = x_end;
+			vertex[5] = y_end;
+			vertex[6] = x_end;
+			vertex[7] = y_beg;
+			texCoord[0] = tx_beg;
+			texCoord[1] = ty_beg;
+			texCoord[2] = tx_beg;
+			texCoord[3] = ty_end;
+			texCoord[4] = tx_end;
+			texCoord[5] = ty_end;
+			texCoord[6] = tx_end;
+			texCoord[7] = ty_beg;
+		}
+	}
+}
+
+/**
+**  Clip the drawing of the chunks to the viewport.
+**
+**  The chunks are drawn as a whole, so they are clipped by OpenGL.
+**  The projection maps the screen on the window, or keeps the pixels
+**  with the shader pipeline.
+*/
+static void BeginDrawChunkQuads(const CViewport &vp)
+{
+	const float scaleX = GLShaderPipelineSupported ? 1.f : float(Video.ViewportWidth) / Video.Width;
+	const float scaleY = GLShaderPipelineSupported ? 1.f : float(Video.ViewportHeight) / Video.Height;
+	const int x_beg = int(vp.TopLeftPos.x * scaleX);
+	const int x_end = int((vp.BottomRightPos.x + 1) * scaleX);
+	const int y_beg = int(vp.TopLeftPos.y * scaleY);
+	const int y_end = int((vp.BottomRightPos.y + 1) * scaleY);
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(x_beg, Video.ViewportHeight - y_end, x_end - x_beg, y_end - y_beg);
+	glBindTexture(GL_TEXTURE_2D, Map.TileGraphic->Textures[0]);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+static void DrawChunkQuads(const TerrainChunk &chunk, const PixelPos &screenPos)
+{
+	glPushMatrix();
+	glTranslatef(GLfloat(screenPos.x), GLfloat(screenPos.y), 0.f);
+	glVertexPointer(2, GL_SHORT, 0, &chunk.Vertices[0]);
+	glTexCoordPointer(2, GL_FLOAT, 0, &chunk.TexCoords[0]);
+	glDrawArrays(GL_QUADS, 0, GLsizei(chunk.Vertices.size() / 2));
+	glPopMatrix();
+}
+
+static void EndDrawChunkQuads()
+{
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisable(GL_SCISSOR_TEST);
+}
+#endif
+
+/**
+**  Draw the map backgrounds.
+**
+**  The background is drawn by chunks of TerrainChunkSize tiles, which
+**  are composited again only when one of their seen tiles changed.
+*/
+void CViewport::DrawMapBackgroundInViewport() const
+{
+	if (!CanDrawTerrainChunks()) {
+		DrawMapBackgroundTiles();
+		return;
+	}
+	PrepareTerrainChunks();
+
+	const int chunkWidth = TerrainChunkSize * PixelTileSize.x;
+	const int chunkHeight = TerrainChunkSize * PixelTileSize.y;
+	// screen position of the top left tile of the map
+	const PixelPos mapScreenPos(this->TopLeftPos.x - this->Offset.x - this->MapPos.x * PixelTileSize.x,
+								this->TopLeftPos.y - this->Offset.y - this->MapPos.y * PixelTileSize.y);
+	const Vec2i chunkBeg(std::max(0, (this->TopLeftPos.x - mapScreenPos.x) / chunkWidth),
+						 std::max(0, (this->TopLeftPos.y - mapScreenPos.y) / chunkHeight));
+	const Vec2i chunkEnd(std::min<int>(TerrainChunkCount.x - 1, (this->BottomRightPos.x - mapScreenPos.x) / chunkWidth),
+						 std::min<int>(TerrainChunkCount.y - 1, (this->BottomRightPos.y - mapScreenPos.y) / chunkHeight));
+
+#ifdef USE_OPENGL
+	if (UseOpenGL) {
+		BeginDrawChunkQuads(*this);
+	}
+#endif
+	for (int cy = chunkBeg.y; cy <= chunkEnd.y; ++cy) {
+		for (int cx = chunkBeg.x; cx <= chunkEnd.x; ++cx) {
+			TerrainChunk &chunk = TerrainChunks[cy * TerrainChunkCount.x + cx];
+			const Vec2i pos(cx * TerrainChunkSize, cy * TerrainChunkSize);
+			const Vec2i size(std::min<int>(TerrainChunkSize, Map.Info.MapWidth - pos.x),
+							 std::min<int>(TerrainChunkSize, Map.Info.MapHeight - pos.y));
+			const PixelPos screenPos(mapScreenPos.x + cx * chunkWidth, mapScreenPos.y + cy * chunkHeight);
+			const bool changed = UpdateChunkTiles(chunk, pos, size);
+
+			chunk.LastUsed = TerrainChunkDraws;
+#ifdef USE_OPENGL
+			if (UseOpenGL) {
+				if (changed || chunk.Vertices.empty()) {
+					MakeChunkQuads(chunk, size);
+				}
+				DrawChunkQuads(chunk, screenPos);
+				continue;
+			}
+#endif
+			if (changed || chunk.Surface == NULL) {
+				MakeChunkSurface(chunk, size);
+			}
+			if (chunk.Surface) {
+				DrawChunkSurface(*this, chunk, screenPos);
+			}
+		}
+	}
+#ifdef USE_OPENGL
+	if (UseOpenGL) {
+		EndDrawChunkQuads();
+	}
+#endif
+}
+
 /**
 **  Show unit's name under cursor or print the message if territory is invisible.
 **
@@ -332,78 +718,32 @@ void CViewport::Draw() const
 
 	CurrentViewport = this;
 	{
-		// Now we need to sort units, missiles, particles by draw level and draw them
+		// Now we need to sort units, missiles by draw level and draw them,
+		// the particles of a draw level are drawn before its units and missiles
 		std::vector<CUnit *> unittable;
 		std::vector<Missile *> missiletable;
-		std::vector<CParticle *> particletable;
 
 		FindAndSortUnits(*this, unittable);
 		const size_t nunits = unittable.size();
 		FindAndSortMissiles(*this, missiletable);
 		const size_t nmissiles = missiletable.size();
-		ParticleManager.prepareToDraw(*this, particletable);
-		const size_t nparticles = particletable.size();
+		ParticleManager.prepareToDraw(*this);
 
 		size_t i = 0;
 		size_t j = 0;
-		size_t k = 0;
-
-
-		while ((i < nunits && j < nmissiles) || (i < nunits && k < nparticles)
-			   || (j < nmissiles && k < nparticles)) {
-			if (i == nunits) {
-				if (missiletable[j]->Type->DrawLevel < particletable[k]->getDrawLevel()) {
-					missiletable[j]->DrawMissile(*this);
-					++j;
-				} else {
-					particletable[k]->draw();
-					++k;
-				}
-			} else if (j == nmissiles) {
-				if (unittable[i]->Type->DrawLevel < particletable[k]->getDrawLevel()) {
-					unittable[i]->Draw(*this);
-					++i;
-				} else {
-					particletable[k]->draw();
-					++k;
-				}
-			} else if (k == nparticles) {
-				if (unittable[i]->Type->DrawLevel < missiletable[j]->Type->DrawLevel) {
-					unittable[i]->Draw(*this);
-					++i;
-				} else {
-					missiletable[j]->DrawMissile(*this);
-					++j;
-				}
+
+		while (i < nunits || j < nmissiles) {
+			if (j == nmissiles
+				|| (i < nunits && unittable[i]->Type->DrawLevel < missiletable[j]->Type->DrawLevel)) {
+				ParticleManager.drawUpTo(unittable[i]->Type->DrawLevel);
+				unittable[i]->Draw(*this);
+				++i;
 			} else {
-				if (unittable[i]->Type->DrawLevel <= missiletable[j]->Type->DrawLevel) {
-					if (unittable[i]->Type->DrawLevel < particletable[k]->getDrawLevel()) {
-						unittable[i]->Draw(*this);
-						++i;
-					} else {
-						particletable[k]->draw();
-						++k;
-					}
-				} else {
-					if (missiletable[j]->Type->DrawLevel < particletable[k]->getDrawLevel()) {
-						missiletable[j]->DrawMissile(*this);
-						++j;
-					} else {
-						particletable[k]->draw();
-						++k;
-					}
-				}
+				ParticleManager.drawUpTo(missiletable[j]->Type->DrawLevel);
+				missiletable[j]->DrawMissile(*this);
+				++j;
 			}
 		}
-		for (; i < nunits; ++i) {
-			unittable[i]->Draw(*this);
-		}
-		for (; j < nmissiles; ++j) {
-			missiletable[j]->DrawMissile(*this);
-		}
-		for (; k < nparticles; ++k) {
-			particletable[k]->draw();
-		}
 		ParticleManager.endDraw();
 	}
 
@@ -426,7 +766,7 @@ void CViewport::Draw() const
 	//
 	if (CursorOn == CursorOnMap && Preference.ShowNameDelay && (ShowNameDelay < GameCycle) && (GameCycle < ShowNameTime)) {
 		const Vec2i tilePos = this->ScreenToTilePos(CursorScreenPos);
-		const bool isMapFieldVisile = Map.Field(tilePos)->playerInfo.IsTeamVisible(*ThisPlayer);
+		const bool isMapFieldVisile = Map.IsFieldTeamVisible(*ThisPlayer, tilePos);
 
 		if (UI.MouseViewport->IsInsideMapArea(CursorScreenPos) && UnitUnderCursor
 			&& ((isMapFieldVisile && !UnitUnderCursor->Type->BoolFlag[ISNOTSELECTABLE_INDEX].value) || ReplayRevealMap)) {
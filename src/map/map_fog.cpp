@@ -41,6 +41,7 @@
 #include "actions.h"
 #include "minimap.h"
 #include "player.h"
+#include "profiler.h"
 #include "ui.h"
 #include "unit.h"
 #include "unit_manager.h"
@@ -65,6 +66,12 @@ static const int FogTable[16] = {
 };
 
 static std::vector<unsigned short> VisibleTable;
+static int VisibleTablePlayer = -1;      /// player of the VisibleTable
+static bool VisibleTableNoFogOfWar;      /// Map.NoFogOfWar of the VisibleTable
+
+static Vec2i SightDirtyMinPos;           /// changes of the current MapSight
+static Vec2i SightDirtyMaxPos;
+static bool SightDirty;
 
 static SDL_Surface *OnlyFogSurface;
 static CGraphic *AlphaFogG;
@@ -73,6 +80,91 @@ static CGraphic *AlphaFogG;
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Create the visibility planes.
+**
+**  @param fieldCount  Number of fields of the map.
+*/
+void CMapVisibility::Create(unsigned int fieldCount)
+{
+	FieldCount = fieldCount;
+	Counters.clear();
+	Counters.resize(PlayerMax * fieldCount, 0);
+	MarkAllDirty();
+}
+
+/**
+**  Free the visibility planes.
+*/
+void CMapVisibility::Clean()
+{
+	Counters.clear();
+	FieldCount = 0;
+	MarkAllDirty();
+}
+
+/**
+**  Note that the visibility state of the fields changed in a rectangle.
+**
+**  @param minPos  Top left field of the rectangle.
+**  @param maxPos  Bottom right field of the rectangle.
+*/
+void CMapVisibility::MarkDirty(const Vec2i &minPos, const Vec2i &maxPos)
+{
+	if (AllDirty) {
+		return;
+	}
+	if (DirtyRects.size() == 2 * MaxDirtyRects) {
+		MarkAllDirty();
+		return;
+	}
+	DirtyRects.push_back(minPos);
+	DirtyRects.push_back(maxPos);
+}
+
+/**
+**  Note that the visibility state of a field changed for a player.
+**
+**  Only the changes seen by the local player are kept.
+**
+**  @param player  Player who sees the field.
+**  @param index   Field which changed.
+*/
+static void MarkSightDirty(const CPlayer &player, const unsigned int index)
+{
+	if (ThisPlayer == NULL) {
+		Map.Visibility.MarkAllDirty();
+		return;
+	}
+	if (&player != ThisPlayer && !ThisPlayer->IsBothSharedVision(player)) {
+		return;
+	}
+	const Vec2i pos(index % Map.Info.MapWidth, index / Map.Info.MapWidth);
+
+	if (!SightDirty) {
+		SightDirtyMinPos = pos;
+		SightDirtyMaxPos = pos;
+		SightDirty = true;
+		return;
+	}
+	SightDirtyMinPos.x = std::min(SightDirtyMinPos.x, pos.x);
+	SightDirtyMinPos.y = std::min(SightDirtyMinPos.y, pos.y);
+	SightDirtyMaxPos.x = std::max(SightDirtyMaxPos.x, pos.x);
+	SightDirtyMaxPos.y = std::max(SightDirtyMaxPos.y, pos.y);
+}
+
+/**
+**  Give the changes of the last sight marking to the map.
+*/
+static void FlushSightDirty()
+{
+	if (SightDirty) {
+		Map.Visibility.MarkDirty(SightDirtyMinPos, SightDirtyMaxPos);
+		UI.Minimap.MarkDirty(SightDirtyMinPos, SightDirtyMaxPos);
+		SightDirty = false;
+	}
+}
+
 class _filter_flags
 {
 public:
@@ -215,14 +307,15 @@ static void UnitsOnTileUnmarkSeen(const CPlayer &player, CMapField &mf, int cloa
 void MapMarkTileSight(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &(mf.playerInfo.Visible[player.Index]);
+	unsigned short *v = &Map.Visibility.Plane(player.Index)[index];
 	if (*v == 0 || *v == 1) { // Unexplored or unseen
 		// When there is no fog only unexplored tiles are marked.
 		if (!Map.NoFogOfWar || *v == 0) {
 			UnitsOnTileMarkSeen(player, mf, 0);
 		}
 		*v = 2;
-		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+		MarkSightDirty(player, index);
+		if (Map.IsFieldTeamVisible(*ThisPlayer, index)) {
 			Map.MarkSeenTile(mf);
 		}
 		return;
@@ -246,7 +339,7 @@ void MapMarkTileSight(const CPlayer &player, const Vec2i &pos)
 void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &mf.playerInfo.Visible[player.Index];
+	unsigned short *v = &Map.Visibility.Plane(player.Index)[index];
 	switch (*v) {
 		case 0:  // Unexplored
 		case 1:
@@ -257,8 +350,9 @@ void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 			if (!Map.NoFogOfWar) {
 				UnitsOnTileUnmarkSeen(player, mf, 0);
 			}
+			MarkSightDirty(player, index);
 			// Check visible Tile, then deduct...
-			if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+			if (Map.IsFieldTeamVisible(*ThisPlayer, index)) {
 				Map.MarkSeenTile(mf);
 			}
 		default:  // seen -> seen
@@ -387,6 +481,97 @@ void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range,
 #endif
 		}
 	}
+	FlushSightDirty();
+}
+
+/**
+**  Get the tiles of a row in the sight of a unit.
+**
+**  @param pos    Top left tile of the unit.
+**  @param w      Width of the unit, in tiles.
+**  @param h      Height of the unit, in tiles.
+**  @param range  Radius of the sight.
+**  @param y      Row of the map.
+**  @param minx   First tile of the row in the sight.
+**  @param maxx   Tile after the last tile of the row in the sight.
+**
+**  @return       true if some tiles of the row are in the sight.
+*/
+static bool GetSightRow(const Vec2i &pos, int w, int h, int range, int y, int *minx, int *maxx)
+{
+	int offsetx;
+
+	if (y < pos.y - range || y >= pos.y + h + range) {
+		return false;
+	}
+	if (y < pos.y) { // Up hemi-cycle
+		offsetx = isqrt(square(range + 1) - square(pos.y - y) - 1);
+	} else if (y < pos.y + h) {
+		offsetx = range;
+	} else { // bottom hemi-cycle
+		offsetx = isqrt(square(range + 1) - square(y - pos.y - h + 1) - 1);
+	}
+	*minx = std::max(0, pos.x - offsetx);
+	*maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
+	return *minx < *maxx;
+}
+
+/**
+**  Mark the sight of unit, except the tiles also seen from an other position.
+**
+**  When a unit moves, unmarking the tiles only seen from the old position
+**  and marking the tiles only seen from the new position gives the same
+**  counters as MapSight on the whole sight, without touching the common
+**  tiles.
+**
+**  @param player    player to mark the sight for (not unit owner)
+**  @param pos       location to mark
+**  @param otherPos  location whose sight is not marked
+**  @param w         width to mark, in square
+**  @param h         height to mark, in square
+**  @param range     Radius to mark.
+**  @param marker    Function to mark or unmark sight
+*/
+void MapSightDelta(const CPlayer &player, const Vec2i &pos, const Vec2i &otherPos,
+				   int w, int h, int range, MapMarkerFunc *marker)
+{
+	// Units under construction have no sight range.
+	if (!range) {
+		return;
+	}
+	const int miny = std::max(pos.y - range, 0);
+	const int maxy = std::min(pos.y + h + range, Map.Info.MapHeight);
+
+	for (int y = miny; y < maxy; ++y) {
+		int minx;
+		int maxx;
+		int otherMinx;
+		int otherMaxx;
+
+		if (!GetSightRow(pos, w, h, range, y, &minx, &maxx)) {
+			continue;
+		}
+		if (!GetSightRow(otherPos, w, h, range, y, &otherMinx, &otherMaxx)) {
+			otherMinx = otherMaxx = maxx;
+		}
+		Vec2i mpos(minx, y);
+#ifdef MARKER_ON_INDEX
+		const unsigned int index = mpos.y * Map.Info.MapWidth;
+#endif
+		// Left of the other sight, then right of it
+		const int spans[2][2] = {{minx, std::min(maxx, otherMinx)}, {std::max(minx, otherMaxx), maxx}};
+
+		for (int i = 0; i != 2; ++i) {
+			for (mpos.x = spans[i][0]; mpos.x < spans[i][1]; ++mpos.x) {
+#ifdef MARKER_ON_INDEX
+				marker(player, mpos.x + index);
+#else
+				marker(player, mpos);
+#endif
+			}
+		}
+	}
+	FlushSightDirty();
 }
 
 /**
@@ -400,7 +585,7 @@ void UpdateFogOfWarChange()
 		const unsigned int w = Map.Info.MapHeight * Map.Info.MapWidth;
 		for (unsigned int index = 0; index != w; ++index) {
 			CMapField &mf = *Map.Field(index);
-			if (mf.playerInfo.IsExplored(*ThisPlayer)) {
+			if (Map.IsFieldExplored(*ThisPlayer, index)) {
 				Map.MarkSeenTile(mf);
 			}
 		}
@@ -614,38 +799,66 @@ static void DrawFogOfWarTile(int sx, int sy, int dx, int dy)
 #undef IsMapFieldVisibleTable
 }
 
+/**
+**  Compute the visibility state of the fields in a rectangle.
+**
+**  @param minPos  Top left field of the rectangle.
+**  @param maxPos  Bottom right field of the rectangle.
+*/
+static void UpdateVisibleTable(const Vec2i &minPos, const Vec2i &maxPos)
+{
+	unsigned int my_index = minPos.y * Map.Info.MapWidth;
+
+	for (int my = minPos.y; my <= maxPos.y; ++my) {
+		for (int mx = minPos.x; mx <= maxPos.x; ++mx) {
+			VisibleTable[my_index + mx] = Map.FieldTeamVisibilityState(*ThisPlayer, mx + my_index);
+		}
+		my_index += Map.Info.MapWidth;
+	}
+}
+
+/**
+**  Update the visibility state of the fields which changed since the
+**  last call.
+*/
+static void UpdateVisibleTable()
+{
+	if (VisibleTablePlayer != ThisPlayer->Index || VisibleTableNoFogOfWar != Map.NoFogOfWar) {
+		VisibleTablePlayer = ThisPlayer->Index;
+		VisibleTableNoFogOfWar = Map.NoFogOfWar;
+		Map.Visibility.MarkAllDirty();
+	}
+	if (Map.Visibility.IsAllDirty()) {
+		UpdateVisibleTable(Vec2i(0, 0), Vec2i(Map.Info.MapWidth - 1, Map.Info.MapHeight - 1));
+	} else {
+		for (size_t i = 0; i != Map.Visibility.GetDirtyRectCount(); ++i) {
+			UpdateVisibleTable(Map.Visibility.GetDirtyMinPos(i), Map.Visibility.GetDirtyMaxPos(i));
+		}
+	}
+	Map.Visibility.ClearDirty();
+}
+
 /**
 **  Draw the map fog of war.
 */
 void CViewport::DrawMapFogOfWar() const
 {
+	PROFILE_ZONE("DrawMapFogOfWar");
 	// flags must redraw or not
 	if (ReplayRevealMap) {
 		return;
 	}
 
-	int sx = std::max<int>(MapPos.x - 1, 0);
-	int ex = std::min<int>(MapPos.x + MapWidth + 1, Map.Info.MapWidth);
-	int my = std::max<int>(MapPos.y - 1, 0);
-	int ey = std::min<int>(MapPos.y + MapHeight + 1, Map.Info.MapHeight);
-
-	// Update for visibility all tile in viewport
-	// and 1 tile around viewport (for fog-of-war connection display)
+	// Update for visibility the tiles which changed
+	UpdateVisibleTable();
 
-	unsigned int my_index = my * Map.Info.MapWidth;
-	for (; my < ey; ++my) {
-		for (int mx = sx; mx < ex; ++mx) {
-			VisibleTable[my_index + mx] = Map.Field(mx + my_index)->playerInfo.TeamVisibilityState(*ThisPlayer);
-		}
-		my_index += Map.Info.MapWidth;
-	}
-	ex = this->BottomRightPos.x;
+	const int ex = this->BottomRightPos.x;
 	int sy = MapPos.y * Map.Info.MapWidth;
 	int dy = this->TopLeftPos.y - Offset.y;
-	ey = this->BottomRightPos.y;
+	const int ey = this->BottomRightPos.y;
 
 	while (dy <= ey) {
-		sx = MapPos.x + sy;
+		int sx = MapPos.x + sy;
 		int dx = this->TopLeftPos.x - Offset.x;
 		while (dx <= ex) {
 			if (VisibleTable[sx]) {
@@ -744,6 +957,7 @@ void CMap::InitFogOfWar()
 
 	VisibleTable.clear();
 	VisibleTable.resize(Info.MapWidth * Info.MapHeight);
+	VisibleTablePlayer = -1;
 }
 
 /**
@@ -752,6 +966,7 @@ void CMap::InitFogOfWar()
 void CMap::CleanFogOfWar()
 {
 	VisibleTable.clear();
+	VisibleTablePlayer = -1;
 
 	CGraphic::Free(Map.FogGraphic);
 	FogGraphic = NULL;
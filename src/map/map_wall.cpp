@@ -37,6 +37,7 @@
 
 #include "stratagus.h"
 #include "map.h"
+#include "pathfinder.h"
 #include "tileset.h"
 #include "ui.h"
 #include "player.h"
@@ -139,7 +140,7 @@ void MapFixSeenWallTile(const Vec2i &pos)
 	if (mf.playerInfo.SeenTile != wallTile) { // Already there!
 		mf.playerInfo.SeenTile = wallTile;
 		// FIXME: can this only happen if seen?
-		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+		if (Map.IsFieldTeamVisible(*ThisPlayer, pos)) {
 			UI.Minimap.UpdateSeenXY(pos);
 		}
 	}
@@ -184,7 +185,7 @@ void MapFixWallTile(const Vec2i &pos)
 		mf.setGraphicTile(wallTile);
 		UI.Minimap.UpdateXY(pos);
 
-		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+		if (Map.IsFieldTeamVisible(*ThisPlayer, pos)) {
 			UI.Minimap.UpdateSeenXY(pos);
 			Map.MarkSeenTile(mf);
 		}
@@ -222,8 +223,9 @@ void CMap::RemoveWall(const Vec2i &pos)
 	mf.Flags &= ~(MapFieldHuman | MapFieldWall | MapFieldUnpassable);
 	MapFixWallNeighbors(pos);
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, Vec2i(1, 1));
 
-	if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+	if (this->IsFieldTeamVisible(*ThisPlayer, pos)) {
 		UI.Minimap.UpdateSeenXY(pos);
 		this->MarkSeenTile(mf);
 	}
@@ -250,10 +252,11 @@ void CMap::SetWall(const Vec2i &pos, bool humanwall)
 	}
 
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, Vec2i(1, 1));
 	MapFixWallTile(pos);
 	MapFixWallNeighbors(pos);
 
-	if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+	if (this->IsFieldTeamVisible(*ThisPlayer, pos)) {
 		UI.Minimap.UpdateSeenXY(pos);
 		this->MarkSeenTile(mf);
 	}
@@ -41,6 +41,7 @@
 #include "map.h"
 #include "player.h"
 #include "script.h"
+#include "snapshot.h"
 #include "tileset.h"
 #include "unit.h"
 #include "unit_manager.h"
@@ -94,11 +95,11 @@ void CMapField::setTileIndex(const CTileset &tileset, unsigned int tileIndex, in
 #endif
 }
 
-void CMapField::Save(CFile &file) const
+void CMapField::Save(CFile &file, unsigned int index) const
 {
 	file.printf("  {%3d, %3d, %2d, %2d", tile, playerInfo.SeenTile, Value, cost);
 	for (int i = 0; i != PlayerMax; ++i) {
-		if (playerInfo.Visible[i] == 1) {
+		if (Map.Visibility.Get(i, index) == 1) {
 			file.printf(", \"explored\", %d", i);
 		}
 	}
@@ -150,7 +151,7 @@ void CMapField::Save(CFile &file) const
 }
 
 
-void CMapField::parse(lua_State *l)
+void CMapField::parse(lua_State *l, unsigned int index)
 {
 	if (!lua_istable(l, -1)) {
 		LuaError(l, "incorrect argument");
@@ -170,7 +171,7 @@ void CMapField::parse(lua_State *l)
 
 		if (!strcmp(value, "explored")) {
 			++j;
-			this->playerInfo.Visible[LuaToNumber(l, -1, j + 1)] = 1;
+			Map.Visibility.Plane(LuaToNumber(l, -1, j + 1))[index] = 1;
 		} else if (!strcmp(value, "human")) {
 			this->Flags |= MapFieldHuman;
 		} else if (!strcmp(value, "land")) {
@@ -203,6 +204,44 @@ void CMapField::parse(lua_State *l)
 	}
 }
 
+/// Flags kept in a savegame, the same as in CMapField::Save
+static const unsigned short MapFieldSavedFlags = MapFieldHuman | MapFieldLandAllowed
+	| MapFieldCoastAllowed | MapFieldWaterAllowed | MapFieldNoBuilding | MapFieldUnpassable
+	| MapFieldWall | MapFieldRocks | MapFieldForest
+	| MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit | MapFieldBuilding;
+
+/**
+**  Store the field in a savegame snapshot.
+**
+**  The field takes SnapshotSize bytes: tile, seen tile and flags on 16
+**  bits little endian, then value and cost. The explored state is saved
+**  by CMap::SaveFieldsSnapshot.
+**
+**  @param p  Where to store the field.
+*/
+void CMapField::SaveSnapshot(unsigned char *p) const
+{
+	SnapshotPut16(p, tile);
+	SnapshotPut16(p + 2, playerInfo.SeenTile);
+	SnapshotPut16(p + 4, Flags & MapFieldSavedFlags);
+	p[6] = Value;
+	p[7] = cost;
+}
+
+/**
+**  Load the field from a savegame snapshot.
+**
+**  @param p  Field stored by SaveSnapshot.
+*/
+void CMapField::LoadSnapshot(const unsigned char *p)
+{
+	tile = SnapshotGet16(p);
+	playerInfo.SeenTile = SnapshotGet16(p + 2);
+	Flags |= SnapshotGet16(p + 4);
+	Value = p[6];
+	cost = p[7];
+}
+
 /// Check if a field flags.
 bool CMapField::CheckMask(int mask) const
 {
@@ -253,47 +292,4 @@ bool CMapField::isAOrcWall() const
 	return (Flags & humanWallFlag) == MapFieldWall;
 }
 
-//
-//  CMapFieldPlayerInfo
-//
-
-unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) const
-{
-	if (IsVisible(player)) {
-		return 2;
-	}
-	unsigned char maxVision = 0;
-	if (IsExplored(player)) {
-		maxVision = 1;
-	}
-	for (int i = 0; i != PlayerMax ; ++i) {
-		if (player.IsBothSharedVision(Players[i])) {
-			maxVision = std::max<unsigned char>(maxVision, Visible[i]);
-			if (maxVision >= 2) {
-				return 2;
-			}
-		}
-	}
-	if (maxVision == 1 && Map.NoFogOfWar) {
-		return 2;
-	}
-	return maxVision;
-}
-
-bool CMapFieldPlayerInfo::IsExplored(const CPlayer &player) const
-{
-	return Visible[player.Index] != 0;
-}
-
-bool CMapFieldPlayerInfo::IsVisible(const CPlayer &player) const
-{
-	const bool fogOfWar = !Map.NoFogOfWar;
-	return Visible[player.Index] >= 2 || (!fogOfWar && IsExplored(player));
-}
-
-bool CMapFieldPlayerInfo::IsTeamVisible(const CPlayer &player) const
-{
-	return TeamVisibilityState(player) == 2;
-}
-
 //@}
@@ -42,8 +42,10 @@
 #include "editor.h"
 #include "map.h"
 #include "player.h"
+#include "profiler.h"
 #include "settings.h"
 #include "unit.h"
+#include "unit_find.h"
 #include "unit_manager.h"
 #include "ui.h"
 #include "unittype.h"
@@ -62,6 +64,11 @@
 
 #define SCALE_PRECISION 100
 
+/// tiles by side of the blocks which are updated when they changed
+#define MINIMAP_BLOCK_SIZE 8
+/// the whole minimap is updated after this amount of updates
+#define MINIMAP_FULL_UPDATE_PERIOD 10
+
 
 /*----------------------------------------------------------------------------
 --  Variables
@@ -92,6 +99,23 @@ static int MinimapScaleY;                  /// Minimap scale to fit into window
 
 #define MAX_MINIMAP_EVENTS 8
 
+/// Area of the minimap, in pixels
+struct MinimapArea {
+	int X;
+	int Y;
+	int W;
+	int H;
+};
+
+static std::vector<char> DirtyBlocks;      /// changed blocks of the map
+static std::vector<int> DirtyBlockList;    /// index of the changed blocks
+static int BlockColumns;                   /// blocks in a row of the map
+static bool AllDirty = true;               /// the whole minimap must be updated
+static int UpdatesSinceFull;               /// updates since the last full update
+static int LastState = -1;                 /// settings of the last update
+static int UnitMargin;                     /// tiles where the units can reach the pixels of a block
+static std::vector<Vec2i> ChangingUnits;   /// min and max pos of the units whose color changes alone
+
 struct MinimapEvent {
 	PixelPos pos;
 	int Size;
@@ -186,6 +210,23 @@ void CMinimap::Create()
 
 	UpdateTerrain();
 
+	// A unit is drawn one pixel right and down of its tiles, and a pixel
+	// can show many tiles on big maps.
+	const int tilesPerPixel = std::max((MINIMAP_FAC + MinimapScaleX - 1) / MinimapScaleX,
+									   (MINIMAP_FAC + MinimapScaleY - 1) / MinimapScaleY);
+	int unitSize = 1;
+	for (std::vector<CUnitType *>::const_iterator it = UnitTypes.begin(); it != UnitTypes.end(); ++it) {
+		unitSize = std::max(unitSize, std::max((*it)->TileWidth, (*it)->TileHeight));
+	}
+	UnitMargin = 2 * tilesPerPixel + unitSize;
+
+	BlockColumns = (Map.Info.MapWidth + MINIMAP_BLOCK_SIZE - 1) / MINIMAP_BLOCK_SIZE;
+	const int blockRows = (Map.Info.MapHeight + MINIMAP_BLOCK_SIZE - 1) / MINIMAP_BLOCK_SIZE;
+	DirtyBlocks.assign(BlockColumns * blockRows, 0);
+	DirtyBlockList.clear();
+	ChangingUnits.clear();
+	MarkAllDirty();
+
 	NumMinimapEvents = 0;
 }
 
@@ -426,6 +467,60 @@ void CMinimap::UpdateXY(const Vec2i &pos)
 		SDL_UnlockSurface(MinimapTerrainSurface);
 	}
 	SDL_UnlockSurface(Map.TileGraphic->Surface);
+	MarkDirty(pos, pos);
+}
+
+/**
+**  Note that the units or the fog of war changed in a rectangle of the
+**  map, so the next update draws it again.
+**
+**  @param minPos  Top left tile of the rectangle.
+**  @param maxPos  Bottom right tile of the rectangle.
+*/
+void CMinimap::MarkDirty(const Vec2i &minPos, const Vec2i &maxPos)
+{
+	if (AllDirty || DirtyBlocks.empty()) {
+		return;
+	}
+	const int minX = std::max<int>(minPos.x, 0) / MINIMAP_BLOCK_SIZE;
+	const int minY = std::max<int>(minPos.y, 0) / MINIMAP_BLOCK_SIZE;
+	const int maxX = std::min<int>(maxPos.x, Map.Info.MapWidth - 1) / MINIMAP_BLOCK_SIZE;
+	const int maxY = std::min<int>(maxPos.y, Map.Info.MapHeight - 1) / MINIMAP_BLOCK_SIZE;
+
+	for (int y = minY; y <= maxY; ++y) {
+		for (int x = minX; x <= maxX; ++x) {
+			const int index = x + y * BlockColumns;
+
+			if (!DirtyBlocks[index]) {
+				DirtyBlocks[index] = 1;
+				DirtyBlockList.push_back(index);
+			}
+		}
+	}
+}
+
+/**
+**  Note that a unit changed on the minimap.
+**
+**  @param unit  Unit which appeared, disappeared or changed its color.
+*/
+void CMinimap::MarkUnitDirty(const CUnit &unit)
+{
+	const Vec2i size(unit.Type->TileWidth - 1, unit.Type->TileHeight - 1);
+
+	MarkDirty(unit.tilePos, unit.tilePos + size);
+}
+
+/**
+**  Note that the whole minimap must be updated.
+*/
+void CMinimap::MarkAllDirty()
+{
+	AllDirty = true;
+	for (std::vector<int>::const_iterator it = DirtyBlockList.begin(); it != DirtyBlockList.end(); ++it) {
+		DirtyBlocks[*it] = 0;
+	}
+	DirtyBlockList.clear();
 }
 
 /**
@@ -450,14 +545,21 @@ static void DrawUnitOn(CUnit &unit, int red_phase)
 	if (unit.Player->Index == PlayerNumNeutral) {
 		color = Video.MapRGB(TheScreen->format, type->NeutralMinimapColorRGB);
 	} else if (unit.Player == ThisPlayer && !Editor.Running) {
-		if (unit.Attacked && unit.Attacked + ATTACK_BLINK_DURATION > GameCycle &&
-			(red_phase || unit.Attacked + ATTACK_RED_DURATION > GameCycle)) {
+		const bool attacked = unit.Attacked && unit.Attacked + ATTACK_BLINK_DURATION > GameCycle;
+		const bool selected = UI.Minimap.ShowSelected && unit.Selected;
+
+		if (attacked && (red_phase || unit.Attacked + ATTACK_RED_DURATION > GameCycle)) {
 			color = ColorRed;
-		} else if (UI.Minimap.ShowSelected && unit.Selected) {
+		} else if (selected) {
 			color = ColorWhite;
 		} else {
 			color = ColorGreen;
 		}
+		if (attacked || selected) {
+			// the next update draws it again, even if it does not move
+			ChangingUnits.push_back(unit.tilePos);
+			ChangingUnits.push_back(unit.tilePos + Vec2i(type->TileWidth - 1, type->TileHeight - 1));
+		}
 	} else {
 		color = PlayerColors[GameSettings.Presets[unit.Player->Index].PlayerColor][0];
 	}
@@ -502,70 +604,81 @@ static void DrawUnitOn(CUnit &unit, int red_phase)
 }
 
 /**
-**  Update the minimap with the current game information
+**  Draw the background and the terrain of an area of the minimap.
+**  The minimap surface must not be locked.
+**
+**  @param x  Left pixel of the area.
+**  @param y  Top pixel of the area.
+**  @param w  Width of the area.
+**  @param h  Height of the area.
 */
-void CMinimap::Update()
+void CMinimap::DrawTerrainArea(int x, int y, int w, int h)
 {
-	static int red_phase;
-
-	int red_phase_changed = red_phase != (int)((FrameCounter / FRAMES_PER_SECOND) & 1);
-	if (red_phase_changed) {
-		red_phase = !red_phase;
-	}
-
 	// Clear Minimap background if not transparent
 	if (!Transparent) {
 #if defined(USE_OPENGL) || defined(USE_GLES)
 		if (UseOpenGL) {
-			memset(MinimapSurfaceGL, 0, MinimapTextureWidth * MinimapTextureHeight * 4);
+			for (int my = y; my < y + h; ++my) {
+				memset(&MinimapSurfaceGL[(x + my * MinimapTextureWidth) * 4], 0, w * 4);
+			}
 		} else
 #endif
 		{
-			SDL_FillRect(MinimapSurface, NULL, SDL_MapRGB(MinimapSurface->format, 0, 0, 0));
+			SDL_Rect rect = {Sint16(x), Sint16(y), Uint16(w), Uint16(h)};
+			SDL_FillRect(MinimapSurface, &rect, SDL_MapRGB(MinimapSurface->format, 0, 0, 0));
 		}
 	}
 
-	int bpp;
-#if defined(USE_OPENGL) || defined(USE_GLES)
-	if (UseOpenGL) {
-		bpp = 0;
-	} else
-#endif
-	{
-		bpp = MinimapSurface->format->BytesPerPixel;
-	}
-
 	//
 	// Draw the terrain
 	//
 	if (WithTerrain) {
 #if defined(USE_OPENGL) || defined(USE_GLES)
 		if (UseOpenGL) {
-			memcpy(MinimapSurfaceGL, MinimapTerrainSurfaceGL, MinimapTextureWidth * MinimapTextureHeight * 4);
+			for (int my = y; my < y + h; ++my) {
+				const int index = (x + my * MinimapTextureWidth) * 4;
+				memcpy(&MinimapSurfaceGL[index], &MinimapTerrainSurfaceGL[index], w * 4);
+			}
 		} else
 #endif
 		{
-			SDL_BlitSurface(MinimapTerrainSurface, NULL, MinimapSurface, NULL);
+			SDL_Rect srect = {Sint16(x), Sint16(y), Uint16(w), Uint16(h)};
+			SDL_Rect drect = srect;
+			SDL_BlitSurface(MinimapTerrainSurface, &srect, MinimapSurface, &drect);
 		}
 	}
+}
 
+/**
+**  Draw the fog of war of an area of the minimap.
+**  The minimap surface must be locked.
+**
+**  @param x  Left pixel of the area.
+**  @param y  Top pixel of the area.
+**  @param w  Width of the area.
+**  @param h  Height of the area.
+*/
+void CMinimap::DrawFogArea(int x, int y, int w, int h)
+{
+	int bpp;
 #if defined(USE_OPENGL) || defined(USE_GLES)
-	if (!UseOpenGL)
+	if (UseOpenGL) {
+		bpp = 0;
+	} else
 #endif
 	{
-		SDL_LockSurface(MinimapSurface);
-		SDL_LockSurface(MinimapTerrainSurface);
+		bpp = MinimapSurface->format->BytesPerPixel;
 	}
 
-	for (int my = 0; my < H; ++my) {
-		for (int mx = 0; mx < W; ++mx) {
+	for (int my = y; my < y + h; ++my) {
+		for (int mx = x; mx < x + w; ++mx) {
 			int visiontype; // 0 unexplored, 1 explored, >1 visible.
 
 			if (ReplayRevealMap) {
 				visiontype = 2;
 			} else {
 				const Vec2i tilePos(Minimap2MapX[mx], Minimap2MapY[my] / Map.Info.MapWidth);
-				visiontype = Map.Field(tilePos)->playerInfo.TeamVisibilityState(*ThisPlayer);
+				visiontype = Map.FieldTeamVisibilityState(*ThisPlayer, tilePos);
 			}
 
 			if (visiontype == 0 || (visiontype == 1 && ((mx & 1) != (my & 1)))) {
@@ -585,6 +698,24 @@ void CMinimap::Update()
 			}
 		}
 	}
+}
+
+/**
+**  Update the whole minimap.
+*/
+void CMinimap::UpdateAll(int red_phase)
+{
+	DrawTerrainArea(0, 0, W, H);
+
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (!UseOpenGL)
+#endif
+	{
+		SDL_LockSurface(MinimapSurface);
+		SDL_LockSurface(MinimapTerrainSurface);
+	}
+
+	DrawFogArea(0, 0, W, H);
 
 #if defined(USE_OPENGL) || defined(USE_GLES)
 	if (!UseOpenGL)
@@ -610,6 +741,135 @@ void CMinimap::Update()
 	}
 }
 
+/**
+**  Update the blocks of the minimap which changed since the last update,
+**  and draw again the units which reach their pixels.
+*/
+void CMinimap::UpdateDirty(int red_phase)
+{
+	std::vector<MinimapArea> areas;
+	std::vector<CUnit *> units;
+	std::vector<CUnit *> blockUnits;
+
+	areas.reserve(DirtyBlockList.size());
+	for (std::vector<int>::const_iterator it = DirtyBlockList.begin(); it != DirtyBlockList.end(); ++it) {
+		const Vec2i minPos((*it % BlockColumns) * MINIMAP_BLOCK_SIZE, (*it / BlockColumns) * MINIMAP_BLOCK_SIZE);
+		// first tiles after the block
+		const Vec2i endPos(std::min<int>(minPos.x + MINIMAP_BLOCK_SIZE, Map.Info.MapWidth),
+						   std::min<int>(minPos.y + MINIMAP_BLOCK_SIZE, Map.Info.MapHeight));
+
+		// pixels of the tiles, and of the units drawn on their right and bottom border
+		const int x0 = XOffset + (minPos.x * MinimapScaleX) / MINIMAP_FAC;
+		const int y0 = YOffset + (minPos.y * MinimapScaleY) / MINIMAP_FAC;
+		const int x1 = std::min(1 + XOffset + (endPos.x * MinimapScaleX) / MINIMAP_FAC, W - 1);
+		const int y1 = std::min(1 + YOffset + (endPos.y * MinimapScaleY) / MINIMAP_FAC, H - 1);
+		const MinimapArea area = {x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+
+		areas.push_back(area);
+		DrawTerrainArea(area.X, area.Y, area.W, area.H);
+
+		const Vec2i margin(UnitMargin, UnitMargin);
+		blockUnits.clear();
+		Select(minPos - margin, endPos + margin, blockUnits);
+		units.insert(units.end(), blockUnits.begin(), blockUnits.end());
+
+		DirtyBlocks[*it] = 0;
+	}
+	DirtyBlockList.clear();
+
+	// a unit near many blocks is drawn once
+	std::sort(units.begin(), units.end());
+	units.erase(std::unique(units.begin(), units.end()), units.end());
+
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (!UseOpenGL)
+#endif
+	{
+		SDL_LockSurface(MinimapSurface);
+		SDL_LockSurface(MinimapTerrainSurface);
+	}
+
+	for (std::vector<MinimapArea>::const_iterator it = areas.begin(); it != areas.end(); ++it) {
+		DrawFogArea(it->X, it->Y, it->W, it->H);
+	}
+
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (!UseOpenGL)
+#endif
+	{
+		SDL_UnlockSurface(MinimapTerrainSurface);
+	}
+
+	for (std::vector<CUnit *>::const_iterator it = units.begin(); it != units.end(); ++it) {
+		CUnit &unit = **it;
+		if (unit.IsVisibleOnMinimap()) {
+			DrawUnitOn(unit, red_phase);
+		}
+	}
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (!UseOpenGL)
+#endif
+	{
+		SDL_UnlockSurface(MinimapSurface);
+	}
+}
+
+/**
+**  Settings which change the whole minimap.
+*/
+static int GetMinimapState(const CMinimap &minimap)
+{
+	return (ThisPlayer ? ThisPlayer->Index : PlayerMax)
+		   | (ReplayRevealMap << 8) | (Editor.Running << 9)
+		   | (minimap.WithTerrain << 10) | (minimap.ShowSelected << 11) | (minimap.Transparent << 12);
+}
+
+/**
+**  Update the minimap with the current game information.
+**
+**  Only the blocks of the map where the terrain, the fog of war or the
+**  units changed since the last update are drawn again. The whole
+**  minimap is updated when its settings change, and every
+**  MINIMAP_FULL_UPDATE_PERIOD updates for the changes which are not
+**  tracked, like the radar and the units only seen under the fog.
+*/
+void CMinimap::Update()
+{
+	PROFILE_ZONE("CMinimap::Update");
+	static int red_phase;
+
+	int red_phase_changed = red_phase != (int)((FrameCounter / FRAMES_PER_SECOND) & 1);
+	if (red_phase_changed) {
+		red_phase = !red_phase;
+	}
+
+	const int state = GetMinimapState(*this);
+	if (state != LastState || ++UpdatesSinceFull >= MINIMAP_FULL_UPDATE_PERIOD) {
+		LastState = state;
+		MarkAllDirty();
+	}
+
+	// the units whose color changes alone
+	std::vector<Vec2i> changingUnits;
+	changingUnits.swap(ChangingUnits);
+	for (size_t i = 0; i + 1 < changingUnits.size(); i += 2) {
+		MarkDirty(changingUnits[i], changingUnits[i + 1]);
+	}
+	if (ShowSelected) {
+		for (std::vector<CUnit *>::const_iterator it = Selected.begin(); it != Selected.end(); ++it) {
+			MarkUnitDirty(**it);
+		}
+	}
+
+	if (AllDirty) {
+		UpdateAll(red_phase);
+		AllDirty = false;
+		UpdatesSinceFull = 0;
+	} else if (!DirtyBlockList.empty()) {
+		UpdateDirty(red_phase);
+	}
+}
+
 /**
 **  Draw the minimap events
 */
@@ -747,6 +1007,10 @@ void CMinimap::Destroy()
 	Minimap2MapX = NULL;
 	delete[] Minimap2MapY;
 	Minimap2MapY = NULL;
+	DirtyBlocks.clear();
+	DirtyBlockList.clear();
+	ChangingUnits.clear();
+	AllDirty = true;
 }
 
 /**
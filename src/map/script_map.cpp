@@ -43,6 +43,7 @@
 #include "translate.h"
 #include "ui.h"
 #include "unit.h"
+#include "unit_manager.h"
 #include "version.h"
 #include "video.h"
 
@@ -90,6 +91,8 @@ static int CclStratagusMap(lua_State *l)
 
 					delete[] Map.Fields;
 					Map.Fields = new CMapField[Map.Info.MapWidth * Map.Info.MapHeight];
+					Map.UnitCells.Create(Map.Info.MapWidth, Map.Info.MapHeight);
+					Map.Visibility.Create(Map.Info.MapWidth * Map.Info.MapHeight);
 					// FIXME: this should be CreateMap or InitMap?
 				} else if (!strcmp(value, "fog-of-war")) {
 					Map.NoFogOfWar = false;
@@ -113,7 +116,7 @@ static int CclStratagusMap(lua_State *l)
 						if (!lua_istable(l, -1)) {
 							LuaError(l, "incorrect argument");
 						}
-						Map.Fields[i].parse(l);
+						Map.Fields[i].parse(l, i);
 						lua_pop(l, 1);
 					}
 					lua_pop(l, 1);
@@ -197,6 +200,7 @@ static int CclShowMapLocation(lua_State *l)
 		target->tilePos.x = LuaToNumber(l, 1);
 		target->tilePos.y = LuaToNumber(l, 2);
 		target->TTL = GameCycle + LuaToNumber(l, 4);
+		UnitManager.UpdateHotState(*target, false);
 		target->CurrentSightRange = LuaToNumber(l, 3);
 		MapMarkUnitSight(*target);
 	} else {
@@ -47,6 +47,8 @@
 #include "luacallback.h"
 #include "map.h"
 #include "player.h"
+#include "pool.h"
+#include "profiler.h"
 #include "sound.h"
 #include "spells.h"
 #include "trigger.h"
@@ -74,6 +76,9 @@ std::vector<BurningBuildingFrame *> BurningBuildingFrames; /// Burning building
 
 extern NumberDesc *Damage;                   /// Damage calculation for missile.
 
+/// Memory of the missiles
+static CClassPool MissilePool("missiles", 256);
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -102,9 +107,19 @@ void MissileType::LoadMissileSprite()
 void LoadMissileSprites()
 {
 #ifndef DYNAMIC_LOAD
+	std::vector<std::string> files;
+
+	for (MissileTypeMap::iterator it = MissileTypes.begin(); it != MissileTypes.end(); ++it) {
+		const CGraphic *g = (*it).second->G;
+		if (g && !g->IsLoaded()) {
+			files.push_back(g->File);
+		}
+	}
+	PreloadGraphics(files);
 	for (MissileTypeMap::iterator it = MissileTypes.begin(); it != MissileTypes.end(); ++it) {
 		(*it).second->LoadMissileSprite();
 	}
+	FreePreloadedGraphics();
 #endif
 }
 /**
@@ -472,7 +487,7 @@ static int MissileVisibleInViewport(const CViewport &vp, const Missile &missile)
 	Vec2i pos;
 	for (pos.x = boxmin.x; pos.x <= boxmax.x; ++pos.x) {
 		for (pos.y = boxmin.y; pos.y <= boxmax.y; ++pos.y) {
-			if (ReplayRevealMap || Map.Field(pos)->playerInfo.IsTeamVisible(*ThisPlayer)) {
+			if (ReplayRevealMap || Map.IsFieldTeamVisible(*ThisPlayer, pos)) {
 				return 1;
 			}
 		}
@@ -1151,42 +1166,57 @@ void Missile::NextMissileFrameCycle()
 	}
 }
 
+/**
+**  Handle the action of a missile for this cycle.
+**
+**  @param missile  Missile to handle.
+**
+**  @return         false if the missile is expired.
+*/
+static bool MissileAction(Missile &missile)
+{
+	if (missile.Delay) {
+		missile.Delay--;
+		return true;  // delay start of missile
+	}
+	if (missile.TTL > 0) {
+		missile.TTL--;  // overall time to live if specified
+	}
+	if (missile.TTL == 0) {
+		return false;
+	}
+	Assert(missile.Wait);
+	if (--missile.Wait) {  // wait until time is over
+		return true;
+	}
+	missile.Action(); // may create other missiles, and so modifies the array
+	return missile.TTL != 0;
+}
+
 /**
 **  Handle all missile actions of global/local missiles.
 **
+**  The expired missiles are removed in a single pass, moving the others
+**  down in place, so the missiles keep their order which the sync needs.
+**  The missiles created by an action are appended and handled in the
+**  same pass.
+**
 **  @param missiles  Table of missiles.
 */
 static void MissilesActionLoop(std::vector<Missile *> &missiles)
 {
-	for (size_t i = 0; i != missiles.size(); /* empty */) {
-		Missile &missile = *missiles[i];
+	size_t alive = 0;
 
-		if (missile.Delay) {
-			missile.Delay--;
-			++i;
-			continue;  // delay start of missile
-		}
-		if (missile.TTL > 0) {
-			missile.TTL--;  // overall time to live if specified
-		}
-		if (missile.TTL == 0) {
-			delete &missile;
-			missiles.erase(missiles.begin() + i);
-			continue;
-		}
-		Assert(missile.Wait);
-		if (--missile.Wait) {  // wait until time is over
-			++i;
-			continue;
-		}
-		missile.Action(); // may create other missiles, and so modifies the array
-		if (missile.TTL == 0) {
-			delete &missile;
-			missiles.erase(missiles.begin() + i);
-			continue;
+	for (size_t i = 0; i != missiles.size(); ++i) {
+		Missile *missile = missiles[i];
+
+		if (MissileAction(*missile)) {
+			missiles[alive++] = missile;
+		} else {
+			delete missile; // back to the missile pool
 		}
-		++i;
 	}
+	missiles.resize(alive);
 }
 
 /**
@@ -1194,10 +1224,64 @@ static void MissilesActionLoop(std::vector<Missile *> &missiles)
 */
 void MissileActions()
 {
+	PROFILE_ZONE("MissileActions");
 	MissilesActionLoop(GlobalMissiles);
 	MissilesActionLoop(LocalMissiles);
 }
 
+/**
+**  Measure the missile actions with many missiles at the same time.
+**
+**  The global missiles are put aside, then count missiles of the type
+**  fly between random points of the map. The expired missiles are
+**  replaced each cycle, so there are always count missiles. They have no
+**  source unit and do not damage the units, but their actions may use
+**  the synced random: do not use it in a network or replayed game.
+**
+**  @param file    Where to print the results.
+**  @param mtype   Type of the missiles.
+**  @param count   Number of missiles at the same time.
+**  @param cycles  Number of cycles to run.
+*/
+void PrintMissileBenchmark(FILE *file, const MissileType &mtype, int count, int cycles)
+{
+	const PixelSize mapSize(Map.Info.MapWidth * PixelTileSize.x, Map.Info.MapHeight * PixelTileSize.y);
+	std::vector<Missile *> savedMissiles;
+	unsigned long actions = 0;
+	unsigned long created = 0;
+	clock_t time = 0;
+
+	if (mapSize.x <= 0 || mapSize.y <= 0) {
+		fprintf(file, "No map to fly the missiles\n");
+		return;
+	}
+	savedMissiles.swap(GlobalMissiles);
+	GlobalMissiles.reserve(count);
+	for (int cycle = 0; cycle != cycles; ++cycle) {
+		for (int i = GlobalMissiles.size(); i < count; ++i) {
+			const PixelPos startPos(MyRand() % mapSize.x, MyRand() % mapSize.y);
+			const PixelPos destPos(MyRand() % mapSize.x, MyRand() % mapSize.y);
+
+			MakeMissile(mtype, startPos, destPos);
+			++created;
+		}
+		actions += GlobalMissiles.size();
+
+		const clock_t start = clock();
+		MissilesActionLoop(GlobalMissiles);
+		time += clock() - start;
+	}
+	fprintf(file, "%d cycles of %d %s missiles: %.3fs, %.1f us per cycle, %lu actions, %lu missiles created\n",
+			cycles, count, mtype.Ident.c_str(), double(time) / CLOCKS_PER_SEC,
+			cycles ? 1000000.0 * time / CLOCKS_PER_SEC / cycles : 0.0, actions, created);
+	PrintPoolStatistics(file);
+
+	for (std::vector<Missile *>::iterator it = GlobalMissiles.begin(); it != GlobalMissiles.end(); ++it) {
+		delete *it;
+	}
+	GlobalMissiles.swap(savedMissiles);
+}
+
 /**
 **  Calculate distance from view-point to missile.
 **
@@ -1377,6 +1461,16 @@ Missile::~Missile()
 	PiercedUnits.clear();
 }
 
+void *Missile::operator new(size_t size)
+{
+	return MissilePool.Alloc(size);
+}
+
+void Missile::operator delete(void *p, size_t size)
+{
+	MissilePool.Free(p, size);
+}
+
 /**
 **  Clean up missiles.
 */
@@ -417,6 +417,30 @@ static int CclCreateMissile(lua_State *l)
 	return 0;
 }
 
+/**
+**  Measure the missile actions with many missiles at the same time.
+**
+**  @param l  Lua state.
+*/
+static int CclBenchmarkMissiles(lua_State *l)
+{
+	const int args = lua_gettop(l);
+	if (args < 1 || args > 3) {
+		LuaError(l, "incorrect argument");
+	}
+	const MissileType *mtype = MissileTypeByIdent(LuaToString(l, 1));
+	if (!mtype) {
+		LuaError(l, "Bad missile");
+	}
+	const int count = args > 1 ? LuaToNumber(l, 2) : 5000;
+	const int cycles = args > 2 ? LuaToNumber(l, 3) : 1000;
+	if (count < 0 || cycles < 0) {
+		LuaError(l, "incorrect argument");
+	}
+	PrintMissileBenchmark(stdout, *mtype, count, cycles);
+	return 0;
+}
+
 /**
 **  Register CCL features for missile-type.
 */
@@ -426,6 +450,7 @@ void MissileCclRegister()
 	lua_register(Lua, "Missile", CclMissile);
 	lua_register(Lua, "DefineBurningBuilding", CclDefineBurningBuilding);
 	lua_register(Lua, "CreateMissile", CclCreateMissile);
+	lua_register(Lua, "BenchmarkMissiles", CclBenchmarkMissiles);
 }
 
 //@}
@@ -586,13 +586,16 @@ int NetSendTCP(Socket sockfd, const void *buf, int len)
 /**
 **  Listen for connections on a TCP socket.
 **
+**  The queue of pending connections has the system maximum size, as the
+**  metaserver may receive many connections at once.
+**
 **  @param sockfd  Socket
 **
 **  @return 0 for success, -1 for error
 */
 int NetListenTCP(Socket sockfd)
 {
-	return listen(sockfd, PlayerMax);
+	return listen(sockfd, SOMAXCONN);
 }
 
 /**
@@ -250,6 +250,8 @@ size_t CServerSetup::Serialize(unsigned char *buf) const
 	p += serialize8(p, this->Difficulty);
 	p += serialize8(p, this->MapRichness);
 	p += serialize8(p, this->Opponents);
+	p += serialize8(p, this->PathfinderPrefetch);
+	p += serialize8(p, this->PathCache);
 	for (int i = 0; i < PlayerMax; ++i) {
 		p += serialize8(p, this->CompOpt[i]);
 	}
@@ -275,6 +277,8 @@ size_t CServerSetup::Deserialize(const unsigned char *p)
 	p += deserialize8(p, &this->Difficulty);
 	p += deserialize8(p, &this->MapRichness);
 	p += deserialize8(p, &this->Opponents);
+	p += deserialize8(p, &this->PathfinderPrefetch);
+	p += deserialize8(p, &this->PathCache);
 	for (int i = 0; i < PlayerMax; ++i) {
 		p += deserialize8(p, &this->CompOpt[i]);
 	}
@@ -299,6 +303,8 @@ void CServerSetup::Clear()
 	Difficulty = 0;
 	MapRichness = 0;
 	Opponents = 0;
+	PathfinderPrefetch = 0;
+	PathCache = 0;
 	memset(CompOpt, 0, sizeof(CompOpt));
 	memset(Ready, 0, sizeof(Ready));
 	memset(Race, 0, sizeof(Race));
@@ -316,6 +322,8 @@ bool CServerSetup::operator == (const CServerSetup &rhs) const
 			&& Difficulty == rhs.Difficulty
 			&& MapRichness == rhs.MapRichness
 			&& Opponents == rhs.Opponents
+			&& PathfinderPrefetch == rhs.PathfinderPrefetch
+			&& PathCache == rhs.PathCache
 			&& memcmp(CompOpt, rhs.CompOpt, sizeof(CompOpt)) == 0
 			&& memcmp(Ready, rhs.Ready, sizeof(Ready)) == 0
 			&& memcmp(Race, rhs.Race, sizeof(Race)) == 0);
@@ -349,7 +357,7 @@ CInitMessage_Hello::CInitMessage_Hello(const char *name) :
 	header(MessageInit_FromClient, ICMHello)
 {
 	strncpy_s(this->PlyName, sizeof(this->PlyName), name, _TRUNCATE);
-	this->Stratagus = StratagusVersion;
+	this->Stratagus = NetworkProtocolVersion;
 	this->Version = FileChecksums;
 }
 
@@ -413,7 +421,7 @@ void CInitMessage_Config::Deserialize(const unsigned char *p)
 CInitMessage_EngineMismatch::CInitMessage_EngineMismatch() :
 	header(MessageInit_FromServer, ICMEngineMismatch)
 {
-	this->Stratagus = StratagusVersion;
+	this->Stratagus = NetworkProtocolVersion;
 }
 
 const unsigned char *CInitMessage_EngineMismatch::Serialize() const
@@ -661,6 +669,11 @@ size_t CNetworkCommandSync::Serialize(unsigned char *buf) const
 	unsigned char *p = buf;
 	p += serialize32(p, this->syncSeed);
 	p += serialize32(p, this->syncHash);
+	p += serialize32(p, this->pingTime);
+	p += serialize32(p, this->echoTime);
+	p += serialize16(p, this->echoDelay);
+	p += serialize8(p, this->echoPlayer);
+	p += serialize8(p, this->lag);
 	return p - buf;
 }
 
@@ -669,6 +682,11 @@ size_t CNetworkCommandSync::Deserialize(const unsigned char *buf)
 	const unsigned char *p = buf;
 	p += deserialize32(p, &this->syncSeed);
 	p += deserialize32(p, &this->syncHash);
+	p += deserialize32(p, &this->pingTime);
+	p += deserialize32(p, &this->echoTime);
+	p += deserialize16(p, &this->echoDelay);
+	p += deserialize8(p, &this->echoPlayer);
+	p += deserialize8(p, &this->lag);
 	return p - buf;
 }
 
@@ -884,8 +884,9 @@ void CClient::Parse_EngineMismatch(const unsigned char *buf)
 
 	msg.Deserialize(buf);
 	const std::string serverHostStr = serverHost.toString();
-	fprintf(stderr, "Incompatible Stratagus version %d <-> %d\nfrom %s\n",
-			StratagusVersion, msg.Stratagus, serverHostStr.c_str());
+	fprintf(stderr, "Incompatible network protocol " NetworkProtocolFormatString " <-> " NetworkProtocolFormatString "\nfrom %s\n",
+			NetworkProtocolFormatArgs(NetworkProtocolVersion), NetworkProtocolFormatArgs(msg.Stratagus),
+			serverHostStr.c_str());
 	networkState.State = ccs_incompatibleengine;
 }
 
@@ -1290,10 +1291,11 @@ void CServer::Parse_SeeYou(const int h)
 */
 static int CheckVersions(const CInitMessage_Hello &msg, CUDPSocket &socket, const CHost &host)
 {
-	if (msg.Stratagus != StratagusVersion) {
+	if (msg.Stratagus != NetworkProtocolVersion) {
 		const std::string hostStr = host.toString();
-		fprintf(stderr, "Incompatible Stratagus version %d <-> %d from %s\n",
-				StratagusVersion, msg.Stratagus, hostStr.c_str());
+		fprintf(stderr, "Incompatible network protocol " NetworkProtocolFormatString " <-> " NetworkProtocolFormatString " from %s\n",
+				NetworkProtocolFormatArgs(NetworkProtocolVersion), NetworkProtocolFormatArgs(msg.Stratagus),
+				hostStr.c_str());
 
 		const CInitMessage_EngineMismatch message;
 		NetworkSendICMessage_Log(socket, host, message);
@@ -1628,6 +1630,9 @@ void NetworkServerStartGame()
 	}
 
 	// Prepare the final state message:
+	// the settings changing the simulation are the ones of the server
+	ServerSetupState.PathfinderPrefetch = GameSettings.PathfinderPrefetch;
+	ServerSetupState.PathCache = GameSettings.PathCache;
 	const CInitMessage_State statemsg(MessageInit_FromServer, ServerSetupState);
 
 	DebugPrint("Ready, sending InitConfig to %d host(s)\n" _C_ HostsCount);
@@ -1760,6 +1765,8 @@ void NetworkInitServerConnect(int openslots)
 	ServerSetupState.Clear();
 	LocalSetupState.Clear(); // Unused when we are server
 	Server.Init(Parameters::Instance.LocalPlayerName, &NetworkFildes, &ServerSetupState);
+	ServerSetupState.PathfinderPrefetch = GameSettings.PathfinderPrefetch;
+	ServerSetupState.PathCache = GameSettings.PathCache;
 
 	// preset the server (initially always slot 0)
 	Hosts[0].SetName(Parameters::Instance.LocalPlayerName.c_str());
@@ -1787,6 +1794,8 @@ void NetworkGamePrepareGameSettings()
 	DebugPrint("NetPlayers = %d\n" _C_ NetPlayers);
 
 	GameSettings.NetGameType = SettingsMultiPlayerGame;
+	GameSettings.PathfinderPrefetch = ServerSetupState.PathfinderPrefetch != 0;
+	GameSettings.PathCache = ServerSetupState.PathCache != 0;
 
 #ifdef DEBUG
 	for (int i = 0; i < PlayerMax - 1; i++) {
@@ -146,6 +146,17 @@
 ** If there are missing packages, the game is paused and old commands
 ** are resend to all clients.
 **
+** @subsection lag Adaptive lag
+**
+** The syncs carry the time they were sent and echo the time of the last
+** sync received from one of the hosts the player talks to directly (the
+** server for a client, the clients for the server). This gives the
+** round-trip time and its jitter of each link, from which each player
+** computes the lag it wants and sends it in its syncs. Those are executed
+** like the other commands, so at each lag update point all the players
+** take the same lag: the biggest wanted one. The lag grows at once but
+** shrinks by one update per lag update point.
+**
 ** @section missing What features are missing
 **
 ** @li The recover from lost packets can be improved, as the player knows
@@ -156,7 +167,7 @@
 **
 ** @li Add a server/client protocol, which allows more players per game.
 **
-** @li Lag (latency) and bandwidth should be automatic detected during game setup
+** @li Bandwidth should be automatic detected during game setup
 ** and later during game automatic adapted.
 **
 ** @li Also it would be nice, if we support viewing clients. This means
@@ -235,6 +246,7 @@
 #include "netconnect.h"
 #include "parameters.h"
 #include "player.h"
+#include "profiler.h"
 #include "replay.h"
 #include "sound.h"
 #include "translate.h"
@@ -303,24 +315,115 @@ static CNetworkCommandQueue NetworkIn[256][PlayerMax][MaxNetworkCommands]; /// P
 static std::deque<CNetworkCommandQueue> CommandsIn;    /// Network command input queue
 static std::deque<CNetworkCommandQueue> MsgCommandsIn; /// Network message input queue
 
+static const unsigned int NetworkMaxLag = 120;          /// Max lag, the input queue keeps 256 cycles
+static const unsigned int NetworkLagUpdateCycles = 5 * CYCLES_PER_SECOND; /// Cycles between lag updates
+static unsigned int NetworkCurrentLag;                  /// Lag in use (# game cycles)
+static unsigned long NetworkLastSentCycle;              /// Last cycle our commands were sent for
+static unsigned int NetworkLagWanted[PlayerMax];        /// Lag wanted by each player, as executed
+static int NetworkEchoNext;                             /// Next host to echo the sync of
+
+/**
+**  Round-trip time of the link to another host.
+**
+**  The rtt is smoothed like the retransmission timer of TCP.
+*/
+class CNetworkLink
+{
+public:
+	CNetworkLink() { Clear(); }
+
+	void Clear()
+	{
+		LastCycle = 0;
+		EchoTime = EchoReceived = 0;
+		EchoPending = false;
+		Rtt = Jitter = 0;
+		SampleCount = 0;
+	}
+
+	void AddSample(unsigned int rtt)
+	{
+		if (SampleCount == 0) {
+			Rtt = rtt;
+			Jitter = rtt / 2;
+		} else {
+			const unsigned int delta = rtt > Rtt ? rtt - Rtt : Rtt - rtt;
+			Jitter = (3 * Jitter + delta) / 4;
+			Rtt = (7 * Rtt + rtt) / 8;
+		}
+		++SampleCount;
+	}
+
+public:
+	unsigned long LastCycle;     /// Cycle of the last sync received
+	unsigned long EchoTime;      /// Ticks of the host when it sent that sync
+	unsigned long EchoReceived;  /// Local ticks when that sync was received
+	bool EchoPending;            /// That sync has not been echoed yet
+	unsigned int Rtt;            /// Smoothed round-trip time in ms
+	unsigned int Jitter;         /// Mean deviation of the round-trip time in ms
+	unsigned int SampleCount;    /// Number of rtt samples
+};
+
+static CNetworkLink NetworkLinks[PlayerMax]; /// Links to the other players
 
-#ifdef DEBUG
 class CNetworkStat
 {
 public:
 	CNetworkStat() :
-		resentPacketCount(0)
+		resentPacketCount(0), stallCount(0), stallFrameCount(0),
+		lag(0), minLag(0), maxLag(0), lagChangeCount(0)
 	{}
 
-	void print() const
+	/// Start the statistics of a game
+	void startLag(unsigned int startLag)
+	{
+		resentPacketCount = 0;
+		stallCount = 0;
+		stallFrameCount = 0;
+		lag = minLag = maxLag = startLag;
+		lagChangeCount = 0;
+	}
+
+	void changeLag(unsigned int newLag)
 	{
-		DebugPrint("resent: %d packets\n" _C_ resentPacketCount);
+		lag = newLag;
+		minLag = std::min(minLag, newLag);
+		maxLag = std::max(maxLag, newLag);
+		++lagChangeCount;
+	}
+
+	/**
+	**  Print the statistics of the game, so the lag adaptation can be
+	**  checked in the release builds too.
+	*/
+	void print(FILE *file) const
+	{
+		fprintf(file, "Network resent: %u packets\n", resentPacketCount);
+		fprintf(file, "Network lag: %u cycles (min %u, max %u, %u changes)\n",
+				lag, minLag, maxLag, lagChangeCount);
+		fprintf(file, "Network stalls: %u (%lu frames)\n", stallCount, stallFrameCount);
+		for (int i = 0; i < PlayerMax; ++i) {
+			if (NetworkLinks[i].SampleCount) {
+				fprintf(file, "Network rtt player %d: %u ms, jitter %u ms (%u samples)\n", i,
+						NetworkLinks[i].Rtt, NetworkLinks[i].Jitter, NetworkLinks[i].SampleCount);
+			}
+		}
 	}
 
 public:
 	unsigned int resentPacketCount;
+	unsigned int stallCount;       /// Times the commands of a player were late
+	unsigned long stallFrameCount; /// Frames waited for late commands
+	unsigned int lag;              /// Lag in use (# game cycles)
+	unsigned int minLag;           /// Smallest lag used
+	unsigned int maxLag;           /// Biggest lag used
+	unsigned int lagChangeCount;   /// Number of lag changes
 };
 
+static CNetworkStat NetworkStat;
+
+#ifdef DEBUG
+
 static void printStatistic(const CUDPSocket::CStatistic &statistic)
 {
 	DebugPrint("Sent: %d packets %d bytes (max %d bytes).\n"
@@ -331,8 +434,6 @@ static void printStatistic(const CUDPSocket::CStatistic &statistic)
 			   _C_ statistic.biggestReceivedPacketSize);
 	DebugPrint("Received: %d error(s).\n" _C_ statistic.receivedErrorCount);
 }
-
-static CNetworkStat NetworkStat;
 #endif
 
 static int PlayerQuit[PlayerMax];          /// Player quit
@@ -447,8 +548,8 @@ void ExitNetwork1()
 #ifdef DEBUG
 	printStatistic(NetworkFildes.getStatistic());
 	NetworkFildes.clearStatistic();
-	NetworkStat.print();
 #endif
+	NetworkStat.print(stdout);
 
 	NetworkFildes.Close();
 	NetExit(); // machine dependent setup
@@ -471,6 +572,17 @@ void NetworkOnStartGame()
 			   CNetworkParameter::Instance.gameCyclesPerUpdate _C_
 			   CNetworkParameter::Instance.NetworkLag _C_ HostsCount);
 
+	// The commands are sent and executed each gameCyclesPerUpdate
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	NetworkCurrentLag = (CNetworkParameter::Instance.NetworkLag + gameCyclesPerUpdate - 1) / gameCyclesPerUpdate * gameCyclesPerUpdate;
+	NetworkLastSentCycle = NetworkCurrentLag;
+	NetworkStat.startLag(NetworkCurrentLag);
+	NetworkEchoNext = 0;
+	for (int i = 0; i != PlayerMax; ++i) {
+		NetworkLinks[i].Clear();
+		NetworkLagWanted[i] = 0;
+	}
+
 	NetworkInSync = true;
 	CommandsIn.clear();
 	MsgCommandsIn.clear();
@@ -486,7 +598,7 @@ void NetworkOnStartGame()
 	//nc.syncHash = SyncHash;
 	//nc.syncSeed = SyncRandSeed;
 
-	for (unsigned int i = 0; i <= CNetworkParameter::Instance.NetworkLag; i += CNetworkParameter::Instance.gameCyclesPerUpdate) {
+	for (unsigned int i = 0; i <= NetworkCurrentLag; i += gameCyclesPerUpdate) {
 		for (int n = 0; n < HostsCount; ++n) {
 			CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[i][Hosts[n].PlyNr];
 
@@ -661,6 +773,8 @@ static void NetworkRemovePlayer(int player)
 			NetworkIn[i][player][c].Time = 0;
 		}
 	}
+	NetworkLinks[player].Clear();
+	NetworkLagWanted[player] = 0;
 }
 
 static bool IsNetworkCommandReady(int hostIndex, unsigned long gameNetCycle)
@@ -765,6 +879,112 @@ static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int p
 	// FIXME: not all values in nc have been validated
 }
 
+/**
+**  Check if we send our packets to a player, and not through the server.
+**
+**  @param player  Player number
+*/
+static bool IsDirectLink(int player)
+{
+	if (NetConnectType == 1) { // server
+		return true;
+	}
+	return HostsCount > 0 && Hosts[HostsCount - 1].PlyNr == player;
+}
+
+/**
+**  Take the round-trip time sample of a sync received from a player,
+**  and keep its time to echo it.
+**
+**  @param player        Player who sent the sync
+**  @param data          Sync message
+**  @param gameNetCycle  Cycle of the sync
+*/
+static void NetworkParseSync(int player, const std::vector<unsigned char> &data, unsigned long gameNetCycle)
+{
+	CNetworkLink &link = NetworkLinks[player];
+
+	// Resent syncs are late, their time gives no rtt.
+	if (!IsDirectLink(player) || data.size() < CNetworkCommandSync::Size() || gameNetCycle <= link.LastCycle) {
+		return;
+	}
+	CNetworkCommandSync nc;
+	nc.Deserialize(&data[0]);
+
+	const uint32_t ticks = GetTicks();
+	link.LastCycle = gameNetCycle;
+	link.EchoTime = nc.pingTime;
+	link.EchoReceived = ticks;
+	link.EchoPending = true;
+	if (nc.echoPlayer == ThisPlayer->Index) {
+		const uint32_t rtt = ticks - nc.echoTime - nc.echoDelay;
+
+		if (rtt < 10000) {
+			link.AddSample(rtt);
+		}
+	}
+}
+
+/**
+**  Lag wanted for the links of this player.
+**
+**  The commands must reach the other players before they execute them:
+**  it takes the trip to the server and, for the other clients, the trip
+**  from the server, so one round-trip time, plus one update to be sent.
+**
+**  @return the lag in game cycles, 0 if no link has been measured yet.
+*/
+static unsigned int NetworkWantedLag()
+{
+	unsigned int delay = 0;
+
+	for (int i = 0; i < HostsCount; ++i) {
+		const CNetworkLink &link = NetworkLinks[Hosts[i].PlyNr];
+
+		if (link.SampleCount && IsDirectLink(Hosts[i].PlyNr)) {
+			delay = std::max(delay, link.Rtt + 4 * link.Jitter);
+		}
+	}
+	if (delay == 0) {
+		return 0;
+	}
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	const unsigned int cycleTime = std::max(100000 / (CYCLES_PER_SECOND * std::max(VideoSyncSpeed, 1)), 1);
+	unsigned int lag = (delay + cycleTime - 1) / cycleTime + gameCyclesPerUpdate;
+
+	lag = (lag + gameCyclesPerUpdate - 1) / gameCyclesPerUpdate * gameCyclesPerUpdate;
+	return std::min(std::max(lag, 2 * gameCyclesPerUpdate), NetworkMaxLag / gameCyclesPerUpdate * gameCyclesPerUpdate);
+}
+
+/**
+**  Fill the times and the wanted lag of a sync to send.
+**
+**  The sync echoes the last sync received from one of the linked
+**  players, in turn.
+**
+**  @param nc  Sync to send
+*/
+static void NetworkPrepareSync(CNetworkCommandSync &nc)
+{
+	const uint32_t ticks = GetTicks();
+
+	nc.pingTime = ticks;
+	nc.lag = NetworkWantedLag();
+	for (int i = 0; i < HostsCount; ++i) {
+		const int index = (NetworkEchoNext + i) % HostsCount;
+		CNetworkLink &link = NetworkLinks[Hosts[index].PlyNr];
+
+		if (link.EchoPending && IsDirectLink(Hosts[index].PlyNr)) {
+			nc.echoPlayer = Hosts[index].PlyNr;
+			nc.echoTime = link.EchoTime;
+			nc.echoDelay = std::min<uint32_t>(ticks - uint32_t(link.EchoReceived), 0xFFFF);
+			link.EchoPending = false;
+			NetworkEchoNext = index + 1;
+			break;
+		}
+	}
+}
+
 static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHost &host)
 {
 	CNetworkPacket packet;
@@ -793,6 +1013,11 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 		return;
 	}
 	NetworkLastCycle[player] = packet.Header.Cycle;
+	// Destination cycle (time to execute).
+	unsigned long n = ((GameCycle + 128) & ~0xFF) | packet.Header.Cycle;
+	if (n > GameCycle + 128) {
+		n -= 0x100;
+	}
 	// Parse the packet commands.
 	for (int i = 0; i != commands; ++i) {
 		// Handle some messages.
@@ -815,10 +1040,8 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 		bool validCommand = IsAValidCommand(packet, i, player);
 		// Place in network in
 		if (validCommand) {
-			// Destination cycle (time to execute).
-			unsigned long n = ((GameCycle + 128) & ~0xFF) | packet.Header.Cycle;
-			if (n > GameCycle + 128) {
-				n -= 0x100;
+			if (packet.Header.Type[i] == MessageSync) {
+				NetworkParseSync(player, packet.Command[i], n);
 			}
 			NetworkIn[packet.Header.Cycle][player][i].Time = n;
 			NetworkIn[packet.Header.Cycle][player][i].Type = packet.Header.Type[i];
@@ -884,9 +1107,8 @@ void NetworkQuitGame()
 	if (!ThisPlayer || IsNetworkGame() == false) {
 		return;
 	}
-	const int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
-	const int NetworkLag = CNetworkParameter::Instance.NetworkLag;
-	const int n = (GameCycle + gameCyclesPerUpdate) / gameCyclesPerUpdate * gameCyclesPerUpdate + NetworkLag;
+	// Next cycle our commands will be sent for
+	const unsigned long n = NetworkLastSentCycle + CNetworkParameter::Instance.gameCyclesPerUpdate;
 	CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[n & 0xFF][ThisPlayer->Index];
 	CNetworkCommandQuit nc;
 	nc.player = ThisPlayer->Index;
@@ -901,12 +1123,16 @@ void NetworkQuitGame()
 	NetworkSendPacket(ncqs);
 }
 
-static void NetworkExecCommand_Sync(const CNetworkCommandQueue &ncq)
+static void NetworkExecCommand_Sync(const CNetworkCommandQueue &ncq, int player)
 {
 	Assert((ncq.Type & 0x7F) == MessageSync);
 
 	CNetworkCommandSync nc;
 	nc.Deserialize(&ncq.Data[0]);
+	// Same on all the computers, see NetworkUpdateLag
+	if (nc.lag) {
+		NetworkLagWanted[player] = nc.lag;
+	}
 	const unsigned long gameNetCycle = GameCycle;
 	const int syncSeed = nc.syncSeed;
 	const int syncHash = nc.syncHash;
@@ -982,12 +1208,13 @@ static void NetworkExecCommand_Command(const CNetworkCommandQueue &ncq)
 /**
 **  Execute a network command.
 **
-**  @param ncq  Network command from queue
+**  @param ncq     Network command from queue
+**  @param player  Player who sent the command
 */
-static void NetworkExecCommand(const CNetworkCommandQueue &ncq)
+static void NetworkExecCommand(const CNetworkCommandQueue &ncq, int player)
 {
 	switch (ncq.Type & 0x7F) {
-		case MessageSync: NetworkExecCommand_Sync(ncq); break;
+		case MessageSync: NetworkExecCommand_Sync(ncq, player); break;
 		case MessageSelection: NetworkExecCommand_Selection(ncq); break;
 		case MessageChat: NetworkExecCommand_Chat(ncq); break;
 		case MessageQuit: NetworkExecCommand_Quit(ncq); break;
@@ -1005,46 +1232,46 @@ static void NetworkExecCommand(const CNetworkCommandQueue &ncq)
 */
 static void NetworkSendCommands(unsigned long gameNetCycle)
 {
-	// No command available, send sync.
 	int numcommands = 0;
 	CNetworkCommandQueue(&ncq)[MaxNetworkCommands] = NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index];
 	ncq[0].Clear();
-	if (CommandsIn.empty() && MsgCommandsIn.empty()) {
-		CNetworkCommandSync nc;
-		ncq[0].Type = MessageSync;
-		nc.syncHash = SyncHash;
-		nc.syncSeed = SyncRandSeed;
-		ncq[0].Data.resize(nc.Size());
-		nc.Serialize(&ncq[0].Data[0]);
-		ncq[0].Time = gameNetCycle;
-		numcommands = 1;
-	} else {
-		while (!CommandsIn.empty() && numcommands < MaxNetworkCommands) {
-			const CNetworkCommandQueue &incommand = CommandsIn.front();
+	while (!CommandsIn.empty() && numcommands < MaxNetworkCommands) {
+		const CNetworkCommandQueue &incommand = CommandsIn.front();
 #ifdef DEBUG
-			if (incommand.Type != MessageExtendedCommand) {
-				CNetworkCommand nc;
-				nc.Deserialize(&incommand.Data[0]);
-
-				const CUnit &unit = UnitManager.GetSlotUnit(nc.Unit);
-				// FIXME: we can send destoyed units over network :(
-				if (unit.Destroyed) {
-					DebugPrint("Sending destroyed unit %d over network!!!!!!\n" _C_ nc.Unit);
-				}
+		if (incommand.Type != MessageExtendedCommand) {
+			CNetworkCommand nc;
+			nc.Deserialize(&incommand.Data[0]);
+
+			const CUnit &unit = UnitManager.GetSlotUnit(nc.Unit);
+			// FIXME: we can send destoyed units over network :(
+			if (unit.Destroyed) {
+				DebugPrint("Sending destroyed unit %d over network!!!!!!\n" _C_ nc.Unit);
 			}
-#endif
-			ncq[numcommands] = incommand;
-			ncq[numcommands].Time = gameNetCycle;
-			++numcommands;
-			CommandsIn.pop_front();
-		}
-		while (!MsgCommandsIn.empty() && numcommands < MaxNetworkCommands) {
-			const CNetworkCommandQueue &incommand = MsgCommandsIn.front();
-			ncq[numcommands] = incommand;
-			ncq[numcommands].Time = gameNetCycle;
-			++numcommands;
-			MsgCommandsIn.pop_front();
 		}
+#endif
+		ncq[numcommands] = incommand;
+		ncq[numcommands].Time = gameNetCycle;
+		++numcommands;
+		CommandsIn.pop_front();
+	}
+	while (!MsgCommandsIn.empty() && numcommands < MaxNetworkCommands) {
+		const CNetworkCommandQueue &incommand = MsgCommandsIn.front();
+		ncq[numcommands] = incommand;
+		ncq[numcommands].Time = gameNetCycle;
+		++numcommands;
+		MsgCommandsIn.pop_front();
+	}
+	// Send sync if there is room, it also measures the lag.
+	if (numcommands != MaxNetworkCommands) {
+		CNetworkCommandSync nc;
+		nc.syncHash = SyncHash;
+		nc.syncSeed = SyncRandSeed;
+		NetworkPrepareSync(nc);
+		ncq[numcommands].Type = MessageSync;
+		ncq[numcommands].Data.resize(nc.Size());
+		nc.Serialize(&ncq[numcommands].Data[0]);
+		ncq[numcommands].Time = gameNetCycle;
+		++numcommands;
 	}
 	if (numcommands != MaxNetworkCommands) {
 		ncq[numcommands].Type = MessageNone;
@@ -1068,28 +1295,71 @@ static void NetworkExecCommands(unsigned long gameNetCycle)
 				break;
 			}
 			if (ncq.Time && ncq.Time == gameNetCycle) {
-				NetworkExecCommand(ncq);
+				NetworkExecCommand(ncq, i);
 			}
 		}
 	}
 }
 
+/**
+**  Take the lag wanted by the players.
+**
+**  The wanted lags come from the executed syncs, so all the computers
+**  take the same lag at the same cycle. The lag grows at once, and
+**  shrinks by one update, a late packet stalls the game.
+*/
+static void NetworkUpdateLag()
+{
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	unsigned int lag = 0;
+
+	for (int i = 0; i != PlayerMax; ++i) {
+		lag = std::max(lag, NetworkLagWanted[i]);
+	}
+	if (lag == 0) { // Not measured yet
+		return;
+	}
+	if (lag < NetworkCurrentLag) {
+		lag = std::max(lag, NetworkCurrentLag - gameCyclesPerUpdate);
+	}
+	lag = (lag + gameCyclesPerUpdate - 1) / gameCyclesPerUpdate * gameCyclesPerUpdate;
+	lag = std::min(std::max(lag, 2 * gameCyclesPerUpdate), NetworkMaxLag / gameCyclesPerUpdate * gameCyclesPerUpdate);
+	if (lag != NetworkCurrentLag) {
+		DebugPrint("Lag %d -> %d at cycle %lu\n" _C_ NetworkCurrentLag _C_ lag _C_ GameCycle);
+		NetworkCurrentLag = lag;
+		NetworkStat.changeLag(lag);
+	}
+}
+
 /**
 **  Handle network commands.
 */
 void NetworkCommands()
 {
+	PROFILE_ZONE("NetworkCommands");
 	if (!IsNetworkGame()) {
 		return;
 	}
-	if ((GameCycle % CNetworkParameter::Instance.gameCyclesPerUpdate) != 0) {
+	const unsigned int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	if ((GameCycle % gameCyclesPerUpdate) != 0) {
 		return;
 	}
 	const unsigned long gameNetCycle = GameCycle;
-	// Send messages to all clients (other players)
-	NetworkSendCommands(gameNetCycle + CNetworkParameter::Instance.NetworkLag);
+	if (gameNetCycle % NetworkLagUpdateCycles < gameCyclesPerUpdate) {
+		NetworkUpdateLag();
+	}
+	// Send messages to all clients (other players).
+	// When the lag grows, the cycles in between get their packet too,
+	// when it shrinks, nothing is sent until the lag is reached.
+	for (unsigned long cycle = NetworkLastSentCycle + gameCyclesPerUpdate; cycle <= gameNetCycle + NetworkCurrentLag; cycle += gameCyclesPerUpdate) {
+		NetworkSendCommands(cycle);
+		NetworkLastSentCycle = cycle;
+	}
 	NetworkExecCommands(gameNetCycle);
-	NetworkInSync = IsNetworkCommandReady(gameNetCycle + CNetworkParameter::Instance.gameCyclesPerUpdate);
+	NetworkInSync = IsNetworkCommandReady(gameNetCycle + gameCyclesPerUpdate);
+	if (!NetworkInSync) {
+		++NetworkStat.stallCount;
+	}
 }
 
 static void CheckPlayerThatTimeOut(int hostIndex)
@@ -1137,9 +1407,7 @@ static void CheckPlayerThatTimeOut(int hostIndex)
 */
 static void NetworkResendCommands()
 {
-#ifdef DEBUG
 	++NetworkStat.resentPacketCount;
-#endif
 
 	const int networkUpdates = CNetworkParameter::Instance.gameCyclesPerUpdate;
 	const int nextGameCycle = ((GameCycle / networkUpdates) + 1) * networkUpdates;
@@ -1161,6 +1429,7 @@ void NetworkRecover()
 		NetworkInSync = true;
 		return;
 	}
+	++NetworkStat.stallFrameCount;
 	if (FrameCounter % CNetworkParameter::Instance.gameCyclesPerUpdate != 0) {
 		return;
 	}
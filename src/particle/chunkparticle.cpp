@@ -36,8 +36,6 @@
 #include "video.h"
 
 
-static const int gravity = 32 * 12;
-
 static inline float deg2rad(int degrees)
 {
 	return degrees * (3.1415926535f / 180);
@@ -47,8 +45,8 @@ static inline float deg2rad(int degrees)
 CChunkParticle::CChunkParticle(CPosition position, GraphicAnimation *smokeAnimation, GraphicAnimation *debrisAnimation,
 							   GraphicAnimation *destroyAnimation,
 							   int minVelocity, int maxVelocity, int minTrajectoryAngle, int maxTTL, int drawlevel) :
-	CParticle(position, drawlevel), initialPos(position), maxTTL(maxTTL), nextSmokeTicks(0),
-	age(0), height(0.f)
+	CParticle(position, drawlevel), maxTTL(maxTTL), smokeDrawLevel(0), destroyDrawLevel(0),
+	debrisAnimation(*debrisAnimation), smokeAnimation(*smokeAnimation), destroyAnimation(*destroyAnimation)
 {
 	float radians = deg2rad(MyRand() % 360);
 	direction.x = cos(radians);
@@ -59,99 +57,25 @@ CChunkParticle::CChunkParticle(CPosition position, GraphicAnimation *smokeAnimat
 	this->minTrajectoryAngle = minTrajectoryAngle;
 	this->initialVelocity = this->minVelocity + MyRand() % (this->maxVelocity - this->minVelocity + 1);
 	this->trajectoryAngle = deg2rad(MyRand() % (90 - this->minTrajectoryAngle) + this->minTrajectoryAngle);
-	this->lifetime = (int)(1000 * (initialVelocity * sin(trajectoryAngle) / gravity) * 2);
+	this->lifetime = (int)(1000 * (initialVelocity * sin(trajectoryAngle) / ChunkGravity) * 2);
 	if (maxTTL) {
 		this->lifetime = std::min(maxTTL, this->lifetime);
 	}
-
-	this->smokeAnimation = smokeAnimation->clone();
-	this->debrisAnimation = debrisAnimation->clone();
-	this->destroyAnimation = destroyAnimation->clone();
-}
-
-CChunkParticle::~CChunkParticle()
-{
-	delete debrisAnimation;
-	delete smokeAnimation;
-	delete destroyAnimation;
-}
-
-static float calculateScreenPos(float posy, float height)
-{
-	return posy - height * 0.2f;
-}
-
-
-bool CChunkParticle::isVisible(const CViewport &vp) const
-{
-	return debrisAnimation && debrisAnimation->isVisible(vp, pos);
-}
-
-void CChunkParticle::draw()
-{
-	CPosition screenPos = ParticleManager.getScreenPos(pos);
-	screenPos.y = calculateScreenPos(screenPos.y, height);
-	debrisAnimation->draw(static_cast<int>(screenPos.x), static_cast<int>(screenPos.y));
-}
-
-static float getHorizontalPosition(int initialVelocity, float trajectoryAngle, float time)
-{
-	return (initialVelocity * cos(trajectoryAngle)) * time;
-}
-
-static float getVerticalPosition(int initialVelocity, float trajectoryAngle, float time)
-{
-	return (initialVelocity * sin(trajectoryAngle)) * time -
-		   (gravity / 2.0f) * (time * time);
 }
 
-void CChunkParticle::update(int ticks)
+void CChunkParticle::addTo(CParticleManager &manager) const
 {
-	age += ticks;
-	if (age >= lifetime) {
-		if (destroyAnimation) {
-			CPosition p(pos.x, calculateScreenPos(pos.y, height));
-			GraphicAnimation *destroyanimation = destroyAnimation->clone();
-			StaticParticle *destroy = new StaticParticle(p, destroyanimation, destroyDrawLevel);
-			ParticleManager.add(destroy);
-		}
-
-		destroy();
-		return;
-	}
-
-	const int minSmokeTicks = 150;
-	const int randSmokeTicks = 50;
+	const float horizontalSpeed = initialVelocity * cos(trajectoryAngle);
+	const float verticalSpeed = initialVelocity * sin(trajectoryAngle);
 
-	if (age > nextSmokeTicks) {
-		CPosition p(pos.x, calculateScreenPos(pos.y, height));
-		GraphicAnimation *smokeanimation = smokeAnimation->clone();
-		CSmokeParticle *smoke = new CSmokeParticle(p, smokeanimation, 0, -22.0f, smokeDrawLevel);
-		ParticleManager.add(smoke);
-
-		nextSmokeTicks += MyRand() % randSmokeTicks + minSmokeTicks;
-	}
-
-	debrisAnimation->update(ticks);
-	if (debrisAnimation->isFinished()) {
-		GraphicAnimation *debrisanimation = debrisAnimation->clone();
-		delete debrisAnimation;
-		debrisAnimation = debrisanimation;
-	}
-
-	float time = age / 1000.f;
-
-	float distance = getHorizontalPosition(initialVelocity, trajectoryAngle, time);
-	pos.x = initialPos.x + distance * direction.x;
-	pos.y = initialPos.y + distance * direction.y;
-
-	height = getVerticalPosition(initialVelocity, trajectoryAngle, time);
+	manager.addChunk(pos, debrisAnimation, smokeAnimation, destroyAnimation,
+					 horizontalSpeed * direction.x, horizontalSpeed * direction.y, verticalSpeed,
+					 lifetime, drawLevel, smokeDrawLevel, destroyDrawLevel);
 }
 
-
 CParticle *CChunkParticle::clone()
 {
-	CChunkParticle *particle = new CChunkParticle(pos, smokeAnimation, debrisAnimation, destroyAnimation, minVelocity, maxVelocity, minTrajectoryAngle, maxTTL, drawLevel);
+	CChunkParticle *particle = new CChunkParticle(pos, &smokeAnimation, &debrisAnimation, &destroyAnimation, minVelocity, maxVelocity, minTrajectoryAngle, maxTTL, drawLevel);
 	particle->smokeDrawLevel = smokeDrawLevel;
 	particle->destroyDrawLevel = destroyDrawLevel;
 	return particle;
@@ -33,69 +33,12 @@
 
 #include "particle.h"
 
-#include "map.h"
-#include "player.h"
-#include "ui.h"
-#include "video.h"
-
 GraphicAnimation::GraphicAnimation(CGraphic *g, int ticksPerFrame) :
-	g(g), ticksPerFrame(ticksPerFrame), currentFrame(0), currTicks(0)
+	g(g), ticksPerFrame(ticksPerFrame)
 {
 	Assert(g);
 }
 
-
-void GraphicAnimation::draw(int x, int y)
-{
-	if (!isFinished()) {
-		g->DrawFrameClip(currentFrame, x - g->Width / 2, y - g->Height / 2);
-	}
-}
-
-void GraphicAnimation::update(int ticks)
-{
-	currTicks += ticks;
-	while (currTicks > ticksPerFrame) {
-		currTicks -= ticksPerFrame;
-		++currentFrame;
-	}
-}
-
-bool GraphicAnimation::isFinished()
-{
-	return currentFrame >= g->NumFrames;
-}
-
-bool GraphicAnimation::isVisible(const CViewport &vp, const CPosition &pos)
-{
-	// invisible graphics always invisible
-	if (!g) {
-		return false;
-	}
-
-	PixelSize graphicSize(g->Width, g->Height);
-	PixelDiff margin(PixelTileSize.x - 1, PixelTileSize.y - 1);
-	PixelPos position(pos.x, pos.y);
-	Vec2i minPos = Map.MapPixelPosToTilePos(position);
-	Vec2i maxPos = Map.MapPixelPosToTilePos(position + graphicSize + margin);
-	Map.Clamp(minPos);
-	Map.Clamp(maxPos);
-
-	if (!vp.AnyMapAreaVisibleInViewport(minPos, maxPos)) {
-		return false;
-	}
-
-	Vec2i p;
-	for (p.x = minPos.x; p.x <= maxPos.x; ++p.x) {
-		for (p.y = minPos.y; p.y <= maxPos.y; ++p.y) {
-			if (ReplayRevealMap || Map.Field(p)->playerInfo.IsTeamVisible(*ThisPlayer)) {
-				return true;
-			}
-		}
-	}
-	return false;
-}
-
 GraphicAnimation *GraphicAnimation::clone()
 {
 	return new GraphicAnimation(g, ticksPerFrame);
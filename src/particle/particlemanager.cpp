@@ -31,17 +31,271 @@
 
 #include "stratagus.h"
 #include "particle.h"
+
+#include "map.h"
+#include "player.h"
+#include "pool.h"
 #include "ui.h"
 #include "video.h"
 
 #include <algorithm>
+#include <limits>
 
 
 CParticleManager ParticleManager;
 
+/// Memory of the particles and of their animations
+static CClassPool ParticlePool("particles", 256);
+
+
+void *CParticle::operator new(size_t size)
+{
+	return ParticlePool.Alloc(size);
+}
+
+void CParticle::operator delete(void *p, size_t size)
+{
+	ParticlePool.Free(p, size);
+}
+
+void *GraphicAnimation::operator new(size_t size)
+{
+	return ParticlePool.Alloc(size);
+}
+
+void GraphicAnimation::operator delete(void *p, size_t size)
+{
+	ParticlePool.Free(p, size);
+}
+
+
+/**
+**  Check if a particle is in the viewport and on a visible tile.
+**
+**  @param vp  viewport where to draw the particle
+**  @param g   animation sheet of the particle
+**  @param x   x map pixel position of the particle
+**  @param y   y map pixel position of the particle
+*/
+static bool IsParticleVisible(const CViewport &vp, const CGraphic &g, float x, float y)
+{
+	PixelSize graphicSize(g.Width, g.Height);
+	PixelDiff margin(PixelTileSize.x - 1, PixelTileSize.y - 1);
+	PixelPos position(x, y);
+	Vec2i minPos = Map.MapPixelPosToTilePos(position);
+	Vec2i maxPos = Map.MapPixelPosToTilePos(position + graphicSize + margin);
+	Map.Clamp(minPos);
+	Map.Clamp(maxPos);
+
+	if (!vp.AnyMapAreaVisibleInViewport(minPos, maxPos)) {
+		return false;
+	}
+
+	Vec2i p;
+	for (p.x = minPos.x; p.x <= maxPos.x; ++p.x) {
+		for (p.y = minPos.y; p.y <= maxPos.y; ++p.y) {
+			if (ReplayRevealMap || Map.IsFieldTeamVisible(*ThisPlayer, p)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/// Indexes of the particles which are kept by the compaction
+static std::vector<size_t> KeptParticles;
+
+/**
+**  Keep the elements of KeptParticles at the beginning of the array.
+*/
+template <typename T>
+static void CompactArray(std::vector<T> &array)
+{
+	const size_t count = KeptParticles.size();
+
+	for (size_t i = 0; i != count; ++i) {
+		array[i] = array[KeptParticles[i]];
+	}
+	array.resize(count);
+}
+
+/*----------------------------------------------------------------------------
+--  Animated particles
+----------------------------------------------------------------------------*/
+
+void CParticleArray::add(const CPosition &pos, const GraphicAnimation &animation,
+						 float speedx, float speedy, int drawLevel)
+{
+	CGraphic *g = animation.getGraphic();
+
+	X.push_back(pos.x);
+	Y.push_back(pos.y);
+	SpeedX.push_back(speedx);
+	SpeedY.push_back(speedy);
+	Graphic.push_back(g);
+	TicksPerFrame.push_back(std::max(1, animation.getTicksPerFrame()));
+	NumFrames.push_back(g->NumFrames);
+	Frame.push_back(0);
+	FrameTicks.push_back(0);
+	DrawLevel.push_back(drawLevel);
+}
+
+/**
+**  Advance the animations, by as many frames as the elapsed ticks cover.
+**
+**  @param ticks  the number of ticks elapsed since the last update.
+*/
+void CParticleArray::animate(int ticks)
+{
+	const size_t count = size();
+
+	for (size_t i = 0; i != count; ++i) {
+		const int currTicks = FrameTicks[i] + ticks;
+		const int frames = currTicks > TicksPerFrame[i] ? (currTicks - 1) / TicksPerFrame[i] : 0;
+
+		Frame[i] += frames;
+		FrameTicks[i] = currTicks - frames * TicksPerFrame[i];
+	}
+}
+
+/**
+**  Move the particles by their speed.
+**
+**  @param scale  factor of the speed, the elapsed seconds or 1 for a
+**                speed per update.
+*/
+void CParticleArray::move(float scale)
+{
+	const size_t count = size();
+
+	for (size_t i = 0; i != count; ++i) {
+		X[i] += scale * SpeedX[i];
+		Y[i] += scale * SpeedY[i];
+	}
+}
+
+/**
+**  Remove the particles whose animation is finished, in a single pass
+**  which keeps the order of the others.
+*/
+void CParticleArray::removeFinished()
+{
+	const size_t count = size();
+
+	KeptParticles.clear();
+	for (size_t i = 0; i != count; ++i) {
+		if (Frame[i] < NumFrames[i]) {
+			KeptParticles.push_back(i);
+		}
+	}
+	if (KeptParticles.size() == count) {
+		return;
+	}
+	CompactArray(X);
+	CompactArray(Y);
+	CompactArray(SpeedX);
+	CompactArray(SpeedY);
+	CompactArray(Graphic);
+	CompactArray(TicksPerFrame);
+	CompactArray(NumFrames);
+	CompactArray(Frame);
+	CompactArray(FrameTicks);
+	CompactArray(DrawLevel);
+}
+
+void CParticleArray::clear()
+{
+	X.clear();
+	Y.clear();
+	SpeedX.clear();
+	SpeedY.clear();
+	Graphic.clear();
+	TicksPerFrame.clear();
+	NumFrames.clear();
+	Frame.clear();
+	FrameTicks.clear();
+	DrawLevel.clear();
+}
+
+/*----------------------------------------------------------------------------
+--  Chunk particles
+----------------------------------------------------------------------------*/
+
+/**
+**  Remove the chunks which hit the ground, in a single pass which
+**  keeps the order of the others.
+*/
+void CChunkArray::removeDestroyed()
+{
+	const size_t count = size();
+
+	KeptParticles.clear();
+	for (size_t i = 0; i != count; ++i) {
+		if (Age[i] < Lifetime[i]) {
+			KeptParticles.push_back(i);
+		}
+	}
+	if (KeptParticles.size() == count) {
+		return;
+	}
+	CompactArray(X);
+	CompactArray(Y);
+	CompactArray(Height);
+	CompactArray(InitialX);
+	CompactArray(InitialY);
+	CompactArray(SpeedX);
+	CompactArray(SpeedY);
+	CompactArray(SpeedZ);
+	CompactArray(Age);
+	CompactArray(Lifetime);
+	CompactArray(NextSmokeTicks);
+	CompactArray(Graphic);
+	CompactArray(TicksPerFrame);
+	CompactArray(NumFrames);
+	CompactArray(Frame);
+	CompactArray(FrameTicks);
+	CompactArray(DrawLevel);
+	CompactArray(SmokeGraphic);
+	CompactArray(SmokeTicksPerFrame);
+	CompactArray(SmokeDrawLevel);
+	CompactArray(DestroyGraphic);
+	CompactArray(DestroyTicksPerFrame);
+	CompactArray(DestroyDrawLevel);
+}
+
+void CChunkArray::clear()
+{
+	X.clear();
+	Y.clear();
+	Height.clear();
+	InitialX.clear();
+	InitialY.clear();
+	SpeedX.clear();
+	SpeedY.clear();
+	SpeedZ.clear();
+	Age.clear();
+	Lifetime.clear();
+	NextSmokeTicks.clear();
+	Graphic.clear();
+	TicksPerFrame.clear();
+	NumFrames.clear();
+	Frame.clear();
+	FrameTicks.clear();
+	DrawLevel.clear();
+	SmokeGraphic.clear();
+	SmokeTicksPerFrame.clear();
+	SmokeDrawLevel.clear();
+	DestroyGraphic.clear();
+	DestroyTicksPerFrame.clear();
+	DestroyDrawLevel.clear();
+}
+
+/*----------------------------------------------------------------------------
+--  Particle manager
+----------------------------------------------------------------------------*/
 
 CParticleManager::CParticleManager() :
-	vp(NULL), lastTicks(0)
+	nextBucket(0), lastTicks(0), lowDetail(false)
 {
 }
 
@@ -60,75 +314,275 @@ void CParticleManager::exit()
 
 void CParticleManager::clear()
 {
-	std::vector<CParticle *>::iterator i;
-	for (i = particles.begin(); i != particles.end(); ++i) {
-		delete *i;
+	staticParticles.clear();
+	smokeParticles.clear();
+	radialParticles.clear();
+	chunkParticles.clear();
+	buckets.clear();
+	nextBucket = 0;
+}
+
+/**
+**  Add a visible particle to the bucket of its draw level, in the
+**  batch of its animation sheet.
+*/
+void CParticleManager::addToDraw(CGraphic *g, unsigned frame, int x, int y, int drawLevel)
+{
+	size_t b = 0;
+	while (b != buckets.size() && buckets[b].DrawLevel < drawLevel) {
+		++b;
+	}
+	if (b == buckets.size() || buckets[b].DrawLevel != drawLevel) {
+		DrawBucket bucket;
+		bucket.DrawLevel = drawLevel;
+		buckets.insert(buckets.begin() + b, bucket);
 	}
-	particles.clear();
+	std::vector<DrawBatch> &batches = buckets[b].Batches;
 
-	for (i = new_particles.begin(); i != new_particles.end(); ++i) {
-		delete *i;
+	size_t i = 0;
+	while (i != batches.size() && batches[i].Graphic != g) {
+		++i;
 	}
-	new_particles.clear();
+	if (i == batches.size()) {
+		batches.push_back(DrawBatch());
+		batches.back().Graphic = g;
+	}
+	batches[i].Frames.push_back(frame);
+	batches[i].Positions.push_back(PixelPos(x - g->Width / 2, y - g->Height / 2));
 }
 
-static inline bool DrawLevelCompare(const CParticle *lhs, const CParticle *rhs)
+/**
+**  Find the visible particles and put them in the buckets of their
+**  draw level, so that the viewport draws them between its units and
+**  missiles with drawUpTo.
+*/
+void CParticleManager::prepareToDraw(const CViewport &vp)
 {
-	return lhs->getDrawLevel() < rhs->getDrawLevel();
+	const CParticleArray *arrays[] = { &staticParticles, &smokeParticles, &radialParticles };
+
+	for (size_t a = 0; a != sizeof(arrays) / sizeof(*arrays); ++a) {
+		const CParticleArray &particles = *arrays[a];
+
+		for (size_t i = 0; i != particles.size(); ++i) {
+			CGraphic *g = particles.Graphic[i];
+
+			if (particles.Frame[i] < particles.NumFrames[i]
+				&& IsParticleVisible(vp, *g, particles.X[i], particles.Y[i])) {
+				const PixelPos mapPixelPos((int)particles.X[i], (int)particles.Y[i]);
+				const PixelPos screenPos = vp.MapToScreenPixelPos(mapPixelPos);
+
+				addToDraw(g, particles.Frame[i], screenPos.x, screenPos.y, particles.DrawLevel[i]);
+			}
+		}
+	}
+
+	const CChunkArray &chunks = chunkParticles;
+	for (size_t i = 0; i != chunks.size(); ++i) {
+		CGraphic *g = chunks.Graphic[i];
+
+		if (IsParticleVisible(vp, *g, chunks.X[i], chunks.Y[i])) {
+			const PixelPos mapPixelPos((int)chunks.X[i], (int)chunks.Y[i]);
+			const PixelPos screenPos = vp.MapToScreenPixelPos(mapPixelPos);
+			const int y = static_cast<int>(screenPos.y - chunks.Height[i] * 0.2f);
+
+			addToDraw(g, chunks.Frame[i], screenPos.x, y, chunks.DrawLevel[i]);
+		}
+	}
+	nextBucket = 0;
 }
 
-void CParticleManager::prepareToDraw(const CViewport &vp, std::vector<CParticle *> &table)
+/**
+**  Draw the particles whose draw level is lower or equal to drawLevel,
+**  one call for each animation sheet of a draw level.
+**
+**  @param drawLevel  draw level of the next unit or missile.
+*/
+void CParticleManager::drawUpTo(int drawLevel)
 {
-	this->vp = &vp;
+	for (; nextBucket != buckets.size() && buckets[nextBucket].DrawLevel <= drawLevel; ++nextBucket) {
+		std::vector<DrawBatch> &batches = buckets[nextBucket].Batches;
 
-	for (std::vector<CParticle *>::iterator it = particles.begin(); it != particles.end(); ++it) {
-		CParticle &particle = **it;
-		if (particle.isVisible(vp)) {
-			table.push_back(&particle);
+		for (size_t i = 0; i != batches.size(); ++i) {
+			if (!batches[i].Frames.empty()) {
+				batches[i].Graphic->DrawFramesClip(&batches[i].Frames[0],
+												   &batches[i].Positions[0],
+												   batches[i].Frames.size());
+			}
 		}
 	}
-
-	std::sort(table.begin(), table.end(), DrawLevelCompare);
 }
 
+/**
+**  Draw the particles above all the units and missiles, and empty the
+**  buckets. The buckets and batches which were used are kept with
+**  their memory for the next frame.
+*/
 void CParticleManager::endDraw()
 {
-	this->vp = NULL;
+	drawUpTo(std::numeric_limits<int>::max());
+
+	size_t alive = 0;
+	for (size_t b = 0; b != buckets.size(); ++b) {
+		std::vector<DrawBatch> &batches = buckets[b].Batches;
+		size_t used = 0;
+
+		for (size_t i = 0; i != batches.size(); ++i) {
+			if (!batches[i].Frames.empty()) {
+				batches[i].Frames.clear();
+				batches[i].Positions.clear();
+				std::swap(batches[used++], batches[i]);
+			}
+		}
+		batches.resize(used);
+		if (used != 0) {
+			std::swap(buckets[alive++], buckets[b]);
+		}
+	}
+	buckets.resize(alive);
+	nextBucket = 0;
 }
 
-void CParticleManager::update()
+/**
+**  Update the chunks: spawn their smoke and their destroy animation,
+**  animate the debris and follow the trajectories.
+**
+**  @param ticks  the number of ticks elapsed since the last update.
+*/
+void CParticleManager::updateChunks(int ticks)
 {
-	unsigned long ticks = GameCycle - lastTicks;
-	std::vector<CParticle *>::iterator i;
-
-	particles.insert(particles.end(), new_particles.begin(), new_particles.end());
-	new_particles.clear();
-
-	i = particles.begin();
-	while (i != particles.end()) {
-		(*i)->update(1000.0f / CYCLES_PER_SECOND * ticks);
-		if ((*i)->isDestroyed()) {
-			delete *i;
-			i = particles.erase(i);
-		} else {
-			++i;
+	const int minSmokeTicks = 150;
+	const int randSmokeTicks = 50;
+	CChunkArray &chunks = chunkParticles;
+	const size_t count = chunks.size();
+
+	for (size_t i = 0; i != count; ++i) {
+		chunks.Age[i] += ticks;
+
+		const CPosition p(chunks.X[i], chunks.Y[i] - chunks.Height[i] * 0.2f);
+		if (chunks.Age[i] >= chunks.Lifetime[i]) {
+			const GraphicAnimation destroy(chunks.DestroyGraphic[i], chunks.DestroyTicksPerFrame[i]);
+			addStatic(p, destroy, chunks.DestroyDrawLevel[i]);
+		} else if (chunks.Age[i] > chunks.NextSmokeTicks[i]) {
+			const GraphicAnimation smoke(chunks.SmokeGraphic[i], chunks.SmokeTicksPerFrame[i]);
+			addSmoke(p, smoke, 0, -22.0f, chunks.SmokeDrawLevel[i]);
+
+			chunks.NextSmokeTicks[i] += MyRand() % randSmokeTicks + minSmokeTicks;
 		}
 	}
 
+	// the debris animation restarts when it is finished
+	for (size_t i = 0; i != count; ++i) {
+		const int currTicks = chunks.FrameTicks[i] + ticks;
+		const int frames = currTicks > chunks.TicksPerFrame[i] ? (currTicks - 1) / chunks.TicksPerFrame[i] : 0;
+		const bool finished = chunks.Frame[i] + frames >= chunks.NumFrames[i];
+
+		chunks.Frame[i] = finished ? 0 : chunks.Frame[i] + frames;
+		chunks.FrameTicks[i] = finished ? 0 : currTicks - frames * chunks.TicksPerFrame[i];
+	}
+
+	for (size_t i = 0; i != count; ++i) {
+		const float time = chunks.Age[i] / 1000.f;
+
+		chunks.X[i] = chunks.InitialX[i] + chunks.SpeedX[i] * time;
+		chunks.Y[i] = chunks.InitialY[i] + chunks.SpeedY[i] * time;
+		chunks.Height[i] = chunks.SpeedZ[i] * time - (ChunkGravity / 2.0f) * (time * time);
+	}
+	chunks.removeDestroyed();
+}
+
+/**
+**  Update the particles of each kind, and remove the finished ones.
+*/
+void CParticleManager::update()
+{
+	unsigned long ticks = GameCycle - lastTicks;
+	const int t = 1000.0f / CYCLES_PER_SECOND * ticks;
+
+	staticParticles.animate(t);
+	staticParticles.removeFinished();
+
+	// smoke rises
+	smokeParticles.animate(t);
+	smokeParticles.removeFinished();
+	smokeParticles.move(t / 1000.f);
+
+	radialParticles.move(1.0f);
+	radialParticles.animate(t);
+	radialParticles.removeFinished();
+
+	// the new smoke and destroy particles are updated from the next cycle
+	updateChunks(t);
+
 	lastTicks += ticks;
 }
 
+/**
+**  Add a particle. Its state is copied in the arrays of its kind, and
+**  the particle is deleted.
+*/
 void CParticleManager::add(CParticle *particle)
 {
-	new_particles.push_back(particle);
+	particle->addTo(*this);
+	delete particle; // back to the particle pool
+}
+
+void CParticleManager::addStatic(const CPosition &pos, const GraphicAnimation &animation, int drawLevel)
+{
+	staticParticles.add(pos, animation, 0, 0, drawLevel);
 }
 
-CPosition CParticleManager::getScreenPos(const CPosition &pos) const
+void CParticleManager::addSmoke(const CPosition &pos, const GraphicAnimation &animation,
+								float speedx, float speedy, int drawLevel)
 {
-	const PixelPos mapPixelPos((int)pos.x, (int)pos.y);
-	const PixelPos screenPixelPos = vp->MapToScreenPixelPos(mapPixelPos);
+	smokeParticles.add(pos, animation, speedx, speedy, drawLevel);
+}
 
-	return CPosition(screenPixelPos.x, screenPixelPos.y);
+void CParticleManager::addRadial(const CPosition &pos, const GraphicAnimation &animation,
+								 float speedx, float speedy, int drawLevel)
+{
+	radialParticles.add(pos, animation, speedx, speedy, drawLevel);
+}
+
+void CParticleManager::addChunk(const CPosition &pos, const GraphicAnimation &debris,
+								const GraphicAnimation &smoke, const GraphicAnimation &destroy,
+								float speedx, float speedy, float speedz, int lifetime,
+								int drawLevel, int smokeDrawLevel, int destroyDrawLevel)
+{
+	CChunkArray &chunks = chunkParticles;
+	CGraphic *g = debris.getGraphic();
+
+	chunks.X.push_back(pos.x);
+	chunks.Y.push_back(pos.y);
+	chunks.Height.push_back(0.f);
+	chunks.InitialX.push_back(pos.x);
+	chunks.InitialY.push_back(pos.y);
+	chunks.SpeedX.push_back(speedx);
+	chunks.SpeedY.push_back(speedy);
+	chunks.SpeedZ.push_back(speedz);
+	chunks.Age.push_back(0);
+	chunks.Lifetime.push_back(lifetime);
+	chunks.NextSmokeTicks.push_back(0);
+	chunks.Graphic.push_back(g);
+	chunks.TicksPerFrame.push_back(std::max(1, debris.getTicksPerFrame()));
+	chunks.NumFrames.push_back(g->NumFrames);
+	chunks.Frame.push_back(0);
+	chunks.FrameTicks.push_back(0);
+	chunks.DrawLevel.push_back(drawLevel);
+	chunks.SmokeGraphic.push_back(smoke.getGraphic());
+	chunks.SmokeTicksPerFrame.push_back(smoke.getTicksPerFrame());
+	chunks.SmokeDrawLevel.push_back(smokeDrawLevel);
+	chunks.DestroyGraphic.push_back(destroy.getGraphic());
+	chunks.DestroyTicksPerFrame.push_back(destroy.getTicksPerFrame());
+	chunks.DestroyDrawLevel.push_back(destroyDrawLevel);
+}
+
+/**
+**  Number of particles of all kinds.
+*/
+size_t CParticleManager::getCount() const
+{
+	return staticParticles.size() + smokeParticles.size()
+		   + radialParticles.size() + chunkParticles.size();
 }
 
-//@}
\ No newline at end of file
+//@}
@@ -35,11 +35,8 @@
 #include "particle.h"
 
 CRadialParticle::CRadialParticle(CPosition position, GraphicAnimation *animation, int maxSpeed, int drawlevel) :
-	CParticle(position, drawlevel)
+	CParticle(position, drawlevel), animation(*animation)
 {
-	Assert(animation);
-	this->animation = animation->clone();
-
 	const int speedReduction = 10;
 
 	this->direction = (float)(MyRand() % 360);
@@ -47,36 +44,15 @@ CRadialParticle::CRadialParticle(CPosition position, GraphicAnimation *animation
 	this->maxSpeed = maxSpeed;
 }
 
-CRadialParticle::~CRadialParticle()
-{
-	delete animation;
-}
-
-bool CRadialParticle::isVisible(const CViewport &vp) const
+void CRadialParticle::addTo(CParticleManager &manager) const
 {
-	return animation && animation->isVisible(vp, pos);
-}
-
-void CRadialParticle::draw()
-{
-	CPosition screenPos = ParticleManager.getScreenPos(pos);
-	animation->draw(static_cast<int>(screenPos.x), static_cast<int>(screenPos.y));
-}
-
-void CRadialParticle::update(int ticks)
-{
-	this->pos.x += this->speed * sin(this->direction);
-	this->pos.y += this->speed * cos(this->direction);
-
-	animation->update(ticks);
-	if (animation->isFinished()) {
-		destroy();
-	}
+	// the particle moves by the same distance at each update
+	manager.addRadial(pos, animation, speed * sin(direction), speed * cos(direction), drawLevel);
 }
 
 CParticle *CRadialParticle::clone()
 {
-	CParticle *p = new CRadialParticle(pos, animation, maxSpeed, drawLevel);
+	CParticle *p = new CRadialParticle(pos, &animation, maxSpeed, drawLevel);
 	return p;
 }
 
@@ -37,47 +37,20 @@
 
 CSmokeParticle::CSmokeParticle(CPosition position, GraphicAnimation *smoke,
 							   float speedx, float speedy, int drawlevel) :
-	CParticle(position, drawlevel)
+	CParticle(position, drawlevel), puff(*smoke)
 {
-	Assert(smoke);
-	this->puff = smoke->clone();
-
 	speedVector.x = speedx;
 	speedVector.y = speedy;
 }
 
-CSmokeParticle::~CSmokeParticle()
-{
-	delete puff;
-}
-
-bool CSmokeParticle::isVisible(const CViewport &vp) const
+void CSmokeParticle::addTo(CParticleManager &manager) const
 {
-	return puff && puff->isVisible(vp, pos);
-}
-
-void CSmokeParticle::draw()
-{
-	CPosition screenPos = ParticleManager.getScreenPos(pos);
-	puff->draw(static_cast<int>(screenPos.x), static_cast<int>(screenPos.y));
-}
-
-void CSmokeParticle::update(int ticks)
-{
-	puff->update(ticks);
-	if (puff->isFinished()) {
-		destroy();
-		return;
-	}
-
-	// smoke rises
-	pos.x += ticks / 1000.f * speedVector.x;
-	pos.y += ticks / 1000.f * speedVector.y;
+	manager.addSmoke(pos, puff, speedVector.x, speedVector.y, drawLevel);
 }
 
 CParticle *CSmokeParticle::clone()
 {
-	return new CSmokeParticle(pos, puff, speedVector.x, speedVector.y, drawLevel);
+	return new CSmokeParticle(pos, &puff, speedVector.x, speedVector.y, drawLevel);
 }
 
 //@}
@@ -34,39 +34,18 @@
 
 
 StaticParticle::StaticParticle(CPosition position, GraphicAnimation *animation, int drawlevel) :
-	CParticle(position, drawlevel)
+	CParticle(position, drawlevel), animation(*animation)
 {
-	Assert(animation);
-	this->animation = animation->clone();
 }
 
-StaticParticle::~StaticParticle()
+void StaticParticle::addTo(CParticleManager &manager) const
 {
-	delete animation;
-}
-
-bool StaticParticle::isVisible(const CViewport &vp) const
-{
-	return animation && animation->isVisible(vp, pos);
-}
-
-void StaticParticle::draw()
-{
-	CPosition screenPos = ParticleManager.getScreenPos(pos);
-	animation->draw(static_cast<int>(screenPos.x), static_cast<int>(screenPos.y));
-}
-
-void StaticParticle::update(int ticks)
-{
-	animation->update(ticks);
-	if (animation->isFinished()) {
-		destroy();
-	}
+	manager.addStatic(pos, animation, drawLevel);
 }
 
 CParticle *StaticParticle::clone()
 {
-	CParticle *p = new StaticParticle(pos, animation, drawLevel);
+	CParticle *p = new StaticParticle(pos, &animation, drawLevel);
 	return p;
 }
 
@@ -37,6 +37,7 @@
 #include "stratagus.h"
 
 #include "map.h"
+#include "profiler.h"
 #include "settings.h"
 #include "tileset.h"
 #include "unit.h"
@@ -50,18 +51,8 @@
 --  Declarations
 ----------------------------------------------------------------------------*/
 
-struct Node {
-	int CostFromStart;  /// Real costs to reach this point
-	short int CostToGoal;     /// Estimated cost to goal
-	char InGoal;        /// is this point in the goal
-	char Direction;     /// Direction for trace back
-};
-
-struct Open {
-	Vec2i pos;
-	short int Costs; /// complete costs to goal
-	unsigned short int O;     /// Offset into matrix
-};
+typedef PathSearchContext::Node Node;
+typedef PathSearchContext::Open Open;
 
 //for 32 bit signed int
 inline int32_t MyAbs(int32_t x) { return (x ^ (x >> 31)) - (x >> 31); }
@@ -81,18 +72,8 @@ static inline int AStarCosts(const Vec2i &pos, const Vec2i &goalPos)
 //                      //  N NE  E SE  S SW  W NW
 const int Heading2X[9] = {  0, +1, +1, +1, 0, -1, -1, -1, 0 };
 const int Heading2Y[9] = { -1, -1, 0, +1, +1, +1, 0, -1, 0 };
-int Heading2O[9];//heading to offset
 const int XY2Heading[3][3] = { {7, 6, 5}, {0, 0, 4}, {1, 2, 3}};
 
-/// cost matrix
-static Node *AStarMatrix;
-
-/// a list of close nodes, helps to speed up the matrix cleaning
-static int *CloseSet;
-static int CloseSetSize;
-static int Threshold;
-static int OpenSetMaxSize;
-static int AStarMatrixSize;
 #define MAX_CLOSE_SET_RATIO 4
 #define MAX_OPEN_SET_RATIO 8 // 10,16 to small
 
@@ -102,25 +83,11 @@ int AStarMovingUnitCrossingCost = 5;
 bool AStarKnowUnseenTerrain = false;
 int AStarUnknownTerrainCost = 2;
 
-static int AStarMapWidth;
-static int AStarMapHeight;
-
-static int AStarGoalX;
-static int AStarGoalY;
-
-/**
-**  The Open set is handled by a stored array
-**  the end of the array holds the item with the smallest cost.
-*/
-
-/// The set of Open nodes
-static Open *OpenSet;
-/// The size of the open node set
-static int OpenSetSize;
-
-static int *CostMoveToCache;
 static const int CacheNotSet = -5;
 
+/// Context used by the game thread
+static PathSearchContext *MainContext;
+
 /*----------------------------------------------------------------------------
 --  Profile
 ----------------------------------------------------------------------------*/
@@ -248,29 +215,43 @@ inline void ProfilePrint()
 /**
 **  Init A* data structures
 */
-void InitAStar(int mapWidth, int mapHeight)
+PathSearchContext::PathSearchContext(int mapWidth, int mapHeight) :
+	mapWidth(mapWidth), mapHeight(mapHeight), closeSetSize(0),
+	openSet(mapWidth * mapHeight, mapWidth * mapHeight / MAX_OPEN_SET_RATIO), cache(NULL)
 {
-	// Should only be called once
-	Assert(!AStarMatrix);
+	matrixSize = sizeof(Node) * mapWidth * mapHeight;
+	matrix = new Node[mapWidth * mapHeight];
+	memset(matrix, 0, matrixSize);
 
-	AStarMapWidth = mapWidth;
-	AStarMapHeight = mapHeight;
+	threshold = mapWidth * mapHeight / MAX_CLOSE_SET_RATIO;
+	closeSet = new int[threshold];
 
-	AStarMatrixSize = sizeof(Node) * AStarMapWidth * AStarMapHeight;
-	AStarMatrix = new Node[AStarMapWidth * AStarMapHeight];
-	memset(AStarMatrix, 0, AStarMatrixSize);
+	costMoveToCache = new int[mapWidth * mapHeight];
 
-	Threshold = AStarMapWidth * AStarMapHeight / MAX_CLOSE_SET_RATIO;
-	CloseSet = new int[Threshold];
+	for (int i = 0; i < 9; ++i) {
+		heading2O[i] = Heading2Y[i] * mapWidth;
+	}
+}
 
-	OpenSetMaxSize = AStarMapWidth * AStarMapHeight / MAX_OPEN_SET_RATIO;
-	OpenSet = new Open[OpenSetMaxSize];
+/**
+**  Free A* data structure
+*/
+PathSearchContext::~PathSearchContext()
+{
+	delete[] matrix;
+	delete[] closeSet;
+	delete[] costMoveToCache;
+}
 
-	CostMoveToCache = new int[AStarMapWidth * AStarMapHeight];
+/**
+**  Init A* data structures
+*/
+void InitAStar(int mapWidth, int mapHeight)
+{
+	// Should only be called once
+	Assert(!MainContext);
 
-	for (int i = 0; i < 9; ++i) {
-		Heading2O[i] = Heading2Y[i] * AStarMapWidth;
-	}
+	MainContext = new PathSearchContext(mapWidth, mapHeight);
 
 	ProfileInit();
 }
@@ -280,16 +261,8 @@ void InitAStar(int mapWidth, int mapHeight)
 */
 void FreeAStar()
 {
-	delete[] AStarMatrix;
-	AStarMatrix = NULL;
-	delete[] CloseSet;
-	CloseSet = NULL;
-	CloseSetSize = 0;
-	delete[] OpenSet;
-	OpenSet = NULL;
-	OpenSetSize = 0;
-	delete[] CostMoveToCache;
-	CostMoveToCache = NULL;
+	delete MainContext;
+	MainContext = NULL;
 
 	ProfilePrint();
 }
@@ -297,35 +270,35 @@ void FreeAStar()
 /**
 **  Prepare pathfinder.
 */
-static void AStarPrepare()
+void PathSearchContext::Prepare()
 {
-	memset(AStarMatrix, 0, AStarMatrixSize);
+	memset(matrix, 0, matrixSize);
 }
 
 /**
 **  Clean up A*
 */
-static void AStarCleanUp()
+void PathSearchContext::CleanUp()
 {
 	ProfileBegin("AStarCleanUp");
 
-	if (CloseSetSize >= Threshold) {
-		AStarPrepare();
+	if (closeSetSize >= threshold) {
+		Prepare();
 	} else {
-		for (int i = 0; i < CloseSetSize; ++i) {
-			AStarMatrix[CloseSet[i]].CostFromStart = 0;
-			AStarMatrix[CloseSet[i]].InGoal = 0;
+		for (int i = 0; i < closeSetSize; ++i) {
+			matrix[closeSet[i]].CostFromStart = 0;
+			matrix[closeSet[i]].InGoal = 0;
 		}
 	}
 	ProfileEnd("AStarCleanUp");
 }
 
-static void CostMoveToCacheCleanUp()
+void PathSearchContext::CostMoveToCacheCleanUp()
 {
 	ProfileBegin("CostMoveToCacheCleanUp");
-	int AStarMapMax =  AStarMapWidth * AStarMapHeight;
+	int AStarMapMax =  mapWidth * mapHeight;
 #if 1
-	int *ptr = CostMoveToCache;
+	int *ptr = costMoveToCache;
 #ifdef __x86_64__
 	union {
 		intptr_t d;
@@ -358,91 +331,40 @@ static void CostMoveToCacheCleanUp()
 	}
 #else
 	for (int i = 0; i < AStarMapMax; ++i) {
-		CostMoveToCache[i] = CacheNotSet;
+		costMoveToCache[i] = CacheNotSet;
 	}
 #endif
 	ProfileEnd("CostMoveToCacheCleanUp");
 }
 
 /**
-**  Find the best node in the current open node set
-**  Returns the position of this node in the open node set
-*/
-#define AStarFindMinimum() (OpenSetSize - 1)
-
-
-/**
-**  Remove the minimum from the open node set
-*/
-static void AStarRemoveMinimum(int pos)
-{
-	Assert(pos == OpenSetSize - 1);
-
-	OpenSetSize--;
-}
-
-/**
-**  Add a new node to the open set (and update the heap structure)
+**  Add a new node to the open set
 **
 **  @return  0 or PF_FAILED
 */
-static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
+inline int PathSearchContext::AddNode(const Vec2i &pos, int o, int costs)
 {
 	ProfileBegin("AStarAddNode");
 
-	int bigi = 0, smalli = OpenSetSize;
-	int midcost;
-	int midi;
-	int midCostToGoal;
-	int midDist;
-	const Open *open;
-
-	if (OpenSetSize + 1 >= OpenSetMaxSize) {
+	if (openSet.Size() + 1 >= openSet.MaxSize()) {
 		fprintf(stderr, "A* internal error: raise Open Set Max Size "
-				"(current value %d)\n", OpenSetMaxSize);
+				"(current value %d)\n", openSet.MaxSize());
 		ProfileEnd("AStarAddNode");
 		return PF_FAILED;
 	}
-
-	const int costToGoal = AStarMatrix[o].CostToGoal;
-	const int dist = MyAbs(pos.x - AStarGoalX) + MyAbs(pos.y - AStarGoalY);
-
-	// find where we should insert this node.
-	// binary search where to insert the new node
-	while (bigi < smalli) {
-		midi = (smalli + bigi) >> 1;
-		open = &OpenSet[midi];
-		midcost = open->Costs;
-		midCostToGoal = AStarMatrix[open->O].CostToGoal;
-		midDist = MyAbs(open->pos.x - AStarGoalX) + MyAbs(open->pos.y - AStarGoalY);
-		if (costs > midcost || (costs == midcost
-								&& (costToGoal > midCostToGoal || (costToGoal == midCostToGoal
-																   && dist > midDist)))) {
-			smalli = midi;
-		} else if (costs < midcost || (costs == midcost
-									   && (costToGoal < midCostToGoal || (costToGoal == midCostToGoal
-											   && dist < midDist)))) {
-			if (bigi == midi) {
-				bigi++;
-			} else {
-				bigi = midi;
-			}
-		} else {
-			bigi = midi;
-			smalli = midi;
-		}
-	}
-
-	if (OpenSetSize > bigi) {
-		// free a the slot for our node
-		memmove(&OpenSet[bigi + 1], &OpenSet[bigi], (OpenSetSize - bigi) * sizeof(Open));
+	if (costs >= AStarOpenSet::MaxCosts) {
+		fprintf(stderr, "A* internal error: costs too high (%d)\n", costs);
+		ProfileEnd("AStarAddNode");
+		return PF_FAILED;
 	}
 
-	// fill our new node
-	OpenSet[bigi].pos = pos;
-	OpenSet[bigi].O = o;
-	OpenSet[bigi].Costs = costs;
-	++OpenSetSize;
+	AStarOpenNode node;
+	node.pos = pos;
+	node.O = o;
+	node.Costs = costs;
+	node.CostToGoal = matrix[o].CostToGoal;
+	node.Dist = MyAbs(pos.x - goal.x) + MyAbs(pos.y - goal.y);
+	openSet.Push(node);
 
 	ProfileEnd("AStarAddNode");
 
@@ -450,57 +372,40 @@ static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
 }
 
 /**
-**  Change the cost associated to an open node.
-**  Can be further optimised knowing that the new cost MUST BE LOWER
-**  than the old one.
+**  Requeue an open node after a better path to it has been found.
+**
+**  The node keeps its costs, it is only placed again between the nodes
+**  of the same costs, like the path finder has always done.
 */
-static void AStarReplaceNode(int pos)
+void PathSearchContext::ReplaceNode(int eo)
 {
 	ProfileBegin("AStarReplaceNode");
 
-	Open node;
-
-	// Remove the outdated node
-	node = OpenSet[pos];
-	OpenSetSize--;
-	memmove(&OpenSet[pos], &OpenSet[pos+1], sizeof(Open) * (OpenSetSize-pos));
+	openSet.Requeue(eo);
 
-	// Re-add the node with the new cost
-	AStarAddNode(node.pos, node.O, node.Costs);
 	ProfileEnd("AStarReplaceNode");
 }
 
 
 /**
 **  Check if a node is already in the open set.
-**
-**  @return  -1 if not found and the position of the node in the table if found.
 */
-static int AStarFindNode(int eo)
+bool PathSearchContext::FindNode(int eo) const
 {
-	ProfileBegin("AStarFindNode");
-
-	for (int i = 0; i < OpenSetSize; ++i) {
-		if (OpenSet[i].O == eo) {
-			ProfileEnd("AStarFindNode");
-			return i;
-		}
-	}
-	ProfileEnd("AStarFindNode");
-	return -1;
+	return openSet.Contains(eo);
 }
 
 /**
 **  Add a node to the closed set
 */
-static void AStarAddToClose(int node)
+void PathSearchContext::AddToClose(int node)
 {
-	if (CloseSetSize < Threshold) {
-		CloseSet[CloseSetSize++] = node;
+	if (closeSetSize < threshold) {
+		closeSet[closeSetSize++] = node;
 	}
 }
 
-#define GetIndex(x, y) (x) + (y) * AStarMapWidth
+#define GetIndex(x, y) (x) + (y) * mapWidth
 
 /* build-in costmoveto code */
 static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
@@ -525,7 +430,8 @@ static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
 		int i = w;
 		do {
 			const int flag = mf->Flags & mask;
-			if (flag && (AStarKnowUnseenTerrain || mf->playerInfo.IsExplored(*unit.Player))) {
+			const bool known = AStarKnowUnseenTerrain || Map.IsFieldExplored(*unit.Player, index + w - i);
+			if (flag && known) {
 				if (flag & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)) {
 					// we can't cross fixed units and other unpassable things
 					return -1;
@@ -554,7 +460,7 @@ static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
 				}
 			}
 			// Add cost of crossing unknown tiles if required
-			if (!AStarKnowUnseenTerrain && !mf->playerInfo.IsExplored(*unit.Player)) {
+			if (!known) {
 				// Tend against unknown tiles.
 				cost += AStarUnknownTerrainCost;
 			}
@@ -562,7 +468,7 @@ static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
 			cost += mf->getCost();
 			++mf;
 		} while (--i);
-		index += AStarMapWidth;
+		index += Map.Info.MapWidth;
 	} while (--h);
 	return cost;
 }
@@ -579,9 +485,9 @@ static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
 **                0 -> no induced cost, except move
 **               >0 -> costly tile
 */
-static inline int CostMoveTo(unsigned int index, const CUnit &unit)
+inline int PathSearchContext::CostMoveTo(unsigned int index, const CUnit &unit)
 {
-	int *c = &CostMoveToCache[index];
+	int *c = &costMoveToCache[index];
 	if (*c != CacheNotSet) {
 		return *c;
 	}
@@ -589,22 +495,28 @@ static inline int CostMoveTo(unsigned int index, const CUnit &unit)
 	return *c;
 }
 
+void PathSearchContext::MarkGoalTile(int offset, const CUnit &unit, bool *goal_reachable)
+{
+	if (CostMoveTo(offset, unit) >= 0) {
+		matrix[offset].InGoal = 1;
+		*goal_reachable = true;
+	}
+	AddToClose(offset);
+}
+
 class AStarGoalMarker
 {
 public:
-	AStarGoalMarker(const CUnit &unit, bool *goal_reachable) :
-		unit(unit), goal_reachable(goal_reachable)
+	AStarGoalMarker(PathSearchContext &context, const CUnit &unit, bool *goal_reachable) :
+		context(context), unit(unit), goal_reachable(goal_reachable)
 	{}
 
 	void operator()(int offset) const
 	{
-		if (CostMoveTo(offset, unit) >= 0) {
-			AStarMatrix[offset].InGoal = 1;
-			*goal_reachable = true;
-		}
-		AStarAddToClose(offset);
+		context.MarkGoalTile(offset, unit, goal_reachable);
 	}
 private:
+	PathSearchContext &context;
 	const CUnit &unit;
 	bool *goal_reachable;
 };
@@ -769,19 +681,19 @@ private:
 /**
 **  MarkAStarGoal
 */
-static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
-						 int tilesizex, int tilesizey, int minrange, int maxrange, const CUnit &unit)
+int PathSearchContext::MarkGoal(const Vec2i &goal, int gw, int gh,
+								int tilesizex, int tilesizey, int minrange, int maxrange, const CUnit &unit)
 {
 	ProfileBegin("AStarMarkGoal");
 
 	if (minrange == 0 && maxrange == 0 && gw == 0 && gh == 0) {
-		if (goal.x + tilesizex > AStarMapWidth || goal.y + tilesizey > AStarMapHeight) {
+		if (goal.x + tilesizex > mapWidth || goal.y + tilesizey > mapHeight) {
 			ProfileEnd("AStarMarkGoal");
 			return 0;
 		}
 		unsigned int offset = GetIndex(goal.x, goal.y);
 		if (CostMoveTo(offset, unit) >= 0) {
-			AStarMatrix[offset].InGoal = 1;
+			matrix[offset].InGoal = 1;
 			ProfileEnd("AStarMarkGoal");
 			return 1;
 		} else {
@@ -795,7 +707,7 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 	gw = std::max(gw, 1);
 	gh = std::max(gh, 1);
 
-	AStarGoalMarker aStarGoalMarker(unit, &goal_reachable);
+	AStarGoalMarker aStarGoalMarker(*this, unit, &goal_reachable);
 	MinMaxRangeVisitor<AStarGoalMarker> visitor(aStarGoalMarker);
 
 	const Vec2i goalBottomRigth(goal.x + gw - 1, goal.y + gh - 1);
@@ -817,7 +729,7 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 **
 **  @return  The length of the path
 */
-static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen)
+int PathSearchContext::SavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen) const
 {
 	ProfileBegin("AStarSavePath");
 
@@ -828,12 +740,12 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 	// Figure out the full path length
 	fullPathLength = 0;
 	Vec2i curr = endPos;
-	int currO = curr.y * AStarMapWidth;
+	int currO = curr.y * mapWidth;
 	while (curr != startPos) {
-		direction = AStarMatrix[currO + curr.x].Direction;
+		direction = matrix[currO + curr.x].Direction;
 		curr.x -= Heading2X[direction];
 		curr.y -= Heading2Y[direction];
-		currO -= Heading2O[direction];
+		currO -= heading2O[direction];
 		fullPathLength++;
 	}
 
@@ -842,12 +754,12 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 		pathLen = std::min<int>(fullPathLength, pathLen);
 		pathPos = fullPathLength;
 		curr = endPos;
-		currO = curr.y * AStarMapWidth;
+		currO = curr.y * mapWidth;
 		while (curr != startPos) {
-			direction = AStarMatrix[currO + curr.x].Direction;
+			direction = matrix[currO + curr.x].Direction;
 			curr.x -= Heading2X[direction];
 			curr.y -= Heading2Y[direction];
-			currO -= Heading2O[direction];
+			currO -= heading2O[direction];
 			--pathPos;
 			if (pathPos < pathLen) {
 				path[pathLen - pathPos - 1] = direction;
@@ -863,9 +775,9 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 **  Optimization to find a simple path
 **  Check if we're at the goal or if it's 1 tile away
 */
-static int AStarFindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw, int gh,
-							   int, int, int minrange, int maxrange,
-							   char *path, const CUnit &unit)
+int PathSearchContext::FindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw, int gh,
+									  int minrange, int maxrange,
+									  char *path, const CUnit &unit)
 {
 	ProfileBegin("AStarFindSimplePath");
 	// At exact destination point already
@@ -907,59 +819,225 @@ static int AStarFindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw,
 	return PF_FAILED;
 }
 
+/*----------------------------------------------------------------------------
+--  Path cache
+----------------------------------------------------------------------------*/
+
+/**
+**  Paths found in the current cycle.
+**
+**  A unit going to the same goal as a previous unit of the same type and
+**  player reuses its path when it stands on it or next to it, instead of
+**  doing a new search. The cache is cleared at each cycle and when the
+**  passability of the tiles changes.
+*/
+class PathCache
+{
+public:
+	PathCache() : Hits(0), Misses(0), cycle(0) {}
+
+	int Find(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+			 int minrange, int maxrange, char *path, int pathlen, const CUnit &unit);
+	void Add(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+			 int minrange, int maxrange, const char *steps, int length, const CUnit &unit);
+	void Clear() { entries.clear(); }
+
+public:
+	unsigned long Hits;    /// Paths found in the cache
+	unsigned long Misses;  /// Paths not found in the cache
+
+private:
+	struct Entry {
+		Vec2i goalPos;
+		int gw;
+		int gh;
+		int minrange;
+		int maxrange;
+		const CUnitType *type;    /// movement mask and size of the unit
+		const CPlayer *player;    /// explored tiles and enemies
+		bool agressive;           /// can cross the tiles of the enemies
+		Vec2i startPos;
+		std::vector<char> steps;  /// directions from startPos
+	};
+
+	bool Match(const Entry &entry, const Vec2i &goalPos, int gw, int gh,
+			   int minrange, int maxrange, const CUnit &unit) const;
+
+private:
+	enum {MaxEntries = 64};   /// Max paths kept in a cycle
+	std::vector<Entry> entries;
+	unsigned long cycle;      /// GameCycle of the entries
+};
+
+/// Cache of the context used by the game thread
+static PathCache MainPathCache;
+
+bool PathCache::Match(const Entry &entry, const Vec2i &goalPos, int gw, int gh,
+					  int minrange, int maxrange, const CUnit &unit) const
+{
+	return entry.goalPos == goalPos && entry.gw == gw && entry.gh == gh
+		   && entry.minrange == minrange && entry.maxrange == maxrange
+		   && entry.type == unit.Type && entry.player == unit.Player
+		   && entry.agressive == unit.IsAgressive();
+}
+
+/**
+**  Find a cached path from startPos.
+**
+**  @return  length of the path, or PF_FAILED if no path is cached.
+*/
+int PathCache::Find(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					int minrange, int maxrange, char *path, int pathlen, const CUnit &unit)
+{
+	if (cycle != GameCycle) {
+		entries.clear();
+		cycle = GameCycle;
+	}
+	const Entry *best = NULL;
+	int bestIndex = 0;
+	int bestLength = 0;
+	int bestFirstStep = -1;
+
+	for (size_t i = 0; i != entries.size(); ++i) {
+		const Entry &entry = entries[i];
+
+		if (!Match(entry, goalPos, gw, gh, minrange, maxrange, unit)) {
+			continue;
+		}
+		const int length = entry.steps.size();
+		Vec2i pos = entry.startPos;
+		for (int j = 0; j < length; ++j) {
+			const Vec2i diff = pos - startPos;
+			if (MyAbs(diff.x) <= 1 && MyAbs(diff.y) <= 1) {
+				const bool onPath = diff.x == 0 && diff.y == 0;
+				const int newLength = length - j + (onPath ? 0 : 1);
+
+				if (best == NULL || newLength < bestLength) {
+					// Check the step to join the path
+					const int firstStep = onPath ? -1 : XY2Heading[diff.x + 1][diff.y + 1];
+					if (onPath || CostMoveToCallBack_Default(pos.x + pos.y * Map.Info.MapWidth, unit) != -1) {
+						best = &entry;
+						bestIndex = j;
+						bestLength = newLength;
+						bestFirstStep = firstStep;
+					}
+				}
+			}
+			pos.x += Heading2X[(int)entry.steps[j]];
+			pos.y += Heading2Y[(int)entry.steps[j]];
+		}
+	}
+	if (best == NULL) {
+		++Misses;
+		return PF_FAILED;
+	}
+	++Hits;
+	if (path && pathlen > 0) {
+		// path[pathlen - 1] is the first step
+		const int saved = std::min(bestLength, pathlen);
+		int k = 0;
+		if (bestFirstStep != -1) {
+			path[saved - 1] = bestFirstStep;
+			++k;
+		}
+		for (int j = bestIndex; k < saved; ++j, ++k) {
+			path[saved - 1 - k] = best->steps[j];
+		}
+	}
+	return bestLength;
+}
+
+/**
+**  Add a path found by the search.
+**
+**  @param steps   Directions of the path, the first step is the last one.
+**  @param length  Number of steps.
+*/
+void PathCache::Add(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					int minrange, int maxrange, const char *steps, int length, const CUnit &unit)
+{
+	if (cycle != GameCycle) {
+		entries.clear();
+		cycle = GameCycle;
+	}
+	if (entries.size() >= MaxEntries) {
+		return;
+	}
+	entries.push_back(Entry());
+	Entry &entry = entries.back();
+	entry.goalPos = goalPos;
+	entry.gw = gw;
+	entry.gh = gh;
+	entry.minrange = minrange;
+	entry.maxrange = maxrange;
+	entry.type = unit.Type;
+	entry.player = unit.Player;
+	entry.agressive = unit.IsAgressive();
+	entry.startPos = startPos;
+	entry.steps.assign(steps, steps + length);
+	std::reverse(entry.steps.begin(), entry.steps.end());
+}
+
 /**
 **  Find path.
 */
-int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
-				  int tilesizex, int tilesizey, int minrange, int maxrange,
-				  char *path, int pathlen, const CUnit &unit)
+int PathSearchContext::FindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+								int tilesizex, int tilesizey, int minrange, int maxrange,
+								char *path, int pathlen, const CUnit &unit)
 {
+	PROFILE_ZONE("AStarFindPath");
 	Assert(Map.Info.IsPointOnMap(startPos));
 
 	ProfileBegin("AStarFindPath");
 
-	AStarGoalX = goalPos.x;
-	AStarGoalY = goalPos.y;
+	goal = goalPos;
 
 	//  Check for simple cases first
-	int ret = AStarFindSimplePath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
-								  minrange, maxrange, path, unit);
+	int ret = FindSimplePath(startPos, goalPos, gw, gh, minrange, maxrange, path, unit);
 	if (ret != PF_FAILED) {
 		ProfileEnd("AStarFindPath");
 		return ret;
 	}
 
+	if (cache) {
+		ret = cache->Find(startPos, goalPos, gw, gh, minrange, maxrange, path, pathlen, unit);
+		if (ret != PF_FAILED) {
+			ProfileEnd("AStarFindPath");
+			return ret;
+		}
+	}
+
 	//  Initialize
-	AStarCleanUp();
+	CleanUp();
 	CostMoveToCacheCleanUp();
 
-	OpenSetSize = 0;
-	CloseSetSize = 0;
+	openSet.Clear();
+	closeSetSize = 0;
 
-	if (!AStarMarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
+	if (!MarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
 		// goal is not reachable
 		ret = PF_UNREACHABLE;
 		ProfileEnd("AStarFindPath");
 		return ret;
 	}
 
-	int eo = startPos.y * AStarMapWidth + startPos.x;
+	int eo = startPos.y * mapWidth + startPos.x;
 	// it is quite important to start from 1 rather than 0, because we use
 	// 0 as a way to represent nodes that we have not visited yet.
-	AStarMatrix[eo].CostFromStart = 1;
+	matrix[eo].CostFromStart = 1;
 	// 8 to say we are came from nowhere.
-	AStarMatrix[eo].Direction = 8;
+	matrix[eo].Direction = 8;
 
 	// place start point in open, it that failed, try another pathfinder
 	int costToGoal = AStarCosts(startPos, goalPos);
-	AStarMatrix[eo].CostToGoal = costToGoal;
-	if (AStarAddNode(startPos, eo, 1 + costToGoal) == PF_FAILED) {
+	matrix[eo].CostToGoal = costToGoal;
+	if (AddNode(startPos, eo, 1 + costToGoal) == PF_FAILED) {
 		ret = PF_FAILED;
 		ProfileEnd("AStarFindPath");
 		return ret;
 	}
-	AStarAddToClose(OpenSet[0].O);
-	if (AStarMatrix[eo].InGoal) {
+	AddToClose(eo);
+	if (matrix[eo].InGoal) {
 		ret = PF_REACHED;
 		ProfileEnd("AStarFindPath");
 		return ret;
@@ -969,15 +1047,13 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 	//  Begin search
 	while (1) {
 		// Find the best node of from the open set
-		const int shortest = AStarFindMinimum();
-		const int x = OpenSet[shortest].pos.x;
-		const int y = OpenSet[shortest].pos.y;
-		const int o = OpenSet[shortest].O;
-
-		AStarRemoveMinimum(shortest);
+		const Open shortest = openSet.PopMinimum();
+		const int x = shortest.pos.x;
+		const int y = shortest.pos.y;
+		const int o = shortest.O;
 
 		// If we have reached the goal, then exit.
-		if (AStarMatrix[o].InGoal == 1) {
+		if (matrix[o].InGoal == 1) {
 			endPos.x = x;
 			endPos.y = y;
 			break;
@@ -998,8 +1074,8 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 		// Generate successors of this node.
 
 		// Node that this node was generated from.
-		const int px = x - Heading2X[(int)AStarMatrix[o].Direction];
-		const int py = y - Heading2Y[(int)AStarMatrix[o].Direction];
+		const int px = x - Heading2X[(int)matrix[o].Direction];
+		const int py = y - Heading2Y[(int)matrix[o].Direction];
 
 		for (int i = 0; i < 8; ++i) {
 			endPos.x = x + Heading2X[i];
@@ -1013,13 +1089,13 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 			}
 
 			// Outside the map or can't be entered.
-			if (endPos.x < 0 || endPos.x + tilesizex - 1 >= AStarMapWidth
-				|| endPos.y < 0 || endPos.y + tilesizey - 1 >= AStarMapHeight) {
+			if (endPos.x < 0 || endPos.x + tilesizex - 1 >= mapWidth
+				|| endPos.y < 0 || endPos.y + tilesizey - 1 >= mapHeight) {
 				continue;
 			}
 
 			//eo = GetIndex(ex, ey);
-			eo = endPos.x + (o - x) + Heading2O[i];
+			eo = endPos.x + (o - x) + heading2O[i];
 
 			// if the point is "move to"-able and
 			// if we have not reached this point before,
@@ -1032,51 +1108,56 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 
 			// Add a cost for walking to make paths more realistic for the user.
 			new_cost++;
-			new_cost += AStarMatrix[o].CostFromStart;
-			if (AStarMatrix[eo].CostFromStart == 0) {
+			new_cost += matrix[o].CostFromStart;
+			if (matrix[eo].CostFromStart == 0) {
 				// we are sure the current node has not been already visited
-				AStarMatrix[eo].CostFromStart = new_cost;
-				AStarMatrix[eo].Direction = i;
+				matrix[eo].CostFromStart = new_cost;
+				matrix[eo].Direction = i;
 				costToGoal = AStarCosts(endPos, goalPos);
-				AStarMatrix[eo].CostToGoal = costToGoal;
-				if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
+				matrix[eo].CostToGoal = costToGoal;
+				if (AddNode(endPos, eo, matrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
 					ret = PF_FAILED;
 					ProfileEnd("AStarFindPath");
 					return ret;
 				}
 				// we add the point to the close set
-				AStarAddToClose(eo);
-			} else if (new_cost < AStarMatrix[eo].CostFromStart) {
+				AddToClose(eo);
+			} else if (new_cost < matrix[eo].CostFromStart) {
 				// Already visited node, but we have here a better path
 				// I know, it's redundant (but simpler like this)
-				AStarMatrix[eo].CostFromStart = new_cost;
-				AStarMatrix[eo].Direction = i;
+				matrix[eo].CostFromStart = new_cost;
+				matrix[eo].Direction = i;
 				// this point might be already in the OpenSet
-				const int j = AStarFindNode(eo);
-				if (j == -1) {
+				if (!FindNode(eo)) {
 					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
+					matrix[eo].CostToGoal = costToGoal;
+					if (AddNode(endPos, eo, matrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
 						ret = PF_FAILED;
 						ProfileEnd("AStarFindPath");
 						return ret;
 					}
 				} else {
 					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					AStarReplaceNode(j);
+					matrix[eo].CostToGoal = costToGoal;
+					ReplaceNode(eo);
 				}
 				// we don't have to add this point to the close set
 			}
 		}
-		if (OpenSetSize <= 0) { // no new nodes generated
+		if (openSet.Size() <= 0) { // no new nodes generated
 			ret = PF_UNREACHABLE;
 			ProfileEnd("AStarFindPath");
 			return ret;
 		}
 	}
 
-	const int path_length = AStarSavePath(startPos, endPos, path, pathlen);
+	const int path_length = SavePath(startPos, endPos, path, pathlen);
+
+	if (cache) {
+		std::vector<char> steps(path_length);
+		SavePath(startPos, endPos, &steps[0], path_length);
+		cache->Add(startPos, goalPos, gw, gh, minrange, maxrange, &steps[0], path_length, unit);
+	}
 
 	ret = path_length;
 
@@ -1084,6 +1165,26 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 	return ret;
 }
 
+/**
+**  Find path with the context of the game thread.
+*/
+int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				  int tilesizex, int tilesizey, int minrange, int maxrange,
+				  char *path, int pathlen, const CUnit &unit)
+{
+	MainContext->SetCache(GameSettings.PathCache ? &MainPathCache : NULL);
+	return MainContext->FindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+								 minrange, maxrange, path, pathlen, unit);
+}
+
+/**
+**  Forget the cached paths, the passability of the tiles changed.
+*/
+void AStarInvalidatePathCache()
+{
+	MainPathCache.Clear();
+}
+
 struct StatsNode {
 	StatsNode() : Direction(0), InGoal(0), CostFromStart(0), Costs(0), CostToGoal(0) {}
 
@@ -1096,23 +1197,24 @@ struct StatsNode {
 
 StatsNode *AStarGetStats()
 {
-	StatsNode *stats = new StatsNode[AStarMapWidth * AStarMapHeight];
+	const int mapSize = Map.Info.MapWidth * Map.Info.MapHeight;
+	StatsNode *stats = new StatsNode[mapSize];
 	StatsNode *s = stats;
-	Node *m = AStarMatrix;
-
-	for (int j = 0; j < AStarMapHeight; ++j) {
-		for (int i = 0; i < AStarMapWidth; ++i) {
-			s->Direction = m->Direction;
-			s->InGoal = m->InGoal;
-			s->CostFromStart = m->CostFromStart;
-			s->CostToGoal = m->CostToGoal;
-			++s;
-			++m;
-		}
+	const Node *m = MainContext->GetMatrix();
+
+	for (int i = 0; i < mapSize; ++i) {
+		s->Direction = m->Direction;
+		s->InGoal = m->InGoal;
+		s->CostFromStart = m->CostFromStart;
+		s->CostToGoal = m->CostToGoal;
+		++s;
+		++m;
 	}
 
-	for (int i = 0; i < OpenSetSize; ++i) {
-		stats[OpenSet[i].O].Costs = OpenSet[i].Costs;
+	std::vector<Open> openSet;
+	MainContext->GetOpenSet().GetNodes(openSet);
+	for (size_t i = 0; i != openSet.size(); ++i) {
+		stats[openSet[i].O].Costs = openSet[i].Costs;
 	}
 	return stats;
 }
@@ -1122,6 +1224,18 @@ void AStarFreeStats(StatsNode *stats)
 	delete[] stats;
 }
 
+/**
+**  Get the counters of the path cache.
+**
+**  @param hits    Paths found in the cache.
+**  @param misses  Paths searched after a cache miss.
+*/
+void AStarGetCacheStats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = MainPathCache.Hits;
+	*misses = MainPathCache.Misses;
+}
+
 /*----------------------------------------------------------------------------
 --  Configurable costs
 ----------------------------------------------------------------------------*/
@@ -0,0 +1,260 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name astar_openset.cpp - The open node set of the a* path finder. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "astar_openset.h"
+
+#include <algorithm>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Compare the order of two nodes.
+**
+**  @return  >0 if lhs is after rhs in the order of the sorted array (lower costs),
+**           <0 if lhs is before rhs, 0 if they have the same costs.
+*/
+static inline int CompareNodes(const AStarOpenNode &lhs, const AStarOpenNode &rhs)
+{
+	if (lhs.Costs != rhs.Costs) {
+		return rhs.Costs - lhs.Costs;
+	}
+	if (lhs.CostToGoal != rhs.CostToGoal) {
+		return rhs.CostToGoal - lhs.CostToGoal;
+	}
+	return rhs.Dist - lhs.Dist;
+}
+
+/**
+**  Find where the binary search of the array sorted by decreasing costs
+**  inserts a node.
+**
+**  @param size   Number of nodes in the array.
+**  @param first  Index of the first node with the same costs as the new one.
+**  @param last   Index after the last node with the same costs.
+**
+**  @return       Index of the new node.
+*/
+static inline int SortedInsertIndex(int size, int first, int last)
+{
+	int bigi = 0;
+	int smalli = size;
+
+	while (bigi < smalli) {
+		const int midi = (smalli + bigi) >> 1;
+
+		if (midi >= last) {
+			smalli = midi;
+		} else if (midi < first) {
+			if (bigi == midi) {
+				bigi++;
+			} else {
+				bigi = midi;
+			}
+		} else {
+			bigi = midi;
+			smalli = midi;
+		}
+	}
+	return bigi;
+}
+
+/*----------------------------------------------------------------------------
+--  Buckets
+----------------------------------------------------------------------------*/
+
+AStarOpenSet::AStarOpenSet(int mapSize, int maxSize) :
+	mapSize(mapSize), size(0), maxSize(maxSize), minCosts(MaxCosts), maxCosts(-1)
+{
+	costsAt = new short int[mapSize];
+	memset(costsAt, 0xFF, mapSize * sizeof(short int));
+}
+
+AStarOpenSet::~AStarOpenSet()
+{
+	delete[] costsAt;
+}
+
+/**
+**  Number of nodes with higher costs.
+**
+**  The costs of the open nodes are close, there are few buckets to count.
+*/
+int AStarOpenSet::CountHigher(int costs) const
+{
+	int res = 0;
+	for (int i = costs + 1; i <= maxCosts; ++i) {
+		res += buckets[i].size();
+	}
+	return res;
+}
+
+/**
+**  Insert a node at the place the sorted array would use.
+*/
+void AStarOpenSet::Insert(const AStarOpenNode &node)
+{
+	const int costs = node.Costs;
+
+	if (costs >= (int)buckets.size()) {
+		buckets.resize(costs + 1);
+	}
+	std::vector<AStarOpenNode> &bucket = buckets[costs];
+	const int bucketSize = bucket.size();
+
+	// Nodes with the same costs are sorted by decreasing CostToGoal and Dist.
+	int first = 0;
+	int last = bucketSize;
+	while (first < last) {
+		const int mid = (first + last) >> 1;
+		if (CompareNodes(node, bucket[mid]) > 0) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+	last = first;
+	while (last < bucketSize && CompareNodes(node, bucket[last]) == 0) {
+		++last;
+	}
+	int index = first;
+	if (first != last) {
+		// Same order as the sorted array: replay its binary search
+		const int start = CountHigher(costs);
+		index = SortedInsertIndex(size, start + first, start + last) - start;
+	}
+	bucket.insert(bucket.begin() + index, node);
+	costsAt[node.O] = costs;
+	++size;
+	minCosts = std::min(minCosts, costs);
+	maxCosts = std::max(maxCosts, costs);
+}
+
+/**
+**  Remove a node from its bucket.
+*/
+void AStarOpenSet::Remove(int costs, int index)
+{
+	std::vector<AStarOpenNode> &bucket = buckets[costs];
+
+	costsAt[bucket[index].O] = -1;
+	bucket.erase(bucket.begin() + index);
+	--size;
+	if (size == 0) {
+		minCosts = MaxCosts;
+	} else if (costs == minCosts) {
+		while (buckets[minCosts].empty()) {
+			++minCosts;
+		}
+	}
+}
+
+/**
+**  Add a new node to the open set.
+**
+**  @return  false if the set is full.
+*/
+bool AStarOpenSet::Push(const AStarOpenNode &node)
+{
+	if (size + 1 >= maxSize) {
+		return false;
+	}
+	Assert(0 <= node.Costs && node.O < mapSize);
+	Insert(node);
+	return true;
+}
+
+/**
+**  Remove the node with the smallest costs from the open set.
+*/
+AStarOpenNode AStarOpenSet::PopMinimum()
+{
+	Assert(size > 0);
+	const AStarOpenNode node = buckets[minCosts].back();
+
+	Remove(minCosts, buckets[minCosts].size() - 1);
+	return node;
+}
+
+/**
+**  Remove the node of this offset and add it again.
+*/
+void AStarOpenSet::Requeue(int o)
+{
+	const int costs = costsAt[o];
+	Assert(costs != -1);
+	std::vector<AStarOpenNode> &bucket = buckets[costs];
+	int index = 0;
+
+	while (bucket[index].O != o) {
+		++index;
+	}
+	const AStarOpenNode node = bucket[index];
+	Remove(costs, index);
+	Insert(node);
+}
+
+void AStarOpenSet::Clear()
+{
+	for (int costs = minCosts; costs <= maxCosts; ++costs) {
+		std::vector<AStarOpenNode> &bucket = buckets[costs];
+
+		if (bucket.empty()) {
+			continue;
+		}
+		for (size_t i = 0; i != bucket.size(); ++i) {
+			costsAt[bucket[i].O] = -1;
+		}
+		bucket.clear();
+	}
+	size = 0;
+	minCosts = MaxCosts;
+	maxCosts = -1;
+}
+
+/**
+**  Copy the nodes, in the order of the sorted array.
+*/
+void AStarOpenSet::GetNodes(std::vector<AStarOpenNode> &result) const
+{
+	result.clear();
+	for (int costs = maxCosts; costs >= 0 && costs >= minCosts; --costs) {
+		result.insert(result.end(), buckets[costs].begin(), buckets[costs].end());
+	}
+}
+
+//@}
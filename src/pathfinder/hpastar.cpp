@@ -0,0 +1,605 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name hpastar.cpp - The hierarchical (HPA*) path finder routines. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "map.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unittype.h"
+
+#include "pathfinder.h"
+
+#include <map>
+#include <queue>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  The map is split in square clusters of HpaClusterSize tiles.
+**  Along each border between two clusters, runs of tiles passable on
+**  both sides are entrances. Each entrance gives one abstract node on
+**  each side, and nodes of a same cluster are linked with the cost of
+**  the shortest path inside the cluster.
+**
+**  The abstract graph only considers terrain and buildings: moving units
+**  are left to the refinement, which is done with the flat A* toward the
+**  next abstract node only (so path is computed lazily per cluster).
+*/
+#define HpaClusterSize 16
+/// Runs of entrance tiles longer than this get one node at each end.
+#define HpaMaxSingleEntranceLength 6
+
+/// Flags which change too often to be part of the abstract graph.
+static const unsigned int HpaDynamicFlags = MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit;
+
+/// Find and a* path for a unit (astar.cpp)
+extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, int minrange,
+						 int maxrange, char *path, int pathlen, const CUnit &unit);
+
+struct HpaEntrance {
+	Vec2i pos;        /// Tile of the entrance inside its cluster
+	Vec2i partnerPos; /// Tile of the connected entrance in the neighbor cluster
+};
+
+struct HpaCluster {
+	std::vector<HpaEntrance> Entrances;
+	/// Entrances.size()^2 costs to go from one entrance to another, -1 if not linked
+	std::vector<int> Costs;
+};
+
+/**
+**  Abstract graph for one movement mask.
+*/
+class HpaGraph
+{
+public:
+	explicit HpaGraph(unsigned int movementMask);
+
+	void MarkDirty(const Vec2i &pos);
+	void Update();
+
+	int FindAbstractPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 std::vector<Vec2i> &abstractPath);
+
+private:
+	bool IsPassable(const Vec2i &pos) const
+	{
+		const unsigned int flags = Map.Field(pos)->getFlag() & mask & ~HpaDynamicFlags;
+		return flags == 0;
+	}
+	int ClusterIndex(const Vec2i &pos) const
+	{
+		return (pos.y / HpaClusterSize) * clusterWidth + pos.x / HpaClusterSize;
+	}
+	void ClusterBounds(int cluster, Vec2i &minPos, Vec2i &maxPos) const;
+
+	void BuildEntrances(int cluster);
+	void AddBorderEntrances(int cluster, const Vec2i &start, const Vec2i &step, const Vec2i &normal);
+	void BuildCosts(int cluster);
+	void ClusterDistances(int cluster, const std::vector<Vec2i> &seeds, std::vector<int> &dist) const;
+
+private:
+	unsigned int mask;
+	int clusterWidth;
+	int clusterHeight;
+	std::vector<HpaCluster> clusters;
+	std::vector<char> dirty;
+	/// Entrance index of the tile inside its cluster, -1 if the tile is not an entrance
+	std::vector<short int> tileEntrance;
+	bool anyDirty;
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// see pathfinder.h
+int PathfinderMode = PathfinderModeFlat;
+
+/// One abstract graph per movement mask, built on demand
+static std::map<unsigned int, HpaGraph *> HpaGraphs;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+HpaGraph::HpaGraph(unsigned int movementMask) : mask(movementMask), anyDirty(true)
+{
+	clusterWidth = (Map.Info.MapWidth + HpaClusterSize - 1) / HpaClusterSize;
+	clusterHeight = (Map.Info.MapHeight + HpaClusterSize - 1) / HpaClusterSize;
+	clusters.resize(clusterWidth * clusterHeight);
+	dirty.resize(clusterWidth * clusterHeight, 1);
+	tileEntrance.resize(Map.Info.MapWidth * Map.Info.MapHeight, -1);
+}
+
+void HpaGraph::ClusterBounds(int cluster, Vec2i &minPos, Vec2i &maxPos) const
+{
+	minPos.x = (cluster % clusterWidth) * HpaClusterSize;
+	minPos.y = (cluster / clusterWidth) * HpaClusterSize;
+	maxPos.x = std::min(minPos.x + HpaClusterSize, Map.Info.MapWidth) - 1;
+	maxPos.y = std::min(minPos.y + HpaClusterSize, Map.Info.MapHeight) - 1;
+}
+
+/**
+**  Mark the cluster of pos as outdated.
+**  Tiles on a cluster border also change the entrances of the neighbor.
+*/
+void HpaGraph::MarkDirty(const Vec2i &pos)
+{
+	const int cx = pos.x / HpaClusterSize;
+	const int cy = pos.y / HpaClusterSize;
+
+	dirty[cy * clusterWidth + cx] = 1;
+	if (pos.x % HpaClusterSize == 0 && cx > 0) {
+		dirty[cy * clusterWidth + cx - 1] = 1;
+	}
+	if (pos.x % HpaClusterSize == HpaClusterSize - 1 && cx + 1 < clusterWidth) {
+		dirty[cy * clusterWidth + cx + 1] = 1;
+	}
+	if (pos.y % HpaClusterSize == 0 && cy > 0) {
+		dirty[(cy - 1) * clusterWidth + cx] = 1;
+	}
+	if (pos.y % HpaClusterSize == HpaClusterSize - 1 && cy + 1 < clusterHeight) {
+		dirty[(cy + 1) * clusterWidth + cx] = 1;
+	}
+	anyDirty = true;
+}
+
+/**
+**  Add entrances along one border of a cluster.
+**
+**  @param cluster  Cluster index.
+**  @param start    First tile of the border inside the cluster.
+**  @param step     Direction along the border.
+**  @param normal   Direction toward the neighbor cluster.
+*/
+void HpaGraph::AddBorderEntrances(int cluster, const Vec2i &start, const Vec2i &step, const Vec2i &normal)
+{
+	HpaCluster &c = clusters[cluster];
+	Vec2i minPos;
+	Vec2i maxPos;
+	ClusterBounds(cluster, minPos, maxPos);
+
+	if (!Map.Info.IsPointOnMap(start + normal)) {
+		return;
+	}
+	Vec2i pos = start;
+	int runLength = 0;
+	for (;;) {
+		const bool inside = minPos.x <= pos.x && pos.x <= maxPos.x && minPos.y <= pos.y && pos.y <= maxPos.y;
+		const bool open = inside && IsPassable(pos) && IsPassable(pos + normal);
+
+		if (open) {
+			++runLength;
+		} else if (runLength) {
+			const Vec2i last = pos - step;
+			const Vec2i first = pos - step * runLength;
+			if (runLength > HpaMaxSingleEntranceLength) {
+				HpaEntrance e1 = {first, first + normal};
+				HpaEntrance e2 = {last, last + normal};
+				c.Entrances.push_back(e1);
+				c.Entrances.push_back(e2);
+			} else {
+				const Vec2i middle = first + step * (runLength / 2);
+				HpaEntrance e = {middle, middle + normal};
+				c.Entrances.push_back(e);
+			}
+			runLength = 0;
+		}
+		if (!inside) {
+			break;
+		}
+		pos += step;
+	}
+}
+
+/**
+**  Rebuild the entrances of a cluster from its four borders.
+*/
+void HpaGraph::BuildEntrances(int cluster)
+{
+	HpaCluster &c = clusters[cluster];
+
+	for (size_t i = 0; i != c.Entrances.size(); ++i) {
+		tileEntrance[Map.getIndex(c.Entrances[i].pos)] = -1;
+	}
+	c.Entrances.clear();
+
+	Vec2i minPos;
+	Vec2i maxPos;
+	ClusterBounds(cluster, minPos, maxPos);
+
+	AddBorderEntrances(cluster, minPos, Vec2i(1, 0), Vec2i(0, -1));
+	AddBorderEntrances(cluster, Vec2i(maxPos.x, minPos.y), Vec2i(0, 1), Vec2i(1, 0));
+	AddBorderEntrances(cluster, Vec2i(minPos.x, maxPos.y), Vec2i(1, 0), Vec2i(0, 1));
+	AddBorderEntrances(cluster, minPos, Vec2i(0, 1), Vec2i(-1, 0));
+
+	// A corner tile may be entrance for two borders, keep only one node.
+	for (size_t i = 0; i != c.Entrances.size(); ++i) {
+		short int &index = tileEntrance[Map.getIndex(c.Entrances[i].pos)];
+		if (index == -1) {
+			index = i;
+		}
+	}
+}
+
+/**
+**  Dijkstra inside a cluster from the seed tiles.
+**
+**  @param dist  Output: cost for each tile of the cluster (row major), -1 if not reached.
+*/
+void HpaGraph::ClusterDistances(int cluster, const std::vector<Vec2i> &seeds, std::vector<int> &dist) const
+{
+	Vec2i minPos;
+	Vec2i maxPos;
+	ClusterBounds(cluster, minPos, maxPos);
+	const int w = maxPos.x - minPos.x + 1;
+	const int h = maxPos.y - minPos.y + 1;
+
+	dist.assign(w * h, -1);
+	typedef std::pair<int, int> CostIndex;
+	std::priority_queue<CostIndex, std::vector<CostIndex>, std::greater<CostIndex> > open;
+
+	for (size_t i = 0; i != seeds.size(); ++i) {
+		const Vec2i local = seeds[i] - minPos;
+		if (local.x < 0 || local.y < 0 || local.x >= w || local.y >= h) {
+			continue;
+		}
+		dist[local.y * w + local.x] = 0;
+		open.push(CostIndex(0, local.y * w + local.x));
+	}
+	while (!open.empty()) {
+		const CostIndex top = open.top();
+		open.pop();
+		if (top.first != dist[top.second]) {
+			continue;
+		}
+		const Vec2i local(top.second % w, top.second / w);
+		for (int i = 0; i < 8; ++i) {
+			const Vec2i next(local.x + Heading2X[i], local.y + Heading2Y[i]);
+			if (next.x < 0 || next.y < 0 || next.x >= w || next.y >= h) {
+				continue;
+			}
+			const Vec2i pos = next + minPos;
+			if (!IsPassable(pos)) {
+				continue;
+			}
+			// Same costs as the flat A*: one for the move and the tile cost.
+			const int cost = top.first + 1 + Map.Field(pos)->getCost();
+			int &d = dist[next.y * w + next.x];
+			if (d == -1 || cost < d) {
+				d = cost;
+				open.push(CostIndex(cost, next.y * w + next.x));
+			}
+		}
+	}
+}
+
+/**
+**  Compute the costs between each pair of entrances of a cluster.
+*/
+void HpaGraph::BuildCosts(int cluster)
+{
+	HpaCluster &c = clusters[cluster];
+	const size_t n = c.Entrances.size();
+	Vec2i minPos;
+	Vec2i maxPos;
+	ClusterBounds(cluster, minPos, maxPos);
+	const int w = maxPos.x - minPos.x + 1;
+
+	c.Costs.assign(n * n, -1);
+	std::vector<Vec2i> seeds(1);
+	std::vector<int> dist;
+	for (size_t i = 0; i != n; ++i) {
+		seeds[0] = c.Entrances[i].pos;
+		ClusterDistances(cluster, seeds, dist);
+		for (size_t j = 0; j != n; ++j) {
+			const Vec2i local = c.Entrances[j].pos - minPos;
+			c.Costs[i * n + j] = dist[local.y * w + local.x];
+		}
+	}
+}
+
+/**
+**  Rebuild the outdated parts of the abstract graph.
+*/
+void HpaGraph::Update()
+{
+	if (!anyDirty) {
+		return;
+	}
+	const int clusterCount = clusterWidth * clusterHeight;
+	for (int i = 0; i != clusterCount; ++i) {
+		if (dirty[i]) {
+			BuildEntrances(i);
+		}
+	}
+	for (int i = 0; i != clusterCount; ++i) {
+		if (dirty[i]) {
+			BuildCosts(i);
+			dirty[i] = 0;
+		}
+	}
+	anyDirty = false;
+}
+
+/**
+**  Find a path in the abstract graph.
+**
+**  @param abstractPath  Output: tiles from startPos to goalPos through the entrances.
+**
+**  @return  Estimated length of the path, or -1 if no abstract path was found.
+*/
+int HpaGraph::FindAbstractPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+							   std::vector<Vec2i> &abstractPath)
+{
+	Update();
+
+	const int startCluster = ClusterIndex(startPos);
+	const int goalCluster = ClusterIndex(goalPos);
+
+	// Give an id to each abstract node, plus one for the goal.
+	const int clusterCount = clusterWidth * clusterHeight;
+	std::vector<int> firstId(clusterCount + 1);
+	for (int i = 0; i != clusterCount; ++i) {
+		firstId[i + 1] = firstId[i] + clusters[i].Entrances.size();
+	}
+	const int goalId = firstId[clusterCount];
+	const int nodeCount = goalId + 1;
+
+	// Link start and goal to the entrances of their clusters.
+	Vec2i minPos;
+	Vec2i maxPos;
+	std::vector<int> dist;
+	std::vector<Vec2i> seeds(1, startPos);
+	ClusterDistances(startCluster, seeds, dist);
+	ClusterBounds(startCluster, minPos, maxPos);
+	const int startW = maxPos.x - minPos.x + 1;
+	const Vec2i startMin = minPos;
+
+	std::vector<int> goalCosts;
+	seeds.clear();
+	for (int y = 0; y < std::max(gh, 1); ++y) {
+		for (int x = 0; x < std::max(gw, 1); ++x) {
+			seeds.push_back(goalPos + Vec2i(x, y));
+		}
+	}
+	ClusterDistances(goalCluster, seeds, goalCosts);
+	ClusterBounds(goalCluster, minPos, maxPos);
+	const int goalW = maxPos.x - minPos.x + 1;
+	const Vec2i goalMin = minPos;
+
+	// A* over the abstract nodes.
+	std::vector<int> costFromStart(nodeCount, -1);
+	std::vector<int> parent(nodeCount, -1);
+	typedef std::pair<int, int> CostId;
+	std::priority_queue<CostId, std::vector<CostId>, std::greater<CostId> > open;
+	std::vector<int> nodeCluster(nodeCount, goalCluster);
+	for (int i = 0; i != clusterCount; ++i) {
+		for (int id = firstId[i]; id != firstId[i + 1]; ++id) {
+			nodeCluster[id] = i;
+		}
+	}
+	const HpaCluster &start = clusters[startCluster];
+	for (size_t i = 0; i != start.Entrances.size(); ++i) {
+		const Vec2i local = start.Entrances[i].pos - startMin;
+		const int cost = dist[local.y * startW + local.x];
+		if (cost < 0) {
+			continue;
+		}
+		const int id = firstId[startCluster] + i;
+		costFromStart[id] = cost;
+		const Vec2i diff = start.Entrances[i].pos - goalPos;
+		open.push(CostId(cost + std::max(abs(diff.x), abs(diff.y)), id));
+	}
+
+	while (!open.empty()) {
+		const CostId top = open.top();
+		open.pop();
+		const int id = top.second;
+		if (id == goalId) {
+			break;
+		}
+		const int cluster = nodeCluster[id];
+		const HpaCluster &c = clusters[cluster];
+		const int index = id - firstId[cluster];
+		const HpaEntrance &entrance = c.Entrances[index];
+		const int g = costFromStart[id];
+		{
+			const Vec2i diff = entrance.pos - goalPos;
+			if (top.first != g + std::max(abs(diff.x), abs(diff.y))) {
+				continue; // outdated entry
+			}
+		}
+		const size_t n = c.Entrances.size();
+
+		// Go out of the cluster through the entrance.
+		const int partnerCluster = ClusterIndex(entrance.partnerPos);
+		const int partnerIndex = tileEntrance[Map.getIndex(entrance.partnerPos)];
+		if (partnerIndex != -1) {
+			const int next = firstId[partnerCluster] + partnerIndex;
+			const int cost = g + 1 + Map.Field(entrance.partnerPos)->getCost();
+			if (costFromStart[next] == -1 || cost < costFromStart[next]) {
+				costFromStart[next] = cost;
+				parent[next] = id;
+				const Vec2i diff = entrance.partnerPos - goalPos;
+				open.push(CostId(cost + std::max(abs(diff.x), abs(diff.y)), next));
+			}
+		}
+		// Cross the cluster to another entrance.
+		for (size_t j = 0; j != n; ++j) {
+			const int linkCost = c.Costs[index * n + j];
+			if (j == (size_t)index || linkCost < 0) {
+				continue;
+			}
+			const int next = firstId[cluster] + j;
+			const int cost = g + linkCost;
+			if (costFromStart[next] == -1 || cost < costFromStart[next]) {
+				costFromStart[next] = cost;
+				parent[next] = id;
+				const Vec2i diff = c.Entrances[j].pos - goalPos;
+				open.push(CostId(cost + std::max(abs(diff.x), abs(diff.y)), next));
+			}
+		}
+		// Reach the goal.
+		if (cluster == goalCluster) {
+			const Vec2i local = entrance.pos - goalMin;
+			const int goalCost = goalCosts[local.y * goalW + local.x];
+			if (goalCost >= 0 && (costFromStart[goalId] == -1 || g + goalCost < costFromStart[goalId])) {
+				costFromStart[goalId] = g + goalCost;
+				parent[goalId] = id;
+				open.push(CostId(g + goalCost, goalId));
+			}
+		}
+	}
+	if (costFromStart[goalId] == -1) {
+		return -1;
+	}
+
+	// Trace back the path.
+	abstractPath.clear();
+	abstractPath.push_back(goalPos);
+	for (int id = parent[goalId]; id != -1; id = parent[id]) {
+		const int cluster = nodeCluster[id];
+		abstractPath.push_back(clusters[cluster].Entrances[id - firstId[cluster]].pos);
+	}
+	abstractPath.push_back(startPos);
+	std::reverse(abstractPath.begin(), abstractPath.end());
+
+	int length = 0;
+	for (size_t i = 1; i < abstractPath.size(); ++i) {
+		const Vec2i diff = abstractPath[i] - abstractPath[i - 1];
+		length += std::max(abs(diff.x), abs(diff.y));
+	}
+	return length;
+}
+
+/**
+**  Free the hierarchical pathfinder.
+*/
+void FreeHierarchicalPathfinder()
+{
+	for (std::map<unsigned int, HpaGraph *>::iterator it = HpaGraphs.begin(); it != HpaGraphs.end(); ++it) {
+		delete it->second;
+	}
+	HpaGraphs.clear();
+}
+
+/**
+**  Init the hierarchical pathfinder.
+*/
+void InitHierarchicalPathfinder()
+{
+	FreeHierarchicalPathfinder();
+}
+
+/**
+**  Notify the pathfinders that passability of the tiles changed.
+**
+**  @param pos   Top left tile which changed.
+**  @param size  Size of the changed area.
+*/
+void PathfinderTerrainChanged(const Vec2i &pos, const Vec2i &size)
+{
+	AStarInvalidatePathCache();
+	if (HpaGraphs.empty()) {
+		return;
+	}
+	for (std::map<unsigned int, HpaGraph *>::iterator it = HpaGraphs.begin(); it != HpaGraphs.end(); ++it) {
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				it->second->MarkDirty(pos + Vec2i(x, y));
+			}
+		}
+	}
+}
+
+/**
+**  Find path with the abstract graph, then refine it up to the first
+**  entrance outside the start cluster.
+**
+**  Fall back to the flat A* for near goals, big units, and when the
+**  abstract graph doesn't find a way (it ignores fog of war and units).
+*/
+int HierarchicalFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, int minrange, int maxrange,
+						 char *path, int pathlen, const CUnit &unit)
+{
+	const Vec2i startCluster = startPos / HpaClusterSize;
+	const Vec2i clusterDiff = goalPos / HpaClusterSize - startCluster;
+
+	if (tilesizex != 1 || tilesizey != 1 || std::max(abs(clusterDiff.x), abs(clusterDiff.y)) <= 1) {
+		return AStarFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							 minrange, maxrange, path, pathlen, unit);
+	}
+	const unsigned int mask = unit.Type->MovementMask;
+	HpaGraph *&graph = HpaGraphs[mask];
+	if (graph == NULL) {
+		graph = new HpaGraph(mask);
+	}
+	std::vector<Vec2i> abstractPath;
+	if (graph->FindAbstractPath(startPos, goalPos, gw, gh, abstractPath) < 0) {
+		return AStarFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							 minrange, maxrange, path, pathlen, unit);
+	}
+
+	// Next way point is the first node out of the start cluster.
+	size_t next = 1;
+	while (next + 1 < abstractPath.size() && abstractPath[next] / HpaClusterSize == startCluster) {
+		++next;
+	}
+	int remaining = 0;
+	for (size_t i = next + 1; i < abstractPath.size(); ++i) {
+		const Vec2i diff = abstractPath[i] - abstractPath[i - 1];
+		remaining += std::max(abs(diff.x), abs(diff.y));
+	}
+
+	const int length = AStarFindPath(startPos, abstractPath[next], 0, 0, 1, 1, 0, 0, path, pathlen, unit);
+	if (length <= 0) {
+		// Blocked by units, let the flat A* decide.
+		return AStarFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							 minrange, maxrange, path, pathlen, unit);
+	}
+	// The caller only keeps min(result, pathlen) steps of the path:
+	// if the whole refined path fits, the unit will ask for a new one at the way point.
+	if (path && length < pathlen) {
+		return length;
+	}
+	return length + remaining;
+}
+
+//@}
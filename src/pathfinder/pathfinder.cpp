@@ -40,9 +40,14 @@
 #include "pathfinder.h"
 
 #include "actions.h"
+#include "animation.h"
 #include "map.h"
+#include "settings.h"
 #include "unittype.h"
 #include "unit.h"
+#include "unit_manager.h"
+
+#include "SDL.h"
 
 //astar.cpp
 
@@ -57,10 +62,45 @@ extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, in
 						 int tilesizex, int tilesizey, int minrange,
 						 int maxrange, char *path, int pathlen, const CUnit &unit);
 
+//hpastar.cpp
+
+/// Init the hierarchical pathfinder
+extern void InitHierarchicalPathfinder();
+
+/// Free the hierarchical pathfinder
+extern void FreeHierarchicalPathfinder();
+
+/// Find a path for a unit with the hierarchical pathfinder
+extern int HierarchicalFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+								int tilesizex, int tilesizey, int minrange,
+								int maxrange, char *path, int pathlen, const CUnit &unit);
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
 
+/// Number of threads computing the path batches, 0 to compute each path on demand
+int PathfinderThreads = 0;
+
+/// Path computed for a unit by the batch
+struct PathRequest {
+	CUnit *Unit;                                  /// unit for the path
+	int Result;                                   /// result of the search
+	char Path[PathFinderOutput::MAX_PATH_LENGTH]; /// directions of the path
+};
+
+static struct {
+	SDL_mutex *Lock;                          /// protects the fields below
+	SDL_cond *WorkCond;                       /// a new batch is available
+	SDL_cond *DoneCond;                       /// a worker has finished its part
+	std::vector<SDL_Thread *> Threads;        /// worker threads
+	std::vector<PathSearchContext *> Contexts; /// one per thread, [0] for the game thread
+	std::vector<PathRequest> *Requests;       /// current batch
+	unsigned int Generation;                  /// incremented for each batch
+	int Pending;                              /// workers still computing the batch
+	bool Running;                             /// workers must exit when false
+} PathPool;
+
 void TerrainTraversal::SetSize(unsigned int width, unsigned int height)
 {
 	m_values.resize((width + 2) * (height + 2));
@@ -151,12 +191,126 @@ void TerrainTraversal::Set(const Vec2i &pos, TerrainTraversal::dataType value)
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Compute the paths of the batch assigned to a context.
+**
+**  Request i is computed by the context i % contexts count, so the
+**  result doesn't depend on the thread scheduling.
+**
+**  @param requests  Paths to compute.
+**  @param index     Index of the context.
+*/
+static void ComputePathRequests(std::vector<PathRequest> &requests, size_t index)
+{
+	PathSearchContext &context = *PathPool.Contexts[index];
+	const size_t step = PathPool.Contexts.size();
+
+	for (size_t i = index; i < requests.size(); i += step) {
+		PathRequest &request = requests[i];
+		const PathFinderInput &input = request.Unit->pathFinderData->input;
+
+		request.Result = context.FindPath(input.GetUnitPos(), input.GetGoalPos(),
+										  input.GetGoalSize().x, input.GetGoalSize().y,
+										  input.GetUnitSize().x, input.GetUnitSize().y,
+										  input.GetMinRange(), input.GetMaxRange(),
+										  request.Path, PathFinderOutput::MAX_PATH_LENGTH,
+										  *request.Unit);
+	}
+}
+
+/**
+**  Path worker thread.
+**
+**  @param data  Index of the context of the thread.
+*/
+static int PathWorkerThread(void *data)
+{
+	const size_t index = (size_t)data;
+	unsigned int generation = 0;
+
+	SDL_LockMutex(PathPool.Lock);
+	while (1) {
+		while (PathPool.Running && PathPool.Generation == generation) {
+			SDL_CondWait(PathPool.WorkCond, PathPool.Lock);
+		}
+		if (!PathPool.Running) {
+			break;
+		}
+		generation = PathPool.Generation;
+		std::vector<PathRequest> &requests = *PathPool.Requests;
+		SDL_UnlockMutex(PathPool.Lock);
+
+		ComputePathRequests(requests, index);
+
+		SDL_LockMutex(PathPool.Lock);
+		if (--PathPool.Pending == 0) {
+			SDL_CondSignal(PathPool.DoneCond);
+		}
+	}
+	SDL_UnlockMutex(PathPool.Lock);
+	return 0;
+}
+
+/**
+**  Create the path search contexts and the worker threads.
+*/
+static void InitPathPool()
+{
+	// The prefetch changes the paths, so it is a game setting. The number
+	// of threads is local, it doesn't change them.
+	if (!GameSettings.PathfinderPrefetch) {
+		return;
+	}
+	const int threads = std::max(PathfinderThreads, 1);
+	for (int i = 0; i < threads; ++i) {
+		PathPool.Contexts.push_back(new PathSearchContext(Map.Info.MapWidth, Map.Info.MapHeight));
+	}
+	PathPool.Lock = SDL_CreateMutex();
+	PathPool.WorkCond = SDL_CreateCond();
+	PathPool.DoneCond = SDL_CreateCond();
+	PathPool.Requests = NULL;
+	PathPool.Generation = 0;
+	PathPool.Pending = 0;
+	PathPool.Running = true;
+	// The game thread uses the first context
+	for (int i = 1; i < threads; ++i) {
+		PathPool.Threads.push_back(SDL_CreateThread(PathWorkerThread, (void *)(size_t)i));
+	}
+}
+
+/**
+**  Stop the worker threads and free the path search contexts.
+*/
+static void FreePathPool()
+{
+	if (PathPool.Contexts.empty()) {
+		return;
+	}
+	SDL_LockMutex(PathPool.Lock);
+	PathPool.Running = false;
+	SDL_CondBroadcast(PathPool.WorkCond);
+	SDL_UnlockMutex(PathPool.Lock);
+	for (size_t i = 0; i != PathPool.Threads.size(); ++i) {
+		SDL_WaitThread(PathPool.Threads[i], NULL);
+	}
+	PathPool.Threads.clear();
+	SDL_DestroyCond(PathPool.DoneCond);
+	SDL_DestroyCond(PathPool.WorkCond);
+	SDL_DestroyMutex(PathPool.Lock);
+	for (size_t i = 0; i != PathPool.Contexts.size(); ++i) {
+		delete PathPool.Contexts[i];
+	}
+	PathPool.Contexts.clear();
+}
+
 /**
 **  Init the pathfinder
 */
 void InitPathfinder()
 {
 	InitAStar(Map.Info.MapWidth, Map.Info.MapHeight);
+	InitHierarchicalPathfinder();
+	InitPathPool();
 }
 
 /**
@@ -164,9 +318,26 @@ void InitPathfinder()
 */
 void FreePathfinder()
 {
+	FreePathPool();
+	FreeHierarchicalPathfinder();
 	FreeAStar();
 }
 
+/**
+**  Find path with the selected pathfinder algorithm.
+*/
+static int FindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					int tilesizex, int tilesizey, int minrange, int maxrange,
+					char *path, int pathlen, const CUnit &unit)
+{
+	if (PathfinderMode == PathfinderModeHierarchical) {
+		return HierarchicalFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+									minrange, maxrange, path, pathlen, unit);
+	}
+	return AStarFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+						 minrange, maxrange, path, pathlen, unit);
+}
+
 /*----------------------------------------------------------------------------
 --  PATH-FINDER USE
 ----------------------------------------------------------------------------*/
@@ -185,9 +356,9 @@ void FreePathfinder()
 */
 int PlaceReachable(const CUnit &src, const Vec2i &goalPos, int w, int h, int minrange, int range)
 {
-	int i = AStarFindPath(src.tilePos, goalPos, w, h,
-						  src.Type->TileWidth, src.Type->TileHeight,
-						  minrange, range, NULL, 0, src);
+	int i = FindPath(src.tilePos, goalPos, w, h,
+					 src.Type->TileWidth, src.Type->TileHeight,
+					 minrange, range, NULL, 0, src);
 
 	switch (i) {
 		case PF_FAILED:
@@ -330,13 +501,13 @@ PathFinderOutput::PathFinderOutput()
 static int NewPath(PathFinderInput &input, PathFinderOutput &output)
 {
 	char *path = output.Path;
-	int i = AStarFindPath(input.GetUnitPos(),
-						  input.GetGoalPos(),
-						  input.GetGoalSize().x, input.GetGoalSize().y,
-						  input.GetUnitSize().x, input.GetUnitSize().y,
-						  input.GetMinRange(), input.GetMaxRange(),
-						  path, PathFinderOutput::MAX_PATH_LENGTH,
-						  *input.GetUnit());
+	int i = FindPath(input.GetUnitPos(),
+					 input.GetGoalPos(),
+					 input.GetGoalSize().x, input.GetGoalSize().y,
+					 input.GetUnitSize().x, input.GetUnitSize().y,
+					 input.GetMinRange(), input.GetMaxRange(),
+					 path, PathFinderOutput::MAX_PATH_LENGTH,
+					 *input.GetUnit());
 	input.PathRacalculated();
 	if (i == PF_FAILED) {
 		i = PF_UNREACHABLE;
@@ -353,6 +524,105 @@ static int NewPath(PathFinderInput &input, PathFinderOutput &output)
 	return i;
 }
 
+/**
+**  Check if the unit will ask for a new path during this cycle.
+*/
+static bool IsPathRequestNeeded(CUnit &unit)
+{
+	if (unit.Destroyed || unit.Removed || unit.CriticalOrder != NULL
+		|| unit.CurrentAction() != UnitActionMove || unit.Orders[0]->Finished) {
+		return false;
+	}
+	if (unit.Wait || unit.Waiting || unit.Moving || unit.Anim.Unbreakable
+		|| (unit.Type->Animations->Move == unit.Anim.CurrAnim && unit.Anim.Wait)) {
+		return false;
+	}
+	PathFinderInput &input = unit.pathFinderData->input;
+	const PathFinderOutput &output = unit.pathFinderData->output;
+
+	unit.CurrentOrder()->UpdatePathFinderData(input);
+	return output.Length <= 0 || input.IsRecalculateNeeded();
+}
+
+/**
+**  Compute the new paths of the moving units before their actions.
+**
+**  The paths are computed by PathfinderThreads contexts, all from the
+**  state of the map at the start of the cycle, and stored in the unit
+**  order, so the result is the same whatever the number of threads.
+**  Only the found paths are stored, NextPathElement computes the other
+**  cases as before.
+**
+**  @param units         Units which will be handled in this cycle, in the
+**                       order of the unit table.
+**  @param tableVersion  Version of the unit table when units was copied.
+*/
+void PathfinderPrefetch(const std::vector<CUnit *> &units, unsigned int tableVersion)
+{
+	// The hierarchical graph is updated during the search
+	if (PathPool.Contexts.empty() || PathfinderMode != PathfinderModeFlat) {
+		return;
+	}
+	std::vector<PathRequest> requests;
+
+	const CUnitHotState &hot = UnitManager.GetHotState();
+	// A unit released since the copy of the table moved the hot state
+	const bool useHot = UnitManager.GetTableVersion() == tableVersion;
+
+	Assert(!useHot || hot.Action.size() == units.size());
+	for (size_t i = 0; i != units.size(); ++i) {
+		// Skip the units which do not move without loading them
+		if (useHot && (hot.Destroyed[i] || hot.Removed[i] || hot.Wait[i] || hot.Action[i] != UnitActionMove)) {
+			continue;
+		}
+		if (IsPathRequestNeeded(*units[i])) {
+			PathRequest request;
+
+			request.Unit = units[i];
+			request.Result = PF_FAILED;
+			requests.push_back(request);
+		}
+	}
+	if (requests.empty()) {
+		return;
+	}
+
+	if (PathPool.Threads.empty() || requests.size() == 1) {
+		for (size_t i = 0; i != PathPool.Contexts.size(); ++i) {
+			ComputePathRequests(requests, i);
+		}
+	} else {
+		SDL_LockMutex(PathPool.Lock);
+		PathPool.Requests = &requests;
+		PathPool.Pending = PathPool.Threads.size();
+		++PathPool.Generation;
+		SDL_CondBroadcast(PathPool.WorkCond);
+		SDL_UnlockMutex(PathPool.Lock);
+
+		ComputePathRequests(requests, 0);
+
+		SDL_LockMutex(PathPool.Lock);
+		while (PathPool.Pending) {
+			SDL_CondWait(PathPool.DoneCond, PathPool.Lock);
+		}
+		PathPool.Requests = NULL;
+		SDL_UnlockMutex(PathPool.Lock);
+	}
+
+	for (size_t i = 0; i != requests.size(); ++i) {
+		const PathRequest &request = requests[i];
+
+		if (request.Result <= 0) {
+			continue;
+		}
+		PathFinderData &data = *request.Unit->pathFinderData;
+
+		memcpy(data.output.Path, request.Path, sizeof(request.Path));
+		data.output.Length = std::min<int>(request.Result, PathFinderOutput::MAX_PATH_LENGTH);
+		data.input.PathRacalculated();
+	}
+}
+
 /**
 **  Returns the next element of a path.
 **
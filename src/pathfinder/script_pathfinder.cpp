@@ -40,6 +40,7 @@
 #include "map.h"
 #include "player.h"
 #include "script.h"
+#include "settings.h"
 #include "unittype.h"
 #include "unit.h"
 
@@ -84,6 +85,11 @@ static int CclAStar(lua_State *l)
 			AStarKnowUnseenTerrain = true;
 		} else if (!strcmp(value, "dont-know-unseen-terrain")) {
 			AStarKnowUnseenTerrain = false;
+		} else if (!strcmp(value, "use-path-cache")) {
+			// Changes the paths, network games and replays carry it
+			GameSettings.PathCache = true;
+		} else if (!strcmp(value, "dont-use-path-cache")) {
+			GameSettings.PathCache = false;
 		} else if (!strcmp(value, "unseen-terrain-cost")) {
 			++j;
 			i = LuaToNumber(l, j + 1);
@@ -101,12 +107,68 @@ static int CclAStar(lua_State *l)
 	return 0;
 }
 
+/**
+**  Select the path finder algorithm.
+**
+**  @param l  Lua state.
+*/
+static int CclSetPathfinderMode(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	const char *value = LuaToString(l, 1);
+	if (!strcmp(value, "flat")) {
+		PathfinderMode = PathfinderModeFlat;
+	} else if (!strcmp(value, "hierarchical")) {
+		PathfinderMode = PathfinderModeHierarchical;
+	} else {
+		LuaError(l, "Unsupported pathfinder mode: %s" _C_ value);
+	}
+	return 0;
+}
+
+/**
+**  Get the path finder algorithm.
+**
+**  @param l  Lua state.
+*/
+static int CclGetPathfinderMode(lua_State *l)
+{
+	LuaCheckArgs(l, 0);
+	lua_pushstring(l, PathfinderMode == PathfinderModeHierarchical ? "hierarchical" : "flat");
+	return 1;
+}
+
+/**
+**  Set the number of threads computing the paths of the moving units.
+**
+**  0 computes each path when the unit needs it. The value is used by
+**  the next game. It sets GameSettings.PathfinderPrefetch, which the
+**  network games take from the server and the replays from their header,
+**  as the prefetch changes the paths.
+**
+**  @param l  Lua state.
+*/
+static int CclSetPathfinderThreads(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	const int threads = LuaToNumber(l, 1);
+	if (threads < 0) {
+		LuaError(l, "Invalid number of pathfinder threads: %d" _C_ threads);
+	}
+	PathfinderThreads = threads;
+	GameSettings.PathfinderPrefetch = threads > 0;
+	return 0;
+}
+
 /**
 **  Register CCL features for pathfinder.
 */
 void PathfinderCclRegister()
 {
 	lua_register(Lua, "AStar", CclAStar);
+	lua_register(Lua, "SetPathfinderMode", CclSetPathfinderMode);
+	lua_register(Lua, "GetPathfinderMode", CclGetPathfinderMode);
+	lua_register(Lua, "SetPathfinderThreads", CclSetPathfinderThreads);
 }
 
 //@}
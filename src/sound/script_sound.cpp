@@ -309,6 +309,26 @@ static int CclDefineGameSounds(lua_State *l)
 	return 0;
 }
 
+/**
+**  Measure the mixer with many channels playing at the same time.
+**
+**  @param l  Lua state.
+*/
+static int CclBenchmarkMixer(lua_State *l)
+{
+	const int args = lua_gettop(l);
+	if (args > 2) {
+		LuaError(l, "incorrect argument");
+	}
+	const int channels = args > 0 ? LuaToNumber(l, 1) : 64;
+	const int iterations = args > 1 ? LuaToNumber(l, 2) : 1000;
+	if (channels < 0 || iterations < 0) {
+		LuaError(l, "incorrect argument");
+	}
+	PrintMixerBenchmark(stdout, channels, iterations);
+	return 0;
+}
+
 /**
 **  Set the cut off distance.
 **
@@ -359,6 +379,7 @@ void SoundCclRegister()
 	lua_register(Lua, "MakeSound", CclMakeSound);
 	lua_register(Lua, "MakeSoundGroup", CclMakeSoundGroup);
 	lua_register(Lua, "PlaySound", CclPlaySound);
+	lua_register(Lua, "BenchmarkMixer", CclBenchmarkMixer);
 }
 
 //@}
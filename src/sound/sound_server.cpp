@@ -49,6 +49,20 @@
 
 #include "SDL.h"
 
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_SSE2
+#define MIXER_KERNEL "sse2"
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIXER_NEON
+#define MIXER_KERNEL "neon"
+#else
+#define MIXER_KERNEL "scalar"
+#endif
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
@@ -103,6 +117,177 @@ static struct {
 --  Mixers
 ----------------------------------------------------------------------------*/
 
+/// Output format of the mixer, the samples in memory are converted to it
+#define MIXER_FREQUENCY 44100
+
+/**
+**  Add stereo 16 bit values scaled by the gain of each side to the mix,
+**  one value at a time.
+**
+**  @param mix        signed 32 bit mix.
+**  @param src        stereo 16 bit values, left first.
+**  @param size       number of values, even.
+**  @param leftGain   gain of the left values, 65536 is 1.
+**  @param rightGain  gain of the right values, 65536 is 1.
+*/
+static void MixStereo16Scalar(int *mix, const short *src, int size, int leftGain, int rightGain)
+{
+	for (int i = 0; i < size; i += 2) {
+		mix[i] += (src[i] * leftGain) >> 16;
+		mix[i + 1] += (src[i + 1] * rightGain) >> 16;
+	}
+}
+
+/**
+**  Clip mix to output stereo 16 signed bit, one value at a time.
+**
+**  @param mix     signed 32 bit input.
+**  @param size    number of samples in input.
+**  @param output  clipped 16 signed bit output buffer.
+*/
+static void ClipMixToStereo16Scalar(const int *mix, int size, short *output)
+{
+	const int *end = mix + size;
+
+	while (mix < end) {
+		int s = (*mix++);
+		clamp(&s, SHRT_MIN, SHRT_MAX);
+		*output++ = s;
+	}
+}
+
+/**
+**  Add stereo 16 bit values scaled by the gain of each side to the mix.
+**
+**  Eight values are scaled and added at a time with SSE2 or NEON, the
+**  rest one at a time. The result is the same as MixStereo16Scalar.
+**
+**  @param mix        signed 32 bit mix.
+**  @param src        stereo 16 bit values, left first.
+**  @param size       number of values, even.
+**  @param leftGain   gain of the left values, 65536 is 1.
+**  @param rightGain  gain of the right values, 65536 is 1.
+*/
+static void MixStereo16(int *mix, const short *src, int size, int leftGain, int rightGain)
+{
+	int i = 0;
+
+#if defined(MIXER_SSE2)
+	// the high half of the signed product is the product >> 16
+	const __m128i gain = _mm_set_epi16(rightGain, leftGain, rightGain, leftGain,
+									   rightGain, leftGain, rightGain, leftGain);
+	for (; i + 8 <= size; i += 8) {
+		const __m128i values = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i scaled = _mm_mulhi_epi16(values, gain);
+		// sign extend to 32 bits
+		const __m128i first = _mm_srai_epi32(_mm_unpacklo_epi16(scaled, scaled), 16);
+		const __m128i second = _mm_srai_epi32(_mm_unpackhi_epi16(scaled, scaled), 16);
+		__m128i *dst = (__m128i *)(mix + i);
+
+		_mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), first));
+		_mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), second));
+	}
+#elif defined(MIXER_NEON)
+	const int16_t gains[4] = {(int16_t)leftGain, (int16_t)rightGain, (int16_t)leftGain, (int16_t)rightGain};
+	const int16x4_t gain = vld1_s16(gains);
+	for (; i + 8 <= size; i += 8) {
+		const int16x8_t values = vld1q_s16(src + i);
+		const int32x4_t first = vshrq_n_s32(vmull_s16(vget_low_s16(values), gain), 16);
+		const int32x4_t second = vshrq_n_s32(vmull_s16(vget_high_s16(values), gain), 16);
+
+		vst1q_s32(mix + i, vaddq_s32(vld1q_s32(mix + i), first));
+		vst1q_s32(mix + i + 4, vaddq_s32(vld1q_s32(mix + i + 4), second));
+	}
+#endif
+	MixStereo16Scalar(mix + i, src + i, size - i, leftGain, rightGain);
+}
+
+/**
+**  Clip mix to output stereo 16 signed bit.
+**
+**  Eight values are clipped at a time with the saturating packs of SSE2
+**  or NEON, the rest one at a time.
+**
+**  @param mix     signed 32 bit input.
+**  @param size    number of samples in input.
+**  @param output  clipped 16 signed bit output buffer.
+*/
+static void ClipMixToStereo16(const int *mix, int size, short *output)
+{
+	int i = 0;
+
+#if defined(MIXER_SSE2)
+	for (; i + 8 <= size; i += 8) {
+		const __m128i first = _mm_loadu_si128((const __m128i *)(mix + i));
+		const __m128i second = _mm_loadu_si128((const __m128i *)(mix + i + 4));
+
+		_mm_storeu_si128((__m128i *)(output + i), _mm_packs_epi32(first, second));
+	}
+#elif defined(MIXER_NEON)
+	for (; i + 8 <= size; i += 8) {
+		const int16x4_t first = vqmovn_s32(vld1q_s32(mix + i));
+		const int16x4_t second = vqmovn_s32(vld1q_s32(mix + i + 4));
+
+		vst1q_s16(output + i, vcombine_s16(first, second));
+	}
+#endif
+	ClipMixToStereo16Scalar(mix + i, size - i, output + i);
+}
+
+/**
+**  Gain of a channel side for MixStereo16.
+**
+**  @param volume  volume of the channel, already scaled by the effects volume.
+**  @param side    volume of the side, 128 is the full volume.
+*/
+static int MixerGain(int volume, int side)
+{
+	// FIXME: why taking out '/ 2' leads to distortion
+	return std::min(volume * side * 65536 / 128 / MaxVolume / 2, SHRT_MAX);
+}
+
+/**
+**  Check if a sample is in the output format of the mixer.
+*/
+static bool IsMixerFormat(const CSample &sample)
+{
+	return sample.Frequency == MIXER_FREQUENCY && sample.Channels == 2 && sample.SampleSize == 16;
+}
+
+/**
+**  Convert a sample loaded in memory to the output format of the mixer,
+**  44100 hz, stereo, 16 bits per channel. This is done once, the first
+**  time the sample is played, so the mixer only scales and adds its values.
+**  The converted sample takes up to 8 times more memory (from 22050 hz,
+**  mono, 8 bits), so the samples which are never played stay as loaded.
+**
+**  @param sample  Sample loaded in memory, not in the format of the mixer.
+*/
+static void ConvertSampleToMixerFormat(CSample &sample)
+{
+	const Uint16 format = sample.SampleSize == 8 ? AUDIO_U8 : AUDIO_S16SYS;
+	SDL_AudioCVT acvt;
+
+	if (SDL_BuildAudioCVT(&acvt, format, sample.Channels, sample.Frequency,
+						  AUDIO_S16SYS, 2, MIXER_FREQUENCY) < 0) {
+		fprintf(stderr, "Can't convert the sound: %s\n", SDL_GetError());
+		return;
+	}
+	unsigned char *buffer = new unsigned char[sample.Len * acvt.len_mult];
+	memcpy(buffer, sample.Buffer, sample.Len);
+	acvt.buf = buffer;
+	acvt.len = sample.Len;
+	SDL_ConvertAudio(&acvt);
+
+	delete[] sample.Buffer;
+	sample.Buffer = buffer;
+	sample.Len = acvt.len_cvt & ~3; // whole stereo frames
+	sample.Frequency = MIXER_FREQUENCY;
+	sample.Channels = 2;
+	sample.SampleSize = 16;
+	sample.BitsPerSample = 16;
+}
+
 /**
 **  Convert RAW sound data to 44100 hz, Stereo, 16 bits per channel
 **
@@ -186,8 +371,8 @@ static void MixMusicToStereo32(int *buffer, int size)
 /**
 **  Mix sample to buffer.
 **
-**  The input samples are adjusted by the local volume and resampled
-**  to the output frequence.
+**  The input samples are in the output format, they are only adjusted
+**  by the local volume.
 **
 **  @param sample  Input sample
 **  @param index   Position into input sample
@@ -197,17 +382,14 @@ static void MixMusicToStereo32(int *buffer, int size)
 **  @param size    Size of output buffer (in samples per channel)
 **
 **  @return        The number of bytes used to fill buffer
-**
-**  @todo          Can mix faster if signed 8 bit buffers are used.
 */
 static int MixSampleToStereo32(CSample *sample, int index, unsigned char volume,
 							   char stereo, int *buffer, int size)
 {
-	static int buf[SOUND_BUFFER_SIZE / 2];
 	unsigned char left;
 	unsigned char right;
 
-	int div = 176400 / (sample->Frequency * (sample->SampleSize / 8) * sample->Channels);
+	Assert(IsMixerFormat(*sample));
 	int local_volume = (int)volume * EffectsVolume / MaxVolume;
 
 	if (stereo < 0) {
@@ -218,22 +400,13 @@ static int MixSampleToStereo32(CSample *sample, int index, unsigned char volume,
 		right = 128;
 	}
 
-	Assert(!(index & 1));
-
-	size = std::min((sample->Len - index) * div / 2, size);
+	Assert(!(index & 3));
 
-	size = ConvertToStereo32((char *)(sample->Buffer + index), (char *)buf, sample->Frequency,
-							 sample->SampleSize / 8, sample->Channels,
-							 size * 2 / div);
+	size = std::min((sample->Len - index) / 2, size) & ~1;
+	MixStereo16(buffer, (const short *)(sample->Buffer + index), size,
+				MixerGain(local_volume, left), MixerGain(local_volume, right));
 
-	size /= 2;
-	for (int i = 0; i < size; i += 2) {
-		// FIXME: why taking out '/ 2' leads to distortion
-		buffer[i] += ((short *)buf)[i] * local_volume * left / 128 / MaxVolume / 2;
-		buffer[i + 1] += ((short *)buf)[i + 1] * local_volume * right / 128 / MaxVolume / 2;
-	}
-
-	return 2 * size / div;
+	return 2 * size;
 }
 
 /**
@@ -265,24 +438,6 @@ static int MixChannelsToStereo32(int *buffer, int size)
 	return new_free_channels;
 }
 
-/**
-**  Clip mix to output stereo 16 signed bit.
-**
-**  @param mix     signed 32 bit input.
-**  @param size    number of samples in input.
-**  @param output  clipped 16 signed bit output buffer.
-*/
-static void ClipMixToStereo16(const int *mix, int size, short *output)
-{
-	const int *end = mix + size;
-
-	while (mix < end) {
-		int s = (*mix++);
-		clamp(&s, SHRT_MIN, SHRT_MAX);
-		*output++ = s;
-	}
-}
-
 /**
 **  Mix into buffer.
 **
@@ -353,6 +508,64 @@ static int FillThread(void *)
 	return 0;
 }
 
+/**
+**  Measure the mixing kernels: mix channels playing at the same time
+**  into a buffer of 4096 stereo frames and clip it, as the fill thread
+**  does, with the scalar kernel and with the vectorized one.
+**
+**  @param file        Where to print the results.
+**  @param channels    Number of channels to mix.
+**  @param iterations  Number of buffers to fill.
+*/
+void PrintMixerBenchmark(FILE *file, int channels, int iterations)
+{
+	const int frames = 4096;
+	const int size = frames * 2;
+	std::vector<short> values(size);
+	std::vector<int> leftGains(channels);
+	std::vector<int> rightGains(channels);
+	std::vector<int> mix(size);
+	std::vector<short> outputs[2];
+
+	// noise, and channels spread from left to right
+	unsigned int seed = 1;
+	for (int i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		values[i] = (short)(seed >> 16);
+	}
+	for (int channel = 0; channel < channels; ++channel) {
+		const int stereo = channel * 255 / std::max(channels - 1, 1) - 128;
+		leftGains[channel] = MixerGain(MaxVolume, stereo < 0 ? 128 : 128 - stereo);
+		rightGains[channel] = MixerGain(MaxVolume, stereo < 0 ? 128 + stereo : 128);
+	}
+
+	const struct {
+		const char *Name;
+		void (*Mix)(int *, const short *, int, int, int);
+		void (*Clip)(const int *, int, short *);
+	} kernels[] = {
+		{"scalar", MixStereo16Scalar, ClipMixToStereo16Scalar},
+		{MIXER_KERNEL, MixStereo16, ClipMixToStereo16}
+	};
+	for (int k = 0; k < 2; ++k) {
+		outputs[k].resize(size);
+		const clock_t start = clock();
+		for (int i = 0; i < iterations; ++i) {
+			memset(&mix[0], 0, size * sizeof(int));
+			for (int channel = 0; channel < channels; ++channel) {
+				kernels[k].Mix(&mix[0], &values[0], size, leftGains[channel], rightGains[channel]);
+			}
+			kernels[k].Clip(&mix[0], size, &outputs[k][0]);
+		}
+		const double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+		fprintf(file, "%-6s mixer, %d channels: %.2f ns per frame\n", kernels[k].Name, channels,
+				seconds * 1e9 / (double(iterations) * frames));
+	}
+	if (outputs[0] != outputs[1]) {
+		fprintf(file, "The " MIXER_KERNEL " mixer does not give the same output as the scalar one\n");
+	}
+}
+
 /*----------------------------------------------------------------------------
 --  Effects
 ----------------------------------------------------------------------------*/
@@ -579,6 +792,10 @@ CSample *LoadSample(const std::string &name)
 
 	if (sample == NULL) {
 		fprintf(stderr, "Can't load the sound '%s'\n", name.c_str());
+		return NULL;
+	}
+	if (IsMixerFormat(*sample)) {
+		sample->Len &= ~3; // whole stereo frames
 	}
 	return sample;
 }
@@ -594,6 +811,13 @@ int PlaySample(CSample *sample, Origin *origin)
 {
 	int channel = -1;
 
+	if (sample && !IsMixerFormat(*sample)) {
+		// Not mixed yet, so no channel uses it
+		ConvertSampleToMixerFormat(*sample);
+		if (!IsMixerFormat(*sample)) {
+			return -1;
+		}
+	}
 	SDL_LockMutex(Audio.Lock);
 	if (SoundEnabled() && EffectsEnabled && sample && NextFreeChannel != MaxChannels) {
 		channel = FillChannel(sample, EffectsVolume, 0, origin);
@@ -36,6 +36,7 @@
 
 #include "script.h"
 #include "unit.h"
+#include "unit_manager.h"
 
 
 /* virtual */ void Spell_AdjustVariable::Parse(lua_State *l, int startIndex, int endIndex)
@@ -150,6 +151,7 @@
 		unit->Variable[i].Value += this->Var[i].IncreaseTime * unit->Variable[i].Increase;
 
 		clamp(&unit->Variable[i].Value, 0, unit->Variable[i].Max);
+		UnitManager.UpdateHotState(*unit);
 	}
 	return 1;
 }
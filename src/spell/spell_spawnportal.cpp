@@ -36,6 +36,7 @@
 
 #include "script.h"
 #include "unit.h"
+#include "unit_manager.h"
 
 /* virtual */ void Spell_SpawnPortal::Parse(lua_State *l, int startIndex, int endIndex)
 {
@@ -88,6 +89,7 @@
 		portal->Summoned = 1;
 	}
 	portal->TTL = GameCycle + this->TTL;
+	UnitManager.UpdateHotState(*portal, false);
 	//  Goal is used to link to destination circle of power
 	caster.Goal = portal;
 	//FIXME: setting destination circle of power should use mana
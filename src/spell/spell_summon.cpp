@@ -43,6 +43,7 @@
 #include "script.h"
 #include "unit.h"
 #include "unit_find.h"
+#include "unit_manager.h"
 
 /* virtual */ void Spell_Summon::Parse(lua_State *l, int startIndex, int endIndex)
 {
@@ -137,6 +138,7 @@ public:
 			//
 			if (ttl) {
 				target->TTL = GameCycle + ttl;
+				UnitManager.UpdateHotState(*target, false);
 			}
 
 			// Insert summoned unit to AI force so it will help them in battle
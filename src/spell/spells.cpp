@@ -52,6 +52,7 @@
 #include "sound.h"
 #include "unit.h"
 #include "unit_find.h"
+#include "unit_manager.h"
 #include "upgrade.h"
 
 /*----------------------------------------------------------------------------
@@ -548,6 +549,7 @@ int SpellCast(CUnit &caster, const SpellType &spell, CUnit *target, const Vec2i
 		}
 		caster.Player->SubCosts(spell.Costs);
 		caster.SpellCoolDownTimers[spell.Slot] = spell.CoolDown;
+		UnitManager.UpdateHotState(caster);
 		//
 		// Spells like blizzard are casted again.
 		// This is sort of confusing, we do the test again, to
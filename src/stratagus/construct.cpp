@@ -128,11 +128,23 @@ void InitConstructions()
 */
 void LoadConstructions()
 {
+	std::vector<std::string> files;
+
+	for (std::vector<CConstruction *>::iterator it = Constructions.begin();
+		 it != Constructions.end();
+		 ++it) {
+		if (!(*it)->Ident.empty()) {
+			files.push_back((*it)->File.File);
+			files.push_back((*it)->ShadowFile.File);
+		}
+	}
+	PreloadGraphics(files);
 	for (std::vector<CConstruction *>::iterator it = Constructions.begin();
 		 it != Constructions.end();
 		 ++it) {
 		(*it)->Load();
 	}
+	FreePreloadedGraphics();
 }
 
 /**
@@ -44,8 +44,10 @@
 #include "parameters.h"
 #include "util.h"
 
+#include <chrono>
 #include <stdarg.h>
 #include <stdio.h>
+#include <unordered_set>
 
 #ifdef USE_ZLIB
 #include <zlib.h>
@@ -62,6 +64,7 @@ public:
 	~PImpl();
 
 	int open(const char *name, long flags);
+	int openBuffer(std::string &buffer);
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
@@ -76,6 +79,7 @@ private:
 private:
 	int   cl_type;   /// type of CFile
 	FILE *cl_plain;  /// standard file pointer
+	std::string *cl_buffer; /// memory buffer
 #ifdef USE_ZLIB
 	gzFile cl_gz;    /// gzip file pointer
 #endif // !USE_ZLIB
@@ -107,6 +111,16 @@ int CFile::open(const char *name, long flags)
 	return pimpl->open(name, flags);
 }
 
+/**
+**  Open a memory buffer for writing, the data is appended to it.
+**
+**  @param buffer  Buffer to fill.
+*/
+int CFile::openBuffer(std::string &buffer)
+{
+	return pimpl->openBuffer(buffer);
+}
+
 /**
 **  CLclose Library file close
 */
@@ -131,6 +145,17 @@ int CFile::read(void *buf, size_t len)
 	return pimpl->read(buf, len);
 }
 
+/**
+**  CLwrite Library file write
+**
+**  @param buf  Pointer to the data to write.
+**  @param len  number of bytes to write.
+*/
+int CFile::write(const void *buf, size_t len)
+{
+	return pimpl->write(buf, len);
+}
+
 /**
 **  CLseek Library file seek
 **
@@ -291,6 +316,9 @@ int CFile::PImpl::open(const char *name, long openflags)
 				if ((cl_plain = fopen(name, openstring))) {
 					cl_type = CLF_TYPE_PLAIN;
 				}
+		if (cl_type != CLF_TYPE_INVALID) {
+			NoteFileWritten(cl_type == CLF_TYPE_PLAIN ? name : buf);
+		}
 	} else {
 		if (!(cl_plain = fopen(name, openstring))) { // try plain first
 #ifdef USE_ZLIB
@@ -347,6 +375,13 @@ int CFile::PImpl::open(const char *name, long openflags)
 	return 0;
 }
 
+int CFile::PImpl::openBuffer(std::string &buffer)
+{
+	cl_buffer = &buffer;
+	cl_type = CLF_TYPE_BUFFER;
+	return 0;
+}
+
 int CFile::PImpl::close()
 {
 	int ret = EOF;
@@ -367,6 +402,10 @@ int CFile::PImpl::close()
 			ret = 0;
 		}
 #endif // USE_BZ2LIB
+		if (tp == CLF_TYPE_BUFFER) {
+			cl_buffer = NULL;
+			ret = 0;
+		}
 	} else {
 		errno = EBADF;
 	}
@@ -438,6 +477,10 @@ int CFile::PImpl::write(const void *buf, size_t size)
 			ret = BZ2_bzwrite(cl_bz, const_cast<void *>(buf), size);
 		}
 #endif // USE_BZ2LIB
+		if (tp == CLF_TYPE_BUFFER) {
+			cl_buffer->append(static_cast<const char *>(buf), size);
+			ret = size;
+		}
 	} else {
 		errno = EBADF;
 	}
@@ -490,6 +533,9 @@ long CFile::PImpl::tell()
 			ret = -1;
 		}
 #endif // USE_BZ2LIB
+		if (tp == CLF_TYPE_BUFFER) {
+			ret = cl_buffer->size();
+		}
 	} else {
 		errno = EBADF;
 	}
@@ -497,6 +543,231 @@ long CFile::PImpl::tell()
 }
 
 
+/*----------------------------------------------------------------------------
+--  Index of the data files
+----------------------------------------------------------------------------*/
+
+/**
+**  Index of the files of the data directory.
+**
+**  The data directory is scanned once, then the searches of the library
+**  files in it are answered without access() calls. The directories are
+**  indexed with and without a final '/', as access() finds them too. The
+**  files written and removed by the engine are noted with NoteFileWritten
+**  and NoteFileRemoved, the changes of the data directory by other
+**  programs while the game runs are not seen.
+*/
+static struct {
+	bool Disabled;                          /// use access() for all the searches
+	bool Built;                             /// the data directory has been scanned
+	bool CurrentDirIsRoot;                  /// the relative paths are in the data directory
+	std::string LibPath;                    /// StratagusLibPath when scanned
+	std::string Root;                       /// data directory, with a final '/'
+	std::unordered_set<std::string> Files;  /// paths of the files and directories relative to Root
+
+	unsigned long Lookups;                  /// calls of LibraryFileName
+	unsigned long IndexHits;                /// files found in the index
+	unsigned long AccessCalls;              /// access() calls of the searches
+	unsigned long ScannedDirs;              /// directories read by the scan
+	double LookupTime;                      /// time spent in LibraryFileName, in ms
+	double ScanTime;                        /// time spent to scan, in ms
+} FileIndex;
+
+static const int FileIndexMaxDepth = 16; /// Stop at symbolic link loops
+
+/// Get a time in ms for the statistics
+static double GetFileIndexTime()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+**  Add a directory to the index, with and without a final '/'.
+**
+**  @param rel  Path of the directory relative to the root, without a final '/'.
+*/
+static void AddFileIndexDirectory(const std::string &rel)
+{
+	FileIndex.Files.insert(rel);
+	FileIndex.Files.insert(rel + "/");
+}
+
+#ifndef USE_WIN32
+/**
+**  Add the files of a directory and its subdirectories to the index.
+**
+**  @param dir    Path of the directory, with a final '/'.
+**  @param rel    Path of the directory relative to the root.
+**  @param depth  Depth of the directory.
+*/
+static void ScanFileIndexDirectory(const std::string &dir, const std::string &rel, int depth)
+{
+	DIR *dirp = opendir(dir.c_str());
+	if (dirp == NULL) {
+		return;
+	}
+	++FileIndex.ScannedDirs;
+	struct dirent *dp;
+	while ((dp = readdir(dirp)) != NULL) {
+		const char *name = dp->d_name;
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+			continue;
+		}
+		bool isDir = false;
+#ifdef _DIRENT_HAVE_D_TYPE
+		if (dp->d_type == DT_DIR) {
+			isDir = true;
+		} else if (dp->d_type == DT_UNKNOWN || dp->d_type == DT_LNK) {
+#endif
+			struct stat st;
+			isDir = !stat((dir + name).c_str(), &st) && S_ISDIR(st.st_mode);
+#ifdef _DIRENT_HAVE_D_TYPE
+		}
+#endif
+		if (isDir) {
+			AddFileIndexDirectory(rel + name);
+			if (depth < FileIndexMaxDepth) {
+				ScanFileIndexDirectory(dir + name + "/", rel + name + "/", depth + 1);
+			}
+		} else {
+			FileIndex.Files.insert(rel + name);
+		}
+	}
+	closedir(dirp);
+}
+#endif
+
+/**
+**  Scan the data directory if it isn't done.
+*/
+static void BuildFileIndex()
+{
+	if (FileIndex.Built && FileIndex.LibPath == StratagusLibPath) {
+		return;
+	}
+	const double start = GetFileIndexTime();
+
+	FileIndex.Built = true;
+	FileIndex.LibPath = StratagusLibPath;
+	FileIndex.Root = StratagusLibPath + "/";
+	FileIndex.Files.clear();
+	FileIndex.CurrentDirIsRoot = false;
+#ifndef USE_WIN32
+	ScanFileIndexDirectory(FileIndex.Root, "", 0);
+
+	char root[PATH_MAX];
+	char current[PATH_MAX];
+	if (realpath(StratagusLibPath.c_str(), root) && realpath(".", current)) {
+		FileIndex.CurrentDirIsRoot = !strcmp(root, current);
+	}
+#endif
+	FileIndex.ScanTime += GetFileIndexTime() - start;
+}
+
+/**
+**  Get the path of a file relative to the indexed data directory.
+**
+**  @param file  Path of the file.
+**
+**  @return the relative path, or NULL if the file isn't in the index.
+*/
+static const char *GetFileIndexPath(const char *file)
+{
+#ifdef USE_WIN32
+	// Case insensitive names, not indexed
+	return NULL;
+#else
+	if (FileIndex.Disabled || StratagusLibPath.empty()) {
+		return NULL;
+	}
+	BuildFileIndex();
+
+	const char *rel = NULL;
+	if (!strncmp(file, FileIndex.Root.c_str(), FileIndex.Root.size())) {
+		rel = file + FileIndex.Root.size();
+	} else if (FileIndex.CurrentDirIsRoot && file[0] != '/') {
+		rel = file;
+	} else {
+		return NULL;
+	}
+	// The paths with . and .. or empty components aren't normalized
+	if (!strncmp(rel, "./", 2) || !strncmp(rel, "../", 3)
+		|| strstr(rel, "/./") || strstr(rel, "/../") || strstr(rel, "//")) {
+		return NULL;
+	}
+	return rel;
+#endif
+}
+
+/**
+**  Note that the engine has written a file, so it is found in the index.
+**
+**  @param filename  Path of the file written.
+*/
+void NoteFileWritten(const char *filename)
+{
+	if (!FileIndex.Built || FileIndex.Disabled) {
+		return;
+	}
+	const char *rel = GetFileIndexPath(filename);
+	if (rel == NULL) {
+		return;
+	}
+	FileIndex.Files.insert(rel);
+	// The file may be in a new directory
+	const std::string path(rel);
+	for (size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+		AddFileIndexDirectory(path.substr(0, pos));
+	}
+}
+
+/**
+**  Note that the engine has removed a file, so it isn't found in the index.
+**
+**  @param filename  Path of the file removed.
+*/
+void NoteFileRemoved(const char *filename)
+{
+	if (!FileIndex.Built || FileIndex.Disabled) {
+		return;
+	}
+	const char *rel = GetFileIndexPath(filename);
+	if (rel != NULL) {
+		FileIndex.Files.erase(rel);
+	}
+}
+
+/**
+**  Enable or disable the index of the data files.
+**
+**  @param enabled  false to search the files with access().
+*/
+void SetFileIndexEnabled(bool enabled)
+{
+	FileIndex.Disabled = !enabled;
+	if (!enabled) {
+		FileIndex.Built = false;
+		std::unordered_set<std::string>().swap(FileIndex.Files);
+	}
+}
+
+/**
+**  Print the statistics of the searches of the library files.
+**
+**  Run the game with and without the index to compare the syscalls and
+**  the time of the startup.
+**
+**  @param file  Output file.
+*/
+void PrintFileLookupStatistics(FILE *file)
+{
+	fprintf(file, "File index: %s, %u files, %lu directories scanned in %.2f ms\n",
+			FileIndex.Disabled ? "disabled" : "enabled", (unsigned int)FileIndex.Files.size(),
+			FileIndex.ScannedDirs, FileIndex.ScanTime);
+	fprintf(file, "File lookups: %lu, %lu found in the index, %lu access() calls, %.2f ms\n",
+			FileIndex.Lookups, FileIndex.IndexHits, FileIndex.AccessCalls, FileIndex.LookupTime);
+}
+
 /**
 **  Find a file with its correct extension ("", ".gz" or ".bz2")
 **
@@ -508,6 +779,31 @@ long CFile::PImpl::tell()
 */
 static bool FindFileWithExtension(char(&file)[PATH_MAX])
 {
+	const char *rel = GetFileIndexPath(file);
+	if (rel != NULL) {
+		std::string name(rel);
+		if (FileIndex.Files.count(name)) {
+			++FileIndex.IndexHits;
+			return true;
+		}
+#ifdef USE_ZLIB
+		if (FileIndex.Files.count(name + ".gz")) {
+			++FileIndex.IndexHits;
+			strcat_s(file, PATH_MAX, ".gz");
+			return true;
+		}
+#endif
+#ifdef USE_BZ2LIB
+		if (FileIndex.Files.count(name + ".bz2")) {
+			++FileIndex.IndexHits;
+			strcat_s(file, PATH_MAX, ".bz2");
+			return true;
+		}
+#endif
+		return false;
+	}
+
+	++FileIndex.AccessCalls;
 	if (!access(file, R_OK)) {
 		return true;
 	}
@@ -516,6 +812,7 @@ static bool FindFileWithExtension(char(&file)[PATH_MAX])
 #endif
 #ifdef USE_ZLIB // gzip or bzip2 in global shared directory
 	sprintf(buf, "%s.gz", file);
+	++FileIndex.AccessCalls;
 	if (!access(buf, R_OK)) {
 		strcpy_s(file, PATH_MAX, buf);
 		return true;
@@ -523,6 +820,7 @@ static bool FindFileWithExtension(char(&file)[PATH_MAX])
 #endif
 #ifdef USE_BZ2LIB
 	sprintf(buf, "%s.bz2", file);
+	++FileIndex.AccessCalls;
 	if (!access(buf, R_OK)) {
 		strcpy_s(file, PATH_MAX, buf);
 		return true;
@@ -631,8 +929,11 @@ static void LibraryFileName(const char *file, char(&buffer)[PATH_MAX])
 
 extern std::string LibraryFileName(const char *file)
 {
+	const double start = GetFileIndexTime();
 	char buffer[PATH_MAX];
 	LibraryFileName(file, buffer);
+	++FileIndex.Lookups;
+	FileIndex.LookupTime += GetFileIndexTime() - start;
 	return buffer;
 }
 
@@ -786,11 +1087,15 @@ public:
 */
 FileWriter *CreateFileWriter(const std::string &filename)
 {
+	FileWriter *writer;
+
 	if (strcasestr(filename.c_str(), ".gz")) {
-		return new GzFileWriter(filename);
+		writer = new GzFileWriter(filename);
 	} else {
-		return new RawFileWriter(filename);
+		writer = new RawFileWriter(filename);
 	}
+	NoteFileWritten(filename.c_str());
+	return writer;
 }
 
 //@}
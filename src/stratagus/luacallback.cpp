@@ -33,6 +33,7 @@
 
 #include "luacallback.h"
 
+#include "profiler.h"
 #include "script.h"
 
 /**
@@ -145,6 +146,7 @@ int LuaCallback::popInteger()
 */
 void LuaCallback::run(int results)
 {
+	PROFILE_ZONE("LuaCallback");
 	//FIXME call error reporting function
 	int status = lua_pcall(luastate, arguments, results, base);
 
@@ -42,6 +42,7 @@
 #include "missile.h"
 #include "network.h"
 #include "particle.h"
+#include "profiler.h"
 #include "replay.h"
 #include "results.h"
 #include "sound.h"
@@ -54,6 +55,10 @@
 #include <guichan.h>
 void DrawGuichanWidgets();
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
 //----------------------------------------------------------------------------
 // Variables
 //----------------------------------------------------------------------------
@@ -67,6 +72,31 @@ int MouseScrollState = ScrollNone;
 EventCallback GameCallbacks;   /// Game callbacks
 EventCallback EditorCallbacks; /// Editor callbacks
 
+/// Parts of the game cycle timed in headless mode
+enum HeadlessSubsystem {
+	HeadlessTriggers,
+	HeadlessUnits,
+	HeadlessMissiles,
+	HeadlessPlayers,
+	HeadlessAi,
+	HeadlessOther,
+	HeadlessSubsystemMax
+};
+
+/// Names of the timed parts, as printed in the headless report
+static const char *const HeadlessSubsystemNames[HeadlessSubsystemMax] = {
+	"TriggersEachCycle",
+	"UnitActions",
+	"MissileActions",
+	"PlayersEachCycle",
+	"AI (PlayersEachSecond)",
+	"Other"
+};
+
+static unsigned long long HeadlessTime[HeadlessSubsystemMax]; /// Nanoseconds spent in each part
+static unsigned long long HeadlessLapStart;                   /// Start of the part being timed
+static std::vector<unsigned long long> HeadlessCycleTimes;    /// Nanoseconds of each cycle
+
 //----------------------------------------------------------------------------
 // Functions
 //----------------------------------------------------------------------------
@@ -168,6 +198,8 @@ void DrawMapArea()
 */
 void UpdateDisplay()
 {
+	PROFILE_ZONE("UpdateDisplay");
+
 	if (GameRunning || Editor.Running == EditorEditing) {
 		// to prevent empty spaces in the UI
 #if defined(USE_OPENGL) || defined(USE_GLES)
@@ -213,6 +245,8 @@ void UpdateDisplay()
 
 	DrawGuichanWidgets();
 
+	DrawProfilerOverlay();
+
 	if (CursorState != CursorStateRectangle) {
 		DrawCursor();
 	}
@@ -223,6 +257,31 @@ void UpdateDisplay()
 	Invalidate();
 }
 
+/**
+**  Get a monotonic time for the headless timings.
+**
+**  @return  Time in nanoseconds.
+*/
+static unsigned long long HeadlessNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+**  Charge the time since the last lap to a part of the game cycle.
+**  Does nothing outside of the headless mode.
+**
+**  @param subsystem  Part of the game cycle which just ran.
+*/
+static inline void HeadlessLap(HeadlessSubsystem subsystem)
+{
+	if (HeadlessCycles) {
+		const unsigned long long now = HeadlessNow();
+		HeadlessTime[subsystem] += now - HeadlessLapStart;
+		HeadlessLapStart = now;
+	}
+}
+
 static void InitGameCallbacks()
 {
 	GameCallbacks.ButtonPressed = HandleButtonDown;
@@ -249,10 +308,15 @@ static void GameLogicLoop()
 		++GameCycle;
 		MultiPlayerReplayEachCycle();
 		NetworkCommands(); // Get network commands
+		HeadlessLap(HeadlessOther);
 		TriggersEachCycle();// handle triggers
+		HeadlessLap(HeadlessTriggers);
 		UnitActions();      // handle units
+		HeadlessLap(HeadlessUnits);
 		MissileActions();   // handle missiles
+		HeadlessLap(HeadlessMissiles);
 		PlayersEachCycle(); // handle players
+		HeadlessLap(HeadlessPlayers);
 		UpdateTimer();      // update game timer
 
 
@@ -269,9 +333,11 @@ static void GameLogicLoop()
 		switch (GameCycle % CYCLES_PER_SECOND) {
 			case 0: // At cycle 0, start all ai players...
 				if (GameCycle == 0) {
+					HeadlessLap(HeadlessOther);
 					for (int player = 0; player < NumPlayers; ++player) {
 						PlayersEachSecond(player);
 					}
+					HeadlessLap(HeadlessAi);
 				}
 				break;
 			case 1:
@@ -294,23 +360,27 @@ static void GameLogicLoop()
 				int player = (GameCycle % CYCLES_PER_SECOND) - 7;
 				Assert(player >= 0);
 				if (player < NumPlayers) {
+					HeadlessLap(HeadlessOther);
 					PlayersEachSecond(player);
+					HeadlessLap(HeadlessAi);
 				}
 			}
 		}
 		
-		if (Preference.AutosaveMinutes != 0 && !IsNetworkGame() && GameCycle > 0 && (GameCycle % (CYCLES_PER_SECOND * 60 * Preference.AutosaveMinutes)) == 0) { // autosave every X minutes (default is 5), if the option is enabled
+		if (Preference.AutosaveMinutes != 0 && !IsNetworkGame() && !HeadlessCycles && GameCycle > 0 && (GameCycle % (CYCLES_PER_SECOND * 60 * Preference.AutosaveMinutes)) == 0) { // autosave every X minutes (default is 5), if the option is enabled
 		//Wyrmgus end
-			UI.StatusLine.Set(_("Autosave"));
-			SaveGame("autosave.sav");
+			// sets the status line if the save starts
+			SaveGameAsync("autosave.sav");
 		}
+		UpdateAsyncSave();
+		CommandLogEachCycle(); // flush the replay log, store its keyframes
 	}
 
 	UpdateMessages();     // update messages
 	ParticleManager.update(); // handle particles
 	CheckMusicFinished(); // Check for next song
 
-	if (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f)) {
+	if (!HeadlessCycles && (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f))) {
 		WaitEventsOneFrame();
 	}
 
@@ -384,9 +454,76 @@ static void SingleGameLoop()
 	while (GameRunning) {
 		DisplayLoop();
 		GameLogicLoop();
+		ProfileFrame();
 	}
 }
 
+/**
+**  Print the timings of the headless mode and the final SyncHash.
+**
+**  @param cycles  Number of simulated game cycles.
+**  @param total   Nanoseconds spent to simulate them.
+*/
+static void PrintHeadlessReport(unsigned long cycles, unsigned long long total)
+{
+	const double seconds = total / 1e9;
+	std::vector<unsigned long long> times(HeadlessCycleTimes);
+	std::sort(times.begin(), times.end());
+	const size_t count = times.size();
+	const double p50 = count ? times[count / 2] / 1e6 : 0.;
+	const double p99 = count ? times[std::min(count - 1, count * 99 / 100)] / 1e6 : 0.;
+	const double worst = count ? times.back() / 1e6 : 0.;
+
+	fprintf(stdout, "Headless: %lu cycles in %.3f s, %.1f cycles/s\n",
+			cycles, seconds, seconds > 0. ? cycles / seconds : 0.);
+	fprintf(stdout, "Cycle time: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", p50, p99, worst);
+	fprintf(stdout, "%-24s %12s %7s %12s\n", "subsystem", "total ms", "%", "ms/cycle");
+	for (int i = 0; i != HeadlessSubsystemMax; ++i) {
+		fprintf(stdout, "%-24s %12.3f %6.1f%% %12.4f\n", HeadlessSubsystemNames[i],
+				HeadlessTime[i] / 1e6, total ? HeadlessTime[i] * 100. / total : 0.,
+				cycles ? HeadlessTime[i] / 1e6 / cycles : 0.);
+	}
+	fprintf(stdout, "GameCycle: %lu\n", GameCycle);
+	fprintf(stdout, "SyncHash: 0x%08X\n", SyncHash);
+	fflush(stdout);
+}
+
+/**
+**  Run the game logic as fast as possible, without display and input,
+**  for HeadlessCycles cycles or until the game ends.
+**
+**  The game is then saved in HeadlessSaveFile if it is set. Running the
+**  savegame for more cycles must give the SyncHash of a run of the map
+**  for all the cycles, which checks that a savegame keeps the state.
+*/
+static void HeadlessGameLoop()
+{
+	const unsigned long firstCycle = GameCycle;
+
+	std::fill(HeadlessTime, HeadlessTime + HeadlessSubsystemMax, 0ULL);
+	HeadlessCycleTimes.clear();
+	HeadlessCycleTimes.reserve(HeadlessCycles);
+
+	const unsigned long long start = HeadlessNow();
+	for (unsigned long i = 0; i != HeadlessCycles && GameRunning; ++i) {
+		const unsigned long long cycleStart = HeadlessNow();
+		HeadlessLapStart = cycleStart;
+		GameLogicLoop();
+		HeadlessLap(HeadlessOther);
+		ProfileFrame();
+		HeadlessCycleTimes.push_back(HeadlessLapStart - cycleStart);
+	}
+	const unsigned long long total = HeadlessNow() - start;
+
+	if (!HeadlessSaveFile.empty() && SaveGame(HeadlessSaveFile) == -1) {
+		fprintf(stderr, "Can't save the headless game to '%s'\n", HeadlessSaveFile.c_str());
+	}
+	PrintHeadlessReport(GameCycle - firstCycle, total);
+
+	GameRunning = false;
+	GameResult = GameExit;
+}
+
 /**
 **  Game main loop.
 **
@@ -420,7 +557,11 @@ void GameMainLoop()
 
 	MultiPlayerReplayEachCycle();
 
-	SingleGameLoop();
+	if (HeadlessCycles) {
+		HeadlessGameLoop();
+	} else {
+		SingleGameLoop();
+	}
 
 	//
 	// Game over
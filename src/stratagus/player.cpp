@@ -1364,11 +1364,15 @@ void CPlayer::SetDiplomacyCrazyWith(const CPlayer &player)
 void CPlayer::ShareVisionWith(const CPlayer &player)
 {
 	this->SharedVision |= (1 << player.Index);
+	Map.Visibility.MarkAllDirty();
+	UI.Minimap.MarkAllDirty();
 }
 
 void CPlayer::UnshareVisionWith(const CPlayer &player)
 {
 	this->SharedVision &= ~(1 << player.Index);
+	Map.Visibility.MarkAllDirty();
+	UI.Minimap.MarkAllDirty();
 }
 
 
@@ -0,0 +1,256 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name pool.cpp - The object pools. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "pool.h"
+
+#include "SDL.h"
+
+#include <algorithm>
+#include <new>
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/**
+**  All the class pools.
+**
+**  Plain arrays, they are ready before the constructors of the pools
+**  register them, and have no destructor.
+*/
+static CClassPool *ClassPools[CClassPool::MaxClassPools];
+static int ClassPoolCount;
+
+static Uint32 ClassPoolThread; /// Thread allowed to use the class pools
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+CObjectPool::CObjectPool(size_t objectSize, size_t objectsPerSlab) :
+	freeList(NULL), objectSize(objectSize), objectsPerSlab(objectsPerSlab),
+	usedCount(0), peakCount(0)
+{
+	Assert(objectSize >= sizeof(FreeObject));
+}
+
+CObjectPool::~CObjectPool()
+{
+	for (size_t i = 0; i != slabs.size(); ++i) {
+		delete[] slabs[i];
+	}
+}
+
+/**
+**  Allocate a new slab and put its objects in the free list.
+*/
+void CObjectPool::AddSlab()
+{
+	char *slab = new char[objectSize * objectsPerSlab];
+
+	slabs.push_back(slab);
+	// Keep the order of the memory, the first object is used first
+	for (size_t i = objectsPerSlab; i != 0; --i) {
+		FreeObject *object = reinterpret_cast<FreeObject *>(slab + (i - 1) * objectSize);
+		object->Next = freeList;
+		freeList = object;
+	}
+}
+
+/**
+**  Get memory for an object.
+*/
+void *CObjectPool::Alloc()
+{
+	if (freeList == NULL) {
+		AddSlab();
+	}
+	FreeObject *object = freeList;
+	freeList = object->Next;
+	++usedCount;
+	peakCount = std::max(peakCount, usedCount);
+	return object;
+}
+
+/**
+**  Give back the memory of an object.
+*/
+void CObjectPool::Free(void *p)
+{
+	Assert(usedCount != 0);
+	FreeObject *object = static_cast<FreeObject *>(p);
+
+	object->Next = freeList;
+	freeList = object;
+	--usedCount;
+}
+
+CClassPool::CClassPool(const char *name, size_t objectsPerSlab) :
+	name(name), objectsPerSlab(objectsPerSlab), pools(NULL), bigCount(0)
+{
+	Assert(ClassPoolCount < MaxClassPools);
+	ClassPools[ClassPoolCount++] = this;
+}
+
+/**
+**  Make the table of the pools, the pools are made by the first objects
+**  of their size.
+*/
+void CClassPool::Init()
+{
+	if (pools == NULL) {
+		pools = new CObjectPool *[PoolCount]();
+	}
+}
+
+/**
+**  Free the pools.
+**
+**  Pools with objects still in use are kept, so the objects can still
+**  be deleted.
+*/
+void CClassPool::Clean()
+{
+	if (pools == NULL) {
+		return;
+	}
+	bool used = false;
+	for (size_t i = 0; i != PoolCount; ++i) {
+		if (pools[i] && pools[i]->GetUsedCount() == 0) {
+			delete pools[i];
+			pools[i] = NULL;
+		}
+		used |= pools[i] != NULL;
+	}
+	if (!used) {
+		delete[] pools;
+		pools = NULL;
+	}
+}
+
+/**
+**  Get memory for an object of this size.
+*/
+void *CClassPool::Alloc(size_t size)
+{
+	Assert(pools != NULL && SDL_ThreadID() == ClassPoolThread);
+	const size_t index = (size + Alignment - 1) / Alignment;
+
+	if (index >= PoolCount) {
+		++bigCount;
+		return ::operator new(size);
+	}
+	if (pools[index] == NULL) {
+		pools[index] = new CObjectPool(index * Alignment, objectsPerSlab);
+	}
+	return pools[index]->Alloc();
+}
+
+/**
+**  Give back the memory of an object of this size.
+*/
+void CClassPool::Free(void *object, size_t size)
+{
+	if (object == NULL) {
+		return;
+	}
+	Assert(SDL_ThreadID() == ClassPoolThread);
+	const size_t index = (size + Alignment - 1) / Alignment;
+
+	if (index >= PoolCount) {
+		--bigCount;
+		::operator delete(object);
+		return;
+	}
+	Assert(pools && pools[index]);
+	pools[index]->Free(object);
+}
+
+/**
+**  Print the occupancy of the pools.
+*/
+void CClassPool::PrintStatistics(FILE *file) const
+{
+	for (size_t i = 0; pools && i != PoolCount; ++i) {
+		const CObjectPool *pool = pools[i];
+
+		if (pool == NULL) {
+			continue;
+		}
+		fprintf(file, "%-10s %5lu bytes: %6lu used, %6lu peak, %6lu capacity, %3lu slabs (%lu KB)\n",
+				name, (unsigned long)pool->GetObjectSize(), (unsigned long)pool->GetUsedCount(),
+				(unsigned long)pool->GetPeakCount(), (unsigned long)pool->GetCapacity(),
+				(unsigned long)pool->GetSlabCount(),
+				(unsigned long)(pool->GetCapacity() * pool->GetObjectSize() / 1024));
+	}
+	if (bigCount) {
+		fprintf(file, "%-10s %lu objects out of the pools\n", name, (unsigned long)bigCount);
+	}
+}
+
+/**
+**  Print the occupancy of all the class pools.
+*/
+void PrintPoolStatistics(FILE *file)
+{
+	for (int i = 0; i != ClassPoolCount; ++i) {
+		ClassPools[i]->PrintStatistics(file);
+	}
+}
+
+/**
+**  Make the memory of all the class pools, before the game thread
+**  allocates the first objects.
+*/
+void InitClassPools()
+{
+	ClassPoolThread = SDL_ThreadID();
+	for (int i = 0; i != ClassPoolCount; ++i) {
+		ClassPools[i]->Init();
+	}
+}
+
+/**
+**  Free the memory of all the class pools, once the modules have deleted
+**  their objects.
+*/
+void CleanClassPools()
+{
+	for (int i = 0; i != ClassPoolCount; ++i) {
+		ClassPools[i]->Clean();
+	}
+}
+
+//@}
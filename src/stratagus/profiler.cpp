@@ -0,0 +1,420 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name profiler.cpp - The profiler. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "profiler.h"
+
+#include "font.h"
+#include "game.h"
+#include "iocompat.h"
+#include "parameters.h"
+#include "script.h"
+#include "ui.h"
+#include "video.h"
+
+#include "SDL_mutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <sys/stat.h>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/// Zone recorded by a thread
+struct ProfileEvent {
+	CProfileZoneInfo *Zone;        /// measured zone
+	unsigned long long Begin;      /// time of the beginning of the zone
+	unsigned long long End;        /// time of the end of the zone
+};
+
+/// Number of events kept by each thread, a power of 2
+static const unsigned int ProfileBufferSize = 1 << 16;
+
+/**
+**  Ring buffer of the last zones recorded by a thread.
+**
+**  Only its thread writes in it. Count is published after the event, so
+**  the other threads see the complete events, but the oldest ones can be
+**  overwritten while they read them.
+*/
+struct ProfileBuffer {
+	explicit ProfileBuffer(int threadId) : Events(ProfileBufferSize), Count(0), ThreadId(threadId) {}
+
+	std::vector<ProfileEvent> Events;           /// the last recorded zones
+	std::atomic<unsigned long long> Count;      /// number of zones recorded since the start
+	int ThreadId;                               /// id of the thread in the trace
+};
+
+/// Number of frames shown by the overlay
+static const int ProfileHistory = 120;
+
+/// Time spent in a zone during the last frames of the main thread
+struct ProfileZoneStat {
+	CProfileZoneInfo *Zone;                     /// measured zone
+	unsigned long long Times[ProfileHistory];   /// time spent in each frame
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+std::atomic<bool> ProfilerEnabled(false); /// Zones are recorded, read by all the threads
+bool ShowProfiler;                    /// Draw the profiler overlay
+
+static std::vector<ProfileBuffer *> ProfileBuffers;   /// buffers of all the threads
+static SDL_mutex *ProfileBuffersLock;                 /// protects ProfileBuffers
+static thread_local ProfileBuffer *ThreadProfileBuffer; /// buffer of the current thread
+
+static CProfileZoneInfo FrameZone("Frame");           /// zone of a whole frame
+static std::vector<ProfileZoneStat> ZoneStats;        /// zones of the overlay
+static unsigned long long FrameTimes[ProfileHistory]; /// duration of the last frames
+static int FrameCount;                                /// frames measured since the start
+static unsigned long long FrameBegin;                 /// time of the beginning of the frame
+static unsigned long long FrameEventCount;            /// events of the main thread before the frame
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Get the time of the profiler clock.
+**
+**  @return  Monotonic time in nanoseconds.
+*/
+unsigned long long GetProfileTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+**  Get the buffer of the current thread, made at the first zone it records.
+*/
+static ProfileBuffer &GetProfileBuffer()
+{
+	if (ThreadProfileBuffer == NULL) {
+		SDL_LockMutex(ProfileBuffersLock);
+		ThreadProfileBuffer = new ProfileBuffer(ProfileBuffers.size());
+		ProfileBuffers.push_back(ThreadProfileBuffer);
+		SDL_UnlockMutex(ProfileBuffersLock);
+	}
+	return *ThreadProfileBuffer;
+}
+
+/**
+**  Record the end of a zone in the buffer of the current thread.
+**
+**  @param info   Measured zone.
+**  @param begin  Time of the beginning of the zone.
+*/
+void EndProfileZone(CProfileZoneInfo &info, unsigned long long begin)
+{
+	ProfileBuffer &buffer = GetProfileBuffer();
+	const unsigned long long count = buffer.Count.load(std::memory_order_relaxed);
+	ProfileEvent &event = buffer.Events[count & (ProfileBufferSize - 1)];
+
+	event.Zone = &info;
+	event.Begin = begin;
+	event.End = GetProfileTime();
+	buffer.Count.store(count + 1, std::memory_order_release);
+}
+
+/**
+**  Start or stop the recording of the zones.
+**
+**  @param enabled  Record the zones.
+*/
+void SetProfilerEnabled(bool enabled)
+{
+	if (ProfileBuffersLock == NULL) {
+		ProfileBuffersLock = SDL_CreateMutex();
+	}
+	if (enabled && !ProfilerEnabled.load(std::memory_order_relaxed)) {
+		FrameBegin = 0;
+	}
+	ProfilerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+**  Mark the end of a displayed frame, and add the zones recorded by the
+**  main thread during the frame to the statistics of the overlay.
+*/
+void ProfileFrame()
+{
+	if (!ProfilerEnabled.load(std::memory_order_relaxed)) {
+		return;
+	}
+	ProfileBuffer &buffer = GetProfileBuffer();
+	const unsigned long long now = GetProfileTime();
+
+	if (FrameBegin == 0) {
+		FrameBegin = now;
+		FrameEventCount = buffer.Count;
+		return;
+	}
+	EndProfileZone(FrameZone, FrameBegin);
+
+	const int slot = FrameCount % ProfileHistory;
+	FrameTimes[slot] = now - FrameBegin;
+	for (size_t i = 0; i != ZoneStats.size(); ++i) {
+		ZoneStats[i].Times[slot] = 0;
+	}
+
+	const unsigned long long count = buffer.Count;
+	unsigned long long first = FrameEventCount;
+	if (count - first > ProfileBufferSize) {
+		first = count - ProfileBufferSize;
+	}
+	for (unsigned long long i = first; i != count; ++i) {
+		const ProfileEvent &event = buffer.Events[i & (ProfileBufferSize - 1)];
+		CProfileZoneInfo &zone = *event.Zone;
+
+		if (&zone == &FrameZone) {
+			continue;
+		}
+		if (zone.StatIndex < 0) {
+			ProfileZoneStat stat;
+			stat.Zone = &zone;
+			std::fill(stat.Times, stat.Times + ProfileHistory, 0);
+			zone.StatIndex = ZoneStats.size();
+			ZoneStats.push_back(stat);
+		}
+		ZoneStats[zone.StatIndex].Times[slot] += event.End - event.Begin;
+	}
+	++FrameCount;
+	FrameBegin = now;
+	FrameEventCount = count;
+}
+
+/**
+**  Draw a line of the overlay: a name and an average and a maximum time.
+*/
+static void DrawProfilerLine(const CLabel &label, int x, int y, const char *name,
+							 const unsigned long long *times, int count)
+{
+	unsigned long long total = 0;
+	unsigned long long worst = 0;
+	for (int i = 0; i != count; ++i) {
+		total += times[i];
+		worst = std::max(worst, times[i]);
+	}
+	char buf[32];
+
+	label.Draw(x, y, name);
+	snprintf(buf, sizeof(buf), "%.2f", total / 1e6 / count);
+	label.Draw(x + 110, y, buf);
+	snprintf(buf, sizeof(buf), "%.2f", worst / 1e6);
+	label.Draw(x + 160, y, buf);
+}
+
+/**
+**  Draw the duration of the last frames, and the average and maximum
+**  time spent in each zone by the main thread during a frame.
+*/
+void DrawProfilerOverlay()
+{
+	if (!ShowProfiler || !ProfilerEnabled.load(std::memory_order_relaxed) || FrameCount == 0) {
+		return;
+	}
+	const CFont &font = GetSmallFont();
+	const CLabel label(font, "white", "red");
+	const int count = std::min(FrameCount, ProfileHistory);
+	const int graphHeight = 50;
+	const int lineHeight = font.Height() + 1;
+	const int width = std::max(ProfileHistory, 210) + 8;
+	const int height = graphHeight + (2 + ZoneStats.size()) * lineHeight + 12;
+	const int x = UI.MapArea.X + 4;
+	int y = UI.MapArea.Y + 4;
+
+	Video.FillTransRectangleClip(ColorBlack, x, y, width, height, 160);
+	y += 4;
+
+	// a pixel per millisecond, frames over the frame budget in red
+	const unsigned long long budget = 1000000000ULL / FRAMES_PER_SECOND;
+	for (int i = 0; i != count; ++i) {
+		const unsigned long long time = FrameTimes[(FrameCount - count + i) % ProfileHistory];
+		const int h = std::min<int>(graphHeight, time / 1000000);
+		if (h > 0) {
+			Video.DrawVLineClip(time > budget ? ColorRed : ColorGreen,
+								x + 4 + ProfileHistory - count + i, y + graphHeight - h, h);
+		}
+	}
+	y += graphHeight + 4;
+
+	label.Draw(x + 4, y, "ms");
+	label.Draw(x + 114, y, "avg");
+	label.Draw(x + 164, y, "max");
+	y += lineHeight;
+
+	unsigned long long times[ProfileHistory];
+	for (int i = 0; i != count; ++i) {
+		times[i] = FrameTimes[(FrameCount - count + i) % ProfileHistory];
+	}
+	DrawProfilerLine(label, x + 4, y, FrameZone.Name, times, count);
+	y += lineHeight;
+	for (size_t z = 0; z != ZoneStats.size(); ++z) {
+		for (int i = 0; i != count; ++i) {
+			times[i] = ZoneStats[z].Times[(FrameCount - count + i) % ProfileHistory];
+		}
+		DrawProfilerLine(label, x + 4, y, ZoneStats[z].Zone->Name, times, count);
+		y += lineHeight;
+	}
+}
+
+/**
+**  Save the zones recorded by all the threads in the Chrome trace
+**  format, to load in chrome://tracing.
+**
+**  @param filename  Name of the file, in the logs directory of the game.
+**
+**  @return          true if the file is saved.
+*/
+bool SaveProfilerTrace(const std::string &filename)
+{
+	if (filename.find_first_of("\\/") != std::string::npos) {
+		fprintf(stderr, "\\ or / not allowed in SaveProfilerTrace filename\n");
+		return false;
+	}
+	std::string path(Parameters::Instance.GetUserDirectory());
+	if (!GameName.empty()) {
+		path += "/";
+		path += GameName;
+	}
+	path += "/logs";
+	struct stat tmp;
+	if (stat(path.c_str(), &tmp) < 0) {
+		makedir(path.c_str(), 0777);
+	}
+	path += "/" + filename;
+
+	FILE *fd = fopen(path.c_str(), "wb");
+	if (!fd) {
+		fprintf(stderr, "Can't save the profiler trace '%s': %s\n", path.c_str(), strerror(errno));
+		return false;
+	}
+	if (ProfileBuffersLock) {
+		SDL_LockMutex(ProfileBuffersLock);
+	}
+
+	// times are relative to the oldest event
+	unsigned long long origin = 0;
+	for (size_t b = 0; b != ProfileBuffers.size(); ++b) {
+		const ProfileBuffer &buffer = *ProfileBuffers[b];
+		const unsigned long long count = buffer.Count.load(std::memory_order_acquire);
+		const unsigned long long first = count > ProfileBufferSize ? count - ProfileBufferSize : 0;
+		for (unsigned long long i = first; i != count; ++i) {
+			const unsigned long long begin = buffer.Events[i & (ProfileBufferSize - 1)].Begin;
+			if (origin == 0 || begin < origin) {
+				origin = begin;
+			}
+		}
+	}
+
+	fprintf(fd, "{\"traceEvents\":[\n");
+	bool firstEvent = true;
+	for (size_t b = 0; b != ProfileBuffers.size(); ++b) {
+		const ProfileBuffer &buffer = *ProfileBuffers[b];
+		const unsigned long long count = buffer.Count.load(std::memory_order_acquire);
+		const unsigned long long first = count > ProfileBufferSize ? count - ProfileBufferSize : 0;
+		for (unsigned long long i = first; i != count; ++i) {
+			const ProfileEvent &event = buffer.Events[i & (ProfileBufferSize - 1)];
+			if (event.Begin < origin) {
+				continue;
+			}
+			fprintf(fd, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					firstEvent ? "" : ",\n", event.Zone->Name, buffer.ThreadId,
+					(event.Begin - origin) / 1e3, (event.End - event.Begin) / 1e3);
+			firstEvent = false;
+		}
+	}
+	fprintf(fd, "\n]}\n");
+
+	if (ProfileBuffersLock) {
+		SDL_UnlockMutex(ProfileBuffersLock);
+	}
+	fclose(fd);
+	return true;
+}
+
+/**
+**  Start or stop the recording of the profiler zones.
+**
+**  @param l  Lua state.
+*/
+static int CclSetProfilerEnabled(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	SetProfilerEnabled(LuaToBoolean(l, 1));
+	return 0;
+}
+
+/**
+**  Show or hide the profiler overlay. Showing it starts the recording.
+**
+**  @param l  Lua state.
+*/
+static int CclSetShowProfiler(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	ShowProfiler = LuaToBoolean(l, 1);
+	if (ShowProfiler) {
+		SetProfilerEnabled(true);
+	}
+	return 0;
+}
+
+/**
+**  Save the recorded profiler zones in the Chrome trace format.
+**
+**  @param l  Lua state.
+*/
+static int CclSaveProfilerTrace(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	lua_pushboolean(l, SaveProfilerTrace(LuaToString(l, 1)));
+	return 1;
+}
+
+/**
+**  Register CCL features for the profiler.
+*/
+void ProfilerCclRegister()
+{
+	lua_register(Lua, "SetProfilerEnabled", CclSetProfilerEnabled);
+	lua_register(Lua, "SetShowProfiler", CclSetShowProfiler);
+	lua_register(Lua, "SaveProfilerTrace", CclSaveProfilerTrace);
+}
+
+//@}
@@ -46,6 +46,9 @@
 #include "iolib.h"
 #include "map.h"
 #include "parameters.h"
+#include "pool.h"
+#include "profiler.h"
+#include "script_program.h"
 #include "translate.h"
 #include "trigger.h"
 #include "ui.h"
@@ -158,6 +161,7 @@ static int luatraceback(lua_State *L)
 */
 int LuaCall(int narg, int clear, bool exitOnError)
 {
+	PROFILE_ZONE("LuaCall");
 	const int base = lua_gettop(Lua) - narg;  // function index
 	lua_pushcfunction(Lua, luatraceback);  // push traceback function
 	lua_insert(Lua, base);  // put it under chunk and args
@@ -172,7 +176,7 @@ int LuaCall(int narg, int clear, bool exitOnError)
 /**
 **  Get the (uncompressed) content of the file into a string
 */
-static bool GetFileContent(const std::string &file, std::string &content)
+bool GetFileContent(const std::string &file, std::string &content)
 {
 	CFile fp;
 
@@ -240,6 +244,27 @@ int LuaLoadFile(const std::string &file, const std::string &strArg)
 	return status;
 }
 
+/**
+**  Execute a lua script in memory
+**
+**  @param buffer  Script to execute.
+**  @param size    Size of the script.
+**  @param name    Name of the script in the error messages.
+**
+**  @return        0 for success, else exit.
+*/
+int LuaLoadBuffer(const char *buffer, size_t size, const std::string &name)
+{
+	const int status = luaL_loadbuffer(Lua, buffer, size, name.c_str());
+
+	if (!status) {
+		LuaCall(0, 1);
+	} else {
+		report(status, true);
+	}
+	return status;
+}
+
 /**
 **  Save preferences
 **
@@ -554,7 +579,7 @@ static int ParseLuaFunction(lua_State *l, const char *tablename, int *counter)
 **
 **  @return  lua function result.
 */
-static int CallLuaNumberFunction(unsigned int handler)
+int CallLuaNumberFunction(unsigned int handler)
 {
 	const int narg = lua_gettop(Lua);
 
@@ -576,7 +601,7 @@ static int CallLuaNumberFunction(unsigned int handler)
 **
 **  @return         lua function result.
 */
-static std::string CallLuaStringFunction(unsigned int handler)
+std::string CallLuaStringFunction(unsigned int handler)
 {
 	const int narg = lua_gettop(Lua);
 	lua_getglobal(Lua, "_stringfunction_");
@@ -599,7 +624,7 @@ static std::string CallLuaStringFunction(unsigned int handler)
 */
 NumberDesc *CclParseNumberDesc(lua_State *l)
 {
-	NumberDesc *res = new NumberDesc;
+	NumberDesc *res = new NumberDesc();
 
 	if (lua_isnumber(l, -1)) {
 		res->e = ENumber_Dir;
@@ -790,7 +815,7 @@ NumberDesc *CclParseNumberDesc(lua_State *l)
 */
 StringDesc *CclParseStringDesc(lua_State *l)
 {
-	StringDesc *res = new StringDesc;
+	StringDesc *res = new StringDesc();
 
 	if (lua_isstring(l, -1)) {
 		res->e = EString_Dir;
@@ -919,7 +944,7 @@ CUnit *EvalUnit(const UnitDesc *unitdesc)
 }
 
 /**
-**  compute the number expression
+**  compute the number expression, walking its tree.
 **
 **  @param number  struct with definition of the calculation.
 **
@@ -927,7 +952,7 @@ CUnit *EvalUnit(const UnitDesc *unitdesc)
 **
 **  @todo Manage better the error (div/0, unit==NULL, ...).
 */
-int EvalNumber(const NumberDesc *number)
+int EvalNumberTree(const NumberDesc *number)
 {
 	CUnit *unit;
 	CUnitType **type;
@@ -942,53 +967,53 @@ int EvalNumber(const NumberDesc *number)
 		case ENumber_Dir :     // directly a number.
 			return number->D.Val;
 		case ENumber_Add :     // a + b.
-			return EvalNumber(number->D.binOp.Left) + EvalNumber(number->D.binOp.Right);
+			return EvalNumberTree(number->D.binOp.Left) + EvalNumberTree(number->D.binOp.Right);
 		case ENumber_Sub :     // a - b.
-			return EvalNumber(number->D.binOp.Left) - EvalNumber(number->D.binOp.Right);
+			return EvalNumberTree(number->D.binOp.Left) - EvalNumberTree(number->D.binOp.Right);
 		case ENumber_Mul :     // a * b.
-			return EvalNumber(number->D.binOp.Left) * EvalNumber(number->D.binOp.Right);
+			return EvalNumberTree(number->D.binOp.Left) * EvalNumberTree(number->D.binOp.Right);
 		case ENumber_Div :     // a / b.
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			if (!b) { // FIXME : manage better this.
 				return 0;
 			}
 			return a / b;
 		case ENumber_Min :     // a <= b ? a : b
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return std::min(a, b);
 		case ENumber_Max :     // a >= b ? a : b
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return std::max(a, b);
 		case ENumber_Gt  :     // a > b  ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return (a > b ? 1 : 0);
 		case ENumber_GtEq :    // a >= b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return (a >= b ? 1 : 0);
 		case ENumber_Lt  :     // a < b  ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return (a < b ? 1 : 0);
 		case ENumber_LtEq :    // a <= b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return (a <= b ? 1 : 0);
 		case ENumber_Eq  :     // a == b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return (a == b ? 1 : 0);
 		case ENumber_NEq  :    // a != b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
+			a = EvalNumberTree(number->D.binOp.Left);
+			b = EvalNumberTree(number->D.binOp.Right);
 			return (a != b ? 1 : 0);
 
 		case ENumber_Rand :    // random(a) [0..a-1]
-			a = EvalNumber(number->D.N);
+			a = EvalNumberTree(number->D.N);
 			return SyncRand() % a;
 		case ENumber_UnitStat : // property of unit.
 			unit = EvalUnit(number->D.UnitStat.Unit);
@@ -1008,38 +1033,38 @@ int EvalNumber(const NumberDesc *number)
 			}
 		case ENumber_VideoTextLength : // VideoTextLength(font, s)
 			if (number->D.VideoTextLength.String != NULL
-				&& !(s = EvalString(number->D.VideoTextLength.String)).empty()) {
+				&& !(s = EvalStringTree(number->D.VideoTextLength.String)).empty()) {
 				return number->D.VideoTextLength.Font->Width(s);
 			} else { // ERROR.
 				return 0;
 			}
 		case ENumber_StringFind : // s.find(c)
 			if (number->D.StringFind.String != NULL
-				&& !(s = EvalString(number->D.StringFind.String)).empty()) {
+				&& !(s = EvalStringTree(number->D.StringFind.String)).empty()) {
 				size_t pos = s.find(number->D.StringFind.C);
 				return pos != std::string::npos ? (int)pos : -1;
 			} else { // ERROR.
 				return 0;
 			}
 		case ENumber_NumIf : // cond ? True : False;
-			if (EvalNumber(number->D.NumIf.Cond)) {
-				return EvalNumber(number->D.NumIf.BTrue);
+			if (EvalNumberTree(number->D.NumIf.Cond)) {
+				return EvalNumberTree(number->D.NumIf.BTrue);
 			} else if (number->D.NumIf.BFalse) {
-				return EvalNumber(number->D.NumIf.BFalse);
+				return EvalNumberTree(number->D.NumIf.BFalse);
 			} else {
 				return 0;
 			}
 		case ENumber_PlayerData : // getplayerdata(player, data, res);
-			int player = EvalNumber(number->D.PlayerData.Player);
-			std::string data = EvalString(number->D.PlayerData.DataType);
-			std::string res = EvalString(number->D.PlayerData.ResType);
+			int player = EvalNumberTree(number->D.PlayerData.Player);
+			std::string data = EvalStringTree(number->D.PlayerData.DataType);
+			std::string res = EvalStringTree(number->D.PlayerData.ResType);
 			return GetPlayerData(player, data.c_str(), res.c_str());
 	}
 	return 0;
 }
 
 /**
-**  compute the string expression
+**  compute the string expression, walking its tree.
 **
 **  @param s  struct with definition of the calculation.
 **
@@ -1047,7 +1072,7 @@ int EvalNumber(const NumberDesc *number)
 **
 **  @todo Manage better the error.
 */
-std::string EvalString(const StringDesc *s)
+std::string EvalStringTree(const StringDesc *s)
 {
 	std::string res;    // Result string.
 	std::string tmp1;   // Temporary string.
@@ -1060,18 +1085,18 @@ std::string EvalString(const StringDesc *s)
 		case EString_Dir :     // directly a string.
 			return std::string(s->D.Val);
 		case EString_Concat :     // a + b -> "ab"
-			res = EvalString(s->D.Concat.Strings[0]);
+			res = EvalStringTree(s->D.Concat.Strings[0]);
 			for (int i = 1; i < s->D.Concat.n; i++) {
-				res += EvalString(s->D.Concat.Strings[i]);
+				res += EvalStringTree(s->D.Concat.Strings[i]);
 			}
 			return res;
 		case EString_String : {   // 42 -> "42".
 			char buffer[16]; // Should be enough ?
-			sprintf(buffer, "%d", EvalNumber(s->D.Number));
+			sprintf(buffer, "%d", EvalNumberTree(s->D.Number));
 			return std::string(buffer);
 		}
 		case EString_InverseVideo : // "a" -> "~<a~>"
-			tmp1 = EvalString(s->D.String);
+			tmp1 = EvalStringTree(s->D.String);
 			// FIXME replace existing "~<" by "~>" in tmp1.
 			res = std::string("~<") + tmp1 + "~>";
 			return res;
@@ -1083,26 +1108,26 @@ std::string EvalString(const StringDesc *s)
 				return std::string("");
 			}
 		case EString_If : // cond ? True : False;
-			if (EvalNumber(s->D.If.Cond)) {
-				return EvalString(s->D.If.BTrue);
+			if (EvalNumberTree(s->D.If.Cond)) {
+				return EvalStringTree(s->D.If.BTrue);
 			} else if (s->D.If.BFalse) {
-				return EvalString(s->D.If.BFalse);
+				return EvalStringTree(s->D.If.BFalse);
 			} else {
 				return std::string("");
 			}
 		case EString_SubString : // substring(s, begin, end)
 			if (s->D.SubString.String != NULL
-				&& !(tmp1 = EvalString(s->D.SubString.String)).empty()) {
+				&& !(tmp1 = EvalStringTree(s->D.SubString.String)).empty()) {
 				int begin;
 				int end;
 
-				begin = EvalNumber(s->D.SubString.Begin);
+				begin = EvalNumberTree(s->D.SubString.Begin);
 				if ((unsigned) begin > tmp1.size() && begin > 0) {
 					return std::string("");
 				}
 				res = tmp1.c_str() + begin;
 				if (s->D.SubString.End) {
-					end = EvalNumber(s->D.SubString.End);
+					end = EvalNumberTree(s->D.SubString.End);
 				} else {
 					end = -1;
 				}
@@ -1114,19 +1139,19 @@ std::string EvalString(const StringDesc *s)
 				return std::string("");
 			}
 		case EString_Line : // line n of the string
-			if (s->D.Line.String == NULL || (tmp1 = EvalString(s->D.Line.String)).empty()) {
+			if (s->D.Line.String == NULL || (tmp1 = EvalStringTree(s->D.Line.String)).empty()) {
 				return std::string(""); // ERROR.
 			} else {
 				int line;
 				int maxlen;
 				CFont *font;
 
-				line = EvalNumber(s->D.Line.Line);
+				line = EvalNumberTree(s->D.Line.Line);
 				if (line <= 0) {
 					return std::string("");
 				}
 				if (s->D.Line.MaxLen) {
-					maxlen = EvalNumber(s->D.Line.MaxLen);
+					maxlen = EvalNumberTree(s->D.Line.MaxLen);
 					maxlen = std::max(maxlen, 0);
 				} else {
 					maxlen = 0;
@@ -1136,12 +1161,48 @@ std::string EvalString(const StringDesc *s)
 				return res;
 			}
 		case EString_PlayerName : // player name
-			return std::string(Players[EvalNumber(s->D.PlayerName)].Name);
+			return std::string(Players[EvalNumberTree(s->D.PlayerName)].Name);
 	}
 	return std::string("");
 }
 
 
+/**
+**  compute the number expression
+**
+**  The description is compiled the first time it is evaluated.
+**
+**  @param number  struct with definition of the calculation.
+**
+**  @return        the result number.
+*/
+int EvalNumber(const NumberDesc *number)
+{
+	Assert(number);
+	if (!number->Program) {
+		number->Program = CScriptProgram::Compile(*number);
+	}
+	return number->Program->EvalNumber();
+}
+
+/**
+**  compute the string expression
+**
+**  The description is compiled the first time it is evaluated.
+**
+**  @param s  struct with definition of the calculation.
+**
+**  @return   the result string.
+*/
+std::string EvalString(const StringDesc *s)
+{
+	Assert(s);
+	if (!s->Program) {
+		s->Program = CScriptProgram::Compile(*s);
+	}
+	return s->Program->EvalString();
+}
+
 /**
 **  Free the unit expression content. (not the pointer itself).
 **
@@ -1166,6 +1227,8 @@ void FreeNumberDesc(NumberDesc *number)
 	if (number == 0) {
 		return;
 	}
+	delete number->Program;
+	number->Program = NULL;
 	switch (number->e) {
 		case ENumber_Lua :     // a lua function.
 		// FIXME: when lua table should be freed ?
@@ -1238,6 +1301,8 @@ void FreeStringDesc(StringDesc *s)
 	if (s == 0) {
 		return;
 	}
+	delete s->Program;
+	s->Program = NULL;
 	switch (s->e) {
 		case EString_Lua :     // a lua function.
 			// FIXME: when lua table should be freed ?
@@ -2076,6 +2141,60 @@ static int CclDebugPrint(lua_State *l)
 	return 1;
 }
 
+/**
+**  Print the occupancy of the memory pools of units, orders, missiles and particles.
+**
+**  @param l  Lua state.
+*/
+static int CclPrintPoolStatistics(lua_State *l)
+{
+	LuaCheckArgs(l, 0);
+	PrintPoolStatistics(stdout);
+	return 0;
+}
+
+/**
+**  Enable or disable the index of the data files.
+**
+**  @param l  Lua state.
+*/
+static int CclSetFileIndexEnabled(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	SetFileIndexEnabled(LuaToBoolean(l, 1));
+	return 0;
+}
+
+/**
+**  Print the number of searches of library files, of access() calls and
+**  their time.
+**
+**  @param l  Lua state.
+*/
+static int CclPrintFileLookupStatistics(lua_State *l)
+{
+	LuaCheckArgs(l, 0);
+	PrintFileLookupStatistics(stdout);
+	return 0;
+}
+
+/**
+**  Compare the evaluation time of the number and string descriptions
+**  with and without compiling them.
+**
+**  @param l  Lua state.
+*/
+static int CclBenchmarkScriptDescriptions(lua_State *l)
+{
+	const int args = lua_gettop(l);
+	if (args > 1) {
+		LuaError(l, "incorrect argument");
+	}
+	const int iterations = args ? LuaToNumber(l, 1) : 10000;
+	CScriptProgram::PrintBenchmark(stdout, iterations);
+	return 0;
+}
+
 /*............................................................................
 ..  Commands
 ............................................................................*/
@@ -2431,6 +2550,10 @@ void ScriptRegister()
 	lua_register(Lua, "LoadBuffer", CclLoadBuffer);
 
 	lua_register(Lua, "DebugPrint", CclDebugPrint);
+	lua_register(Lua, "PrintPoolStatistics", CclPrintPoolStatistics);
+	lua_register(Lua, "SetFileIndexEnabled", CclSetFileIndexEnabled);
+	lua_register(Lua, "PrintFileLookupStatistics", CclPrintFileLookupStatistics);
+	lua_register(Lua, "BenchmarkScriptDescriptions", CclBenchmarkScriptDescriptions);
 }
 
 //@}
@@ -0,0 +1,838 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name script_program.cpp - The compiled number and string descriptions. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <time.h>
+
+#include <algorithm>
+
+#include "stratagus.h"
+
+#include "script_program.h"
+
+#include "animation/animation_setplayervar.h"
+#include "font.h"
+#include "player.h"
+#include "unit.h"
+#include "unittype.h"
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// Useful for getComponent.
+enum UStrIntType {
+	USTRINT_STR, USTRINT_INT
+};
+struct UStrInt {
+	union {const char *s; int i;};
+	UStrIntType type;
+};
+
+/// Get component for unit variable.
+extern UStrInt GetComponent(const CUnit &unit, int index, EnumVariable e, int t);
+/// Get component for unit type variable.
+extern UStrInt GetComponent(const CUnitType &type, int index, EnumVariable e, int t);
+
+/// All the programs, for the benchmark
+/// (never freed, as descriptions may be freed by static destructors)
+static std::vector<CScriptProgram *> &Programs = *new std::vector<CScriptProgram *>;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Get the value of a binary operation, as EvalNumber does.
+*/
+static int EvalBinOp(ENumber e, int a, int b)
+{
+	switch (e) {
+		case ENumber_Add: return a + b;
+		case ENumber_Sub: return a - b;
+		case ENumber_Mul: return a * b;
+		case ENumber_Div: return b ? a / b : 0;
+		case ENumber_Min: return std::min(a, b);
+		case ENumber_Max: return std::max(a, b);
+		case ENumber_Gt: return a > b ? 1 : 0;
+		case ENumber_GtEq: return a >= b ? 1 : 0;
+		case ENumber_Lt: return a < b ? 1 : 0;
+		case ENumber_LtEq: return a <= b ? 1 : 0;
+		case ENumber_Eq: return a == b ? 1 : 0;
+		case ENumber_NEq: return a != b ? 1 : 0;
+		default: break;
+	}
+	Assert(0);
+	return 0;
+}
+
+/**
+**  Check if a number description is a binary operation.
+*/
+static bool IsBinOp(ENumber e)
+{
+	switch (e) {
+		case ENumber_Add: case ENumber_Sub: case ENumber_Mul: case ENumber_Div:
+		case ENumber_Min: case ENumber_Max:
+		case ENumber_Gt: case ENumber_GtEq: case ENumber_Lt: case ENumber_LtEq:
+		case ENumber_Eq: case ENumber_NEq:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool GetConstString(const StringDesc &s, std::string *value);
+
+/**
+**  Get the value of a number description which doesn't change.
+**
+**  @param number  Number description.
+**  @param value   Where to store the value.
+**
+**  @return        true if the number is constant.
+*/
+static bool GetConstNumber(const NumberDesc &number, int *value)
+{
+	int a;
+	int b;
+	std::string s;
+
+	if (number.e == ENumber_Dir) {
+		*value = number.D.Val;
+		return true;
+	}
+	if (IsBinOp(number.e)) {
+		if (GetConstNumber(*number.D.binOp.Left, &a) && GetConstNumber(*number.D.binOp.Right, &b)) {
+			*value = EvalBinOp(number.e, a, b);
+			return true;
+		}
+		return false;
+	}
+	switch (number.e) {
+		case ENumber_NumIf:
+			if (!GetConstNumber(*number.D.NumIf.Cond, &a)) {
+				return false;
+			}
+			if (a) {
+				return GetConstNumber(*number.D.NumIf.BTrue, value);
+			} else if (number.D.NumIf.BFalse) {
+				return GetConstNumber(*number.D.NumIf.BFalse, value);
+			}
+			*value = 0;
+			return true;
+		case ENumber_StringFind:
+			if (number.D.StringFind.String == NULL || !GetConstString(*number.D.StringFind.String, &s)) {
+				return false;
+			}
+			if (s.empty()) {
+				*value = 0;
+			} else {
+				const size_t pos = s.find(number.D.StringFind.C);
+				*value = pos != std::string::npos ? (int)pos : -1;
+			}
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+**  Get the value of a string description which doesn't change.
+**
+**  @param s      String description.
+**  @param value  Where to store the value.
+**
+**  @return       true if the string is constant.
+*/
+static bool GetConstString(const StringDesc &s, std::string *value)
+{
+	std::string tmp;
+	int a;
+
+	switch (s.e) {
+		case EString_Dir:
+			*value = s.D.Val;
+			return true;
+		case EString_Concat:
+			value->clear();
+			for (int i = 0; i < s.D.Concat.n; ++i) {
+				if (!GetConstString(*s.D.Concat.Strings[i], &tmp)) {
+					return false;
+				}
+				*value += tmp;
+			}
+			return true;
+		case EString_String: {
+			if (!GetConstNumber(*s.D.Number, &a)) {
+				return false;
+			}
+			char buffer[16];
+			sprintf(buffer, "%d", a);
+			*value = buffer;
+			return true;
+		}
+		case EString_InverseVideo:
+			if (!GetConstString(*s.D.String, &tmp)) {
+				return false;
+			}
+			*value = std::string("~<") + tmp + "~>";
+			return true;
+		case EString_If:
+			if (!GetConstNumber(*s.D.If.Cond, &a)) {
+				return false;
+			}
+			if (a) {
+				return GetConstString(*s.D.If.BTrue, value);
+			} else if (s.D.If.BFalse) {
+				return GetConstString(*s.D.If.BFalse, value);
+			}
+			value->clear();
+			return true;
+		default:
+			return false;
+	}
+}
+
+CScriptProgram::CScriptProgram() : SourceNumber(NULL), SourceString(NULL)
+{
+	Programs.push_back(this);
+}
+
+CScriptProgram::~CScriptProgram()
+{
+	Programs.erase(std::find(Programs.begin(), Programs.end(), this));
+}
+
+/**
+**  Add an instruction.
+**
+**  @return  Address of the instruction, to set its jump.
+*/
+size_t CScriptProgram::Emit(OpCode op, int arg, const void *ptr)
+{
+	Instruction instruction;
+
+	instruction.Op = op;
+	instruction.Arg = arg;
+	instruction.Index = 0;
+	instruction.Component = VariableValue;
+	instruction.Ptr = ptr;
+	Code.push_back(instruction);
+	return Code.size() - 1;
+}
+
+/**
+**  Add the instructions computing a number.
+*/
+void CScriptProgram::CompileNumber(const NumberDesc &number)
+{
+	int value;
+
+	if (GetConstNumber(number, &value)) {
+		Emit(OpPushNumber, value);
+		return;
+	}
+	if (IsBinOp(number.e)) {
+		CompileNumber(*number.D.binOp.Left);
+		CompileNumber(*number.D.binOp.Right);
+		switch (number.e) {
+			case ENumber_Add: Emit(OpAdd); break;
+			case ENumber_Sub: Emit(OpSub); break;
+			case ENumber_Mul: Emit(OpMul); break;
+			case ENumber_Div: Emit(OpDiv); break;
+			case ENumber_Min: Emit(OpMin); break;
+			case ENumber_Max: Emit(OpMax); break;
+			case ENumber_Gt: Emit(OpGt); break;
+			case ENumber_GtEq: Emit(OpGtEq); break;
+			case ENumber_Lt: Emit(OpLt); break;
+			case ENumber_LtEq: Emit(OpLtEq); break;
+			case ENumber_Eq: Emit(OpEq); break;
+			default: Emit(OpNEq); break;
+		}
+		return;
+	}
+	switch (number.e) {
+		case ENumber_Lua:
+			Emit(OpLuaNumber, number.D.Index);
+			break;
+		case ENumber_Rand:
+			CompileNumber(*number.D.N);
+			Emit(OpRand);
+			break;
+		case ENumber_UnitStat: {
+			const size_t i = Emit(OpUnitVar, number.D.UnitStat.Loc, number.D.UnitStat.Unit);
+			Code[i].Index = number.D.UnitStat.Index;
+			Code[i].Component = number.D.UnitStat.Component;
+			break;
+		}
+		case ENumber_TypeStat: {
+			const size_t i = Emit(OpTypeVar, number.D.TypeStat.Loc, number.D.TypeStat.Type);
+			Code[i].Index = number.D.TypeStat.Index;
+			Code[i].Component = number.D.TypeStat.Component;
+			break;
+		}
+		case ENumber_VideoTextLength:
+			if (number.D.VideoTextLength.String == NULL) {
+				Emit(OpPushNumber, 0);
+				break;
+			}
+			CompileString(*number.D.VideoTextLength.String);
+			Emit(OpVideoTextLength, 0, number.D.VideoTextLength.Font);
+			break;
+		case ENumber_StringFind:
+			if (number.D.StringFind.String == NULL) {
+				Emit(OpPushNumber, 0);
+				break;
+			}
+			CompileString(*number.D.StringFind.String);
+			Emit(OpStringFind, number.D.StringFind.C);
+			break;
+		case ENumber_NumIf: {
+			if (GetConstNumber(*number.D.NumIf.Cond, &value)) {
+				if (value) {
+					CompileNumber(*number.D.NumIf.BTrue);
+				} else if (number.D.NumIf.BFalse) {
+					CompileNumber(*number.D.NumIf.BFalse);
+				} else {
+					Emit(OpPushNumber, 0);
+				}
+				break;
+			}
+			CompileNumber(*number.D.NumIf.Cond);
+			const size_t jumpFalse = Emit(OpJumpIfZero);
+			CompileNumber(*number.D.NumIf.BTrue);
+			const size_t jumpEnd = Emit(OpJump);
+			Code[jumpFalse].Arg = Code.size();
+			if (number.D.NumIf.BFalse) {
+				CompileNumber(*number.D.NumIf.BFalse);
+			} else {
+				Emit(OpPushNumber, 0);
+			}
+			Code[jumpEnd].Arg = Code.size();
+			break;
+		}
+		case ENumber_PlayerData:
+			CompileNumber(*number.D.PlayerData.Player);
+			CompileString(*number.D.PlayerData.DataType);
+			if (number.D.PlayerData.ResType) {
+				CompileString(*number.D.PlayerData.ResType);
+			} else {
+				Emit(OpPushString, Strings.size());
+				Strings.push_back("");
+			}
+			Emit(OpPlayerData);
+			break;
+		default:
+			Emit(OpPushNumber, 0);
+			break;
+	}
+}
+
+/**
+**  Add the instructions computing a string.
+*/
+void CScriptProgram::CompileString(const StringDesc &s)
+{
+	std::string value;
+
+	if (GetConstString(s, &value)) {
+		Emit(OpPushString, Strings.size());
+		Strings.push_back(value);
+		return;
+	}
+	switch (s.e) {
+		case EString_Lua:
+			Emit(OpLuaString, s.D.Index);
+			break;
+		case EString_Concat: {
+			// Merge the constant strings which follow each other
+			int count = 0;
+			for (int i = 0; i < s.D.Concat.n; ++i) {
+				std::string constant;
+				int j = i;
+
+				for (; j < s.D.Concat.n && GetConstString(*s.D.Concat.Strings[j], &value); ++j) {
+					constant += value;
+				}
+				if (j != i) {
+					Emit(OpPushString, Strings.size());
+					Strings.push_back(constant);
+					i = j - 1;
+				} else {
+					CompileString(*s.D.Concat.Strings[i]);
+				}
+				++count;
+			}
+			if (count > 1) {
+				Emit(OpConcat, count);
+			}
+			break;
+		}
+		case EString_String:
+			CompileNumber(*s.D.Number);
+			Emit(OpNumberToString);
+			break;
+		case EString_InverseVideo:
+			CompileString(*s.D.String);
+			Emit(OpInverseVideo);
+			break;
+		case EString_UnitName:
+			Emit(OpUnitName, 0, s.D.Unit);
+			break;
+		case EString_If: {
+			int cond;
+
+			if (GetConstNumber(*s.D.If.Cond, &cond)) {
+				if (cond) {
+					CompileString(*s.D.If.BTrue);
+				} else if (s.D.If.BFalse) {
+					CompileString(*s.D.If.BFalse);
+				} else {
+					Emit(OpPushString, Strings.size());
+					Strings.push_back("");
+				}
+				break;
+			}
+			CompileNumber(*s.D.If.Cond);
+			const size_t jumpFalse = Emit(OpJumpIfZero);
+			CompileString(*s.D.If.BTrue);
+			const size_t jumpEnd = Emit(OpJump);
+			Code[jumpFalse].Arg = Code.size();
+			if (s.D.If.BFalse) {
+				CompileString(*s.D.If.BFalse);
+			} else {
+				Emit(OpPushString, Strings.size());
+				Strings.push_back("");
+			}
+			Code[jumpEnd].Arg = Code.size();
+			break;
+		}
+		case EString_SubString: {
+			if (s.D.SubString.String == NULL) {
+				Emit(OpPushString, Strings.size());
+				Strings.push_back("");
+				break;
+			}
+			CompileString(*s.D.SubString.String);
+			const size_t jumpEmpty = Emit(OpJumpIfEmpty);
+			CompileNumber(*s.D.SubString.Begin);
+			const size_t check = Emit(OpSubStringCheck);
+			if (s.D.SubString.End) {
+				CompileNumber(*s.D.SubString.End);
+			} else {
+				Emit(OpPushNumber, -1);
+			}
+			Emit(OpSubString);
+			Code[jumpEmpty].Arg = Code.size();
+			Code[check].Arg = Code.size();
+			break;
+		}
+		case EString_Line: {
+			if (s.D.Line.String == NULL) {
+				Emit(OpPushString, Strings.size());
+				Strings.push_back("");
+				break;
+			}
+			CompileString(*s.D.Line.String);
+			const size_t jumpEmpty = Emit(OpJumpIfEmpty);
+			CompileNumber(*s.D.Line.Line);
+			const size_t check = Emit(OpLineCheck);
+			if (s.D.Line.MaxLen) {
+				CompileNumber(*s.D.Line.MaxLen);
+			} else {
+				Emit(OpPushNumber, 0);
+			}
+			Emit(OpLine, 0, s.D.Line.Font);
+			Code[jumpEmpty].Arg = Code.size();
+			Code[check].Arg = Code.size();
+			break;
+		}
+		case EString_PlayerName:
+			CompileNumber(*s.D.PlayerName);
+			Emit(OpPlayerName);
+			break;
+		default:
+			Emit(OpPushString, Strings.size());
+			Strings.push_back("");
+			break;
+	}
+}
+
+/**
+**  Allocate the stacks of the program.
+**
+**  The depths are computed in code order, ignoring the jumps, which
+**  can only overestimate them.
+*/
+void CScriptProgram::AllocateStacks()
+{
+	int numberDepth = 0;
+	int stringDepth = 0;
+	int maxNumberDepth = 1;
+	int maxStringDepth = 1;
+
+	for (size_t i = 0; i != Code.size(); ++i) {
+		switch (Code[i].Op) {
+			case OpPushNumber: case OpLuaNumber: case OpUnitVar: case OpTypeVar:
+				++numberDepth;
+				break;
+			case OpAdd: case OpSub: case OpMul: case OpDiv: case OpMin: case OpMax:
+			case OpGt: case OpGtEq: case OpLt: case OpLtEq: case OpEq: case OpNEq:
+			case OpJumpIfZero:
+				--numberDepth;
+				break;
+			case OpVideoTextLength: case OpStringFind:
+				++numberDepth;
+				--stringDepth;
+				break;
+			case OpPlayerData:
+				stringDepth -= 2;
+				break;
+			case OpPushString: case OpLuaString: case OpUnitName:
+				++stringDepth;
+				break;
+			case OpConcat:
+				stringDepth -= Code[i].Arg - 1;
+				break;
+			case OpNumberToString: case OpPlayerName:
+				--numberDepth;
+				++stringDepth;
+				break;
+			case OpSubString: case OpLine:
+				numberDepth -= 2;
+				break;
+			default:
+				break;
+		}
+		maxNumberDepth = std::max(maxNumberDepth, numberDepth);
+		maxStringDepth = std::max(maxStringDepth, stringDepth);
+	}
+	Numbers.resize(maxNumberDepth);
+	Texts.resize(maxStringDepth);
+}
+
+/**
+**  Compile a number description.
+**
+**  @param number  Number description, which must live as long as the program.
+**
+**  @return        The new program.
+*/
+/* static */ CScriptProgram *CScriptProgram::Compile(const NumberDesc &number)
+{
+	CScriptProgram *program = new CScriptProgram;
+
+	program->SourceNumber = &number;
+	program->CompileNumber(number);
+	program->AllocateStacks();
+	return program;
+}
+
+/**
+**  Compile a string description.
+**
+**  @param s  String description, which must live as long as the program.
+**
+**  @return   The new program.
+*/
+/* static */ CScriptProgram *CScriptProgram::Compile(const StringDesc &s)
+{
+	CScriptProgram *program = new CScriptProgram;
+
+	program->SourceString = &s;
+	program->CompileString(s);
+	program->AllocateStacks();
+	return program;
+}
+
+/**
+**  Execute the program, leaving its result at the bottom of the stack.
+**
+**  @note The stacks belong to the program, so a program must not be
+**  evaluated again by the lua functions it calls.
+*/
+void CScriptProgram::Run() const
+{
+	int *numbers = &Numbers[0] - 1;       // top of the number stack
+	std::string *texts = &Texts[0] - 1;   // top of the string stack
+	const Instruction *code = &Code[0];
+	const size_t size = Code.size();
+
+	for (size_t pc = 0; pc < size; ++pc) {
+		const Instruction &ins = code[pc];
+
+		switch (ins.Op) {
+			case OpPushNumber:
+				*++numbers = ins.Arg;
+				break;
+			case OpLuaNumber:
+				*++numbers = CallLuaNumberFunction(ins.Arg);
+				break;
+			case OpAdd:
+				--numbers;
+				numbers[0] += numbers[1];
+				break;
+			case OpSub:
+				--numbers;
+				numbers[0] -= numbers[1];
+				break;
+			case OpMul:
+				--numbers;
+				numbers[0] *= numbers[1];
+				break;
+			case OpDiv:
+				--numbers;
+				numbers[0] = numbers[1] ? numbers[0] / numbers[1] : 0;
+				break;
+			case OpMin:
+				--numbers;
+				numbers[0] = std::min(numbers[0], numbers[1]);
+				break;
+			case OpMax:
+				--numbers;
+				numbers[0] = std::max(numbers[0], numbers[1]);
+				break;
+			case OpGt:
+				--numbers;
+				numbers[0] = numbers[0] > numbers[1] ? 1 : 0;
+				break;
+			case OpGtEq:
+				--numbers;
+				numbers[0] = numbers[0] >= numbers[1] ? 1 : 0;
+				break;
+			case OpLt:
+				--numbers;
+				numbers[0] = numbers[0] < numbers[1] ? 1 : 0;
+				break;
+			case OpLtEq:
+				--numbers;
+				numbers[0] = numbers[0] <= numbers[1] ? 1 : 0;
+				break;
+			case OpEq:
+				--numbers;
+				numbers[0] = numbers[0] == numbers[1] ? 1 : 0;
+				break;
+			case OpNEq:
+				--numbers;
+				numbers[0] = numbers[0] != numbers[1] ? 1 : 0;
+				break;
+			case OpRand:
+				*numbers = SyncRand() % *numbers;
+				break;
+			case OpUnitVar: {
+				const CUnit *unit = EvalUnit(static_cast<const UnitDesc *>(ins.Ptr));
+				*++numbers = unit ? GetComponent(*unit, ins.Index, ins.Component, ins.Arg).i : 0;
+				break;
+			}
+			case OpTypeVar: {
+				// The description may have no type
+				const CUnitType *type = ins.Ptr ? *static_cast<CUnitType *const *>(ins.Ptr) : NULL;
+				*++numbers = type ? GetComponent(*type, ins.Index, ins.Component, ins.Arg).i : 0;
+				break;
+			}
+			case OpVideoTextLength:
+				*++numbers = texts->empty() ? 0 : static_cast<const CFont *>(ins.Ptr)->Width(*texts);
+				--texts;
+				break;
+			case OpStringFind:
+				if (texts->empty()) {
+					*++numbers = 0;
+				} else {
+					const size_t pos = texts->find((char)ins.Arg);
+					*++numbers = pos != std::string::npos ? (int)pos : -1;
+				}
+				--texts;
+				break;
+			case OpPlayerData:
+				texts -= 2;
+				*numbers = GetPlayerData(*numbers, texts[1].c_str(), texts[2].c_str());
+				break;
+			case OpJump:
+				pc = ins.Arg - 1;
+				break;
+			case OpJumpIfZero:
+				if (!*numbers--) {
+					pc = ins.Arg - 1;
+				}
+				break;
+			case OpJumpIfEmpty:
+				if (texts->empty()) {
+					pc = ins.Arg - 1;
+				}
+				break;
+			case OpPushString:
+				*++texts = Strings[ins.Arg];
+				break;
+			case OpLuaString:
+				*++texts = CallLuaStringFunction(ins.Arg);
+				break;
+			case OpConcat:
+				texts -= ins.Arg - 1;
+				for (int i = 1; i < ins.Arg; ++i) {
+					*texts += texts[i];
+				}
+				break;
+			case OpNumberToString: {
+				char buffer[16]; // Should be enough ?
+				sprintf(buffer, "%d", *numbers--);
+				*++texts = buffer;
+				break;
+			}
+			case OpInverseVideo:
+				// FIXME replace existing "~<" by "~>" in the string.
+				texts->insert(0, "~<");
+				*texts += "~>";
+				break;
+			case OpUnitName: {
+				const CUnit *unit = EvalUnit(static_cast<const UnitDesc *>(ins.Ptr));
+				*++texts = unit ? unit->Type->Name : "";
+				break;
+			}
+			case OpSubStringCheck:
+				if ((unsigned)*numbers > texts->size() && *numbers > 0) {
+					--numbers;
+					texts->clear();
+					pc = ins.Arg - 1;
+				}
+				break;
+			case OpSubString: {
+				numbers -= 2;
+				const int begin = numbers[1];
+				const int end = numbers[2];
+				std::string res = texts->c_str() + begin;
+
+				if ((unsigned)end < res.size() && end >= 0) {
+					res[end] = '\0';
+				}
+				texts->swap(res);
+				break;
+			}
+			case OpLineCheck:
+				if (*numbers <= 0) {
+					--numbers;
+					texts->clear();
+					pc = ins.Arg - 1;
+				}
+				break;
+			case OpLine: {
+				numbers -= 2;
+				const int maxlen = std::max(numbers[2], 0);
+				*texts = GetLineFont(numbers[1], *texts, maxlen, static_cast<const CFont *>(ins.Ptr));
+				break;
+			}
+			case OpPlayerName:
+				*++texts = Players[*numbers--].Name;
+				break;
+		}
+	}
+}
+
+/**
+**  Evaluate a number program.
+*/
+int CScriptProgram::EvalNumber() const
+{
+	Run();
+	return Numbers[0];
+}
+
+/**
+**  Evaluate a string program.
+*/
+std::string CScriptProgram::EvalString() const
+{
+	Run();
+	return Texts[0];
+}
+
+/**
+**  Compare the evaluation of the descriptions with and without their program.
+**
+**  The descriptions using Rand are skipped as they change the synced random.
+**
+**  @param file        Where to print the results.
+**  @param iterations  Number of evaluations of each description.
+*/
+/* static */ void CScriptProgram::PrintBenchmark(FILE *file, int iterations)
+{
+	clock_t treeTime = 0;
+	clock_t programTime = 0;
+	int count = 0;
+	int differences = 0;
+	size_t instructions = 0;
+
+	for (size_t i = 0; i != Programs.size(); ++i) {
+		const CScriptProgram &program = *Programs[i];
+		bool usesRand = false;
+
+		for (size_t j = 0; j != program.Code.size(); ++j) {
+			usesRand |= program.Code[j].Op == OpRand;
+		}
+		if (usesRand) {
+			continue;
+		}
+		++count;
+		instructions += program.Code.size();
+
+		clock_t start = clock();
+		if (program.SourceNumber) {
+			int result = 0;
+			for (int j = 0; j != iterations; ++j) {
+				result = EvalNumberTree(program.SourceNumber);
+			}
+			treeTime += clock() - start;
+			start = clock();
+			differences += result != program.EvalNumber();
+			for (int j = 1; j < iterations; ++j) {
+				program.EvalNumber();
+			}
+		} else {
+			std::string result;
+			for (int j = 0; j != iterations; ++j) {
+				result = EvalStringTree(program.SourceString);
+			}
+			treeTime += clock() - start;
+			start = clock();
+			differences += result != program.EvalString();
+			for (int j = 1; j < iterations; ++j) {
+				program.EvalString();
+			}
+		}
+		programTime += clock() - start;
+	}
+	fprintf(file, "%d descriptions (%d instructions), %d evaluations: tree %.3fs, program %.3fs, %d differences\n",
+			count, (int)instructions, iterations,
+			double(treeTime) / CLOCKS_PER_SEC, double(programTime) / CLOCKS_PER_SEC, differences);
+}
+
+//@}
@@ -191,6 +191,7 @@ extern void beos_init(int argc, char **argv);
 #include "network.h"
 #include "parameters.h"
 #include "player.h"
+#include "pool.h"
 #include "replay.h"
 #include "results.h"
 #include "settings.h"
@@ -206,6 +207,9 @@ extern void beos_init(int argc, char **argv);
 
 #include "missile.h" //for FreeBurningBuildingFrames
 
+extern void StartMap(const std::string &filename, bool clean);
+extern void StartSavedGame(const std::string &filename);
+
 #ifdef USE_STACKTRACE
 #include <stdexcept>
 #include <stacktrace/call_stack.hpp>
@@ -239,6 +243,8 @@ std::string StratagusLibPath;        /// Path for data directory
 const char NameLine[] = NAME " v" VERSION ", " COPYRIGHT;
 
 std::string CliMapName;          /// Filename of the map given on the command line
+unsigned long HeadlessCycles;    /// Cycles to simulate without video, sound and input (0 for a normal game)
+std::string HeadlessSaveFile;    /// Savegame written at the end of the headless mode, empty for none
 std::string MenuRace;
 
 bool EnableDebugPrint;           /// if enabled, print the debug messages
@@ -388,6 +394,30 @@ void PrintLicense()
 }
 
 
+/**
+**  Run the map, the replay or the savegame given on the command line in
+**  headless mode.
+**
+**  A file ending with ".log" is started as a replay, with ".sav" or
+**  ".sav.gz" as a savegame, else as a map.
+*/
+static void HeadlessLoop()
+{
+	initGuichan();
+	InterfaceState = IfaceStateMenu;
+	GameCursor = UI.Point.Cursor;
+
+	const size_t length = CliMapName.size();
+	if (length > 4 && CliMapName.compare(length - 4, 4, ".log") == 0) {
+		StartReplay(CliMapName, false, 0);
+	} else if ((length > 4 && CliMapName.compare(length - 4, 4, ".sav") == 0)
+			   || (length > 7 && CliMapName.compare(length - 7, 7, ".sav.gz") == 0)) {
+		StartSavedGame(CliMapName);
+	} else {
+		StartMap(CliMapName, true);
+	}
+}
+
 /**
 **  Exit the game.
 **
@@ -418,6 +448,7 @@ void Exit(int err)
 			   (SlowFrameCounter * 100) / (FrameCounter ? FrameCounter : 1));
 	lua_settop(Lua, 0);
 	lua_close(Lua);
+	CleanClassPools();
 	DeInitVideo();
 
 	fprintf(stdout, "%s", _("Thanks for playing Stratagus.\n"));
@@ -455,8 +486,11 @@ static void Usage()
 		"\t-F\t\tFull screen video mode\n"
 		"\t-G \"options\"\tGame options (passed to game scripts)\n"
 		"\t-h\t\tHelp shows this page\n"
+		"\t-H cycles\tHeadless mode: simulate the map, replay (.log) or savegame (.sav) for cycles\n"
+		"\t  \t\tgame cycles without video, sound and input, then print the timings and the SyncHash\n"
 		"\t-i\t\tEnables unit info dumping into log (for debugging)\n"
 		"\t-I addr\t\tNetwork address to use\n"
+		"\t-k file.sav\tSave the game at the end of the headless mode, in the save directory\n"
 		"\t-l\t\tDisable command log\n"
 		"\t-N name\t\tName of the player\n"
 #if defined(USE_OPENGL) || defined(USE_GLES)
@@ -523,7 +557,7 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 {
 	char *sep;
 	for (;;) {
-		switch (getopt(argc, argv, "ac:d:D:eE:FG:hiI:lN:oOP:ps:S:u:v:Wx:Z:?-")) {
+		switch (getopt(argc, argv, "ac:d:D:eE:FG:hH:iI:k:lN:oOP:ps:S:u:v:Wx:Z:?-")) {
 			case 'a':
 				EnableAssert = true;
 				continue;
@@ -558,12 +592,23 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			case 'G':
 				parameters.luaScriptArguments = optarg;
 				continue;
+			case 'H':
+				HeadlessCycles = strtoul(optarg, NULL, 0);
+				if (!HeadlessCycles) {
+					fprintf(stderr, "%s: incorrect number of headless cycles\n", optarg);
+					Usage();
+					ExitFatal(-1);
+				}
+				continue;
 			case 'i':
 				EnableUnitDebug = true;
 				continue;
 			case 'I':
 				CNetworkParameter::Instance.localHost = optarg;
 				continue;
+			case 'k':
+				HeadlessSaveFile = optarg;
+				continue;
 			case 'l':
 				CommandLogDisabled = true;
 				continue;
@@ -678,6 +723,12 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			CliMapName[index] = '/';
 		}
 	}
+
+	if (HeadlessCycles && CliMapName.empty()) {
+		fprintf(stderr, "headless mode needs a map or a replay file\n");
+		Usage();
+		ExitFatal(-1);
+	}
 }
 
 #ifdef USE_WIN32
@@ -754,6 +805,7 @@ int stratagusMain(int argc, char **argv)
 	makedir(parameters.GetUserDirectory().c_str(), 0777);
 
 	// Init Lua and register lua functions!
+	StartLoadPhase("scripts");
 	InitLua();
 	LuaRegisterModules();
 
@@ -766,10 +818,22 @@ int stratagusMain(int argc, char **argv)
 	PrintLicense();
 
 	// Setup video display
+	StartLoadPhase("video");
+	if (HeadlessCycles) {
+		// The map still loads its graphics, so draw them on a dummy surface.
+		SDL_putenv(strdup("SDL_VIDEODRIVER=dummy"));
+		SDL_putenv(strdup("SDL_AUDIODRIVER=dummy"));
+		Video.FullScreen = false;
+#if defined(USE_OPENGL) || defined(USE_GLES)
+		ForceUseOpenGL = 1;
+		UseOpenGL = false;
+#endif
+	}
 	InitVideo();
 
 	// Setup sound card
-	if (!InitSound()) {
+	StartLoadPhase("sound");
+	if (!HeadlessCycles && !InitSound()) {
 		InitMusic();
 	}
 
@@ -778,8 +842,10 @@ int stratagusMain(int argc, char **argv)
 #endif
 
 	//  Show title screens.
+	StartLoadPhase("fonts");
 	SetDefaultTextColors(FontYellow, FontWhite);
 	LoadFonts();
+	EndLoadPhases("startup");
 	SetClipping(0, 0, Video.Width - 1, Video.Height - 1);
 	Video.ClearScreen();
 	ShowTitleScreens();
@@ -790,10 +856,15 @@ int stratagusMain(int argc, char **argv)
 	// memset(Players, 0, sizeof(Players));
 	NumPlayers = 0;
 
+	InitClassPools();   // Memory of the units, orders, missiles and particles
 	UnitManager.Init(); // Units memory management
 	PreMenuSetup();     // Load everything needed for menus
 
-	MenuLoop();
+	if (HeadlessCycles) {
+		HeadlessLoop();
+	} else {
+		MenuLoop();
+	}
 
 	Exit(0);
 #ifdef USE_STACKTRACE
@@ -280,12 +280,22 @@ bool IconConfig::Load()
 */
 void LoadIcons()
 {
+	std::vector<std::string> files;
+
+	for (IconMap::iterator it = Icons.begin(); it != Icons.end(); ++it) {
+		const CGraphic *g = (*it).second->G;
+		if (!g->IsLoaded()) {
+			files.push_back(g->File);
+		}
+	}
+	PreloadGraphics(files);
 	for (IconMap::iterator it = Icons.begin(); it != Icons.end(); ++it) {
 		CIcon &icon = *(*it).second;
 
 		ShowLoadProgress(_("Icons %s"), icon.G->File.c_str());
 		icon.Load();
 	}
+	FreePreloadedGraphics();
 }
 
 /**
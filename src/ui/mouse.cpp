@@ -111,7 +111,7 @@ static bool CanBuildOnArea(const CUnit &unit, const Vec2i &pos)
 	for (int j = 0; j < unit.Type->TileHeight; ++j) {
 		for (int i = 0; i < unit.Type->TileWidth; ++i) {
 			const Vec2i tempPos(i, j);
-			if (!Map.Field(pos + tempPos)->playerInfo.IsExplored(*ThisPlayer)) {
+			if (!Map.IsFieldExplored(*ThisPlayer, pos + tempPos)) {
 				return false;
 			}
 		}
@@ -246,7 +246,7 @@ static bool DoRightButton_Harvest_Unit(CUnit &unit, CUnit &dest, int flush, int
 
 static bool DoRightButton_Harvest_Pos(CUnit &unit, const Vec2i &pos, int flush, int &acknowledged)
 {
-	if (!Map.Field(pos)->playerInfo.IsExplored(*unit.Player)) {
+	if (!Map.IsFieldExplored(*unit.Player, pos)) {
 		return false;
 	}
 	const CUnitType &type = *unit.Type;
@@ -478,7 +478,7 @@ static bool DoRightButton_NewOrder(CUnit &unit, CUnit *dest, const Vec2i &pos, i
 	}
 	// FIXME: support harvesting more types of terrain.
 	const CMapField &mf = *Map.Field(pos);
-	if (mf.playerInfo.IsExplored(*unit.Player) && mf.IsTerrainResourceOnMap()) {
+	if (Map.IsFieldExplored(*unit.Player, pos) && mf.IsTerrainResourceOnMap()) {
 		if (!acknowledged) {
 			PlayUnitSound(unit, VoiceAcknowledging);
 			acknowledged = 1;
@@ -1000,9 +1000,8 @@ void UIHandleMouseMove(const PixelPos &cursorPos)
 
 		bool show = ReplayRevealMap ? true : false;
 		if (show == false) {
-			CMapField &mf = *Map.Field(tilePos);
 			for (int i = 0; i < PlayerMax; ++i) {
-				if (mf.playerInfo.IsExplored(Players[i])
+				if (Map.IsFieldExplored(Players[i], tilePos)
 					&& (i == ThisPlayer->Index || Players[i].IsBothSharedVision(*ThisPlayer))) {
 					show = true;
 					break;
@@ -1017,7 +1016,7 @@ void UIHandleMouseMove(const PixelPos &cursorPos)
 	} else if (CursorOn == CursorOnMinimap) {
 		const Vec2i tilePos = UI.Minimap.ScreenToTilePos(cursorPos);
 
-		if (Map.Field(tilePos)->playerInfo.IsExplored(*ThisPlayer) || ReplayRevealMap) {
+		if (Map.IsFieldExplored(*ThisPlayer, tilePos) || ReplayRevealMap) {
 			UnitUnderCursor = UnitOnMapTile(tilePos, -1);
 		}
 	}
@@ -1289,7 +1288,7 @@ static int SendResource(const Vec2i &pos)
 				for (res = 0; res < MaxCosts; ++res) {
 					if (unit.Type->ResInfo[res]
 						&& unit.Type->ResInfo[res]->TerrainHarvester
-						&& mf.playerInfo.IsExplored(*unit.Player)
+						&& Map.IsFieldExplored(*unit.Player, pos)
 						&& mf.IsTerrainResourceOnMap(res)
 						&& unit.ResourcesHeld < unit.Type->ResInfo[res]->ResourceCapacity
 						&& (unit.CurrentResource != res || unit.ResourcesHeld < unit.Type->ResInfo[res]->ResourceCapacity)) {
@@ -1310,7 +1309,7 @@ static int SendResource(const Vec2i &pos)
 				ret = 1;
 				continue;
 			}
-			if (mf.playerInfo.IsExplored(*unit.Player) && mf.IsTerrainResourceOnMap()) {
+			if (Map.IsFieldExplored(*unit.Player, pos) && mf.IsTerrainResourceOnMap()) {
 				SendCommandResourceLoc(unit, pos, flush);
 				ret = 1;
 				continue;
@@ -2027,7 +2026,7 @@ void UIHandleButtonUp(unsigned button)
 			// FIXME: johns: only complete invisibile units
 			const Vec2i cursorTilePos = UI.MouseViewport->ScreenToTilePos(CursorScreenPos);
 			CUnit *unit = NULL;
-			if (ReplayRevealMap || Map.Field(cursorTilePos)->playerInfo.IsTeamVisible(*ThisPlayer)) {
+			if (ReplayRevealMap || Map.IsFieldTeamVisible(*ThisPlayer, cursorTilePos)) {
 				const PixelPos cursorMapPos = UI.MouseViewport->ScreenToMapPixelPos(CursorScreenPos);
 
 				unit = UnitOnScreen(cursorMapPos.x, cursorMapPos.y);
@@ -535,7 +535,7 @@ CUnit *CanBuildUnitType(const CUnit *unit, const CUnitType &type, const Vec2i &p
 				ontop = NULL;
 				break;
 			}
-			if (player && !mf.playerInfo.IsExplored(*player)) {
+			if (player && !Map.IsFieldExplored(*player, index + pos.x + w)) {
 				h = type.TileHeight;
 				ontop = NULL;
 				break;
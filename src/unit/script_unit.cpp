@@ -600,6 +600,7 @@ static int CclUnit(lua_State *l)
 	if (unit->RescuedFrom) {
 		unit->Colors = &unit->RescuedFrom->UnitColors;
 	}
+	UnitManager.UpdateHotState(*unit);
 
 	return 0;
 }
@@ -1232,6 +1233,7 @@ static int CclSetUnitVariable(lua_State *l)
 			}
 		}
 	}
+	UnitManager.UpdateHotState(*unit);
 	lua_pushnumber(l, value);
 	return 1;
 }
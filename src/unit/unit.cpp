@@ -53,10 +53,12 @@
 #include "network.h"
 #include "pathfinder.h"
 #include "player.h"
+#include "pool.h"
 #include "script.h"
 #include "sound.h"
 #include "sound_server.h"
 #include "spells.h"
+#include "tileset.h"
 #include "translate.h"
 #include "ui.h"
 #include "unit_find.h"
@@ -399,6 +401,19 @@ void CUnit::RefsDecrease()
 	}
 }
 
+/// Memory of the units
+static CClassPool UnitPool("units", 64);
+
+void *CUnit::operator new(size_t size)
+{
+	return UnitPool.Alloc(size);
+}
+
+void CUnit::operator delete(void *p, size_t size)
+{
+	UnitPool.Free(p, size);
+}
+
 void CUnit::Init()
 {
 	Refs = 0;
@@ -498,6 +513,7 @@ void CUnit::Release(bool final)
 
 		// Are more references remaining?
 		Destroyed = 1; // mark as destroyed
+		UnitManager.UpdateHotState(*this, false);
 
 		if (Container && !final) {
 			if (Boarded) {
@@ -637,6 +653,7 @@ void CUnit::Init(const CUnitType &type)
 	SavedOrder = NULL;
 	Assert(CriticalOrder == NULL);
 	CriticalOrder = NULL;
+	UnitManager.UpdateHotState(*this);
 }
 
 /**
@@ -800,6 +817,36 @@ static void MapMarkUnitSightRec(const CUnit &unit, const Vec2i &pos, int width,
 	}
 }
 
+/**
+**  (Un)Mark on vision table the Sight of the unit which is not seen from
+**  an other position (and units inside for transporter (recursively))
+**
+**  @param unit      Unit to (un)mark.
+**  @param pos       coord of first container of unit.
+**  @param otherPos  other coord of first container of unit.
+**  @param width     Width of the first container of unit.
+**  @param height    Height of the first container of unit.
+**  @param f         Function to (un)mark for normal vision.
+**  @param f2        Function to (un)mark for cloaking vision.
+*/
+static void MapMarkUnitSightDeltaRec(const CUnit &unit, const Vec2i &pos, const Vec2i &otherPos,
+									 int width, int height, MapMarkerFunc *f, MapMarkerFunc *f2)
+{
+	Assert(f);
+	MapSightDelta(*unit.Player, pos, otherPos, width, height,
+				  unit.Container ? unit.Container->CurrentSightRange : unit.CurrentSightRange, f);
+
+	if (unit.Type && unit.Type->BoolFlag[DETECTCLOAK_INDEX].value && f2) {
+		MapSightDelta(*unit.Player, pos, otherPos, width, height,
+					  unit.Container ? unit.Container->CurrentSightRange : unit.CurrentSightRange, f2);
+	}
+
+	CUnit *unit_inside = unit.UnitInside;
+	for (int i = unit.InsideCount; i--; unit_inside = unit_inside->NextContained) {
+		MapMarkUnitSightDeltaRec(*unit_inside, pos, otherPos, width, height, f, f2);
+	}
+}
+
 /**
 **  Return the unit not transported, by viewing the container recursively.
 **
@@ -817,6 +864,40 @@ CUnit *GetFirstContainer(const CUnit &unit)
 	return const_cast<CUnit *>(container);
 }
 
+/**
+**  Mark the radar and the radar jammer of the unit.
+**
+**  @param unit  unit on the map.
+*/
+static void MapMarkUnitRadar(const CUnit &unit)
+{
+	if (unit.Stats->Variables[RADAR_INDEX].Value) {
+		MapMarkRadar(*unit.Player, unit.tilePos, unit.Type->TileWidth,
+					 unit.Type->TileHeight, unit.Stats->Variables[RADAR_INDEX].Value);
+	}
+	if (unit.Stats->Variables[RADARJAMMER_INDEX].Value) {
+		MapMarkRadarJammer(*unit.Player, unit.tilePos, unit.Type->TileWidth,
+						   unit.Type->TileHeight, unit.Stats->Variables[RADARJAMMER_INDEX].Value);
+	}
+}
+
+/**
+**  Unmark the radar and the radar jammer of the unit.
+**
+**  @param unit  unit on the map.
+*/
+static void MapUnmarkUnitRadar(const CUnit &unit)
+{
+	if (unit.Stats->Variables[RADAR_INDEX].Value) {
+		MapUnmarkRadar(*unit.Player, unit.tilePos, unit.Type->TileWidth,
+					   unit.Type->TileHeight, unit.Stats->Variables[RADAR_INDEX].Value);
+	}
+	if (unit.Stats->Variables[RADARJAMMER_INDEX].Value) {
+		MapUnmarkRadarJammer(*unit.Player, unit.tilePos, unit.Type->TileWidth,
+							 unit.Type->TileHeight, unit.Stats->Variables[RADARJAMMER_INDEX].Value);
+	}
+}
+
 /**
 **  Mark on vision table the Sight of the unit
 **  (and units inside for transporter)
@@ -834,14 +915,7 @@ void MapMarkUnitSight(CUnit &unit)
 
 	// Never mark radar, except if the top unit, and unit is usable
 	if (&unit == container && !unit.IsUnusable()) {
-		if (unit.Stats->Variables[RADAR_INDEX].Value) {
-			MapMarkRadar(*unit.Player, unit.tilePos, unit.Type->TileWidth,
-						 unit.Type->TileHeight, unit.Stats->Variables[RADAR_INDEX].Value);
-		}
-		if (unit.Stats->Variables[RADARJAMMER_INDEX].Value) {
-			MapMarkRadarJammer(*unit.Player, unit.tilePos, unit.Type->TileWidth,
-							   unit.Type->TileHeight, unit.Stats->Variables[RADARJAMMER_INDEX].Value);
-		}
+		MapMarkUnitRadar(unit);
 	}
 }
 
@@ -864,14 +938,50 @@ void MapUnmarkUnitSight(CUnit &unit)
 
 	// Never mark radar, except if the top unit?
 	if (&unit == container && !unit.IsUnusable()) {
-		if (unit.Stats->Variables[RADAR_INDEX].Value) {
-			MapUnmarkRadar(*unit.Player, unit.tilePos, unit.Type->TileWidth,
-						   unit.Type->TileHeight, unit.Stats->Variables[RADAR_INDEX].Value);
-		}
-		if (unit.Stats->Variables[RADARJAMMER_INDEX].Value) {
-			MapUnmarkRadarJammer(*unit.Player, unit.tilePos, unit.Type->TileWidth,
-								 unit.Type->TileHeight, unit.Stats->Variables[RADARJAMMER_INDEX].Value);
-		}
+		MapUnmarkUnitRadar(unit);
+	}
+}
+
+/**
+**  Unmark on vision table the Sight of the unit which will not be seen
+**  anymore when the unit moves (and units inside for transporter)
+**
+**  The tiles seen from both positions keep their counters, so the
+**  sight is not unmarked and marked again for each step of the unit.
+**
+**  @param unit    unit to unmark its vision, not transported.
+**  @param newPos  position where the unit goes.
+**  @see MapMarkUnitSightMoved.
+*/
+void MapUnmarkUnitSightMoving(CUnit &unit, const Vec2i &newPos)
+{
+	Assert(unit.Type);
+	Assert(!unit.Container);
+
+	MapMarkUnitSightDeltaRec(unit, unit.tilePos, newPos, unit.Type->TileWidth, unit.Type->TileHeight,
+							 MapUnmarkTileSight, MapUnmarkTileDetectCloak);
+	if (!unit.IsUnusable()) {
+		MapUnmarkUnitRadar(unit);
+	}
+}
+
+/**
+**  Mark on vision table the Sight of the unit which was not seen before
+**  the unit moved (and units inside for transporter)
+**
+**  @param unit    unit to mark its vision, not transported.
+**  @param oldPos  position where the unit was.
+**  @see MapUnmarkUnitSightMoving.
+*/
+void MapMarkUnitSightMoved(CUnit &unit, const Vec2i &oldPos)
+{
+	Assert(unit.Type);
+	Assert(!unit.Container);
+
+	MapMarkUnitSightDeltaRec(unit, unit.tilePos, oldPos, unit.Type->TileWidth, unit.Type->TileHeight,
+							 MapMarkTileSight, MapMarkTileDetectCloak);
+	if (!unit.IsUnusable()) {
+		MapMarkUnitRadar(unit);
 	}
 }
 
@@ -935,6 +1045,9 @@ void MarkUnitFieldFlags(const CUnit &unit)
 		} while (--w);
 		index += Map.Info.MapWidth;
 	} while (--h);
+	if (flags & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)) {
+		PathfinderTerrainChanged(unit.tilePos, Vec2i(width, unit.Type->TileHeight));
+	}
 }
 
 class _UnmarkUnitFieldFlags
@@ -983,6 +1096,9 @@ void UnmarkUnitFieldFlags(const CUnit &unit)
 		} while (--w);
 		index += Map.Info.MapWidth;
 	} while (--h);
+	if (~flags & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)) {
+		PathfinderTerrainChanged(unit.tilePos, Vec2i(width, unit.Type->TileHeight));
+	}
 }
 
 /**
@@ -1062,7 +1178,10 @@ static void UnitInXY(CUnit &unit, const Vec2i &pos)
 */
 void CUnit::MoveToXY(const Vec2i &pos)
 {
-	MapUnmarkUnitSight(*this);
+	const Vec2i oldPos = tilePos;
+
+	// Only the sight which changes is unmarked and marked.
+	MapUnmarkUnitSightMoving(*this, pos);
 	Map.Remove(*this);
 	UnmarkUnitFieldFlags(*this);
 
@@ -1074,7 +1193,7 @@ void CUnit::MoveToXY(const Vec2i &pos)
 	MarkUnitFieldFlags(*this);
 	//  Recalculate the seen count.
 	UnitCountSeen(*this);
-	MapMarkUnitSight(*this);
+	MapMarkUnitSightMoved(*this, oldPos);
 }
 
 /**
@@ -1094,6 +1213,7 @@ void CUnit::Place(const Vec2i &pos)
 		UpdateUnitSightRange(*this);
 	}
 	Removed = 0;
+	UnitManager.UpdateHotState(*this, false);
 	UnitInXY(*this, pos);
 	// Pathfinding info.
 	MarkUnitFieldFlags(*this);
@@ -1218,6 +1338,7 @@ void CUnit::Remove(CUnit *host)
 	}
 
 	Removed = 1;
+	UnitManager.UpdateHotState(*this, false);
 
 	// Correct surrounding walls directions
 	if (this->Type->BoolFlag[WALL_INDEX].value) {
@@ -1352,6 +1473,7 @@ void UnitClearOrders(CUnit &unit)
 	}
 	unit.Orders.clear();
 	unit.Orders.push_back(COrder::NewActionStill());
+	UnitManager.UpdateHotState(unit, false);
 }
 
 /**
@@ -1595,7 +1717,7 @@ void UnitCountSeen(CUnit &unit)
 							newv++;
 						}
 					} else {
-						if (mf->playerInfo.IsVisible(Players[p])) {
+						if (mf->IsVisible(Players[p])) {
 							newv++;
 						}
 					}
@@ -1765,6 +1887,9 @@ void CUnit::ChangeOwner(CPlayer &newplayer)
 
 	MapUnmarkUnitSight(*this);
 	newplayer.AddUnit(*this);
+	if (!Removed) {
+		Map.ChangeUnitOwner(*this, *oldplayer);
+	}
 	Stats = &Type->Stats[newplayer.Index];
 	UpdateUnitSightRange(*this);
 	MapMarkUnitSight(*this);
@@ -2320,6 +2445,7 @@ void LetUnitDie(CUnit &unit, bool suicide)
 	unit.Variable[HP_INDEX].Value = std::min<int>(0, unit.Variable[HP_INDEX].Value);
 	unit.Moving = 0;
 	unit.TTL = 0;
+	UnitManager.UpdateHotState(unit, false);
 	unit.Anim.Unbreakable = 0;
 
 	const CUnitType *type = unit.Type;
@@ -2412,6 +2538,7 @@ void LetUnitDie(CUnit &unit, bool suicide)
 		// Recalculate the seen count.
 		//UnitCountSeen(unit);
 	}
+	UnitManager.UpdateHotState(unit, false);
 	MapMarkUnitSight(unit);
 }
 
@@ -2494,6 +2621,9 @@ static void HitUnit_LastAttack(const CUnit *attacker, CUnit &target)
 	const unsigned long lastattack = target.Attacked;
 
 	target.Attacked = GameCycle ? GameCycle : 1;
+	if (target.Player == ThisPlayer) {
+		UI.Minimap.MarkUnitDirty(target); // blinks on the minimap
+	}
 	if (target.Type->BoolFlag[WALL_INDEX].value || (lastattack && GameCycle <= lastattack + 2 * CYCLES_PER_SECOND)) {
 		return;
 	}
@@ -2632,6 +2762,7 @@ static void HitUnit_ChangeVariable(CUnit &target, const Missile &missile)
 			target.Variable[var].Value = target.Variable[var].Max;
 		}
 	}
+	UnitManager.UpdateHotState(target);
 }
 
 
@@ -2712,6 +2843,7 @@ static void HitUnit_AttackBack(CUnit &attacker, CUnit &target)
 		// Set threshold value only for aggressive units
 		if (best->IsAgressive()) {
 			target.Threshold = threshold;
+			UnitManager.UpdateHotState(target);
 		}
 		if (savedOrder != NULL) {
 			target.SavedOrder = savedOrder;
@@ -2834,6 +2966,7 @@ void HitUnit(CUnit *attacker, CUnit &target, int damage, const Missile *missile)
 
 	if (target.Threshold && target.CurrentOrder()->HasGoal() && target.CurrentOrder()->GetGoal() == attacker) {
 		target.Threshold = threshold;
+		UnitManager.UpdateHotState(target);
 		return;
 	}
 
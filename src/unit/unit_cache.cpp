@@ -43,6 +43,9 @@
 #include "unit.h"
 #include "unittype.h"
 #include "map.h"
+#include "player.h"
+#include "trigger.h"
+#include "ui.h"
 
 /**
 **  Insert new unit into cache.
@@ -57,11 +60,14 @@ void CMap::Insert(CUnit &unit)
 	const int h = unit.Type->TileHeight;
 	int j, i = h;
 
+	TriggerUnitChanged(*unit.Player, *unit.Type);
+	UI.Minimap.MarkUnitDirty(unit);
 	do {
 		CMapField *mf = Field(index);
 		j = w;
 		do {
 			mf->UnitCache.Insert(&unit);
+			UnitCells.Add(Vec2i(unit.tilePos.x + w - j, unit.tilePos.y + h - i), unit.Player->Index);
 			++mf;
 		} while (--j && unit.tilePos.x + (j - w) < Info.MapWidth);
 		index += Info.MapWidth;
@@ -81,17 +87,135 @@ void CMap::Remove(CUnit &unit)
 	const int h = unit.Type->TileHeight;
 	int j, i = h;
 
+	TriggerUnitChanged(*unit.Player, *unit.Type);
+	UI.Minimap.MarkUnitDirty(unit);
 	do {
 		CMapField *mf = Field(index);
 		j = w;
 		do {
 			mf->UnitCache.Remove(&unit);
+			UnitCells.Sub(Vec2i(unit.tilePos.x + w - j, unit.tilePos.y + h - i), unit.Player->Index);
 			++mf;
 		} while (--j && unit.tilePos.x + (j - w) < Info.MapWidth);
 		index += Info.MapWidth;
 	} while (--i && unit.tilePos.y + (i - h) < Info.MapHeight);
 }
 
+/**
+**  Change the owner of a unit in the cache.
+**
+**  @param unit       Unit on the map, already given to its new player.
+**  @param oldPlayer  Previous owner of the unit.
+*/
+void CMap::ChangeUnitOwner(const CUnit &unit, const CPlayer &oldPlayer)
+{
+	Assert(!unit.Removed);
+	const int w = unit.Type->TileWidth;
+	const int h = unit.Type->TileHeight;
+
+	TriggerUnitChanged(oldPlayer, *unit.Type);
+	TriggerUnitChanged(*unit.Player, *unit.Type);
+	UI.Minimap.MarkUnitDirty(unit);
+	for (int y = 0; y != h; ++y) {
+		for (int x = 0; x != w; ++x) {
+			const Vec2i pos(unit.tilePos.x + x, unit.tilePos.y + y);
+
+			UnitCells.Sub(pos, oldPlayer.Index);
+			UnitCells.Add(pos, unit.Player->Index);
+		}
+	}
+}
+
+/**
+**  Create an empty grid.
+**
+**  @param mapWidth   Width of the map in tiles.
+**  @param mapHeight  Height of the map in tiles.
+*/
+void CUnitCellGrid::Create(int mapWidth, int mapHeight)
+{
+	Width = (mapWidth + CellSize - 1) >> CellShift;
+	Height = (mapHeight + CellSize - 1) >> CellShift;
+	Cells.clear();
+	Cells.resize(Width * Height);
+}
+
+/**
+**  Free the grid.
+*/
+void CUnitCellGrid::Clear()
+{
+	Cells.clear();
+	Width = 0;
+	Height = 0;
+}
+
+/**
+**  Count a tile occupied by a unit.
+**
+**  @param pos     Tile of the unit.
+**  @param player  Index of the owner of the unit.
+*/
+void CUnitCellGrid::Add(const Vec2i &pos, int player)
+{
+	Assert(!Cells.empty());
+	Cell &cell = Cells[(pos.x >> CellShift) + (pos.y >> CellShift) * Width];
+
+	if (cell.Count[player]++ == 0) {
+		cell.Players |= 1 << player;
+	}
+}
+
+/**
+**  Uncount a tile occupied by a unit.
+**
+**  @param pos     Tile of the unit.
+**  @param player  Index of the owner of the unit.
+*/
+void CUnitCellGrid::Sub(const Vec2i &pos, int player)
+{
+	Assert(!Cells.empty());
+	Cell &cell = Cells[(pos.x >> CellShift) + (pos.y >> CellShift) * Width];
+
+	Assert(cell.Count[player] != 0);
+	if (--cell.Count[player] == 0) {
+		cell.Players &= ~(1 << player);
+	}
+}
+
+/**
+**  Check if there are units of some players in a rectangle.
+**
+**  The check is done on whole cells: it can return true when the units
+**  are only near the rectangle, never false when they are in it.
+**
+**  @param ltPos    Top left tile of the rectangle.
+**  @param rbPos    Bottom right tile of the rectangle.
+**  @param players  Bit field of the players.
+**
+**  @return         false if no unit of these players is in the rectangle.
+*/
+bool CUnitCellGrid::HasPlayersIn(const Vec2i &ltPos, const Vec2i &rbPos, unsigned int players) const
+{
+	if (Cells.empty()) {
+		return false;
+	}
+	const int minX = ltPos.x >> CellShift;
+	const int maxX = rbPos.x >> CellShift;
+	const int minY = ltPos.y >> CellShift;
+	const int maxY = rbPos.y >> CellShift;
+
+	for (int y = minY; y <= maxY; ++y) {
+		const Cell *cell = &Cells[minX + y * Width];
+
+		for (int x = minX; x <= maxX; ++x, ++cell) {
+			if (cell->Players & players) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
 
 void CMap::Clamp(Vec2i &pos) const
 {
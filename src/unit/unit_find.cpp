@@ -85,7 +85,7 @@ CUnit *UnitFinder::FindUnitAtPos(const Vec2i &pos) const
 
 VisitResult UnitFinder::Visit(TerrainTraversal &terrainTraversal, const Vec2i &pos, const Vec2i &from)
 {
-	if (!player.AiEnabled && !Map.Field(pos)->playerInfo.IsExplored(player)) {
+	if (!player.AiEnabled && !Map.IsFieldExplored(player, pos)) {
 		return VisitResult_DeadEnd;
 	}
 	// Look if found what was required.
@@ -121,7 +121,7 @@ private:
 
 VisitResult TerrainFinder::Visit(TerrainTraversal &terrainTraversal, const Vec2i &pos, const Vec2i &from)
 {
-	if (!player.AiEnabled && !Map.Field(pos)->playerInfo.IsExplored(player)) {
+	if (!player.AiEnabled && !Map.IsFieldExplored(player, pos)) {
 		return VisitResult_DeadEnd;
 	}
 	// Look if found what was required.
@@ -386,7 +386,7 @@ void ResourceUnitFinder::ResourceUnitFinder_Cost::SetFrom(const CUnit &mine, con
 
 VisitResult ResourceUnitFinder::Visit(TerrainTraversal &terrainTraversal, const Vec2i &pos, const Vec2i &from)
 {
-	if (!worker.Player->AiEnabled && !Map.Field(pos)->playerInfo.IsExplored(*worker.Player)) {
+	if (!worker.Player->AiEnabled && !Map.IsFieldExplored(*worker.Player, pos)) {
 		return VisitResult_DeadEnd;
 	}
 
@@ -1131,6 +1131,34 @@ bool CheckObstaclesBetweenTiles(const Vec2i &unitPos, const Vec2i &goalPos, unsi
 	return true;
 }
 
+/**
+**  Check if there may be enemies around a unit.
+**
+**  @param unit   Unit looking for enemies.
+**  @param range  Distance range to look.
+**
+**  @return       false if there is no enemy unit in the range.
+*/
+static bool HasEnemiesInDistance(const CUnit &unit, int range)
+{
+	// If unit is removed, use containers x and y
+	const CUnit &firstContainer = unit.Container ? *unit.Container : unit;
+	const Vec2i offset(range, range);
+	const Vec2i typeSize(firstContainer.Type->TileWidth - 1, firstContainer.Type->TileHeight - 1);
+	Vec2i minPos = firstContainer.tilePos - offset;
+	Vec2i maxPos = firstContainer.tilePos + typeSize + offset;
+	const CPlayer &player = *unit.Player;
+	unsigned int enemies = 0;
+
+	for (int i = 0; i != PlayerNumNeutral; ++i) {
+		if (player.IsEnemy(i)) {
+			enemies |= 1 << i;
+		}
+	}
+	Map.FixSelectionArea(minPos, maxPos);
+	return Map.UnitCells.HasPlayersIn(minPos, maxPos, enemies);
+}
+
 /**
 **  Attack units in distance.
 **
@@ -1145,6 +1173,10 @@ bool CheckObstaclesBetweenTiles(const Vec2i &unitPos, const Vec2i &goalPos, unsi
 */
 CUnit *AttackUnitsInDistance(const CUnit &unit, int range, CUnitFilter pred)
 {
+	// Only enemies can be chosen, skip the search when there is none
+	if (!HasEnemiesInDistance(unit, std::max(range, unit.Stats->Variables[ATTACKRANGE_INDEX].Max))) {
+		return NULL;
+	}
 	// if necessary, take possible damage on allied units into account...
 	if (unit.Type->Missile.Missile->Range > 1
 		&& (range + unit.Type->Missile.Missile->Range < 15)) {
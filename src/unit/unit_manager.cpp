@@ -36,9 +36,13 @@
 #include "stratagus.h"
 
 #include "unit_manager.h"
-#include "unit.h"
+
+#include "actions.h"
 #include "iolib.h"
 #include "script.h"
+#include "spells.h"
+#include "unit.h"
+#include "unittype.h"
 
 
 /*----------------------------------------------------------------------------
@@ -51,7 +55,56 @@ CUnitManager UnitManager;          /// Unit manager
 --  Functions
 ----------------------------------------------------------------------------*/
 
-CUnitManager::CUnitManager() : lastCreated(NULL)
+void CUnitHotState::Resize(size_t size)
+{
+	Destroyed.resize(size);
+	Removed.resize(size);
+	Action.resize(size);
+	Wait.resize(size);
+	TTL.resize(size);
+	BuffsRunning.resize(size);
+}
+
+void CUnitHotState::Move(size_t from, size_t to)
+{
+	Destroyed[to] = Destroyed[from];
+	Removed[to] = Removed[from];
+	Action[to] = Action[from];
+	Wait[to] = Wait[from];
+	TTL[to] = TTL[from];
+	BuffsRunning[to] = BuffsRunning[from];
+}
+
+/**
+**  Check if HandleBuffsEachCycle changes something for the unit,
+**  apart from the time to live.
+**
+**  @param unit  Unit to check.
+*/
+static bool AreBuffsRunning(const CUnit &unit)
+{
+	if (unit.Threshold != 0 || unit.Variable == NULL) {
+		return true;
+	}
+	if (unit.Type->CanCastSpell && unit.SpellCoolDownTimers) {
+		for (size_t i = 0; i != SpellTypeTable.size(); ++i) {
+			if (unit.SpellCoolDownTimers[i] > 0) {
+				return true;
+			}
+		}
+	}
+	const int SpellEffects[] = {BLOODLUST_INDEX, HASTE_INDEX, SLOW_INDEX, INVISIBLE_INDEX, UNHOLYARMOR_INDEX, POISON_INDEX};
+	for (size_t i = 0; i != sizeof(SpellEffects) / sizeof(*SpellEffects); ++i) {
+		const CVariable &var = unit.Variable[SpellEffects[i]];
+
+		if (var.Value != 0 || var.Increase != -1 || var.Max < 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+CUnitManager::CUnitManager() : lastCreated(NULL), tableVersion(0)
 {
 }
 
@@ -63,6 +116,8 @@ void CUnitManager::Init()
 	lastCreated = NULL;
 	//Assert(units.empty());
 	units.clear();
+	hotState.Resize(0);
+	++tableVersion;
 	// Release memory of units in release list.
 	while (!releasedUnits.empty()) {
 		CUnit *unit = releasedUnits.front();
@@ -117,8 +172,11 @@ void CUnitManager::ReleaseUnit(CUnit *unit)
 		CUnit *temp = units.back();
 		temp->UnitManagerData.unitSlot = unit->UnitManagerData.unitSlot;
 		units[unit->UnitManagerData.unitSlot] = temp;
+		hotState.Move(units.size() - 1, unit->UnitManagerData.unitSlot);
 		unit->UnitManagerData.unitSlot = -1;
 		units.pop_back();
+		hotState.Resize(units.size());
+		++tableVersion;
 	}
 	releasedUnits.push_back(unit);
 	unit->ReleaseCycle = GameCycle + 500; // can be reused after this time
@@ -160,6 +218,37 @@ void CUnitManager::Add(CUnit *unit)
 	lastCreated = unit;
 	unit->UnitManagerData.unitSlot = static_cast<int>(units.size());
 	units.push_back(unit);
+	hotState.Resize(units.size());
+	// Not initialized yet, keep it handled until CUnit::Init updates it
+	hotState.Action[units.size() - 1] = UnitActionNone;
+	hotState.BuffsRunning[units.size() - 1] = 1;
+	++tableVersion;
+}
+
+/**
+**  Update the per-cycle state of a unit, after a change of one of its
+**  fields kept in CUnitHotState.
+**
+**  @param unit   Changed unit.
+**  @param buffs  Also check the buffs, false when only the cheap fields
+**                may have changed.
+*/
+void CUnitManager::UpdateHotState(const CUnit &unit, bool buffs)
+{
+	const int index = unit.UnitManagerData.unitSlot;
+
+	if (index == -1 || unit.Type == NULL) { // Released or loading
+		return;
+	}
+	Assert(units[index] == &unit);
+	hotState.Destroyed[index] = unit.Destroyed;
+	hotState.Removed[index] = unit.Removed;
+	hotState.Action[index] = unit.Orders.empty() ? UnitActionNone : unit.CurrentAction();
+	hotState.Wait[index] = unit.Wait;
+	hotState.TTL[index] = unit.TTL;
+	if (buffs) {
+		hotState.BuffsRunning[index] = AreBuffsRunning(unit);
+	}
 }
 
 /**
@@ -1048,6 +1048,28 @@ void LoadUnitTypeSprite(CUnitType &type)
 */
 void LoadUnitTypes()
 {
+#ifndef DYNAMIC_LOAD
+	std::vector<std::string> files;
+
+	for (std::vector<CUnitType *>::size_type i = 0; i < UnitTypes.size(); ++i) {
+		const CUnitType &type = *UnitTypes[i];
+
+		if (type.Sprite) {
+			continue;
+		}
+		files.push_back(type.File);
+		files.push_back(type.ShadowFile);
+		if (type.BoolFlag[HARVESTER_INDEX].value) {
+			for (int j = 0; j < MaxCosts; ++j) {
+				if (type.ResInfo[j]) {
+					files.push_back(type.ResInfo[j]->FileWhenLoaded);
+					files.push_back(type.ResInfo[j]->FileWhenEmpty);
+				}
+			}
+		}
+	}
+	PreloadGraphics(files);
+#endif
 	for (std::vector<CUnitType *>::size_type i = 0; i < UnitTypes.size(); ++i) {
 		CUnitType &type = *UnitTypes[i];
 
@@ -1074,6 +1096,7 @@ void LoadUnitTypes()
 #endif
 		// FIXME: should i copy the animations of same graphics?
 	}
+	FreePreloadedGraphics();
 }
 
 void CUnitTypeVar::Init()
@@ -52,6 +52,7 @@
 #include "script.h"
 #include "unit.h"
 #include "unit_find.h"
+#include "unit_manager.h"
 #include "unittype.h"
 #include "util.h"
 
@@ -665,6 +666,7 @@ static void ApplyUpgradeModifier(CPlayer &player, const CUpgradeModifier *um)
 							clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 						}
 					}
+					UnitManager.UpdateHotState(unit);
 				}
 			}
 			if (um->ConvertTo) {
@@ -831,6 +833,7 @@ static void RemoveUpgradeModifier(CPlayer &player, const CUpgradeModifier *um)
 
 						clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 					}
+					UnitManager.UpdateHotState(unit);
 				}
 			}
 			if (um->ConvertTo) {
@@ -875,6 +878,7 @@ void ApplyIndividualUpgradeModifier(CUnit &unit, const CUpgradeModifier *um)
 			clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 		}
 	}
+	UnitManager.UpdateHotState(unit);
 	
 	if (um->ConvertTo) {
 		CommandTransformIntoType(unit, *um->ConvertTo);
@@ -910,6 +914,7 @@ static void RemoveIndividualUpgradeModifier(CUnit &unit, const CUpgradeModifier
 			clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 		}
 	}
+	UnitManager.UpdateHotState(unit);
 }
 
 /**
@@ -226,7 +226,7 @@ static void DrawBuildingCursor()
 					  CanBuildOn(posIt, MapFogFilterFlags(*ThisPlayer, posIt,
 														  mask & ((!Selected.empty() && Selected[0]->tilePos == posIt) ?
 																  ~(MapFieldLandUnit | MapFieldSeaUnit) : -1))))
-				&& Map.Field(posIt)->playerInfo.IsExplored(*ThisPlayer)) {
+				&& Map.IsFieldExplored(*ThisPlayer, posIt)) {
 				color = ColorGreen;
 			} else {
 				color = ColorRed;
@@ -897,10 +897,20 @@ void CFont::DynamicLoad() const
 */
 void LoadFonts()
 {
+	std::vector<std::string> files;
+
+	for (FontMap::iterator it = Fonts.begin(); it != Fonts.end(); ++it) {
+		const CFont &font = *it->second;
+		if (font.GetGraphic() && !font.IsLoaded()) {
+			files.push_back(font.GetGraphic()->File);
+		}
+	}
+	PreloadGraphics(files);
 	for (FontMap::iterator it = Fonts.begin(); it != Fonts.end(); ++it) {
 		CFont &font = *it->second;
 		font.Load();
 	}
+	FreePreloadedGraphics();
 
 	// TODO: remove this
 	SmallFont = CFont::Get("small");
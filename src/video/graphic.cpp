@@ -36,9 +36,12 @@
 
 #include "stratagus.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <map>
 #include <list>
+#include <thread>
 
 #include "video.h"
 #include "player.h"
@@ -55,6 +58,18 @@ static int HashCount;
 static std::map<std::string, CGraphic *> GraphicHash;
 static std::list<CGraphic *> Graphics;
 
+static const unsigned int PreloadMaxThreads = 8; /// Max threads decoding the graphics
+
+/// Graphic files decoded by PreloadGraphics, by library path
+static std::map<std::string, SDL_Surface *> PreloadedGraphics;
+
+/// Files decoded by the preload threads
+static struct {
+	const std::vector<std::string> *Files;    /// library paths of the files
+	std::vector<SDL_Surface *> *Surfaces;     /// decoded surfaces, by file
+	std::atomic<size_t> Next;                 /// next file to decode
+} PreloadJob;
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -227,6 +242,68 @@ void CGraphic::DrawFrameClip(unsigned frame, int x, int y) const
 	}
 }
 
+#ifdef USE_OPENGL
+/**
+**  Add the quad of a clipped frame to the current GL_QUADS batch.
+**  The graphic must fit in its single texture.
+*/
+static void AddFrameQuad(const CGraphic &g, unsigned frame, int x, int y)
+{
+	int ox;
+	int oy;
+	int skip;
+	int w = g.Width;
+	int h = g.Height;
+
+	CLIP_RECTANGLE_OFS(x, y, w, h, ox, oy, skip);
+	UNUSED(skip);
+
+	const int gx = g.frame_map[frame].x + ox;
+	const int gy = g.frame_map[frame].y + oy;
+	const GLfloat tx_beg = gx * g.TextureWidth / g.GraphicWidth;
+	const GLfloat tx_end = (gx + w) * g.TextureWidth / g.GraphicWidth;
+	const GLfloat ty_beg = gy * g.TextureHeight / g.GraphicHeight;
+	const GLfloat ty_end = (gy + h) * g.TextureHeight / g.GraphicHeight;
+
+	glTexCoord2f(tx_beg, ty_beg);
+	glVertex2i(x, y);
+	glTexCoord2f(tx_beg, ty_end);
+	glVertex2i(x, y + h);
+	glTexCoord2f(tx_end, ty_end);
+	glVertex2i(x + w, y + h);
+	glTexCoord2f(tx_end, ty_beg);
+	glVertex2i(x + w, y);
+}
+#endif
+
+/**
+**  Draw many frames of the graphic clipped.
+**
+**  With OpenGL, the texture is bound once and all the frames are drawn
+**  in one batch of quads when the graphic fits in a single texture.
+**
+**  @param frames     number of the frame of each sprite
+**  @param positions  screen position of each sprite
+**  @param count      number of sprites
+*/
+void CGraphic::DrawFramesClip(const unsigned *frames, const PixelPos *positions, size_t count) const
+{
+#ifdef USE_OPENGL
+	if (UseOpenGL && NumTextures == 1) {
+		glBindTexture(GL_TEXTURE_2D, Textures[0]);
+		glBegin(GL_QUADS);
+		for (size_t i = 0; i != count; ++i) {
+			AddFrameQuad(*this, frames[i], positions[i].x, positions[i].y);
+		}
+		glEnd();
+		return;
+	}
+#endif
+	for (size_t i = 0; i != count; ++i) {
+		DrawFrameClip(frames[i], positions[i].x, positions[i].y);
+	}
+}
+
 void CGraphic::DrawFrameTrans(unsigned frame, int x, int y, int alpha) const
 {
 #if defined(USE_OPENGL) || defined(USE_GLES)
@@ -750,6 +827,112 @@ void CGraphic::Load(bool grayscale)
 	GenFramesMap();
 }
 
+/**
+**  Decode the files of the preload job until there is none left.
+*/
+static int PreloadGraphicsThread(void *)
+{
+	const std::vector<std::string> &files = *PreloadJob.Files;
+
+	for (size_t i = PreloadJob.Next++; i < files.size(); i = PreloadJob.Next++) {
+		(*PreloadJob.Surfaces)[i] = DecodeGraphicPNG(files[i]);
+	}
+	return 0;
+}
+
+/**
+**  Decode graphic files on worker threads.
+**
+**  The png decoding takes most of the load time of the graphics, so the
+**  loaders decode the files of their graphics together before loading
+**  them one by one. CGraphic::Load then takes the decoded surface and
+**  only does the palette and texture work on the main thread.
+**
+**  @param files  Files of the graphics which will be loaded.
+*/
+void PreloadGraphics(const std::vector<std::string> &files)
+{
+	std::vector<std::string> paths;
+
+	for (size_t i = 0; i != files.size(); ++i) {
+		if (files[i].empty()) {
+			continue;
+		}
+		// The paths are searched here, LibraryFileName isn't thread safe
+		const std::string path = LibraryFileName(files[i].c_str());
+		std::map<std::string, CGraphic *>::const_iterator it = GraphicHash.find(path);
+
+		if ((it != GraphicHash.end() && it->second != NULL && it->second->IsLoaded())
+			|| PreloadedGraphics.find(path) != PreloadedGraphics.end()) {
+			continue;
+		}
+		paths.push_back(path);
+	}
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+	if (paths.size() < 2) {
+		return;
+	}
+
+	std::vector<SDL_Surface *> surfaces(paths.size(), (SDL_Surface *)NULL);
+	PreloadJob.Files = &paths;
+	PreloadJob.Surfaces = &surfaces;
+	PreloadJob.Next = 0;
+
+	const unsigned int threadCount = std::min<size_t>(paths.size(),
+										 std::max(1u, std::min(PreloadMaxThreads, std::thread::hardware_concurrency())));
+	std::vector<SDL_Thread *> threads;
+	// The main thread decodes too
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		SDL_Thread *thread = SDL_CreateThread(PreloadGraphicsThread, NULL);
+		if (thread != NULL) {
+			threads.push_back(thread);
+		}
+	}
+	PreloadGraphicsThread(NULL);
+	for (size_t i = 0; i != threads.size(); ++i) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	for (size_t i = 0; i != paths.size(); ++i) {
+		// The files which can't be decoded are reported by CGraphic::Load
+		if (surfaces[i] != NULL) {
+			PreloadedGraphics[paths[i]] = surfaces[i];
+		}
+	}
+}
+
+/**
+**  Take the decoded surface of a preloaded file.
+**
+**  @param name  Library path of the file.
+**
+**  @return the surface, which belongs to the caller, or NULL.
+*/
+SDL_Surface *TakePreloadedGraphic(const std::string &name)
+{
+	std::map<std::string, SDL_Surface *>::iterator it = PreloadedGraphics.find(name);
+
+	if (it == PreloadedGraphics.end()) {
+		return NULL;
+	}
+	SDL_Surface *surface = it->second;
+	PreloadedGraphics.erase(it);
+	return surface;
+}
+
+/**
+**  Free the preloaded surfaces which have not been loaded.
+*/
+void FreePreloadedGraphics()
+{
+	for (std::map<std::string, SDL_Surface *>::iterator it = PreloadedGraphics.begin();
+		 it != PreloadedGraphics.end(); ++it) {
+		SDL_FreeSurface(it->second);
+	}
+	PreloadedGraphics.clear();
+}
+
 /**
 **  Free a SDL surface
 **
@@ -78,34 +78,30 @@ private:
 };
 
 /**
-**  Load a png graphic file.
+**  Decode a png file into a surface.
 **  Modified function from SDL_Image
 **
-**  @param g  graphic to load.
+**  It only touches the file and the new surface, so it can run on the
+**  threads of PreloadGraphics.
 **
-**  @return   0 for success, -1 for error.
+**  @param name  Library path of the file.
+**
+**  @return      the surface, NULL for error.
 */
-int LoadGraphicPNG(CGraphic *g)
+SDL_Surface *DecodeGraphicPNG(const std::string &name)
 {
-	if (g->File.empty()) {
-		return -1;
-	}
-	const std::string name = LibraryFileName(g->File.c_str());
-	if (name.empty()) {
-		return -1;
-	}
 	CFile fp;
 
 	if (fp.open(name.c_str(), CL_OPEN_READ) == -1) {
 		perror("Can't open file");
-		return -1;
+		return NULL;
 	}
 
 	// Create the PNG loading context structure
 	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (png_ptr == NULL) {
 		fprintf(stderr, "Couldn't allocate memory for PNG file");
-		return -1;
+		return NULL;
 	}
 	// Clean png_ptr on exit
 	AutoPng_read_structp pngRaii(png_ptr);
@@ -114,7 +110,7 @@ int LoadGraphicPNG(CGraphic *g)
 	png_infop info_ptr = png_create_info_struct(png_ptr);
 	if (info_ptr == NULL) {
 		fprintf(stderr, "Couldn't create image information for PNG file");
-		return -1;
+		return NULL;
 	}
 	pngRaii.setInfo(info_ptr);
 
@@ -124,7 +120,7 @@ int LoadGraphicPNG(CGraphic *g)
 	 */
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		fprintf(stderr, "Error reading the PNG file.\n");
-		return -1;
+		return NULL;
 	}
 
 	/* Set up the input control */
@@ -225,7 +221,7 @@ int LoadGraphicPNG(CGraphic *g)
 						 bit_depth * png_get_channels(png_ptr, info_ptr), Rmask, Gmask, Bmask, Amask);
 	if (surface == NULL) {
 		fprintf(stderr, "Out of memory");
-		return -1;
+		return NULL;
 	}
 
 	if (ckey != -1) {
@@ -275,11 +271,36 @@ int LoadGraphicPNG(CGraphic *g)
 		}
 	}
 
+	fp.close();
+	return surface;
+}
+
+/**
+**  Load a png graphic file.
+**
+**  @param g  graphic to load.
+**
+**  @return   0 for success, -1 for error.
+*/
+int LoadGraphicPNG(CGraphic *g)
+{
+	if (g->File.empty()) {
+		return -1;
+	}
+	const std::string name = LibraryFileName(g->File.c_str());
+	if (name.empty()) {
+		return -1;
+	}
+	SDL_Surface *surface = TakePreloadedGraphic(name);
+	if (surface == NULL) {
+		surface = DecodeGraphicPNG(name);
+	}
+	if (surface == NULL) {
+		return -1;
+	}
 	g->Surface = surface;
 	g->GraphicWidth = surface->w;
 	g->GraphicHeight = surface->h;
-
-	fp.close();
 	return 0;
 }
 
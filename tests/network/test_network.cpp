@@ -58,6 +58,11 @@ void FillCustomValue(CNetworkCommandSync *obj)
 {
 	obj->syncSeed = 0x01234567;
 	obj->syncHash = 0x89ABCDEF;
+	obj->pingTime = 0x76543210;
+	obj->echoTime = 0xFEDCBA98;
+	obj->echoDelay = 0x1357;
+	obj->echoPlayer = 3;
+	obj->lag = 42;
 }
 void FillCustomValue(CNetworkCommandQuit *obj)
 {
@@ -0,0 +1,136 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_astar_openset.cpp - The test file for astar_openset.cpp. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "astar_openset.h"
+
+#include <vector>
+
+/// Make a node of the open set
+static AStarOpenNode MakeNode(int o, int costs, int costToGoal, int dist)
+{
+	AStarOpenNode node;
+
+	node.pos = Vec2i(o, 0);
+	node.O = o;
+	node.Costs = costs;
+	node.CostToGoal = costToGoal;
+	node.Dist = dist;
+	return node;
+}
+
+/// Pop all the nodes, check their offsets
+static void CheckPopOrder(AStarOpenSet &openSet, const int *expected, int count)
+{
+	CHECK_EQUAL(count, openSet.Size());
+	for (int i = 0; i != count && openSet.Size(); ++i) {
+		CHECK_EQUAL(expected[i], openSet.PopMinimum().O);
+	}
+	CHECK_EQUAL(0, openSet.Size());
+}
+
+TEST(ASTAR_OPENSET_COSTS)
+{
+	AStarOpenSet openSet(16, 16);
+	const int costs[] = {5, 3, 8, 1, 6};
+
+	for (int i = 0; i != 5; ++i) {
+		CHECK(openSet.Push(MakeNode(i, costs[i], 0, 0)));
+	}
+	const int expected[] = {3, 1, 0, 4, 2};
+	CheckPopOrder(openSet, expected, 5);
+}
+
+TEST(ASTAR_OPENSET_COST_TO_GOAL_THEN_DIST)
+{
+	AStarOpenSet openSet(16, 16);
+
+	openSet.Push(MakeNode(0, 10, 2, 1));
+	openSet.Push(MakeNode(1, 10, 1, 3));
+	openSet.Push(MakeNode(2, 10, 1, 2));
+	openSet.Push(MakeNode(3, 10, 0, 5));
+	const int expected[] = {3, 2, 1, 0};
+	CheckPopOrder(openSet, expected, 4);
+}
+
+TEST(ASTAR_OPENSET_EQUAL_NODES)
+{
+	// The binary search of the array sorted by decreasing costs inserts
+	// the equal nodes 0 to 5 as 1 3 5 4 2 0, the end is popped first.
+	AStarOpenSet openSet(16, 16);
+
+	for (int i = 0; i != 6; ++i) {
+		openSet.Push(MakeNode(i, 4, 0, 0));
+	}
+	std::vector<AStarOpenNode> nodes;
+	openSet.GetNodes(nodes);
+	const int order[] = {1, 3, 5, 4, 2, 0};
+	CHECK_EQUAL(6u, nodes.size());
+	for (size_t i = 0; i != nodes.size(); ++i) {
+		CHECK_EQUAL(order[i], nodes[i].O);
+	}
+	const int expected[] = {0, 2, 4, 5, 3, 1};
+	CheckPopOrder(openSet, expected, 6);
+}
+
+TEST(ASTAR_OPENSET_REQUEUE)
+{
+	AStarOpenSet openSet(16, 16);
+
+	for (int i = 0; i != 6; ++i) {
+		openSet.Push(MakeNode(i, 4, 0, 0));
+	}
+	openSet.Push(MakeNode(6, 9, 0, 0));
+	CHECK(openSet.Contains(1));
+	openSet.Requeue(1);
+	CHECK(openSet.Contains(1));
+	const int expected[] = {0, 2, 4, 1, 5, 3, 6};
+	CheckPopOrder(openSet, expected, 7);
+	CHECK(!openSet.Contains(1));
+}
+
+TEST(ASTAR_OPENSET_CLEAR_AND_FULL)
+{
+	AStarOpenSet openSet(16, 4);
+
+	CHECK(openSet.Push(MakeNode(0, 7, 0, 0)));
+	CHECK(openSet.Push(MakeNode(1, 2, 0, 0)));
+	CHECK(openSet.Push(MakeNode(2, 5, 0, 0)));
+	CHECK(!openSet.Push(MakeNode(3, 1, 0, 0)));
+	CHECK(!openSet.Contains(3));
+	openSet.Clear();
+	CHECK_EQUAL(0, openSet.Size());
+	CHECK(!openSet.Contains(0));
+	CHECK(!openSet.Contains(1));
+
+	openSet.Push(MakeNode(3, 6, 0, 0));
+	openSet.Push(MakeNode(0, 3, 0, 0));
+	const int expected[] = {0, 3};
+	CheckPopOrder(openSet, expected, 2);
+}
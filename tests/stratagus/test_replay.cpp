@@ -0,0 +1,155 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_replay.cpp - The test file for replay.cpp. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "replay_format.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// Make a command of the replay
+static LogEntry MakeCommand(unsigned long gameCycle, const char *action, int unitNumber)
+{
+	LogEntry log;
+
+	log.GameCycle = gameCycle;
+	log.Action = action;
+	log.UnitNumber = unitNumber;
+	log.UnitIdent = unitNumber != -1 ? "unit-footman" : "";
+	log.PosX = 12;
+	log.PosY = -1;
+	log.DestUnitNumber = -1;
+	log.Num = -1;
+	log.SyncRandSeed = 0x89ABCDEF + gameCycle;
+	return log;
+}
+
+/// Write a replay with two keyframes, the file stays open
+static void WriteTestReplay(CReplayWriter &writer, const char *filename, std::vector<unsigned char> (&savegames)[2])
+{
+	FullReplay replay;
+
+	replay.Map = "test map";
+	replay.LocalPlayer = 1;
+	replay.Players[1].Name = "player";
+	replay.PathfinderPrefetch = true;
+	replay.PathCache = true;
+	savegames[0].assign(100, 'a');
+	savegames[1].assign(200, 'b');
+
+	CHECK(writer.Open(filename));
+	writer.WriteHeader(replay);
+	writer.WriteCommand(MakeCommand(10, "move", 3));
+	writer.WriteKeyframe(100, savegames[0]);
+	writer.WriteCommand(MakeCommand(150, "attack", 3));
+	writer.WriteKeyframe(200, savegames[1]);
+	writer.WriteCommand(MakeCommand(250, "quit", -1));
+	writer.Flush();
+}
+
+/// Read the replay and check its commands, keyframes and seeks
+static void CheckTestReplay(const char *filename, const std::vector<unsigned char> (&savegames)[2])
+{
+	std::vector<unsigned char> data;
+	CHECK(ReadReplayFile(filename, data));
+	FullReplay *replay = ParseBinaryReplay(filename, data);
+	CHECK(replay != NULL);
+	if (replay == NULL) {
+		return;
+	}
+	CHECK_EQUAL("test map", replay->Map);
+	CHECK_EQUAL(1, replay->LocalPlayer);
+	CHECK_EQUAL("player", replay->Players[1].Name);
+	CHECK(replay->PathfinderPrefetch);
+	CHECK(replay->PathCache);
+
+	const LogEntry *log = replay->Commands;
+	const unsigned long cycles[] = {10, 150, 250};
+	const char *actions[] = {"move", "attack", "quit"};
+	for (int i = 0; i != 3; ++i) {
+		CHECK(log != NULL);
+		if (log == NULL) {
+			break;
+		}
+		CHECK_EQUAL(cycles[i], log->GameCycle);
+		CHECK_EQUAL(actions[i], log->Action);
+		CHECK_EQUAL(i == 2 ? -1 : 3, log->UnitNumber);
+		CHECK_EQUAL(12, log->PosX);
+		CHECK_EQUAL(-1, log->PosY);
+		CHECK_EQUAL(0x89ABCDEF + cycles[i], log->SyncRandSeed);
+		log = log->Next;
+	}
+	CHECK(log == NULL);
+
+	CHECK_EQUAL(2u, replay->Keyframes.size());
+	CHECK(FindReplayKeyframe(*replay, 99) == NULL);
+	const unsigned long seeks[] = {100, 199, 200, 1000};
+	for (int i = 0; i != 4; ++i) {
+		const ReplayKeyframe *keyframe = FindReplayKeyframe(*replay, seeks[i]);
+		const int expected = seeks[i] < 200 ? 0 : 1;
+
+		CHECK(keyframe != NULL);
+		if (keyframe == NULL) {
+			continue;
+		}
+		CHECK_EQUAL(expected ? 200ul : 100ul, keyframe->GameCycle);
+		CHECK_EQUAL(savegames[expected].size(), keyframe->Size);
+		CHECK(keyframe->Offset + keyframe->Size <= data.size());
+		CHECK(std::vector<unsigned char>(data.begin() + keyframe->Offset,
+										 data.begin() + keyframe->Offset + keyframe->Size) == savegames[expected]);
+	}
+	DeleteReplay(replay);
+}
+
+TEST(REPLAY_KEYFRAMES)
+{
+	const char *filename = "test_replay.log";
+	std::vector<unsigned char> savegames[2];
+	CReplayWriter writer;
+
+	WriteTestReplay(writer, filename, savegames);
+	writer.Close();
+	CheckTestReplay(filename, savegames);
+	remove(filename);
+}
+
+TEST(REPLAY_KEYFRAMES_WITHOUT_INDEX)
+{
+	// The log of a crashed game has no index, the keyframes are found in the records
+	const char *filename = "test_replay_crashed.log";
+	std::vector<unsigned char> savegames[2];
+	CReplayWriter writer;
+
+	WriteTestReplay(writer, filename, savegames);
+	CheckTestReplay(filename, savegames);
+	writer.Close();
+	remove(filename);
+}
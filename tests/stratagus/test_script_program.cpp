@@ -0,0 +1,202 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_script_program.cpp - The test file for script_program.cpp. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "script_program.h"
+#include "util.h"
+
+#include <string>
+
+/// Unit of the unit descriptions, there is none
+static CUnit *NoUnit = NULL;
+
+/// Seed of the generator of the descriptions, apart from the synced random
+static unsigned GenSeed = 0x1234;
+
+/// Random number in [0..max-1] to generate the descriptions
+static int GenRand(int max)
+{
+	GenSeed = GenSeed * 1103515245 + 12345;
+	return (GenSeed >> 16) % max;
+}
+
+static StringDesc *GenerateString(int depth);
+
+/// Generate a number description, its leaves are small so nothing overflows up to depth 3
+static NumberDesc *GenerateNumber(int depth)
+{
+	NumberDesc *number = new NumberDesc();
+
+	switch (depth > 0 ? GenRand(9) : GenRand(2)) {
+		case 0:
+			number->e = ENumber_Dir;
+			number->D.Val = GenRand(19) - 9;
+			break;
+		case 1: // Not constant, there is no unit so its value is 0
+			number->e = ENumber_UnitStat;
+			number->D.UnitStat.Unit = new UnitDesc;
+			number->D.UnitStat.Unit->e = EUnit_Ref;
+			number->D.UnitStat.Unit->D.AUnit = &NoUnit;
+			number->D.UnitStat.Index = 0;
+			number->D.UnitStat.Component = VariableValue;
+			number->D.UnitStat.Loc = 0;
+			break;
+		case 2:
+		case 3:
+		case 4: {
+			const ENumber binOps[] = {ENumber_Add, ENumber_Sub, ENumber_Mul, ENumber_Div,
+									  ENumber_Min, ENumber_Max, ENumber_Gt, ENumber_GtEq,
+									  ENumber_Lt, ENumber_LtEq, ENumber_Eq, ENumber_NEq
+									 };
+			number->e = binOps[GenRand(sizeof(binOps) / sizeof(*binOps))];
+			number->D.binOp.Left = GenerateNumber(depth - 1);
+			number->D.binOp.Right = GenerateNumber(depth - 1);
+			break;
+		}
+		case 5: // Rand of a positive number
+			number->e = ENumber_Rand;
+			number->D.N = new NumberDesc();
+			number->D.N->e = ENumber_Max;
+			number->D.N->D.binOp.Left = GenerateNumber(depth - 1);
+			number->D.N->D.binOp.Right = new NumberDesc();
+			number->D.N->D.binOp.Right->e = ENumber_Dir;
+			number->D.N->D.binOp.Right->D.Val = 1;
+			break;
+		case 6:
+		case 7:
+			number->e = ENumber_NumIf;
+			number->D.NumIf.Cond = GenerateNumber(depth - 1);
+			number->D.NumIf.BTrue = GenerateNumber(depth - 1);
+			number->D.NumIf.BFalse = GenRand(4) ? GenerateNumber(depth - 1) : NULL;
+			break;
+		case 8:
+			number->e = ENumber_StringFind;
+			number->D.StringFind.String = GenerateString(depth - 1);
+			number->D.StringFind.C = "ab~-"[GenRand(4)];
+			break;
+	}
+	return number;
+}
+
+/// Generate a string description
+static StringDesc *GenerateString(int depth)
+{
+	StringDesc *s = new StringDesc();
+
+	switch (depth > 0 ? GenRand(7) : GenRand(2)) {
+		case 0: {
+			const char *texts[] = {"", "a", "ab", "-b-", "~<a~>"};
+			s->e = EString_Dir;
+			s->D.Val = new_strdup(texts[GenRand(sizeof(texts) / sizeof(*texts))]);
+			break;
+		}
+		case 1: // Not constant, there is no unit so it is empty
+			s->e = EString_UnitName;
+			s->D.Unit = new UnitDesc;
+			s->D.Unit->e = EUnit_Ref;
+			s->D.Unit->D.AUnit = &NoUnit;
+			break;
+		case 2:
+			s->e = EString_Concat;
+			s->D.Concat.n = 1 + GenRand(4);
+			s->D.Concat.Strings = new StringDesc *[s->D.Concat.n];
+			for (int i = 0; i != s->D.Concat.n; ++i) {
+				s->D.Concat.Strings[i] = GenerateString(depth - 1);
+			}
+			break;
+		case 3:
+			s->e = EString_String;
+			s->D.Number = GenerateNumber(depth - 1);
+			break;
+		case 4:
+			s->e = EString_InverseVideo;
+			s->D.String = GenerateString(depth - 1);
+			break;
+		case 5:
+			s->e = EString_If;
+			s->D.If.Cond = GenerateNumber(depth - 1);
+			s->D.If.BTrue = GenerateString(depth - 1);
+			s->D.If.BFalse = GenRand(4) ? GenerateString(depth - 1) : NULL;
+			break;
+		case 6: // The begin of a substring can't be negative
+			s->e = EString_SubString;
+			s->D.SubString.String = GenerateString(depth - 1);
+			s->D.SubString.Begin = new NumberDesc();
+			s->D.SubString.Begin->e = ENumber_Max;
+			s->D.SubString.Begin->D.binOp.Left = GenerateNumber(depth - 1);
+			s->D.SubString.Begin->D.binOp.Right = new NumberDesc();
+			s->D.SubString.Begin->D.binOp.Right->e = ENumber_Dir;
+			s->D.SubString.Begin->D.binOp.Right->D.Val = 0;
+			s->D.SubString.End = GenRand(2) ? GenerateNumber(depth - 1) : NULL;
+			break;
+	}
+	return s;
+}
+
+TEST(SCRIPT_PROGRAM_NUMBERS)
+{
+	for (int i = 0; i != 2000; ++i) {
+		NumberDesc *number = GenerateNumber(1 + i % 3);
+
+		SyncRandSeed = 0x87654321 + i;
+		const int expected = EvalNumberTree(number);
+		const unsigned expectedSeed = SyncRandSeed;
+
+		// Twice, the second run reuses the stacks of the program
+		for (int j = 0; j != 2; ++j) {
+			SyncRandSeed = 0x87654321 + i;
+			CHECK_EQUAL(expected, EvalNumber(number));
+			CHECK_EQUAL(expectedSeed, SyncRandSeed);
+		}
+		CHECK(number->Program != NULL);
+		FreeNumberDesc(number);
+		delete number;
+	}
+}
+
+TEST(SCRIPT_PROGRAM_STRINGS)
+{
+	for (int i = 0; i != 2000; ++i) {
+		StringDesc *s = GenerateString(1 + i % 3);
+
+		SyncRandSeed = 0x12345678 + i;
+		const std::string expected = EvalStringTree(s);
+		const unsigned expectedSeed = SyncRandSeed;
+
+		for (int j = 0; j != 2; ++j) {
+			SyncRandSeed = 0x12345678 + i;
+			CHECK_EQUAL(expected, EvalString(s));
+			CHECK_EQUAL(expectedSeed, SyncRandSeed);
+		}
+		CHECK(s->Program != NULL);
+		FreeStringDesc(s);
+		delete s;
+	}
+}
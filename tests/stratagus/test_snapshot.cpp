@@ -0,0 +1,198 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_snapshot.cpp - The test file for snapshot.cpp. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "snapshot.h"
+
+#include "iolib.h"
+#include "map.h"
+#include "script.h"
+#include "tileset.h"
+
+#include <stdio.h>
+#include <string>
+
+TEST(SNAPSHOT_SECTIONS)
+{
+	std::string data;
+	CFile file;
+
+	file.openBuffer(data);
+	CSnapshotWriter writer(file);
+	CHECK(writer.WriteHeader());
+	CHECK(writer.WriteSection(SNAPSHOT_SECTION_LUA, std::string("GameCycle = 42\n")));
+	CHECK(writer.WriteSection(SNAPSHOT_SECTION_MAP_FIELDS, std::string()));
+	file.close();
+
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(data.data());
+	CHECK(CSnapshotReader::IsSnapshot(p, data.size()));
+	CSnapshotReader reader(p, data.size());
+	CHECK_EQUAL(SnapshotVersion, reader.GetVersion());
+	CHECK(reader.NextSection());
+	CHECK(reader.IsSection(SNAPSHOT_SECTION_LUA));
+	CHECK_EQUAL(std::string("GameCycle = 42\n"),
+				std::string(reinterpret_cast<const char *>(reader.GetSectionData()), reader.GetSectionSize()));
+	CHECK(reader.NextSection());
+	CHECK(reader.IsSection(SNAPSHOT_SECTION_MAP_FIELDS));
+	CHECK_EQUAL(0u, reader.GetSectionSize());
+	CHECK(!reader.NextSection());
+	CHECK(reader.IsAtEnd());
+
+	// A truncated snapshot is detected
+	CSnapshotReader truncated(p, data.size() - 3);
+	CHECK(truncated.NextSection());
+	CHECK(!truncated.NextSection());
+	CHECK(!truncated.IsAtEnd());
+
+	CHECK(!CSnapshotReader::IsSnapshot(reinterpret_cast<const unsigned char *>("Load(\"x\")"), 9));
+}
+
+/// Hash of the saved state of the map fields, the way SyncHash mixes numbers
+static unsigned int MapFieldsHash()
+{
+	const unsigned int fieldCount = Map.Info.MapWidth * Map.Info.MapHeight;
+	unsigned int hash = 0;
+
+	for (unsigned int i = 0; i != fieldCount; ++i) {
+		const CMapField &mf = *Map.Field(i);
+		const unsigned int values[] = {mf.getGraphicTile(), mf.playerInfo.SeenTile, mf.getFlag(), mf.Value, mf.getCost()};
+
+		for (size_t j = 0; j != sizeof(values) / sizeof(*values); ++j) {
+			hash = (hash << 5) | (hash >> 27);
+			hash ^= values[j];
+		}
+		for (int player = 0; player != PlayerMax; ++player) {
+			hash = (hash << 1) | (hash >> 31);
+			hash ^= Map.Visibility.Get(player, i) == 1;
+		}
+	}
+	return hash;
+}
+
+/// Create the fields of the map, without tileset
+static void CreateMapFields(int width, int height)
+{
+	delete[] Map.Fields;
+	Map.Info.MapWidth = width;
+	Map.Info.MapHeight = height;
+	Map.Fields = new CMapField[width * height];
+	Map.Visibility.Create(width * height);
+}
+
+/// Create the fields of the map, filled with pseudo random values
+static void FillMapFields(int width, int height)
+{
+	unsigned int seed = 42;
+
+	CreateMapFields(width, height);
+	for (int i = 0; i != width * height; ++i) {
+		CMapField &mf = *Map.Field(i);
+
+		seed = seed * 1103515245 + 12345;
+		mf.setGraphicTile((seed >> 8) & 0x3FF);
+		mf.playerInfo.SeenTile = (seed >> 4) & 0x3FF;
+		mf.Flags = (seed >> 16) & (MapFieldLandAllowed | MapFieldWaterAllowed | MapFieldForest | MapFieldLandUnit);
+		mf.Value = seed >> 24;
+		Map.Visibility.Plane((seed >> 12) % PlayerMax)[i] = 1;
+	}
+}
+
+TEST(SNAPSHOT_MAP_FIELDS)
+{
+	const int width = 256;
+	const int height = 256;
+
+	FillMapFields(width, height);
+	Map.Visibility.Plane(0)[7] = 3; // seen by units, saved unexplored
+	Map.Visibility.Plane(0)[8] = 1;
+	const unsigned int hash = MapFieldsHash();
+
+	std::string section;
+	Map.SaveFieldsSnapshot(section);
+
+	CreateMapFields(width, height);
+	CHECK(Map.LoadFieldsSnapshot(reinterpret_cast<const unsigned char *>(section.data()), section.size()));
+	CHECK_EQUAL(hash, MapFieldsHash());
+	CHECK_EQUAL(0, Map.Visibility.Get(0, 7));
+	CHECK_EQUAL(1, Map.Visibility.Get(0, 8));
+
+	// The section must fit the map created by the lua section
+	CreateMapFields(width, height / 2);
+	CHECK(!Map.LoadFieldsSnapshot(reinterpret_cast<const unsigned char *>(section.data()), section.size()));
+	CreateMapFields(width, height);
+	CHECK(!Map.LoadFieldsSnapshot(reinterpret_cast<const unsigned char *>(section.data()), section.size() - 1));
+
+	delete[] Map.Fields;
+	Map.Fields = NULL;
+	Map.Visibility.Clean();
+}
+
+TEST(SNAPSHOT_FILE)
+{
+	const int width = 128;
+	const int height = 64;
+	const std::string script("SavedGameInfo({\n  SyncHash = 12345, \n} )\n");
+	const char *filename = "test_snapshot.sav";
+
+	FillMapFields(width, height);
+	const unsigned int hash = MapFieldsHash();
+	std::string fields;
+	Map.SaveFieldsSnapshot(fields);
+
+	// Written and read back like SaveGame and LoadGame do
+	CFile file;
+	CHECK(file.open(filename, CL_WRITE_GZ | CL_OPEN_WRITE) != -1);
+	CSnapshotWriter writer(file);
+	CHECK(writer.WriteHeader());
+	CHECK(writer.WriteSection(SNAPSHOT_SECTION_LUA, script));
+	CHECK(writer.WriteSection(SNAPSHOT_SECTION_MAP_FIELDS, fields));
+	file.close();
+
+	std::string content;
+	CHECK(GetFileContent(filename, content));
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(content.data());
+	CHECK(CSnapshotReader::IsSnapshot(p, content.size()));
+	CSnapshotReader reader(p, content.size());
+	CHECK(reader.NextSection());
+	CHECK(reader.IsSection(SNAPSHOT_SECTION_LUA));
+	CHECK_EQUAL(script, std::string(reinterpret_cast<const char *>(reader.GetSectionData()), reader.GetSectionSize()));
+	CHECK(reader.NextSection());
+	CHECK(reader.IsSection(SNAPSHOT_SECTION_MAP_FIELDS));
+	CreateMapFields(width, height);
+	CHECK(Map.LoadFieldsSnapshot(reader.GetSectionData(), reader.GetSectionSize()));
+	CHECK_EQUAL(hash, MapFieldsHash());
+	CHECK(!reader.NextSection());
+	CHECK(reader.IsAtEnd());
+
+	remove(filename);
+	remove((std::string(filename) + ".gz").c_str());
+	delete[] Map.Fields;
+	Map.Fields = NULL;
+	Map.Visibility.Clean();
+}
@@ -0,0 +1,168 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_unit_cache.cpp - The test file for unit_cache.cpp. */
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "unit_cache.h"
+
+#include "map.h"
+#include "player.h"
+#include "unit.h"
+#include "unit_find.h"
+#include "unittype.h"
+
+#include <vector>
+
+TEST(UNIT_CELL_GRID_ADD_SUB)
+{
+	CUnitCellGrid grid;
+
+	grid.Create(20, 12);
+	CHECK(grid.IsEmptyAt(Vec2i(0, 0)));
+	grid.Add(Vec2i(9, 3), 2);
+	grid.Add(Vec2i(10, 4), 2);
+	grid.Add(Vec2i(19, 11), 5);
+	CHECK_EQUAL(1u << 2, grid.PlayersAt(Vec2i(8, 0)));
+	CHECK_EQUAL(1u << 2, grid.PlayersAt(Vec2i(15, 7)));
+	CHECK_EQUAL(1u << 5, grid.PlayersAt(Vec2i(16, 8)));
+	CHECK(grid.IsEmptyAt(Vec2i(7, 7)));
+
+	grid.Sub(Vec2i(9, 3), 2);
+	CHECK_EQUAL(1u << 2, grid.PlayersAt(Vec2i(8, 0)));
+	grid.Sub(Vec2i(10, 4), 2);
+	CHECK(grid.IsEmptyAt(Vec2i(8, 0)));
+}
+
+TEST(UNIT_CELL_GRID_HAS_PLAYERS_IN)
+{
+	CUnitCellGrid grid;
+
+	CHECK(!grid.HasPlayersIn(Vec2i(0, 0), Vec2i(7, 7), ~0u));
+	grid.Create(64, 64);
+	grid.Add(Vec2i(40, 20), 1);
+	grid.Add(Vec2i(41, 20), 3);
+	CHECK(grid.HasPlayersIn(Vec2i(30, 10), Vec2i(45, 25), 1 << 1));
+	CHECK(grid.HasPlayersIn(Vec2i(30, 10), Vec2i(45, 25), (1 << 0) | (1 << 3)));
+	CHECK(!grid.HasPlayersIn(Vec2i(30, 10), Vec2i(45, 25), 1 << 2));
+	CHECK(!grid.HasPlayersIn(Vec2i(0, 0), Vec2i(31, 63), ~0u));
+	CHECK(!grid.HasPlayersIn(Vec2i(48, 0), Vec2i(63, 63), ~0u));
+	grid.Clear();
+	CHECK(!grid.HasPlayersIn(Vec2i(0, 0), Vec2i(63, 63), ~0u));
+}
+
+/// Create the fields and the cell grid of the map, without tileset
+static void CreateMap(int width, int height)
+{
+	delete[] Map.Fields;
+	Map.Info.MapWidth = width;
+	Map.Info.MapHeight = height;
+	Map.Fields = new CMapField[width * height];
+	Map.UnitCells.Create(width, height);
+}
+
+/// Place a unit in the unit caches of the map
+static void InsertUnit(CUnit &unit, CUnitType &type, int player, const Vec2i &pos)
+{
+	unit.Type = &type;
+	unit.Player = &Players[player];
+	unit.tilePos = pos;
+	unit.Offset = Map.getIndex(pos);
+	unit.Removed = 0;
+	unit.CacheLock = 0;
+	Map.Insert(unit);
+}
+
+/// Select the units of an area, check them in the order of their first tile
+static void CheckSelect(const Vec2i &ltPos, const Vec2i &rbPos, CUnit *const *expected, size_t count)
+{
+	std::vector<CUnit *> units;
+
+	Select(ltPos, rbPos, units);
+	CHECK_EQUAL(count, units.size());
+	for (size_t i = 0; i != count && i != units.size(); ++i) {
+		CHECK_EQUAL(expected[i], units[i]);
+	}
+}
+
+TEST(UNIT_CACHE_INSERT_REMOVE_SELECT)
+{
+	CUnitType footmanType;
+	CUnitType farmType;
+	CUnit footman;
+	CUnit farm;
+	CUnit enemy;
+
+	// 3x2 cells of 8x8 tiles
+	CreateMap(24, 16);
+	for (int i = 0; i != PlayerMax; ++i) {
+		Players[i].Index = i;
+	}
+	footmanType.TileWidth = footmanType.TileHeight = 1;
+	farmType.TileWidth = farmType.TileHeight = 2;
+	InsertUnit(footman, footmanType, 0, Vec2i(2, 2));
+	InsertUnit(farm, farmType, 1, Vec2i(7, 1)); // on the first two cells
+	InsertUnit(enemy, footmanType, 1, Vec2i(20, 12));
+
+	CHECK_EQUAL((1u << 0) | (1u << 1), Map.UnitCells.PlayersAt(Vec2i(0, 0)));
+	CHECK_EQUAL(1u << 1, Map.UnitCells.PlayersAt(Vec2i(8, 2)));
+	CHECK_EQUAL(1u << 1, Map.UnitCells.PlayersAt(Vec2i(16, 8)));
+	CHECK(Map.UnitCells.IsEmptyAt(Vec2i(0, 8)));
+
+	CUnit *const all[] = {&farm, &footman, &enemy};
+	CheckSelect(Vec2i(0, 0), Vec2i(23, 15), all, 3);
+	CUnit *const firstCell[] = {&farm, &footman};
+	CheckSelect(Vec2i(0, 0), Vec2i(7, 7), firstCell, 2);
+	CUnit *const secondCell[] = {&farm};
+	CheckSelect(Vec2i(8, 0), Vec2i(15, 7), secondCell, 1);
+	CheckSelect(Vec2i(0, 8), Vec2i(15, 15), NULL, 0);
+	// Clipped to the map
+	CUnit *const corner[] = {&enemy};
+	CheckSelect(Vec2i(18, 10), Vec2i(30, 20), corner, 1);
+
+	std::vector<CUnit *> units;
+	SelectFixed(Vec2i(0, 0), Vec2i(23, 15), units, HasSamePlayerAs(Players[1]));
+	CHECK_EQUAL(2u, units.size());
+	CHECK(units.size() == 2 && units[0] == &farm && units[1] == &enemy);
+	CHECK_EQUAL(&enemy, FindUnit_If(Vec2i(16, 0), Vec2i(23, 15), HasSamePlayerAs(Players[1])));
+	CHECK(FindUnit_If(Vec2i(8, 0), Vec2i(23, 15), HasSamePlayerAs(Players[0])) == NULL);
+
+	Map.Remove(farm);
+	farm.Removed = 1;
+	CHECK_EQUAL(1u << 0, Map.UnitCells.PlayersAt(Vec2i(0, 0)));
+	CHECK(Map.UnitCells.IsEmptyAt(Vec2i(8, 0)));
+	CUnit *const afterRemove[] = {&footman, &enemy};
+	CheckSelect(Vec2i(0, 0), Vec2i(23, 15), afterRemove, 2);
+	CheckSelect(Vec2i(8, 0), Vec2i(15, 7), NULL, 0);
+
+	Map.Remove(footman);
+	Map.Remove(enemy);
+	CheckSelect(Vec2i(0, 0), Vec2i(23, 15), NULL, 0);
+	delete[] Map.Fields;
+	Map.Fields = NULL;
+	Map.UnitCells.Clear();
+}